@@ -186,6 +186,7 @@ typedef struct bio_dgram_data_st {
     OSSL_TIME socket_timeout;
     unsigned int peekmode;
     char local_addr_enabled;
+    unsigned int segmentation; /* BIO_DGRAM_SEGMENT_* */
 } bio_dgram_data;
 #endif
 
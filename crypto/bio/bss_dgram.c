@@ -146,6 +146,24 @@
 #endif
 #endif
 
+/*
+ * UDP segmentation offload for sending (UDP_SEGMENT) is Linux specific and
+ * only worthwhile together with sendmmsg.
+ */
+#if M_METHOD == M_METHOD_RECVMMSG && defined(OPENSSL_SYS_LINUX)
+#include <netinet/udp.h>
+#if !defined(UDP_SEGMENT)
+#define UDP_SEGMENT 103
+#endif
+#define SUPPORT_SEGMENTATION
+/* Kernel limits on the number of segments and size of a segmented send. */
+#define BIO_MAX_SEGMENTS 64
+#define BIO_MAX_SEGMENTED_LEN 65000
+#define BIO_CMSG_SEGMENT_LEN CMSG_SPACE(sizeof(uint16_t))
+#else
+#define BIO_CMSG_SEGMENT_LEN 0
+#endif
+
 #define BIO_MSG_N(array, stride, n) (*(BIO_MSG *)((char *)(array) + (n) * (stride)))
 
 static int dgram_write(BIO *h, const char *buf, int num);
@@ -545,6 +563,37 @@ static int enable_local_addr(BIO *b, int enable)
 }
 #endif
 
+#if defined(SUPPORT_SEGMENTATION)
+/* Determines which segmentation offloads the kernel supports on the socket. */
+static unsigned int dgram_get_segmentation_cap(BIO *b)
+{
+    unsigned int caps = 0;
+    int val;
+    socklen_t len;
+
+    if (!b->init)
+        return 0;
+
+    len = sizeof(val);
+    if (getsockopt(b->num, IPPROTO_UDP, UDP_SEGMENT, (void *)&val, &len) == 0)
+        caps |= BIO_DGRAM_SEGMENT_TX;
+
+    return caps;
+}
+
+static int dgram_set_segmentation(BIO *b, unsigned int segmentation)
+{
+    bio_dgram_data *data = (bio_dgram_data *)b->ptr;
+
+    /* Segmentation is requested per send call, so there is no socket state */
+    if ((segmentation & ~dgram_get_segmentation_cap(b)) != 0)
+        return 0;
+
+    data->segmentation = segmentation;
+    return 1;
+}
+#endif
+
 static long dgram_ctrl(BIO *b, int cmd, long num, void *ptr)
 {
     long ret = 1;
@@ -589,6 +638,14 @@ static long dgram_ctrl(BIO *b, int cmd, long num, void *ptr)
             if (enable_local_addr(b, 1) < 1)
                 data->local_addr_enabled = 0;
         }
+#endif
+#if defined(SUPPORT_SEGMENTATION)
+        if (data->segmentation != 0) {
+            unsigned int segmentation = data->segmentation;
+
+            data->segmentation = 0;
+            dgram_set_segmentation(b, segmentation);
+        }
 #endif
         break;
     case BIO_C_GET_FD:
@@ -1007,6 +1064,26 @@ static long dgram_ctrl(BIO *b, int cmd, long num, void *ptr)
         *(int *)ptr = data->local_addr_enabled;
         break;
 
+    case BIO_CTRL_DGRAM_GET_SEGMENTATION_CAP:
+#if defined(SUPPORT_SEGMENTATION)
+        ret = (long)dgram_get_segmentation_cap(b);
+#else
+        ret = 0;
+#endif
+        break;
+
+    case BIO_CTRL_DGRAM_GET_SEGMENTATION:
+        ret = (long)data->segmentation;
+        break;
+
+    case BIO_CTRL_DGRAM_SET_SEGMENTATION:
+#if defined(SUPPORT_SEGMENTATION)
+        ret = dgram_set_segmentation(b, (unsigned int)num);
+#else
+        ret = num == 0;
+#endif
+        break;
+
     case BIO_CTRL_DGRAM_GET_EFFECTIVE_CAPS:
         ret = (long)(BIO_DGRAM_CAP_HANDLES_DST_ADDR
             | BIO_DGRAM_CAP_HANDLES_SRC_ADDR
@@ -1307,6 +1384,78 @@ static int pack_local(BIO *b, MSGHDR_TYPE *mh, const BIO_ADDR *local)
 }
 #endif
 
+#if defined(SUPPORT_SEGMENTATION)
+static int dgram_addr_eq(const BIO_ADDR *a, const BIO_ADDR *b)
+{
+    if (a == b)
+        return 1;
+    if (a == NULL || b == NULL)
+        return 0;
+
+    return BIO_ADDR_family(a) == BIO_ADDR_family(b)
+        && BIO_ADDR_sockaddr_size(a) == BIO_ADDR_sockaddr_size(b)
+        && memcmp(BIO_ADDR_sockaddr(a), BIO_ADDR_sockaddr(b),
+               BIO_ADDR_sockaddr_size(a))
+        == 0;
+}
+
+/*
+ * Extends the msghdr translated from message |first| with the messages
+ * directly following it which go to the same destination, so that the kernel
+ * sends them all as a UDP_SEGMENT train. All datagrams but the last must be of
+ * the same size, and the last must not be larger. Returns the number of
+ * messages the msghdr now carries.
+ */
+static size_t coalesce_msgs(BIO *b, struct msghdr *mh, unsigned char *control,
+    BIO_MSG *msg, size_t stride, size_t first, size_t num_msg)
+{
+    bio_dgram_data *data = (bio_dgram_data *)b->ptr;
+    const BIO_MSG *m0 = &BIO_MSG_N(msg, stride, first), *m;
+    size_t seg_len = m0->data_len, total = seg_len, n = 1;
+    struct cmsghdr *cmsg;
+    uint16_t val;
+
+    if (seg_len == 0 || seg_len > UINT16_MAX)
+        return 1;
+
+    while (first + n < num_msg && n < BIO_MAX_SEGMENTS) {
+        m = &BIO_MSG_N(msg, stride, first + n);
+        if (m->data_len == 0 || m->data_len > seg_len
+            || total + m->data_len > BIO_MAX_SEGMENTED_LEN
+            || (!data->connected && !dgram_addr_eq(m->peer, m0->peer))
+            || !dgram_addr_eq(m->local, m0->local))
+            break;
+
+        mh->msg_iov[n].iov_base = m->data;
+        mh->msg_iov[n].iov_len = m->data_len;
+        total += m->data_len;
+        ++n;
+
+        if (m->data_len < seg_len)
+            break;
+    }
+
+    if (n == 1)
+        return 1;
+
+    mh->msg_iovlen = n;
+    if (mh->msg_control == NULL) {
+        mh->msg_control = control;
+        mh->msg_controllen = 0;
+    }
+
+    cmsg = (struct cmsghdr *)((unsigned char *)mh->msg_control
+        + mh->msg_controllen);
+    cmsg->cmsg_len = CMSG_LEN(sizeof(val));
+    cmsg->cmsg_level = IPPROTO_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    val = (uint16_t)seg_len;
+    memcpy(CMSG_DATA(cmsg), &val, sizeof(val));
+    mh->msg_controllen += CMSG_SPACE(sizeof(val));
+    return n;
+}
+#endif
+
 /*
  * Converts flags passed to BIO_sendmmsg or BIO_recvmmsg to syscall flags. You
  * should mask out any system flags returned by this function you cannot support
@@ -1329,10 +1478,13 @@ static int dgram_sendmmsg(BIO *b, BIO_MSG *msg, size_t stride,
 #define BIO_MAX_MSGS_PER_CALL 64
     int sysflags;
     bio_dgram_data *data = (bio_dgram_data *)b->ptr;
-    size_t i;
+    size_t i, j, n, num_mh;
     struct mmsghdr mh[BIO_MAX_MSGS_PER_CALL];
     struct iovec iov[BIO_MAX_MSGS_PER_CALL];
-    unsigned char control[BIO_MAX_MSGS_PER_CALL][BIO_CMSG_ALLOC_LEN] = { { 0 } };
+    size_t mh_msgs[BIO_MAX_MSGS_PER_CALL];
+    unsigned char control[BIO_MAX_MSGS_PER_CALL]
+                         [BIO_CMSG_ALLOC_LEN + BIO_CMSG_SEGMENT_LEN]
+        = { { 0 } };
     int have_local_enabled = data->local_addr_enabled;
 #elif M_METHOD == M_METHOD_RECVMSG
     int sysflags;
@@ -1377,9 +1529,16 @@ static int dgram_sendmmsg(BIO *b, BIO_MSG *msg, size_t stride,
     if (num_msg > BIO_MAX_MSGS_PER_CALL)
         num_msg = BIO_MAX_MSGS_PER_CALL;
 
-    for (i = 0; i < num_msg; ++i) {
-        translate_msg(b, &mh[i].msg_hdr, &iov[i],
-            control[i], &BIO_MSG_N(msg, stride, i));
+#if defined(SUPPORT_SEGMENTATION)
+retry:
+#endif
+    /*
+     * Each msghdr normally carries one message, but with transmit segmentation
+     * enabled it may carry a train of several (see coalesce_msgs).
+     */
+    for (i = 0, num_mh = 0; i < num_msg; i += mh_msgs[num_mh++]) {
+        translate_msg(b, &mh[num_mh].msg_hdr, &iov[i],
+            control[num_mh], &BIO_MSG_N(msg, stride, i));
 
         /* If local address was requested, it must have been enabled */
         if (BIO_MSG_N(msg, stride, i).local != NULL) {
@@ -1389,7 +1548,7 @@ static int dgram_sendmmsg(BIO *b, BIO_MSG *msg, size_t stride,
                 return 0;
             }
 
-            if (pack_local(b, &mh[i].msg_hdr,
+            if (pack_local(b, &mh[num_mh].msg_hdr,
                     BIO_MSG_N(msg, stride, i).local)
                 < 1) {
                 ERR_raise(ERR_LIB_BIO, BIO_R_LOCAL_ADDR_NOT_AVAILABLE);
@@ -1397,22 +1556,44 @@ static int dgram_sendmmsg(BIO *b, BIO_MSG *msg, size_t stride,
                 return 0;
             }
         }
+
+        mh_msgs[num_mh] = 1;
+#if defined(SUPPORT_SEGMENTATION)
+        if ((data->segmentation & BIO_DGRAM_SEGMENT_TX) != 0)
+            mh_msgs[num_mh] = coalesce_msgs(b, &mh[num_mh].msg_hdr,
+                control[num_mh], msg, stride, i, num_msg);
+#endif
     }
 
     /* Do the batch */
-    ret = sendmmsg(b->num, mh, num_msg, sysflags);
+    ret = sendmmsg(b->num, mh, num_mh, sysflags);
     if (ret < 0) {
+#if defined(SUPPORT_SEGMENTATION)
+        /*
+         * Segmented sends are refused on some paths, for example by devices
+         * without checksum offload. Stop using them and send individually.
+         */
+        if (mh_msgs[0] > 1
+            && (get_last_socket_error() == EIO
+                || get_last_socket_error() == EINVAL)) {
+            data->segmentation &= ~BIO_DGRAM_SEGMENT_TX;
+            goto retry;
+        }
+#endif
         ERR_raise(ERR_LIB_SYS, get_last_socket_error());
         *num_processed = 0;
         return 0;
     }
 
-    for (i = 0; i < (size_t)ret; ++i) {
-        BIO_MSG_N(msg, stride, i).data_len = mh[i].msg_len;
-        BIO_MSG_N(msg, stride, i).flags = 0;
+    for (n = 0, i = 0; n < (size_t)ret; i += mh_msgs[n++]) {
+        /* A segmented send either goes out entirely or not at all. */
+        if (mh_msgs[n] == 1)
+            BIO_MSG_N(msg, stride, i).data_len = mh[n].msg_len;
+        for (j = i; j < i + mh_msgs[n]; ++j)
+            BIO_MSG_N(msg, stride, j).flags = 0;
     }
 
-    *num_processed = (size_t)ret;
+    *num_processed = i;
     return 1;
 
 #elif M_METHOD == M_METHOD_RECVMSG
@@ -34,7 +34,7 @@ static int ecdsa_sign_setup(EC_KEY *eckey, BN_CTX *ctx_in,
     BIGNUM **kinvp, BIGNUM **rp,
     const unsigned char *dgst, int dlen,
     unsigned int nonce_type, const char *digestname,
-    OSSL_LIB_CTX *libctx, const char *propq);
+    OSSL_LIB_CTX *libctx, const char *propq, int invert);
 
 int ossl_ecdsa_sign_setup(EC_KEY *eckey, BN_CTX *ctx_in, BIGNUM **kinvp,
     BIGNUM **rp)
@@ -113,7 +113,7 @@ int ossl_ecdsa_deterministic_sign(const unsigned char *dgst, int dlen,
 
     *siglen = 0;
     if (!ecdsa_sign_setup(eckey, NULL, &kinv, &r, dgst, dlen,
-            nonce_type, digestname, libctx, propq))
+            nonce_type, digestname, libctx, propq, 1))
         return 0;
 
     s = ECDSA_do_sign_ex(dgst, dlen, kinv, r, eckey);
@@ -129,11 +129,16 @@ end:
     return ret;
 }
 
+/*
+ * Generate a nonce k and r, the x-coordinate of k * G. If |invert| is zero
+ * *kinvp receives k itself instead of its inverse, for callers that invert
+ * several nonces at once.
+ */
 static int ecdsa_sign_setup(EC_KEY *eckey, BN_CTX *ctx_in,
     BIGNUM **kinvp, BIGNUM **rp,
     const unsigned char *dgst, int dlen,
     unsigned int nonce_type, const char *digestname,
-    OSSL_LIB_CTX *libctx, const char *propq)
+    OSSL_LIB_CTX *libctx, const char *propq, int invert)
 {
     BN_CTX *ctx = NULL;
     BIGNUM *k = NULL, *r = NULL, *X = NULL;
@@ -234,7 +239,7 @@ static int ecdsa_sign_setup(EC_KEY *eckey, BN_CTX *ctx_in,
     } while (BN_is_zero(r));
 
     /* compute the inverse of k */
-    if (!ossl_ec_group_do_inverse_ord(group, k, k, ctx)) {
+    if (invert && !ossl_ec_group_do_inverse_ord(group, k, k, ctx)) {
         ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
         goto err;
     }
@@ -262,7 +267,7 @@ int ossl_ecdsa_simple_sign_setup(EC_KEY *eckey, BN_CTX *ctx_in, BIGNUM **kinvp,
     BIGNUM **rp)
 {
     return ecdsa_sign_setup(eckey, ctx_in, kinvp, rp, NULL, 0,
-        0, NULL, NULL, NULL);
+        0, NULL, NULL, NULL, 1);
 }
 
 ECDSA_SIG *ossl_ecdsa_simple_sign_sig(const unsigned char *dgst, int dgst_len,
@@ -337,7 +342,7 @@ ECDSA_SIG *ossl_ecdsa_simple_sign_sig(const unsigned char *dgst, int dgst_len,
     do {
         if (in_kinv == NULL || in_r == NULL) {
             if (!ecdsa_sign_setup(eckey, ctx, &kinv, &ret->r, dgst, dgst_len,
-                    0, NULL, NULL, NULL)) {
+                    0, NULL, NULL, NULL, 1)) {
                 ERR_raise(ERR_LIB_EC, ERR_R_ECDSA_LIB);
                 goto err;
             }
@@ -408,6 +413,152 @@ err:
     return ret;
 }
 
+/*
+ * Sign the |num| digests |dgst| with |eckey|, writing the DER encoded
+ * signatures to |sig|. On entry |siglen| holds the sizes of the |sig| buffers
+ * and on return the lengths of the signatures.
+ *
+ * A nonce is generated for each signature as usual, but their inverses are
+ * computed together with Montgomery's trick: one inversion modulo the order
+ * and three multiplications per signature replace an inversion per signature.
+ */
+int ossl_ecdsa_sign_batch(size_t num, const unsigned char *const *dgst,
+    const size_t *dlen, unsigned char *const *sig, size_t *siglen,
+    EC_KEY *eckey)
+{
+    const EC_GROUP *group = EC_KEY_get0_group(eckey);
+    BN_CTX *ctx = NULL;
+    BIGNUM **k = NULL, **r = NULL, **acc = NULL, *inv, *t;
+    ECDSA_SIG *s;
+    unsigned char *p;
+    unsigned int sltmp;
+    size_t i;
+    int ret = 0;
+
+    if (group == NULL) {
+        ERR_raise(ERR_LIB_EC, ERR_R_PASSED_NULL_PARAMETER);
+        return 0;
+    }
+
+    for (i = 0; i < num; i++) {
+        if (dlen[i] > INT_MAX || siglen[i] < (size_t)ECDSA_size(eckey)) {
+            ERR_raise(ERR_LIB_EC, ERR_R_PASSED_INVALID_ARGUMENT);
+            return 0;
+        }
+    }
+
+    /* Only the built-in implementation is batched */
+    if (num < 2
+        || group->mont_data == NULL
+        || eckey->meth->sign_sig != ossl_ecdsa_sign_sig
+        || group->meth->ecdsa_sign_setup != ossl_ecdsa_simple_sign_setup
+        || group->meth->ecdsa_sign_sig != ossl_ecdsa_simple_sign_sig) {
+        for (i = 0; i < num; i++) {
+            if (!ECDSA_sign_ex(0, dgst[i], (int)dlen[i], sig[i], &sltmp,
+                    NULL, NULL, eckey))
+                return 0;
+            siglen[i] = sltmp;
+        }
+        return 1;
+    }
+
+    if ((ctx = BN_CTX_secure_new_ex(eckey->libctx)) == NULL) {
+        ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+        return 0;
+    }
+    BN_CTX_start(ctx);
+    inv = BN_CTX_get(ctx);
+    t = BN_CTX_get(ctx);
+    if (t == NULL) {
+        ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+        goto err;
+    }
+    BN_set_flags(inv, BN_FLG_CONSTTIME);
+    if ((k = OPENSSL_calloc(num, sizeof(*k))) == NULL
+        || (r = OPENSSL_calloc(num, sizeof(*r))) == NULL
+        || (acc = OPENSSL_calloc(num, sizeof(*acc))) == NULL)
+        goto err;
+
+    /*
+     * With one operand converted to the Montgomery domain the Montgomery
+     * multiplication yields the plain product, as in
+     * ossl_ecdsa_simple_sign_sig(). Everything derived from the nonces is
+     * kept in fixed-top form so that no step depends on their magnitude.
+     */
+    for (i = 0; i < num; i++) {
+        if (!ecdsa_sign_setup(eckey, ctx, &k[i], &r[i], dgst[i], (int)dlen[i],
+                0, NULL, NULL, NULL, 0)) {
+            ERR_raise(ERR_LIB_EC, ERR_R_ECDSA_LIB);
+            goto err;
+        }
+        /* acc[i] = k[0] * ... * k[i] */
+        if ((acc[i] = BN_secure_new()) == NULL) {
+            ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+            goto err;
+        }
+        BN_set_flags(acc[i], BN_FLG_CONSTTIME);
+        if ((i == 0 && BN_copy(acc[i], k[i]) == NULL)
+            || (i > 0
+                && (!bn_to_mont_fixed_top(t, k[i], group->mont_data, ctx)
+                    || !bn_mul_mont_fixed_top(acc[i], acc[i - 1], t,
+                        group->mont_data, ctx)))) {
+            ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+            goto err;
+        }
+    }
+
+    if (!ossl_ec_group_do_inverse_ord(group, inv, acc[num - 1], ctx)) {
+        ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+        goto err;
+    }
+
+    /*
+     * Walk back from the last nonce: with inv = 1 / (k[0] * ... * k[i]) the
+     * inverse of k[i] is inv * acc[i - 1], which replaces acc[i], and the
+     * product without k[i] is inverted by inv * k[i].
+     */
+    for (i = num - 1; i > 0; i--) {
+        if (!bn_to_mont_fixed_top(t, acc[i - 1], group->mont_data, ctx)
+            || !bn_mul_mont_fixed_top(acc[i], inv, t, group->mont_data, ctx)
+            || !bn_to_mont_fixed_top(t, k[i], group->mont_data, ctx)
+            || !bn_mul_mont_fixed_top(inv, inv, t, group->mont_data, ctx)) {
+            ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+            goto err;
+        }
+    }
+    if (BN_copy(acc[0], inv) == NULL) {
+        ERR_raise(ERR_LIB_EC, ERR_R_BN_LIB);
+        goto err;
+    }
+
+    for (i = 0; i < num; i++) {
+        s = ossl_ecdsa_simple_sign_sig(dgst[i], (int)dlen[i], acc[i], r[i],
+            eckey);
+        if (s == NULL)
+            goto err;
+        p = sig[i];
+        siglen[i] = i2d_ECDSA_SIG(s, &p);
+        ECDSA_SIG_free(s);
+    }
+    ret = 1;
+
+err:
+    for (i = 0; i < num; i++) {
+        if (k != NULL)
+            BN_clear_free(k[i]);
+        if (r != NULL)
+            BN_clear_free(r[i]);
+        if (acc != NULL)
+            BN_clear_free(acc[i]);
+    }
+    OPENSSL_free(k);
+    OPENSSL_free(r);
+    OPENSSL_free(acc);
+    BN_CTX_end(ctx);
+    BN_CTX_free(ctx);
+    return ret;
+}
+
 /*-
  * returns
  *      1: correct signature
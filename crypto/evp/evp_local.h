@@ -179,6 +179,7 @@ struct evp_signature_st {
     OSSL_FUNC_signature_newctx_fn *newctx;
     OSSL_FUNC_signature_sign_init_fn *sign_init;
     OSSL_FUNC_signature_sign_fn *sign;
+    OSSL_FUNC_signature_sign_batch_fn *sign_batch;
     OSSL_FUNC_signature_sign_message_init_fn *sign_message_init;
     OSSL_FUNC_signature_sign_message_update_fn *sign_message_update;
     OSSL_FUNC_signature_sign_message_final_fn *sign_message_final;
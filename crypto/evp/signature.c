@@ -109,6 +109,11 @@ static void *evp_signature_from_algorithm(int name_id,
                 break;
             signature->sign = OSSL_FUNC_signature_sign(fns);
             break;
+        case OSSL_FUNC_SIGNATURE_SIGN_BATCH:
+            if (signature->sign_batch != NULL)
+                break;
+            signature->sign_batch = OSSL_FUNC_signature_sign_batch(fns);
+            break;
         case OSSL_FUNC_SIGNATURE_SIGN_MESSAGE_INIT:
             if (signature->sign_message_init != NULL)
                 break;
@@ -1022,6 +1027,64 @@ int EVP_PKEY_sign(EVP_PKEY_CTX *ctx,
     return ret;
 }
 
+int EVP_PKEY_sign_batch(EVP_PKEY_CTX *ctx, size_t num,
+    unsigned char *const *sigs, size_t *siglens,
+    const unsigned char *const *tbs, const size_t *tbslens)
+{
+    EVP_SIGNATURE *signature;
+    const char *desc;
+    size_t i;
+    int ret;
+
+    if (ctx == NULL || (num > 0 && (sigs == NULL || siglens == NULL
+                                       || tbs == NULL || tbslens == NULL))) {
+        ERR_raise(ERR_LIB_EVP, ERR_R_PASSED_NULL_PARAMETER);
+        return -1;
+    }
+
+    if (ctx->operation != EVP_PKEY_OP_SIGN) {
+        ERR_raise(ERR_LIB_EVP, EVP_R_OPERATION_NOT_INITIALIZED);
+        return -1;
+    }
+
+    if (ctx->op.sig.algctx == NULL) {
+        ERR_raise(ERR_LIB_EVP, EVP_R_OPERATION_NOT_SUPPORTED_FOR_THIS_KEYTYPE);
+        return -2;
+    }
+
+    signature = ctx->op.sig.signature;
+    desc = signature->description != NULL ? signature->description : "";
+    if (signature->sign == NULL) {
+        ERR_raise_data(ERR_LIB_EVP, EVP_R_PROVIDER_SIGNATURE_NOT_SUPPORTED,
+            "%s sign:%s", signature->type_name, desc);
+        return -2;
+    }
+
+    for (i = 0; i < num; i++) {
+        if (sigs[i] == NULL) {
+            ERR_raise(ERR_LIB_EVP, ERR_R_PASSED_NULL_PARAMETER);
+            return -1;
+        }
+    }
+
+    if (num == 0)
+        return 1;
+
+    /* Providers without a batch function sign one message at a time */
+    if (signature->sign_batch != NULL) {
+        ret = signature->sign_batch(ctx->op.sig.algctx, num, sigs, siglens,
+            tbs, tbslens);
+    } else {
+        for (i = 0, ret = 1; i < num && ret > 0; i++)
+            ret = signature->sign(ctx->op.sig.algctx, sigs[i], &siglens[i],
+                siglens[i], tbs[i], tbslens[i]);
+    }
+    if (ret <= 0)
+        ERR_raise_data(ERR_LIB_EVP, EVP_R_PROVIDER_SIGNATURE_FAILURE,
+            "%s sign:%s", signature->type_name, desc);
+    return ret;
+}
+
 int EVP_PKEY_verify_init(EVP_PKEY_CTX *ctx)
 {
     return evp_pkey_signature_init(ctx, NULL, EVP_PKEY_OP_VERIFY, NULL);
@@ -247,6 +247,7 @@ static const ERR_STRING_DATA SSL_str_reasons[] = {
         "invalid status response" },
     { ERR_PACK(ERR_LIB_SSL, 0, SSL_R_INVALID_TICKET_KEYS_LENGTH),
         "invalid ticket keys length" },
+    { ERR_PACK(ERR_LIB_SSL, 0, SSL_R_KTLS_REKEY_FAILED), "ktls rekey failed" },
     { ERR_PACK(ERR_LIB_SSL, 0, SSL_R_LEGACY_SIGALG_DISALLOWED_OR_UNSUPPORTED),
         "legacy sigalg disallowed or unsupported" },
     { ERR_PACK(ERR_LIB_SSL, 0, SSL_R_LENGTH_MISMATCH), "length mismatch" },
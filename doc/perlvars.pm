@@ -189,6 +189,7 @@ $OpenSSL::safe::opt_s_synopsis = ""
 . "[B<-min_protocol> I<minprot>]\n"
 . "[B<-max_protocol> I<maxprot>]\n"
 . "[B<-record_padding> I<padding>]\n"
+. "[B<-record_sizing> I<sizing>]\n"
 . "[B<-debug_broken_protocol>]\n"
 . "[B<-no_middlebox>]";
 $OpenSSL::safe::opt_s_item = ""
@@ -202,7 +203,8 @@ $OpenSSL::safe::opt_s_item = ""
 . "I<algs>, B<-client_sigalgs> I<algs>, B<-groups> I<groups>, B<-curves>\n"
 . "I<curves>, B<-named_curve> I<curve>, B<-cipher> I<ciphers>, B<-ciphersuites>\n"
 . "I<1.3ciphers>, B<-min_protocol> I<minprot>, B<-max_protocol> I<maxprot>,\n"
-. "B<-record_padding> I<padding>, B<-debug_broken_protocol>, B<-no_middlebox>\n"
+. "B<-record_padding> I<padding>, B<-record_sizing> I<sizing>,\n"
+. "B<-debug_broken_protocol>, B<-no_middlebox>\n"
 . "\n"
 . "See L<SSL_CONF_cmd(3)/SUPPORTED COMMAND LINE COMMANDS> for details.";
 
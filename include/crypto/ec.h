@@ -102,5 +102,8 @@ int ossl_ecdsa_deterministic_sign(const unsigned char *dgst, int dlen,
     EC_KEY *eckey, unsigned int nonce_type,
     const char *digestname,
     OSSL_LIB_CTX *libctx, const char *propq);
+int ossl_ecdsa_sign_batch(size_t num, const unsigned char *const *dgst,
+    const size_t *dlen, unsigned char *const *sig, size_t *siglen,
+    EC_KEY *eckey);
 #endif /* OPENSSL_NO_EC */
 #endif
@@ -241,6 +241,7 @@ static ossl_inline int ktls_sendfile(int s, int fd, off_t off, size_t size,
 #endif
 
 #include <sys/sendfile.h>
+#include <fcntl.h>
 #include <netinet/tcp.h>
 #include <linux/socket.h>
 #include <openssl/ssl3.h>
@@ -454,6 +455,28 @@ static ossl_inline int ktls_read_record(int fd, void *data, size_t length)
     return ret;
 }
 
+/*
+ * splice() is only declared when _GNU_SOURCE is defined, so only the files
+ * that define it get ktls_splice().
+ */
+#if defined(_GNU_SOURCE) && defined(SPLICE_F_MOVE)
+#define OPENSSL_KTLS_SPLICE
+
+/*
+ * Move up to @size bytes from @in to @out without copying them to user space.
+ * One of the two must be a pipe. When @in is a KTLS socket only the plaintext
+ * of application data records is moved, any other record type fails with
+ * EINVAL and has to be read with ktls_read_record() instead. The call only
+ * fails with EAGAIN rather than waiting if @nonblock is set.
+ */
+static ossl_inline ossl_ssize_t ktls_splice(int in, int out, size_t size,
+    int nonblock)
+{
+    return splice(in, NULL, out, NULL, size,
+        SPLICE_F_MOVE | (nonblock ? SPLICE_F_NONBLOCK : 0));
+}
+#endif
+
 #endif /* OPENSSL_NO_KTLS_RX */
 
 #endif /* OPENSSL_SYS_LINUX */
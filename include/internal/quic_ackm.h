@@ -54,6 +54,13 @@ void ossl_ackm_set_rx_max_ack_delay(OSSL_ACKM *ackm, OSSL_TIME rx_max_ack_delay)
  */
 void ossl_ackm_set_tx_max_ack_delay(OSSL_ACKM *ackm, OSSL_TIME tx_max_ack_delay);
 
+/*
+ * Changes the congestion controller the ACKM reports to. This must only be
+ * done before any packet has been sent.
+ */
+void ossl_ackm_set_cc_method(OSSL_ACKM *ackm, const OSSL_CC_METHOD *cc_method,
+    OSSL_CC_DATA *cc_data);
+
 typedef struct ossl_ackm_tx_pkt_st OSSL_ACKM_TX_PKT;
 struct ossl_ackm_tx_pkt_st {
     /* The packet number of the transmitted packet. */
@@ -208,10 +208,43 @@ struct ossl_cc_method_st {
      */
     int (*on_ecn)(OSSL_CC_DATA *ccdata,
         const OSSL_CC_ECN_INFO *info);
+
+    /*
+     * Returns the rate in bytes per second at which data should be paced out
+     * given the smoothed RTT, or UINT64_MAX if it should not be paced. This
+     * is only consulted if pacing is enabled and may be NULL, in which case
+     * sending is not paced.
+     */
+    uint64_t (*get_pacing_rate)(OSSL_CC_DATA *ccdata, OSSL_TIME srtt);
 };
 
+/*
+ * Diagnostic output locations shared by the built-in congestion controllers.
+ * Each pointer is NULL unless bound by the bind_diagnostic method.
+ */
+typedef struct ossl_cc_diag_st {
+    size_t *p_max_dgram_payload_len;
+    uint64_t *p_cur_cwnd_size;
+    uint64_t *p_min_cwnd_size;
+    uint64_t *p_cur_bytes_in_flight;
+    uint32_t *p_cur_state;
+} OSSL_CC_DIAG;
+
+/* Implements the bind_diagnostic method using diag. */
+int ossl_cc_diag_bind(OSSL_CC_DIAG *diag, OSSL_PARAM *params);
+
+/* Implements the unbind_diagnostic method using diag. */
+void ossl_cc_diag_unbind(OSSL_CC_DIAG *diag, OSSL_PARAM *params);
+
+/* Writes the given values to any bound diagnostic output locations. */
+void ossl_cc_diag_update(const OSSL_CC_DIAG *diag, size_t max_dgram_size,
+    uint64_t cwnd_size, uint64_t min_cwnd_size,
+    uint64_t bytes_in_flight, uint32_t state);
+
 extern const OSSL_CC_METHOD ossl_cc_dummy_method;
 extern const OSSL_CC_METHOD ossl_cc_newreno_method;
+extern const OSSL_CC_METHOD ossl_cc_cubic_method;
+extern const OSSL_CC_METHOD ossl_cc_bbr_method;
 
 #endif
 
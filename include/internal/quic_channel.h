@@ -129,6 +129,12 @@ typedef struct quic_channel_args_st {
     /* Title to use for the qlog session, or NULL. */
     const char *qlog_title;
 
+    /* Congestion controller to use, or NULL for the default. */
+    const OSSL_CC_METHOD *cc_method;
+
+    /* Whether to pace in-flight packets at the congestion controller's rate. */
+    int pacing;
+
     /* Transport parameter values for the channel. */
     uint64_t max_idle_timeout;
     uint64_t max_udp_payload_size;
@@ -538,6 +544,21 @@ uint64_t ossl_quic_channel_get_active_conn_id_limit_request(const QUIC_CHANNEL *
 /* Gets the active connection ID limit advertised by the peer. */
 uint64_t ossl_quic_channel_get_active_conn_id_limit_peer_request(const QUIC_CHANNEL *ch);
 
+/*
+ * Changes the congestion controller used by the channel. This is only possible
+ * before the channel has started.
+ */
+int ossl_quic_channel_set_cc_method(QUIC_CHANNEL *ch,
+    const OSSL_CC_METHOD *cc_method);
+/* Gets the congestion controller used by the channel. */
+const OSSL_CC_METHOD *ossl_quic_channel_get_cc_method(const QUIC_CHANNEL *ch);
+
+/* Enables or disables pacing. This can be changed at any time. */
+int ossl_quic_channel_set_pacing(QUIC_CHANNEL *ch, int enable);
+int ossl_quic_channel_get_pacing(const QUIC_CHANNEL *ch);
+/* Gets the pacer's burst limit in bytes, or 0 if not pacing. */
+uint64_t ossl_quic_channel_get_pacing_burst(const QUIC_CHANNEL *ch);
+
 int ossl_quic_bind_channel(QUIC_CHANNEL *ch, const BIO_ADDR *peer,
     const QUIC_CONN_ID *dcid, const QUIC_CONN_ID *odcid);
 
@@ -111,6 +111,22 @@ void ossl_quic_lcidm_free(QUIC_LCIDM *lcidm);
 /* Gets the local CID length this LCIDM was configured to use. */
 size_t ossl_quic_lcidm_get_lcid_len(const QUIC_LCIDM *lcidm);
 
+/*
+ * Causes all LCIDs subsequently generated by the LCIDM to carry the given shard
+ * index in their first byte, so that a packet can be steered to the shard which
+ * issued its DCID without a lookup. The LCID length must be nonzero.
+ *
+ * Returns 1 on success or 0 on failure.
+ */
+int ossl_quic_lcidm_set_shard(QUIC_LCIDM *lcidm, unsigned char shard);
+
+/*
+ * Returns the shard index encoded in a CID, or -1 if the LCIDM is not sharded
+ * or the CID could not have been generated by it.
+ */
+int ossl_quic_lcidm_get_cid_shard(const QUIC_LCIDM *lcidm,
+    const QUIC_CONN_ID *cid);
+
 /*
  * Determines the number of active LCIDs (i.e,. LCIDs which can be used for
  * reception) currently associated with the given opaque pointer.
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2026 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#ifndef OSSL_QUIC_PACER_H
+#define OSSL_QUIC_PACER_H
+
+#include <openssl/ssl.h>
+#include "internal/time.h"
+
+#ifndef OPENSSL_NO_QUIC
+
+/*
+ * QUIC Pacer
+ * ==========
+ *
+ * A token bucket which spreads the transmission of in-flight packets out over
+ * time (RFC 9002 s. 7.7) rather than sending a whole congestion window as a
+ * single burst. Credit accrues at the pacing rate, which is supplied by the
+ * congestion controller, up to a burst limit. The burst limit is the larger of
+ * ten datagrams and the amount of data sent at the pacing rate in one
+ * millisecond, as the event loop cannot reliably wake up more often than that.
+ *
+ * A rate of UINT64_MAX means that sending is not paced.
+ */
+typedef struct quic_pacer_st QUIC_PACER;
+
+struct quic_pacer_st {
+    uint64_t rate; /* bytes per second */
+    uint64_t burst; /* bucket size in bytes */
+    uint64_t credit; /* in units of 1/OSSL_TIME_SECOND bytes */
+    OSSL_TIME last_update;
+};
+
+/* Initialises a pacer. The pacer is initially unpaced. */
+void ossl_quic_pacer_init(QUIC_PACER *pacer);
+
+/*
+ * Sets the pacing rate in bytes per second. mdpl is the maximum datagram
+ * payload length, used to determine the burst limit. The bucket starts full the
+ * first time a rate is set.
+ */
+void ossl_quic_pacer_set_rate(QUIC_PACER *pacer, uint64_t rate, size_t mdpl,
+    OSSL_TIME now);
+
+/* Gets the pacing rate in bytes per second, or UINT64_MAX if unpaced. */
+uint64_t ossl_quic_pacer_get_rate(const QUIC_PACER *pacer);
+
+/* Gets the burst limit (bucket size) in bytes, or 0 if unpaced. */
+uint64_t ossl_quic_pacer_get_burst(const QUIC_PACER *pacer);
+
+/*
+ * Returns the number of bytes which may be sent at the given time, or
+ * UINT64_MAX if unpaced.
+ */
+uint64_t ossl_quic_pacer_get_credit(QUIC_PACER *pacer, OSSL_TIME now);
+
+/* Records the transmission of num_bytes of in-flight data. */
+void ossl_quic_pacer_consume_credit(QUIC_PACER *pacer, uint64_t num_bytes,
+    OSSL_TIME now);
+
+/*
+ * Returns the time at which the pacer will allow num_bytes to be sent. This is
+ * now if this is already allowed.
+ */
+OSSL_TIME ossl_quic_pacer_get_deadline(QUIC_PACER *pacer, uint64_t num_bytes,
+    OSSL_TIME now);
+
+/*
+ * Helper for window-based congestion controllers: returns gain_pct percent of
+ * cwnd bytes per smoothed RTT, as a rate in bytes per second.
+ */
+uint64_t ossl_quic_pacer_rate_from_cwnd(uint64_t cwnd, OSSL_TIME srtt,
+    uint32_t gain_pct);
+
+#endif
+
+#endif
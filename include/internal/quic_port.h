@@ -245,6 +245,46 @@ uint64_t ossl_quic_port_get_max_pending_channels(const QUIC_PORT *port);
 
 void ossl_quic_port_set_max_pending_channels(QUIC_PORT *port, uint64_t max_pending_channels);
 
+/* Configures the congestion controller used by channels created later. */
+void ossl_quic_port_set_cc_method(QUIC_PORT *port,
+    const OSSL_CC_METHOD *cc_method);
+/* Gets the congestion controller used by channels created later. */
+const OSSL_CC_METHOD *ossl_quic_port_get_cc_method(const QUIC_PORT *port);
+
+/* Configures whether channels created later use pacing. */
+void ossl_quic_port_set_pacing(QUIC_PORT *port, int enable);
+int ossl_quic_port_get_pacing(const QUIC_PORT *port);
+
+#if defined(OPENSSL_THREADS)
+/*
+ * Shard Groups
+ * ============
+ *
+ * A shard group is a set of multi-connection ports, each driven by its own
+ * engine (and typically its own thread and SO_REUSEPORT socket), which
+ * together serve a single address. Each port encodes its shard index in the
+ * first byte of the LCIDs it issues. If a port receives a 1-RTT or Handshake
+ * packet for a DCID it does not know and which was issued by another shard, the
+ * datagram is handed off to that shard instead of being discarded.
+ *
+ * Adds port to the shard group of peer, creating the group if peer is not yet
+ * in one. The caller must hold the engine mutex of peer. port must not yet be
+ * in use. Returns 1 on success or 0 on failure.
+ */
+int ossl_quic_port_join_shard_group(QUIC_PORT *port, QUIC_PORT *peer);
+
+/*
+ * Removes a port from its shard group, if it is in one, discarding any
+ * datagrams handed off to it. This waits for other shards to stop using the
+ * port and must be called before anything used by the port's tick is torn
+ * down.
+ */
+void ossl_quic_port_leave_shard_group(QUIC_PORT *port);
+
+/* Returns the port's shard index, or -1 if it is not in a shard group. */
+int ossl_quic_port_get_shard_index(const QUIC_PORT *port);
+#endif
+
 #endif
 
 #endif
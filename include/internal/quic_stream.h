@@ -241,6 +241,22 @@ int ossl_quic_sstream_append(QUIC_SSTREAM *qss,
     size_t buf_len,
     size_t *consumed);
 
+/*
+ * (Front end use.) Appends user data to the stream without copying it. The
+ * whole buffer is always consumed and does not count against the internal ring
+ * buffer. buf must remain valid and unmodified until release_cb is called,
+ * which happens once all of its data has been acknowledged by the peer or when
+ * the QUIC_SSTREAM is freed, whichever comes first. release_cb may be NULL.
+ *
+ * Returns 1 on success or 0 on failure, in which case release_cb is not
+ * called.
+ */
+int ossl_quic_sstream_append_nocopy(QUIC_SSTREAM *qss,
+    const unsigned char *buf,
+    size_t buf_len,
+    SSL_write_release_cb_fn release_cb,
+    void *release_cb_arg);
+
 /*
  * Marks a stream as finished. ossl_quic_sstream_append() may not be called anymore
  * after calling this.
@@ -48,6 +48,7 @@ typedef struct ossl_quic_tx_packetiser_args_st {
     QUIC_RXFC *max_streams_uni_rxfc;
     const OSSL_CC_METHOD *cc_method; /* QUIC Congestion Controller */
     OSSL_CC_DATA *cc_data; /* QUIC Congestion Controller Instance */
+    OSSL_STATM *statm; /* QUIC RTT Statistics Manager, needed for pacing */
     OSSL_TIME (*now)(void *arg); /* Callback to get current time. */
     void *now_arg;
     QLOG *(*get_qlog_cb)(void *arg); /* Optional QLOG retrieval func */
@@ -159,6 +160,29 @@ int ossl_quic_tx_packetiser_set_peer(OSSL_QUIC_TX_PACKETISER *txp,
 int ossl_quic_tx_packetiser_set_ack_delay_exponent(OSSL_QUIC_TX_PACKETISER *txp,
     uint32_t exp);
 
+/*
+ * Change the congestion controller the TXP consults. This must only be done
+ * before any packet has been sent.
+ */
+void ossl_quic_tx_packetiser_set_cc_method(OSSL_QUIC_TX_PACKETISER *txp,
+    const OSSL_CC_METHOD *cc_method,
+    OSSL_CC_DATA *cc_data);
+
+/*
+ * Enable or disable pacing of in-flight packets at the rate given by the
+ * congestion controller. Pacing requires a statm to have been provided.
+ * Returns 1 on success or 0 on failure.
+ */
+int ossl_quic_tx_packetiser_set_pacing(OSSL_QUIC_TX_PACKETISER *txp,
+    int enable);
+int ossl_quic_tx_packetiser_get_pacing(const OSSL_QUIC_TX_PACKETISER *txp);
+
+/*
+ * Gets the largest number of bytes of in-flight data the pacer lets us send
+ * at once, or 0 if not pacing.
+ */
+uint64_t ossl_quic_tx_packetiser_get_pacing_burst(const OSSL_QUIC_TX_PACKETISER *txp);
+
 /*
  * Change the QLOG instance retrieval function in use after instantiation.
  */
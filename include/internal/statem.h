@@ -83,7 +83,9 @@ typedef enum {
 typedef enum {
     CON_FUNC_ERROR = 0,
     CON_FUNC_SUCCESS,
-    CON_FUNC_DONT_SEND
+    CON_FUNC_DONT_SEND,
+    /* Waiting for the application, call again from the start to resume */
+    CON_FUNC_RETRY
 } CON_FUNC_RETURN;
 
 typedef enum {
@@ -826,10 +826,14 @@ OSSL_CORE_MAKE_FUNC(void *, keyexch_derive_skey, (void *ctx, const char *key_typ
 #define OSSL_FUNC_SIGNATURE_VERIFY_MESSAGE_INIT 30
 #define OSSL_FUNC_SIGNATURE_VERIFY_MESSAGE_UPDATE 31
 #define OSSL_FUNC_SIGNATURE_VERIFY_MESSAGE_FINAL 32
+#define OSSL_FUNC_SIGNATURE_SIGN_BATCH 33
 
 OSSL_CORE_MAKE_FUNC(void *, signature_newctx, (void *provctx, const char *propq))
 OSSL_CORE_MAKE_FUNC(int, signature_sign_init, (void *ctx, void *provkey, const OSSL_PARAM params[]))
 OSSL_CORE_MAKE_FUNC(int, signature_sign, (void *ctx, unsigned char *sig, size_t *siglen, size_t sigsize, const unsigned char *tbs, size_t tbslen))
+OSSL_CORE_MAKE_FUNC(int, signature_sign_batch,
+    (void *ctx, size_t num, unsigned char *const *sigs, size_t *siglens,
+        const unsigned char *const *tbs, const size_t *tbslens))
 OSSL_CORE_MAKE_FUNC(int, signature_sign_message_init,
     (void *ctx, void *provkey, const OSSL_PARAM params[]))
 OSSL_CORE_MAKE_FUNC(int, signature_sign_message_update,
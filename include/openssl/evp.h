@@ -1777,6 +1777,9 @@ int EVP_PKEY_sign_init_ex2(EVP_PKEY_CTX *ctx,
 int EVP_PKEY_sign(EVP_PKEY_CTX *ctx,
     unsigned char *sig, size_t *siglen,
     const unsigned char *tbs, size_t tbslen);
+int EVP_PKEY_sign_batch(EVP_PKEY_CTX *ctx, size_t num,
+    unsigned char *const *sigs, size_t *siglens,
+    const unsigned char *const *tbs, const size_t *tbslens);
 int EVP_PKEY_sign_message_init(EVP_PKEY_CTX *ctx,
     EVP_SIGNATURE *algo, const OSSL_PARAM params[]);
 int EVP_PKEY_sign_message_update(EVP_PKEY_CTX *ctx,
@@ -384,6 +384,18 @@ __owur int SSL_check_chain(SSL *s, X509 *x, EVP_PKEY *pk, STACK_OF(X509) *chain)
 #endif
 int SSL_CTX_set_tlsext_ticket_key_evp_cb(SSL_CTX *ctx, int (*fp)(SSL *, unsigned char *, unsigned char *, EVP_CIPHER_CTX *, EVP_MAC_CTX *, int));
 
+/* Length of a session ticket key: a 16 byte name, an HMAC and an AES key */
+#define SSL_TICKET_KEY_LENGTH 80
+/* Maximum number of session ticket keys in the key ring of an SSL_CTX */
+#define SSL_TICKET_KEYS_MAX 8
+__owur int SSL_CTX_set1_ticket_keys(SSL_CTX *ctx, const unsigned char *keys,
+    size_t keyslen);
+size_t SSL_CTX_get_ticket_keys(SSL_CTX *ctx, unsigned char *keys,
+    size_t keyslen);
+__owur int SSL_CTX_set_ticket_key_rotation(SSL_CTX *ctx, time_t interval,
+    size_t num_keys);
+__owur int SSL_CTX_rotate_ticket_keys(SSL_CTX *ctx);
+
 /* PSK ciphersuites from 4279 */
 #define TLS1_CK_PSK_WITH_RC4_128_SHA 0x0300008A
 #define TLS1_CK_PSK_WITH_3DES_EDE_CBC_SHA 0x0300008B
@@ -395,6 +395,39 @@ static int ecdsa_sign_directly(void *vctx,
     return 1;
 }
 
+/*
+ * Sign several digests in one call, see ossl_ecdsa_sign_batch().  Signatures
+ * with deterministic nonces are made one by one.
+ */
+static int ecdsa_sign_batch(void *vctx, size_t num,
+    unsigned char *const *sigs, size_t *siglens,
+    const unsigned char *const *tbs, const size_t *tbslens)
+{
+    PROV_ECDSA_CTX *ctx = (PROV_ECDSA_CTX *)vctx;
+    size_t i;
+
+    if (!ossl_prov_is_running() || ctx->operation != EVP_PKEY_OP_SIGN)
+        return 0;
+
+    if (ctx->nonce_type != 0
+#if !defined(OPENSSL_NO_ACVP_TESTS)
+        || ctx->kattest
+#endif
+    ) {
+        for (i = 0; i < num; i++)
+            if (!ecdsa_sign_directly(ctx, sigs[i], &siglens[i], siglens[i],
+                    tbs[i], tbslens[i]))
+                return 0;
+        return 1;
+    }
+
+    for (i = 0; i < num; i++)
+        if (ctx->mdsize != 0 && tbslens[i] != ctx->mdsize)
+            return 0;
+
+    return ossl_ecdsa_sign_batch(num, tbs, tbslens, sigs, siglens, ctx->ec);
+}
+
 static int ecdsa_signverify_message_update(void *vctx,
     const unsigned char *data,
     size_t datalen)
@@ -845,6 +878,7 @@ const OSSL_DISPATCH ossl_ecdsa_signature_functions[] = {
     { OSSL_FUNC_SIGNATURE_NEWCTX, (void (*)(void))ecdsa_newctx },
     { OSSL_FUNC_SIGNATURE_SIGN_INIT, (void (*)(void))ecdsa_sign_init },
     { OSSL_FUNC_SIGNATURE_SIGN, (void (*)(void))ecdsa_sign },
+    { OSSL_FUNC_SIGNATURE_SIGN_BATCH, (void (*)(void))ecdsa_sign_batch },
     { OSSL_FUNC_SIGNATURE_VERIFY_INIT, (void (*)(void))ecdsa_verify_init },
     { OSSL_FUNC_SIGNATURE_VERIFY, (void (*)(void))ecdsa_verify },
     { OSSL_FUNC_SIGNATURE_DIGEST_SIGN_INIT,
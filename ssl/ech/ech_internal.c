@@ -593,6 +593,8 @@ int ossl_ech_reset_hs_buffer(SSL_CONNECTION *s, const unsigned char *buf,
     }
     EVP_MD_CTX_free(s->s3.handshake_dgst);
     s->s3.handshake_dgst = NULL;
+    /* the transcript lanes have not hashed what is written here */
+    ssl3_free_transcript_lanes(s);
     /* providing nothing at all is a real use (mid-HRR) */
     if (buf != NULL && blen > 0)
         BIO_write(s->s3.handshake_buffer, (void *)buf, (int)blen);
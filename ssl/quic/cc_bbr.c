@@ -0,0 +1,656 @@
+/*
+ * Copyright 2026 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <string.h>
+#include "internal/quic_cc.h"
+#include "internal/quic_pacer.h"
+#include "internal/quic_types.h"
+#include "internal/safe_math.h"
+
+OSSL_SAFE_MATH_UNSIGNED(u64, uint64_t)
+
+/* Number of round trips over which the maximum delivery rate is taken. */
+#define BBR_BW_FILTER_LEN 10
+
+/*
+ * BBR-style model-based congestion controller.
+ *
+ * Rather than treating every loss as a congestion signal, this controller
+ * builds a model of the path from the delivery rate and RTT it observes and
+ * sizes the congestion window from the estimated bandwidth-delay product
+ * (BDP). It follows the state machine of BBR (STARTUP, DRAIN, PROBE_BW and
+ * PROBE_RTT) together with the loss response of BBRv2: losses only reduce
+ * the window when they exceed a loss rate threshold within a round trip, in
+ * which case an upper bound is placed on the data in flight.
+ *
+ * As pacing is optional, the state machine's gains are applied to the
+ * congestion window. When pacing is enabled they are also applied to the
+ * pacing rate. The delivery rate is sampled once per round trip rather than
+ * per packet.
+ */
+typedef struct ossl_cc_bbr_st {
+    /* Dependencies. */
+    OSSL_TIME (*now_cb)(void *arg);
+    void *now_cb_arg;
+
+    /* 'Constants' (which we allow to be configurable). */
+    uint64_t k_init_wnd, k_min_wnd;
+
+    /* State. */
+    size_t max_dgram_size;
+    uint64_t bytes_in_flight, cong_wnd;
+    int state;
+
+    /* Round trip counting. */
+    uint64_t delivered; /* total bytes acknowledged */
+    uint64_t round_count;
+    uint64_t round_start_delivered;
+    OSSL_TIME round_start_time; /* zero before the first transmission */
+
+    /* Path model. */
+    uint64_t bw_samples[BBR_BW_FILTER_LEN]; /* per-round rates, bytes/s */
+    uint64_t max_bw; /* windowed maximum of bw_samples */
+    OSSL_TIME min_rtt, min_rtt_stamp;
+
+    /*
+     * Whether we filled the congestion window during this round and during
+     * the previous one. This is determined at transmission time, as when
+     * acknowledgements arrive in batches the window may briefly appear
+     * underused.
+     */
+    int round_cwnd_limited, cwnd_limited;
+
+    /* STARTUP full pipe detection. */
+    uint64_t full_bw;
+    int full_bw_count, filled_pipe;
+
+    /* PROBE_BW gain cycling and PROBE_RTT. */
+    int cycle_idx;
+    uint64_t prior_cwnd;
+    OSSL_TIME probe_rtt_done_stamp;
+
+    /* Loss response. */
+    uint64_t inflight_hi; /* upper bound on in-flight data */
+    uint64_t round_lost; /* bytes lost during this round */
+    uint32_t round_loss_events; /* packets lost during this round */
+    int round_loss_handled; /* 1 if we already responded this round */
+
+    /* Diagnostic output locations. */
+    OSSL_CC_DIAG diag;
+} OSSL_CC_BBR;
+
+#define MIN_MAX_INIT_WND_SIZE 14720 /* RFC 9002 s. 7.2 */
+
+enum {
+    BBR_STATE_STARTUP,
+    BBR_STATE_DRAIN,
+    BBR_STATE_PROBE_BW,
+    BBR_STATE_PROBE_RTT
+};
+
+/* Minimum RTT estimates expire after this long without being refreshed. */
+#define BBR_MIN_RTT_WIN_MS 10000
+
+/* Time spent at the minimum window while in PROBE_RTT. */
+#define BBR_PROBE_RTT_MS 200
+
+/*
+ * Loss rate (as 1/n) within a round above which losses are treated as a
+ * congestion signal, and the factor (numerator/10) applied to the window.
+ * A single loss is never enough, as with a small window it would always
+ * exceed the threshold.
+ */
+#define BBR_LOSS_THRESH_DEN 50
+#define BBR_MIN_LOSS_EVENTS 2
+#define BBR_BETA_NUM 7
+
+/* PROBE_BW window gains in quarters, one phase per round trip. */
+static const unsigned char bbr_cycle_gain[8] = { 5, 3, 4, 4, 4, 4, 4, 4 };
+
+/* STARTUP and DRAIN pacing gains in percent (2/ln(2) and its inverse). */
+#define BBR_HIGH_PACING_GAIN 289
+#define BBR_DRAIN_PACING_GAIN 35
+
+static void bbr_set_max_dgram_size(OSSL_CC_BBR *bbr,
+    size_t max_dgram_size);
+static void bbr_update_diag(OSSL_CC_BBR *bbr);
+
+static void bbr_reset(OSSL_CC_DATA *cc);
+
+static OSSL_CC_DATA *bbr_new(OSSL_TIME (*now_cb)(void *arg),
+    void *now_cb_arg)
+{
+    OSSL_CC_BBR *bbr;
+
+    if ((bbr = OPENSSL_zalloc(sizeof(*bbr))) == NULL)
+        return NULL;
+
+    bbr->now_cb = now_cb;
+    bbr->now_cb_arg = now_cb_arg;
+
+    bbr_set_max_dgram_size(bbr, QUIC_MIN_INITIAL_DGRAM_LEN);
+    bbr_reset((OSSL_CC_DATA *)bbr);
+
+    return (OSSL_CC_DATA *)bbr;
+}
+
+static void bbr_free(OSSL_CC_DATA *cc)
+{
+    OPENSSL_free(cc);
+}
+
+static void bbr_set_max_dgram_size(OSSL_CC_BBR *bbr,
+    size_t max_dgram_size)
+{
+    size_t max_init_wnd;
+    int is_reduced = (max_dgram_size < bbr->max_dgram_size);
+
+    bbr->max_dgram_size = max_dgram_size;
+
+    max_init_wnd = 2 * max_dgram_size;
+    if (max_init_wnd < MIN_MAX_INIT_WND_SIZE)
+        max_init_wnd = MIN_MAX_INIT_WND_SIZE;
+
+    bbr->k_init_wnd = 10 * max_dgram_size;
+    if (bbr->k_init_wnd > max_init_wnd)
+        bbr->k_init_wnd = max_init_wnd;
+
+    /* BBR keeps at least four packets in flight, including in PROBE_RTT. */
+    bbr->k_min_wnd = 4 * max_dgram_size;
+
+    if (is_reduced)
+        bbr->cong_wnd = bbr->k_init_wnd;
+
+    bbr_update_diag(bbr);
+}
+
+static void bbr_reset(OSSL_CC_DATA *cc)
+{
+    OSSL_CC_BBR *bbr = (OSSL_CC_BBR *)cc;
+
+    bbr->cong_wnd = bbr->k_init_wnd;
+    bbr->bytes_in_flight = 0;
+    bbr->state = BBR_STATE_STARTUP;
+
+    bbr->delivered = 0;
+    bbr->round_count = 0;
+    bbr->round_start_delivered = 0;
+    bbr->round_start_time = ossl_time_zero();
+
+    memset(bbr->bw_samples, 0, sizeof(bbr->bw_samples));
+    bbr->max_bw = 0;
+    bbr->min_rtt = ossl_time_infinite();
+    bbr->min_rtt_stamp = ossl_time_zero();
+
+    bbr->round_cwnd_limited = 0;
+    bbr->cwnd_limited = 0;
+
+    bbr->full_bw = 0;
+    bbr->full_bw_count = 0;
+    bbr->filled_pipe = 0;
+
+    bbr->cycle_idx = 0;
+    bbr->prior_cwnd = 0;
+    bbr->probe_rtt_done_stamp = ossl_time_zero();
+
+    bbr->inflight_hi = UINT64_MAX;
+    bbr->round_lost = 0;
+    bbr->round_loss_events = 0;
+    bbr->round_loss_handled = 0;
+}
+
+static int bbr_set_input_params(OSSL_CC_DATA *cc, const OSSL_PARAM *params)
+{
+    OSSL_CC_BBR *bbr = (OSSL_CC_BBR *)cc;
+    const OSSL_PARAM *p;
+    size_t value;
+
+    p = OSSL_PARAM_locate_const(params, OSSL_CC_OPTION_MAX_DGRAM_PAYLOAD_LEN);
+    if (p != NULL) {
+        if (!OSSL_PARAM_get_size_t(p, &value))
+            return 0;
+        if (value < QUIC_MIN_INITIAL_DGRAM_LEN)
+            return 0;
+
+        bbr_set_max_dgram_size(bbr, value);
+    }
+
+    return 1;
+}
+
+static int bbr_bind_diagnostic(OSSL_CC_DATA *cc, OSSL_PARAM *params)
+{
+    OSSL_CC_BBR *bbr = (OSSL_CC_BBR *)cc;
+
+    if (!ossl_cc_diag_bind(&bbr->diag, params))
+        return 0;
+
+    bbr_update_diag(bbr);
+    return 1;
+}
+
+static int bbr_unbind_diagnostic(OSSL_CC_DATA *cc, OSSL_PARAM *params)
+{
+    OSSL_CC_BBR *bbr = (OSSL_CC_BBR *)cc;
+
+    ossl_cc_diag_unbind(&bbr->diag, params);
+    return 1;
+}
+
+static void bbr_update_diag(OSSL_CC_BBR *bbr)
+{
+    static const char state_chars[] = "SDBT";
+
+    ossl_cc_diag_update(&bbr->diag, bbr->max_dgram_size, bbr->cong_wnd,
+        bbr->k_min_wnd, bbr->bytes_in_flight,
+        (uint32_t)state_chars[bbr->state]);
+}
+
+/* Estimated bandwidth-delay product in bytes. */
+static uint64_t bbr_bdp(OSSL_CC_BBR *bbr)
+{
+    int err = 0;
+    uint64_t bdp;
+
+    if (bbr->max_bw == 0 || ossl_time_is_infinite(bbr->min_rtt))
+        return bbr->k_init_wnd;
+
+    bdp = safe_muldiv_u64(bbr->max_bw, ossl_time2us(bbr->min_rtt),
+        1000000, &err);
+
+    return err ? UINT64_MAX : bdp;
+}
+
+static void bbr_enter_probe_bw(OSSL_CC_BBR *bbr)
+{
+    bbr->state = BBR_STATE_PROBE_BW;
+    /* Start in a cruising phase rather than immediately probing upwards. */
+    bbr->cycle_idx = 2;
+}
+
+static void bbr_on_round_end(OSSL_CC_BBR *bbr, OSSL_TIME now)
+{
+    int err = 0;
+    size_t i;
+    uint64_t interval_us, sample = 0;
+
+    /* Sample the delivery rate over the round which has just ended. */
+    interval_us = ossl_time2us(ossl_time_subtract(now, bbr->round_start_time));
+    if (interval_us > 0) {
+        sample = safe_muldiv_u64(bbr->delivered - bbr->round_start_delivered,
+            1000000, interval_us, &err);
+        if (err)
+            sample = UINT64_MAX;
+    }
+
+    bbr->bw_samples[bbr->round_count % BBR_BW_FILTER_LEN] = sample;
+    bbr->max_bw = 0;
+    for (i = 0; i < BBR_BW_FILTER_LEN; ++i)
+        if (bbr->bw_samples[i] > bbr->max_bw)
+            bbr->max_bw = bbr->bw_samples[i];
+
+    /*
+     * If we did not respond to losses this round, gradually lift any bound on
+     * in-flight data so that we can discover newly available capacity.
+     */
+    if (!bbr->round_loss_handled && bbr->inflight_hi != UINT64_MAX) {
+        bbr->inflight_hi = safe_add_u64(bbr->inflight_hi,
+            bbr->inflight_hi / 8 + bbr->max_dgram_size, &err);
+        if (err)
+            bbr->inflight_hi = UINT64_MAX;
+    }
+
+    ++bbr->round_count;
+    bbr->round_start_time = now;
+    bbr->round_start_delivered = bbr->delivered;
+    bbr->round_lost = 0;
+    bbr->round_loss_events = 0;
+    bbr->round_loss_handled = 0;
+    bbr->cwnd_limited = bbr->round_cwnd_limited;
+    bbr->round_cwnd_limited = 0;
+
+    switch (bbr->state) {
+    case BBR_STATE_STARTUP:
+        /*
+         * The pipe is considered full once the bandwidth estimate has failed
+         * to grow by at least 25% for three rounds. Rounds in which the
+         * application did not make use of the window say nothing about the
+         * capacity of the path, and would otherwise end STARTUP early. This
+         * matters when pacing, as the rate is then derived from the estimate.
+         */
+        if (bbr->max_bw >= bbr->full_bw + bbr->full_bw / 4) {
+            bbr->full_bw = bbr->max_bw;
+            bbr->full_bw_count = 0;
+        } else if (bbr->cwnd_limited && ++bbr->full_bw_count >= 3) {
+            bbr->filled_pipe = 1;
+            bbr->state = BBR_STATE_DRAIN;
+        }
+        break;
+
+    case BBR_STATE_PROBE_BW:
+        bbr->cycle_idx = (bbr->cycle_idx + 1) % (int)sizeof(bbr_cycle_gain);
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void bbr_update_min_rtt(OSSL_CC_BBR *bbr, OSSL_TIME now, OSSL_TIME rtt)
+{
+    int expired = !ossl_time_is_infinite(bbr->min_rtt)
+        && ossl_time_compare(now,
+               ossl_time_add(bbr->min_rtt_stamp,
+                   ossl_ms2time(BBR_MIN_RTT_WIN_MS)))
+            > 0;
+
+    if (ossl_time_compare(rtt, bbr->min_rtt) <= 0 || expired) {
+        bbr->min_rtt = rtt;
+        bbr->min_rtt_stamp = now;
+    }
+
+    /*
+     * If the minimum RTT has not been refreshed for a while, briefly drain the
+     * path so that a fresh measurement can be taken.
+     */
+    if (expired && bbr->filled_pipe && bbr->state != BBR_STATE_PROBE_RTT) {
+        bbr->state = BBR_STATE_PROBE_RTT;
+        bbr->prior_cwnd = bbr->cong_wnd;
+        bbr->probe_rtt_done_stamp = ossl_time_zero();
+    }
+}
+
+static void bbr_check_probe_rtt_done(OSSL_CC_BBR *bbr, OSSL_TIME now)
+{
+    if (ossl_time_is_zero(bbr->probe_rtt_done_stamp)) {
+        if (bbr->bytes_in_flight <= bbr->k_min_wnd)
+            bbr->probe_rtt_done_stamp
+                = ossl_time_add(now, ossl_ms2time(BBR_PROBE_RTT_MS));
+        return;
+    }
+
+    if (ossl_time_compare(now, bbr->probe_rtt_done_stamp) < 0)
+        return;
+
+    bbr->min_rtt_stamp = now;
+    if (bbr->cong_wnd < bbr->prior_cwnd)
+        bbr->cong_wnd = bbr->prior_cwnd;
+
+    bbr_enter_probe_bw(bbr);
+}
+
+static int bbr_is_cong_limited(OSSL_CC_BBR *bbr)
+{
+    return bbr->cwnd_limited || bbr->round_cwnd_limited;
+}
+
+static void bbr_set_cwnd(OSSL_CC_BBR *bbr, size_t acked)
+{
+    int err = 0;
+    uint64_t target, bdp = bbr_bdp(bbr);
+
+    switch (bbr->state) {
+    case BBR_STATE_STARTUP:
+        /* Grow exponentially until the pipe is full, as in slow start. */
+        if (bbr_is_cong_limited(bbr))
+            bbr->cong_wnd += acked;
+        break;
+
+    case BBR_STATE_DRAIN:
+    case BBR_STATE_PROBE_BW:
+        if (bbr->state == BBR_STATE_DRAIN)
+            target = bdp;
+        else
+            target = safe_muldiv_u64(bdp, bbr_cycle_gain[bbr->cycle_idx], 4,
+                &err);
+
+        /* Allow for acknowledgement aggregation. */
+        target = safe_add_u64(target, 2 * bbr->max_dgram_size, &err);
+        if (err)
+            target = UINT64_MAX;
+
+        if (bbr->cong_wnd >= target)
+            bbr->cong_wnd = target;
+        else if (bbr_is_cong_limited(bbr))
+            bbr->cong_wnd += (target - bbr->cong_wnd < acked)
+                ? target - bbr->cong_wnd
+                : acked;
+        break;
+
+    case BBR_STATE_PROBE_RTT:
+        bbr->cong_wnd = bbr->k_min_wnd;
+        break;
+    }
+
+    if (bbr->cong_wnd > bbr->inflight_hi)
+        bbr->cong_wnd = bbr->inflight_hi;
+
+    if (bbr->cong_wnd < bbr->k_min_wnd)
+        bbr->cong_wnd = bbr->k_min_wnd;
+}
+
+static uint64_t bbr_get_tx_allowance(OSSL_CC_DATA *cc)
+{
+    OSSL_CC_BBR *bbr = (OSSL_CC_BBR *)cc;
+
+    if (bbr->bytes_in_flight >= bbr->cong_wnd)
+        return 0;
+
+    return bbr->cong_wnd - bbr->bytes_in_flight;
+}
+
+static OSSL_TIME bbr_get_wakeup_deadline(OSSL_CC_DATA *cc)
+{
+    if (bbr_get_tx_allowance(cc) > 0) {
+        /* We have TX allowance now so wakeup immediately */
+        return ossl_time_zero();
+    } else {
+        /* The model is only updated in response to acknowledgements. */
+        return ossl_time_infinite();
+    }
+}
+
+static int bbr_on_data_sent(OSSL_CC_DATA *cc, uint64_t num_bytes)
+{
+    OSSL_CC_BBR *bbr = (OSSL_CC_BBR *)cc;
+
+    /* The first round trip starts with the first transmission. */
+    if (ossl_time_is_zero(bbr->round_start_time))
+        bbr->round_start_time = bbr->now_cb(bbr->now_cb_arg);
+
+    bbr->bytes_in_flight += num_bytes;
+
+    /*
+     * As for NewReno, we only grow the window if we are using a significant
+     * part of it, treating STARTUP as slow start.
+     */
+    if (bbr->bytes_in_flight + 3 * bbr->max_dgram_size >= bbr->cong_wnd
+        || (bbr->state == BBR_STATE_STARTUP
+            && bbr->bytes_in_flight >= bbr->cong_wnd / 2))
+        bbr->round_cwnd_limited = 1;
+
+    bbr_update_diag(bbr);
+    return 1;
+}
+
+static int bbr_on_data_acked(OSSL_CC_DATA *cc,
+    const OSSL_CC_ACK_INFO *info)
+{
+    OSSL_CC_BBR *bbr = (OSSL_CC_BBR *)cc;
+    OSSL_TIME now = bbr->now_cb(bbr->now_cb_arg);
+
+    bbr->bytes_in_flight -= info->tx_size;
+    bbr->delivered += info->tx_size;
+
+    bbr_update_min_rtt(bbr, now, ossl_time_subtract(now, info->tx_time));
+
+    /*
+     * A round trip ends when a packet sent after the start of the round is
+     * acknowledged.
+     */
+    if (ossl_time_compare(info->tx_time, bbr->round_start_time) >= 0)
+        bbr_on_round_end(bbr, now);
+
+    if (bbr->state == BBR_STATE_DRAIN
+        && bbr->bytes_in_flight <= bbr_bdp(bbr))
+        bbr_enter_probe_bw(bbr);
+
+    if (bbr->state == BBR_STATE_PROBE_RTT)
+        bbr_check_probe_rtt_done(bbr, now);
+
+    bbr_set_cwnd(bbr, info->tx_size);
+    bbr_update_diag(bbr);
+    return 1;
+}
+
+/*
+ * Responds to a congestion signal by bounding the data in flight, at most
+ * once per round trip.
+ */
+static void bbr_on_congestion(OSSL_CC_BBR *bbr)
+{
+    int err = 0;
+    uint64_t bdp;
+
+    if (bbr->round_loss_handled)
+        return;
+
+    bbr->round_loss_handled = 1;
+
+    /*
+     * Back off multiplicatively, but not below the estimated BDP: if the loss
+     * is due to a reduction in path capacity, the delivery rate samples will
+     * lower the BDP estimate in turn.
+     */
+    bbr->inflight_hi = safe_muldiv_u64(bbr->cong_wnd, BBR_BETA_NUM, 10, &err);
+    bdp = bbr_bdp(bbr);
+    if (bbr->inflight_hi < bdp)
+        bbr->inflight_hi = bdp;
+    if (bbr->inflight_hi < bbr->k_min_wnd)
+        bbr->inflight_hi = bbr->k_min_wnd;
+
+    if (bbr->cong_wnd > bbr->inflight_hi)
+        bbr->cong_wnd = bbr->inflight_hi;
+
+    /* Excessive loss during STARTUP means the pipe is already full. */
+    if (bbr->state == BBR_STATE_STARTUP) {
+        bbr->filled_pipe = 1;
+        bbr->state = BBR_STATE_DRAIN;
+    }
+}
+
+static int bbr_on_data_lost(OSSL_CC_DATA *cc,
+    const OSSL_CC_LOSS_INFO *info)
+{
+    OSSL_CC_BBR *bbr = (OSSL_CC_BBR *)cc;
+
+    if (info->tx_size > bbr->bytes_in_flight)
+        return 0;
+
+    bbr->bytes_in_flight -= info->tx_size;
+    bbr->round_lost += info->tx_size;
+    ++bbr->round_loss_events;
+
+    bbr_update_diag(bbr);
+    return 1;
+}
+
+static int bbr_on_data_lost_finished(OSSL_CC_DATA *cc, uint32_t flags)
+{
+    OSSL_CC_BBR *bbr = (OSSL_CC_BBR *)cc;
+    uint64_t round_total;
+
+    /*
+     * Only treat loss as a congestion signal if the fraction of data lost in
+     * this round is significant. Random loss below this rate (for example on
+     * a lossy wireless or long-haul link) does not reduce the window.
+     */
+    round_total = bbr->delivered - bbr->round_start_delivered + bbr->round_lost;
+    if (round_total < bbr->cong_wnd)
+        round_total = bbr->cong_wnd;
+
+    if (bbr->round_loss_events >= BBR_MIN_LOSS_EVENTS
+        && bbr->round_lost > round_total / BBR_LOSS_THRESH_DEN)
+        bbr_on_congestion(bbr);
+
+    if ((flags & OSSL_CC_LOST_FLAG_PERSISTENT_CONGESTION) != 0)
+        bbr->cong_wnd = bbr->k_min_wnd;
+
+    bbr_update_diag(bbr);
+    return 1;
+}
+
+static int bbr_on_data_invalidated(OSSL_CC_DATA *cc,
+    uint64_t num_bytes)
+{
+    OSSL_CC_BBR *bbr = (OSSL_CC_BBR *)cc;
+
+    bbr->bytes_in_flight -= num_bytes;
+    bbr_update_diag(bbr);
+    return 1;
+}
+
+static int bbr_on_ecn(OSSL_CC_DATA *cc,
+    const OSSL_CC_ECN_INFO *info)
+{
+    OSSL_CC_BBR *bbr = (OSSL_CC_BBR *)cc;
+
+    bbr_on_congestion(bbr);
+    bbr_update_diag(bbr);
+    return 1;
+}
+
+static uint64_t bbr_get_pacing_rate(OSSL_CC_DATA *cc, OSSL_TIME srtt)
+{
+    OSSL_CC_BBR *bbr = (OSSL_CC_BBR *)cc;
+    int err = 0;
+    uint32_t gain_pct;
+    uint64_t rate;
+
+    switch (bbr->state) {
+    case BBR_STATE_STARTUP:
+        gain_pct = BBR_HIGH_PACING_GAIN;
+        break;
+    case BBR_STATE_DRAIN:
+        gain_pct = BBR_DRAIN_PACING_GAIN;
+        break;
+    case BBR_STATE_PROBE_BW:
+        gain_pct = bbr_cycle_gain[bbr->cycle_idx] * 25;
+        break;
+    default:
+        gain_pct = 100;
+        break;
+    }
+
+    /* Until the bandwidth has been measured, derive a rate from the window. */
+    if (bbr->max_bw == 0)
+        return ossl_quic_pacer_rate_from_cwnd(bbr->cong_wnd, srtt,
+            BBR_HIGH_PACING_GAIN);
+
+    rate = safe_muldiv_u64(bbr->max_bw, gain_pct, 100, &err);
+    return err ? UINT64_MAX : rate;
+}
+
+const OSSL_CC_METHOD ossl_cc_bbr_method = {
+    bbr_new,
+    bbr_free,
+    bbr_reset,
+    bbr_set_input_params,
+    bbr_bind_diagnostic,
+    bbr_unbind_diagnostic,
+    bbr_get_tx_allowance,
+    bbr_get_wakeup_deadline,
+    bbr_on_data_sent,
+    bbr_on_data_acked,
+    bbr_on_data_lost,
+    bbr_on_data_lost_finished,
+    bbr_on_data_invalidated,
+    bbr_on_ecn,
+    bbr_get_pacing_rate,
+};
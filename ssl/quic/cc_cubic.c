@@ -0,0 +1,571 @@
+/*
+ * Copyright 2026 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include "internal/quic_cc.h"
+#include "internal/quic_pacer.h"
+#include "internal/quic_types.h"
+#include "internal/safe_math.h"
+
+OSSL_SAFE_MATH_UNSIGNED(u64, uint64_t)
+
+/*
+ * CUBIC congestion controller (RFC 9438).
+ *
+ * Slow start, loss detection and the recovery period work exactly as in the
+ * NewReno controller. The difference is in congestion avoidance: rather than
+ * growing the window by one datagram per RTT, the window follows a cubic
+ * function of the time since the last congestion event, centred on the window
+ * size at which that event occurred (W_max). This makes window growth
+ * independent of RTT, so that long fat paths recover much faster than with
+ * NewReno, while a Reno-friendly estimate (W_est) ensures we are never less
+ * aggressive than NewReno would be on short paths.
+ *
+ * All arithmetic is integral. Times used in the cubic function are in
+ * milliseconds and windows are in bytes.
+ */
+typedef struct ossl_cc_cubic_st {
+    /* Dependencies. */
+    OSSL_TIME (*now_cb)(void *arg);
+    void *now_cb_arg;
+
+    /* 'Constants' (which we allow to be configurable). */
+    uint64_t k_init_wnd, k_min_wnd;
+
+    /* State. */
+    size_t max_dgram_size;
+    uint64_t bytes_in_flight, cong_wnd, slow_start_thresh;
+    OSSL_TIME cong_recovery_start_time;
+
+    /* CUBIC congestion avoidance state. */
+    uint64_t w_max; /* window before the last reduction */
+    uint64_t w_origin; /* origin point of the current cubic curve */
+    uint64_t w_est; /* Reno-friendly window estimate */
+    uint64_t k_ms; /* time to reach w_origin from the epoch start */
+    uint64_t est_bytes_acked; /* accumulator for w_est growth */
+    uint64_t cubic_acc; /* accumulator for cong_wnd growth */
+    OSSL_TIME epoch_start; /* zero if no epoch is in progress */
+    OSSL_TIME min_rtt; /* infinite if no sample yet */
+
+    /* Unflushed state during multiple on-loss calls. */
+    int processing_loss; /* 1 if not flushed */
+    OSSL_TIME tx_time_of_last_loss;
+
+    /* Diagnostic state. */
+    int in_congestion_recovery;
+
+    /* Diagnostic output locations. */
+    OSSL_CC_DIAG diag;
+} OSSL_CC_CUBIC;
+
+#define MIN_MAX_INIT_WND_SIZE 14720 /* RFC 9002 s. 7.2 */
+
+/* Multiplicative decrease factor, beta_cubic = 0.7 (RFC 9438 s. 4.6). */
+#define CUBIC_BETA_NUM 7
+#define CUBIC_BETA_DEN 10
+
+/*
+ * Scaling constant C = 0.4 (RFC 9438 s. 5). With t in milliseconds and the
+ * window in bytes, W_cubic(t) = C * (t - K)^3 * mss / 10^9 + W_max, so the
+ * cube of the time offset is multiplied by mss and divided by the following.
+ */
+#define CUBIC_C_DIV 2500000000ULL /* 10^9 / C */
+
+/* Clamp for the time offset so that its cube cannot overflow 64 bits. */
+#define CUBIC_MAX_T_MS 2000000
+
+static void cubic_set_max_dgram_size(OSSL_CC_CUBIC *cubic,
+    size_t max_dgram_size);
+static void cubic_update_diag(OSSL_CC_CUBIC *cubic);
+
+static void cubic_reset(OSSL_CC_DATA *cc);
+
+static OSSL_CC_DATA *cubic_new(OSSL_TIME (*now_cb)(void *arg),
+    void *now_cb_arg)
+{
+    OSSL_CC_CUBIC *cubic;
+
+    if ((cubic = OPENSSL_zalloc(sizeof(*cubic))) == NULL)
+        return NULL;
+
+    cubic->now_cb = now_cb;
+    cubic->now_cb_arg = now_cb_arg;
+
+    cubic_set_max_dgram_size(cubic, QUIC_MIN_INITIAL_DGRAM_LEN);
+    cubic_reset((OSSL_CC_DATA *)cubic);
+
+    return (OSSL_CC_DATA *)cubic;
+}
+
+static void cubic_free(OSSL_CC_DATA *cc)
+{
+    OPENSSL_free(cc);
+}
+
+static void cubic_set_max_dgram_size(OSSL_CC_CUBIC *cubic,
+    size_t max_dgram_size)
+{
+    size_t max_init_wnd;
+    int is_reduced = (max_dgram_size < cubic->max_dgram_size);
+
+    cubic->max_dgram_size = max_dgram_size;
+
+    max_init_wnd = 2 * max_dgram_size;
+    if (max_init_wnd < MIN_MAX_INIT_WND_SIZE)
+        max_init_wnd = MIN_MAX_INIT_WND_SIZE;
+
+    cubic->k_init_wnd = 10 * max_dgram_size;
+    if (cubic->k_init_wnd > max_init_wnd)
+        cubic->k_init_wnd = max_init_wnd;
+
+    cubic->k_min_wnd = 2 * max_dgram_size;
+
+    if (is_reduced)
+        cubic->cong_wnd = cubic->k_init_wnd;
+
+    cubic_update_diag(cubic);
+}
+
+static void cubic_reset(OSSL_CC_DATA *cc)
+{
+    OSSL_CC_CUBIC *cubic = (OSSL_CC_CUBIC *)cc;
+
+    cubic->cong_wnd = cubic->k_init_wnd;
+    cubic->bytes_in_flight = 0;
+    cubic->slow_start_thresh = UINT64_MAX;
+    cubic->cong_recovery_start_time = ossl_time_zero();
+
+    cubic->w_max = 0;
+    cubic->w_origin = 0;
+    cubic->w_est = 0;
+    cubic->k_ms = 0;
+    cubic->est_bytes_acked = 0;
+    cubic->cubic_acc = 0;
+    cubic->epoch_start = ossl_time_zero();
+    cubic->min_rtt = ossl_time_infinite();
+
+    cubic->processing_loss = 0;
+    cubic->tx_time_of_last_loss = ossl_time_zero();
+    cubic->in_congestion_recovery = 0;
+}
+
+static int cubic_set_input_params(OSSL_CC_DATA *cc, const OSSL_PARAM *params)
+{
+    OSSL_CC_CUBIC *cubic = (OSSL_CC_CUBIC *)cc;
+    const OSSL_PARAM *p;
+    size_t value;
+
+    p = OSSL_PARAM_locate_const(params, OSSL_CC_OPTION_MAX_DGRAM_PAYLOAD_LEN);
+    if (p != NULL) {
+        if (!OSSL_PARAM_get_size_t(p, &value))
+            return 0;
+        if (value < QUIC_MIN_INITIAL_DGRAM_LEN)
+            return 0;
+
+        cubic_set_max_dgram_size(cubic, value);
+    }
+
+    return 1;
+}
+
+static int cubic_bind_diagnostic(OSSL_CC_DATA *cc, OSSL_PARAM *params)
+{
+    OSSL_CC_CUBIC *cubic = (OSSL_CC_CUBIC *)cc;
+
+    if (!ossl_cc_diag_bind(&cubic->diag, params))
+        return 0;
+
+    cubic_update_diag(cubic);
+    return 1;
+}
+
+static int cubic_unbind_diagnostic(OSSL_CC_DATA *cc, OSSL_PARAM *params)
+{
+    OSSL_CC_CUBIC *cubic = (OSSL_CC_CUBIC *)cc;
+
+    ossl_cc_diag_unbind(&cubic->diag, params);
+    return 1;
+}
+
+static void cubic_update_diag(OSSL_CC_CUBIC *cubic)
+{
+    uint32_t state;
+
+    if (cubic->in_congestion_recovery)
+        state = 'R';
+    else if (cubic->cong_wnd < cubic->slow_start_thresh)
+        state = 'S';
+    else
+        state = 'C';
+
+    ossl_cc_diag_update(&cubic->diag, cubic->max_dgram_size, cubic->cong_wnd,
+        cubic->k_min_wnd, cubic->bytes_in_flight, state);
+}
+
+/* Integer cube root, rounded down. */
+static uint64_t cubic_cbrt(uint64_t v)
+{
+    uint64_t r = 0, b;
+    int s;
+
+    for (s = 63; s >= 0; s -= 3) {
+        r <<= 1;
+        b = 3 * r * (r + 1) + 1;
+        if ((v >> s) >= b) {
+            v -= b << s;
+            ++r;
+        }
+    }
+
+    return r;
+}
+
+/*
+ * Starts a new congestion avoidance epoch, computing the time K (in ms) it
+ * will take the cubic function to grow the current window back to W_max.
+ */
+static void cubic_start_epoch(OSSL_CC_CUBIC *cubic, OSSL_TIME now)
+{
+    int err = 0;
+    uint64_t k3;
+
+    cubic->epoch_start = now;
+    cubic->est_bytes_acked = 0;
+    cubic->cubic_acc = 0;
+    cubic->w_est = cubic->cong_wnd;
+
+    if (cubic->cong_wnd < cubic->w_max) {
+        /* K = cbrt((W_max - cwnd_epoch) / C), RFC 9438 s. 4.2. */
+        k3 = safe_muldiv_u64(cubic->w_max - cubic->cong_wnd, CUBIC_C_DIV,
+            cubic->max_dgram_size, &err);
+        if (err)
+            k3 = UINT64_MAX;
+
+        cubic->k_ms = cubic_cbrt(k3);
+        cubic->w_origin = cubic->w_max;
+    } else {
+        cubic->k_ms = 0;
+        cubic->w_origin = cubic->cong_wnd;
+    }
+}
+
+/* Computes W_cubic(t) in bytes, with t given in ms since the epoch start. */
+static uint64_t cubic_window_at(OSSL_CC_CUBIC *cubic, uint64_t t_ms)
+{
+    int err = 0, below = (t_ms < cubic->k_ms);
+    uint64_t d = below ? cubic->k_ms - t_ms : t_ms - cubic->k_ms, delta;
+
+    if (d > CUBIC_MAX_T_MS)
+        d = CUBIC_MAX_T_MS;
+
+    delta = safe_muldiv_u64(d * d * d, cubic->max_dgram_size, CUBIC_C_DIV,
+        &err);
+    if (err)
+        delta = UINT64_MAX;
+
+    if (below)
+        return delta >= cubic->w_origin ? 0 : cubic->w_origin - delta;
+
+    delta = safe_add_u64(cubic->w_origin, delta, &err);
+    return err ? UINT64_MAX : delta;
+}
+
+static int cubic_in_cong_recovery(OSSL_CC_CUBIC *cubic, OSSL_TIME tx_time)
+{
+    return ossl_time_compare(tx_time, cubic->cong_recovery_start_time) <= 0;
+}
+
+static void cubic_cong(OSSL_CC_CUBIC *cubic, OSSL_TIME tx_time)
+{
+    int err = 0;
+
+    /* No reaction if already in a recovery period. */
+    if (cubic_in_cong_recovery(cubic, tx_time))
+        return;
+
+    /* Start a new recovery period. */
+    cubic->in_congestion_recovery = 1;
+    cubic->cong_recovery_start_time = cubic->now_cb(cubic->now_cb_arg);
+
+    /*
+     * Fast convergence (RFC 9438 s. 4.7): if we are losing before reaching
+     * the previous W_max, another flow is probably taking bandwidth, so
+     * release some by remembering a lower W_max.
+     */
+    if (cubic->cong_wnd < cubic->w_max)
+        cubic->w_max = safe_muldiv_u64(cubic->cong_wnd,
+            CUBIC_BETA_DEN + CUBIC_BETA_NUM,
+            2 * CUBIC_BETA_DEN, &err);
+    else
+        cubic->w_max = cubic->cong_wnd;
+
+    /* slow_start_thresh = cong_wnd * beta_cubic */
+    cubic->slow_start_thresh = safe_muldiv_u64(cubic->cong_wnd,
+        CUBIC_BETA_NUM, CUBIC_BETA_DEN, &err);
+
+    if (err) {
+        cubic->w_max = UINT64_MAX;
+        cubic->slow_start_thresh = UINT64_MAX;
+    }
+
+    cubic->cong_wnd = cubic->slow_start_thresh;
+    if (cubic->cong_wnd < cubic->k_min_wnd)
+        cubic->cong_wnd = cubic->k_min_wnd;
+
+    /* The next acknowledgement in congestion avoidance starts a new epoch. */
+    cubic->epoch_start = ossl_time_zero();
+}
+
+static void cubic_flush(OSSL_CC_CUBIC *cubic, uint32_t flags)
+{
+    if (!cubic->processing_loss)
+        return;
+
+    cubic_cong(cubic, cubic->tx_time_of_last_loss);
+
+    if ((flags & OSSL_CC_LOST_FLAG_PERSISTENT_CONGESTION) != 0) {
+        cubic->cong_wnd = cubic->k_min_wnd;
+        cubic->cong_recovery_start_time = ossl_time_zero();
+        cubic->epoch_start = ossl_time_zero();
+    }
+
+    cubic->processing_loss = 0;
+    cubic_update_diag(cubic);
+}
+
+static uint64_t cubic_get_tx_allowance(OSSL_CC_DATA *cc)
+{
+    OSSL_CC_CUBIC *cubic = (OSSL_CC_CUBIC *)cc;
+
+    if (cubic->bytes_in_flight >= cubic->cong_wnd)
+        return 0;
+
+    return cubic->cong_wnd - cubic->bytes_in_flight;
+}
+
+static OSSL_TIME cubic_get_wakeup_deadline(OSSL_CC_DATA *cc)
+{
+    if (cubic_get_tx_allowance(cc) > 0) {
+        /* We have TX allowance now so wakeup immediately */
+        return ossl_time_zero();
+    } else {
+        /*
+         * Although the cubic function is a function of time, the window is
+         * only ever updated in response to acknowledgements.
+         */
+        return ossl_time_infinite();
+    }
+}
+
+static int cubic_on_data_sent(OSSL_CC_DATA *cc, uint64_t num_bytes)
+{
+    OSSL_CC_CUBIC *cubic = (OSSL_CC_CUBIC *)cc;
+
+    cubic->bytes_in_flight += num_bytes;
+    cubic_update_diag(cubic);
+    return 1;
+}
+
+static int cubic_is_cong_limited(OSSL_CC_CUBIC *cubic)
+{
+    uint64_t wnd_rem;
+
+    /* We are congestion-limited if we are already at the congestion window. */
+    if (cubic->bytes_in_flight >= cubic->cong_wnd)
+        return 1;
+
+    wnd_rem = cubic->cong_wnd - cubic->bytes_in_flight;
+
+    /* As for NewReno. */
+    return (cubic->cong_wnd < cubic->slow_start_thresh
+               && wnd_rem <= cubic->cong_wnd / 2)
+        || wnd_rem <= 3 * cubic->max_dgram_size;
+}
+
+static void cubic_avoid_cong(OSSL_CC_CUBIC *cubic, size_t acked)
+{
+    OSSL_TIME now = cubic->now_cb(cubic->now_cb_arg);
+    uint64_t t_ms, target, max_target, inc;
+    int err = 0;
+
+    if (ossl_time_is_zero(cubic->epoch_start))
+        cubic_start_epoch(cubic, now);
+
+    /*
+     * Target the window the cubic function gives one RTT from now
+     * (RFC 9438 s. 4.2), limited to 1.5 times the current window.
+     */
+    t_ms = ossl_time2ms(ossl_time_subtract(now, cubic->epoch_start));
+    if (!ossl_time_is_infinite(cubic->min_rtt))
+        t_ms += ossl_time2ms(cubic->min_rtt);
+
+    target = cubic_window_at(cubic, t_ms);
+    max_target = cubic->cong_wnd + cubic->cong_wnd / 2;
+    if (target > max_target)
+        target = max_target;
+
+    /*
+     * Reno-friendly region (RFC 9438 s. 4.3): W_est grows by
+     * alpha_cubic = 3 * (1 - beta) / (1 + beta) = 9/17 datagrams for every
+     * congestion window's worth of acknowledged data.
+     */
+    cubic->est_bytes_acked += (uint64_t)acked * 9;
+    while (cubic->est_bytes_acked >= cubic->cong_wnd * 17) {
+        cubic->est_bytes_acked -= cubic->cong_wnd * 17;
+        cubic->w_est += cubic->max_dgram_size;
+    }
+
+    if (target < cubic->w_est) {
+        if (cubic->w_est > cubic->cong_wnd)
+            cubic->cong_wnd = cubic->w_est;
+        return;
+    }
+
+    if (target <= cubic->cong_wnd)
+        return;
+
+    /* cong_wnd += (target - cong_wnd) * acked / cong_wnd */
+    cubic->cubic_acc = safe_add_u64(cubic->cubic_acc,
+        safe_mul_u64(target - cubic->cong_wnd, acked, &err), &err);
+    if (err) {
+        cubic->cubic_acc = 0;
+        cubic->cong_wnd = target;
+        return;
+    }
+
+    inc = cubic->cubic_acc / cubic->cong_wnd;
+    cubic->cubic_acc -= inc * cubic->cong_wnd;
+    cubic->cong_wnd += inc;
+}
+
+static int cubic_on_data_acked(OSSL_CC_DATA *cc,
+    const OSSL_CC_ACK_INFO *info)
+{
+    OSSL_CC_CUBIC *cubic = (OSSL_CC_CUBIC *)cc;
+    OSSL_TIME rtt;
+
+    /*
+     * Packet has been acked. Firstly, remove it from the aggregate count of
+     * bytes in flight.
+     */
+    cubic->bytes_in_flight -= info->tx_size;
+
+    /*
+     * Track the minimum RTT observed, which is used to look one RTT ahead on
+     * the cubic curve. This includes any ACK delay, which only makes us more
+     * conservative.
+     */
+    rtt = ossl_time_subtract(cubic->now_cb(cubic->now_cb_arg), info->tx_time);
+    if (ossl_time_compare(rtt, cubic->min_rtt) < 0)
+        cubic->min_rtt = rtt;
+
+    /* As for NewReno, only grow the window if we are actually using it. */
+    if (!cubic_is_cong_limited(cubic))
+        goto out;
+
+    if (cubic_in_cong_recovery(cubic, info->tx_time)) {
+        /* Congestion recovery, do nothing. */
+    } else if (cubic->cong_wnd < cubic->slow_start_thresh) {
+        /* Slow start. */
+        cubic->cong_wnd += info->tx_size;
+        cubic->in_congestion_recovery = 0;
+    } else {
+        /* Congestion avoidance. */
+        cubic_avoid_cong(cubic, info->tx_size);
+        cubic->in_congestion_recovery = 0;
+    }
+
+out:
+    cubic_update_diag(cubic);
+    return 1;
+}
+
+static int cubic_on_data_lost(OSSL_CC_DATA *cc,
+    const OSSL_CC_LOSS_INFO *info)
+{
+    OSSL_CC_CUBIC *cubic = (OSSL_CC_CUBIC *)cc;
+
+    if (info->tx_size > cubic->bytes_in_flight)
+        return 0;
+
+    cubic->bytes_in_flight -= info->tx_size;
+
+    if (!cubic->processing_loss) {
+        if (ossl_time_compare(info->tx_time, cubic->tx_time_of_last_loss) <= 0)
+            /*
+             * As for NewReno, a loss of a packet sent before the last one we
+             * reacted to does not constitute a new congestion event.
+             */
+            goto out;
+
+        cubic->processing_loss = 1;
+    }
+
+    cubic->tx_time_of_last_loss
+        = ossl_time_max(cubic->tx_time_of_last_loss, info->tx_time);
+
+out:
+    cubic_update_diag(cubic);
+    return 1;
+}
+
+static int cubic_on_data_lost_finished(OSSL_CC_DATA *cc, uint32_t flags)
+{
+    OSSL_CC_CUBIC *cubic = (OSSL_CC_CUBIC *)cc;
+
+    cubic_flush(cubic, flags);
+    return 1;
+}
+
+static int cubic_on_data_invalidated(OSSL_CC_DATA *cc,
+    uint64_t num_bytes)
+{
+    OSSL_CC_CUBIC *cubic = (OSSL_CC_CUBIC *)cc;
+
+    cubic->bytes_in_flight -= num_bytes;
+    cubic_update_diag(cubic);
+    return 1;
+}
+
+static int cubic_on_ecn(OSSL_CC_DATA *cc,
+    const OSSL_CC_ECN_INFO *info)
+{
+    OSSL_CC_CUBIC *cubic = (OSSL_CC_CUBIC *)cc;
+
+    cubic->processing_loss = 1;
+    cubic->tx_time_of_last_loss = info->largest_acked_time;
+    cubic_flush(cubic, 0);
+    return 1;
+}
+
+/* Pacing gains are the same as for NewReno. */
+static uint64_t cubic_get_pacing_rate(OSSL_CC_DATA *cc, OSSL_TIME srtt)
+{
+    OSSL_CC_CUBIC *cubic = (OSSL_CC_CUBIC *)cc;
+
+    return ossl_quic_pacer_rate_from_cwnd(cubic->cong_wnd, srtt,
+        cubic->cong_wnd < cubic->slow_start_thresh ? 200 : 125);
+}
+
+const OSSL_CC_METHOD ossl_cc_cubic_method = {
+    cubic_new,
+    cubic_free,
+    cubic_reset,
+    cubic_set_input_params,
+    cubic_bind_diagnostic,
+    cubic_unbind_diagnostic,
+    cubic_get_tx_allowance,
+    cubic_get_wakeup_deadline,
+    cubic_on_data_sent,
+    cubic_on_data_acked,
+    cubic_on_data_lost,
+    cubic_on_data_lost_finished,
+    cubic_on_data_invalidated,
+    cubic_on_ecn,
+    cubic_get_pacing_rate,
+};
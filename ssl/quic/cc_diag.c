@@ -0,0 +1,112 @@
+/*
+ * Copyright 2026 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include "internal/quic_cc.h"
+
+/*
+ * Diagnostic binding common to all of the built-in congestion controllers.
+ */
+static int bind_diag(OSSL_PARAM *params, const char *param_name, size_t len,
+    void **pp)
+{
+    const OSSL_PARAM *p = OSSL_PARAM_locate_const(params, param_name);
+
+    *pp = NULL;
+
+    if (p == NULL)
+        return 1;
+
+    if (p->data_type != OSSL_PARAM_UNSIGNED_INTEGER
+        || p->data_size != len)
+        return 0;
+
+    *pp = p->data;
+    return 1;
+}
+
+int ossl_cc_diag_bind(OSSL_CC_DIAG *diag, OSSL_PARAM *params)
+{
+    size_t *new_p_max_dgram_payload_len;
+    uint64_t *new_p_cur_cwnd_size;
+    uint64_t *new_p_min_cwnd_size;
+    uint64_t *new_p_cur_bytes_in_flight;
+    uint32_t *new_p_cur_state;
+
+    if (!bind_diag(params, OSSL_CC_OPTION_MAX_DGRAM_PAYLOAD_LEN,
+            sizeof(size_t), (void **)&new_p_max_dgram_payload_len)
+        || !bind_diag(params, OSSL_CC_OPTION_CUR_CWND_SIZE,
+            sizeof(uint64_t), (void **)&new_p_cur_cwnd_size)
+        || !bind_diag(params, OSSL_CC_OPTION_MIN_CWND_SIZE,
+            sizeof(uint64_t), (void **)&new_p_min_cwnd_size)
+        || !bind_diag(params, OSSL_CC_OPTION_CUR_BYTES_IN_FLIGHT,
+            sizeof(uint64_t), (void **)&new_p_cur_bytes_in_flight)
+        || !bind_diag(params, OSSL_CC_OPTION_CUR_STATE,
+            sizeof(uint32_t), (void **)&new_p_cur_state))
+        return 0;
+
+    if (new_p_max_dgram_payload_len != NULL)
+        diag->p_max_dgram_payload_len = new_p_max_dgram_payload_len;
+
+    if (new_p_cur_cwnd_size != NULL)
+        diag->p_cur_cwnd_size = new_p_cur_cwnd_size;
+
+    if (new_p_min_cwnd_size != NULL)
+        diag->p_min_cwnd_size = new_p_min_cwnd_size;
+
+    if (new_p_cur_bytes_in_flight != NULL)
+        diag->p_cur_bytes_in_flight = new_p_cur_bytes_in_flight;
+
+    if (new_p_cur_state != NULL)
+        diag->p_cur_state = new_p_cur_state;
+
+    return 1;
+}
+
+static void unbind_diag(OSSL_PARAM *params, const char *param_name,
+    void **pp)
+{
+    const OSSL_PARAM *p = OSSL_PARAM_locate_const(params, param_name);
+
+    if (p != NULL)
+        *pp = NULL;
+}
+
+void ossl_cc_diag_unbind(OSSL_CC_DIAG *diag, OSSL_PARAM *params)
+{
+    unbind_diag(params, OSSL_CC_OPTION_MAX_DGRAM_PAYLOAD_LEN,
+        (void **)&diag->p_max_dgram_payload_len);
+    unbind_diag(params, OSSL_CC_OPTION_CUR_CWND_SIZE,
+        (void **)&diag->p_cur_cwnd_size);
+    unbind_diag(params, OSSL_CC_OPTION_MIN_CWND_SIZE,
+        (void **)&diag->p_min_cwnd_size);
+    unbind_diag(params, OSSL_CC_OPTION_CUR_BYTES_IN_FLIGHT,
+        (void **)&diag->p_cur_bytes_in_flight);
+    unbind_diag(params, OSSL_CC_OPTION_CUR_STATE,
+        (void **)&diag->p_cur_state);
+}
+
+void ossl_cc_diag_update(const OSSL_CC_DIAG *diag, size_t max_dgram_size,
+    uint64_t cwnd_size, uint64_t min_cwnd_size,
+    uint64_t bytes_in_flight, uint32_t state)
+{
+    if (diag->p_max_dgram_payload_len != NULL)
+        *diag->p_max_dgram_payload_len = max_dgram_size;
+
+    if (diag->p_cur_cwnd_size != NULL)
+        *diag->p_cur_cwnd_size = cwnd_size;
+
+    if (diag->p_min_cwnd_size != NULL)
+        *diag->p_min_cwnd_size = min_cwnd_size;
+
+    if (diag->p_cur_bytes_in_flight != NULL)
+        *diag->p_cur_bytes_in_flight = bytes_in_flight;
+
+    if (diag->p_cur_state != NULL)
+        *diag->p_cur_state = state;
+}
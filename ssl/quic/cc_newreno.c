@@ -1,4 +1,5 @@
 #include "internal/quic_cc.h"
+#include "internal/quic_pacer.h"
 #include "internal/quic_types.h"
 #include "internal/safe_math.h"
 
@@ -27,11 +28,7 @@ typedef struct ossl_cc_newreno_st {
     int in_congestion_recovery;
 
     /* Diagnostic output locations. */
-    size_t *p_diag_max_dgram_payload_len;
-    uint64_t *p_diag_cur_cwnd_size;
-    uint64_t *p_diag_min_cwnd_size;
-    uint64_t *p_diag_cur_bytes_in_flight;
-    uint32_t *p_diag_cur_state;
+    OSSL_CC_DIAG diag;
 } OSSL_CC_NEWRENO;
 
 #define MIN_MAX_INIT_WND_SIZE 14720 /* RFC 9002 s. 7.2 */
@@ -128,112 +125,38 @@ static int newreno_set_input_params(OSSL_CC_DATA *cc, const OSSL_PARAM *params)
     return 1;
 }
 
-static int bind_diag(OSSL_PARAM *params, const char *param_name, size_t len,
-    void **pp)
-{
-    const OSSL_PARAM *p = OSSL_PARAM_locate_const(params, param_name);
-
-    *pp = NULL;
-
-    if (p == NULL)
-        return 1;
-
-    if (p->data_type != OSSL_PARAM_UNSIGNED_INTEGER
-        || p->data_size != len)
-        return 0;
-
-    *pp = p->data;
-    return 1;
-}
-
 static int newreno_bind_diagnostic(OSSL_CC_DATA *cc, OSSL_PARAM *params)
 {
     OSSL_CC_NEWRENO *nr = (OSSL_CC_NEWRENO *)cc;
-    size_t *new_p_max_dgram_payload_len;
-    uint64_t *new_p_cur_cwnd_size;
-    uint64_t *new_p_min_cwnd_size;
-    uint64_t *new_p_cur_bytes_in_flight;
-    uint32_t *new_p_cur_state;
-
-    if (!bind_diag(params, OSSL_CC_OPTION_MAX_DGRAM_PAYLOAD_LEN,
-            sizeof(size_t), (void **)&new_p_max_dgram_payload_len)
-        || !bind_diag(params, OSSL_CC_OPTION_CUR_CWND_SIZE,
-            sizeof(uint64_t), (void **)&new_p_cur_cwnd_size)
-        || !bind_diag(params, OSSL_CC_OPTION_MIN_CWND_SIZE,
-            sizeof(uint64_t), (void **)&new_p_min_cwnd_size)
-        || !bind_diag(params, OSSL_CC_OPTION_CUR_BYTES_IN_FLIGHT,
-            sizeof(uint64_t), (void **)&new_p_cur_bytes_in_flight)
-        || !bind_diag(params, OSSL_CC_OPTION_CUR_STATE,
-            sizeof(uint32_t), (void **)&new_p_cur_state))
-        return 0;
-
-    if (new_p_max_dgram_payload_len != NULL)
-        nr->p_diag_max_dgram_payload_len = new_p_max_dgram_payload_len;
-
-    if (new_p_cur_cwnd_size != NULL)
-        nr->p_diag_cur_cwnd_size = new_p_cur_cwnd_size;
-
-    if (new_p_min_cwnd_size != NULL)
-        nr->p_diag_min_cwnd_size = new_p_min_cwnd_size;
 
-    if (new_p_cur_bytes_in_flight != NULL)
-        nr->p_diag_cur_bytes_in_flight = new_p_cur_bytes_in_flight;
-
-    if (new_p_cur_state != NULL)
-        nr->p_diag_cur_state = new_p_cur_state;
+    if (!ossl_cc_diag_bind(&nr->diag, params))
+        return 0;
 
     newreno_update_diag(nr);
     return 1;
 }
 
-static void unbind_diag(OSSL_PARAM *params, const char *param_name,
-    void **pp)
-{
-    const OSSL_PARAM *p = OSSL_PARAM_locate_const(params, param_name);
-
-    if (p != NULL)
-        *pp = NULL;
-}
-
 static int newreno_unbind_diagnostic(OSSL_CC_DATA *cc, OSSL_PARAM *params)
 {
     OSSL_CC_NEWRENO *nr = (OSSL_CC_NEWRENO *)cc;
 
-    unbind_diag(params, OSSL_CC_OPTION_MAX_DGRAM_PAYLOAD_LEN,
-        (void **)&nr->p_diag_max_dgram_payload_len);
-    unbind_diag(params, OSSL_CC_OPTION_CUR_CWND_SIZE,
-        (void **)&nr->p_diag_cur_cwnd_size);
-    unbind_diag(params, OSSL_CC_OPTION_MIN_CWND_SIZE,
-        (void **)&nr->p_diag_min_cwnd_size);
-    unbind_diag(params, OSSL_CC_OPTION_CUR_BYTES_IN_FLIGHT,
-        (void **)&nr->p_diag_cur_bytes_in_flight);
-    unbind_diag(params, OSSL_CC_OPTION_CUR_STATE,
-        (void **)&nr->p_diag_cur_state);
+    ossl_cc_diag_unbind(&nr->diag, params);
     return 1;
 }
 
 static void newreno_update_diag(OSSL_CC_NEWRENO *nr)
 {
-    if (nr->p_diag_max_dgram_payload_len != NULL)
-        *nr->p_diag_max_dgram_payload_len = nr->max_dgram_size;
-
-    if (nr->p_diag_cur_cwnd_size != NULL)
-        *nr->p_diag_cur_cwnd_size = nr->cong_wnd;
+    uint32_t state;
 
-    if (nr->p_diag_min_cwnd_size != NULL)
-        *nr->p_diag_min_cwnd_size = nr->k_min_wnd;
+    if (nr->in_congestion_recovery)
+        state = 'R';
+    else if (nr->cong_wnd < nr->slow_start_thresh)
+        state = 'S';
+    else
+        state = 'A';
 
-    if (nr->p_diag_cur_bytes_in_flight != NULL)
-        *nr->p_diag_cur_bytes_in_flight = nr->bytes_in_flight;
-
-    if (nr->p_diag_cur_state != NULL) {
-        if (nr->in_congestion_recovery)
-            *nr->p_diag_cur_state = 'R';
-        else if (nr->cong_wnd < nr->slow_start_thresh)
-            *nr->p_diag_cur_state = 'S';
-        else
-            *nr->p_diag_cur_state = 'A';
-    }
+    ossl_cc_diag_update(&nr->diag, nr->max_dgram_size, nr->cong_wnd,
+        nr->k_min_wnd, nr->bytes_in_flight, state);
 }
 
 static int newreno_in_cong_recovery(OSSL_CC_NEWRENO *nr, OSSL_TIME tx_time)
@@ -467,6 +390,19 @@ static int newreno_on_ecn(OSSL_CC_DATA *cc,
     return 1;
 }
 
+/*
+ * Pace at twice the window per RTT during slow start, so that pacing does not
+ * hold back the growth of the window, and at 1.25 times the window per RTT
+ * otherwise (RFC 9002 s. 7.7).
+ */
+static uint64_t newreno_get_pacing_rate(OSSL_CC_DATA *cc, OSSL_TIME srtt)
+{
+    OSSL_CC_NEWRENO *nr = (OSSL_CC_NEWRENO *)cc;
+
+    return ossl_quic_pacer_rate_from_cwnd(nr->cong_wnd, srtt,
+        nr->cong_wnd < nr->slow_start_thresh ? 200 : 125);
+}
+
 const OSSL_CC_METHOD ossl_cc_newreno_method = {
     newreno_new,
     newreno_free,
@@ -482,4 +418,5 @@ const OSSL_CC_METHOD ossl_cc_newreno_method = {
     newreno_on_data_lost_finished,
     newreno_on_data_invalidated,
     newreno_on_ecn,
+    newreno_get_pacing_rate,
 };
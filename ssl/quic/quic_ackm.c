@@ -1757,3 +1757,10 @@ void ossl_ackm_set_tx_max_ack_delay(OSSL_ACKM *ackm, OSSL_TIME tx_max_ack_delay)
 {
     ackm->tx_max_ack_delay = tx_max_ack_delay;
 }
+
+void ossl_ackm_set_cc_method(OSSL_ACKM *ackm, const OSSL_CC_METHOD *cc_method,
+    OSSL_CC_DATA *cc_data)
+{
+    ackm->cc_method = cc_method;
+    ackm->cc_data = cc_data;
+}
@@ -208,7 +208,8 @@ static int ch_init(QUIC_CHANNEL *ch)
         goto err;
 
     ch->have_statm = 1;
-    ch->cc_method = &ossl_cc_newreno_method;
+    if (ch->cc_method == NULL)
+        ch->cc_method = &ossl_cc_newreno_method;
     if ((ch->cc_data = ch->cc_method->new(get_time, ch)) == NULL)
         goto err;
 
@@ -246,6 +247,7 @@ static int ch_init(QUIC_CHANNEL *ch)
     txp_args.max_streams_uni_rxfc = &ch->max_streams_uni_rxfc;
     txp_args.cc_method = ch->cc_method;
     txp_args.cc_data = ch->cc_data;
+    txp_args.statm = &ch->statm;
     txp_args.now = get_time;
     txp_args.now_arg = ch;
     txp_args.get_qlog_cb = ch_get_qlog_cb;
@@ -264,6 +266,9 @@ static int ch_init(QUIC_CHANNEL *ch)
     if (ch->txp == NULL)
         goto err;
 
+    if (ch->pacing && !ossl_quic_tx_packetiser_set_pacing(ch->txp, 1))
+        goto err;
+
     /* clients have no amplification limit, so are considered always valid */
     if (!ch->is_server)
         ossl_quic_tx_packetiser_set_validated(ch->txp);
@@ -467,6 +472,8 @@ QUIC_CHANNEL *ossl_quic_channel_alloc(const QUIC_CHANNEL_ARGS *args)
         return NULL;
 
     ch->port = args->port;
+    ch->cc_method = args->cc_method;
+    ch->pacing = (args->pacing != 0);
     ch->is_server = args->is_server;
     ch->tls = args->tls;
     ch->lcidm = args->lcidm;
@@ -4322,6 +4329,54 @@ uint64_t ossl_quic_channel_get_max_ack_delay_peer_request(const QUIC_CHANNEL *ch
     return ch->rx_max_ack_delay;
 }
 
+int ossl_quic_channel_set_cc_method(QUIC_CHANNEL *ch,
+    const OSSL_CC_METHOD *cc_method)
+{
+    OSSL_CC_DATA *cc_data;
+
+    /* Nothing can have been sent yet, so no state needs to carry over. */
+    if (ossl_quic_channel_have_generated_transport_params(ch))
+        return 0;
+
+    if (cc_method == ch->cc_method)
+        return 1;
+
+    if ((cc_data = cc_method->new(get_time, ch)) == NULL)
+        return 0;
+
+    ch->cc_method->free(ch->cc_data);
+    ch->cc_method = cc_method;
+    ch->cc_data = cc_data;
+
+    ossl_ackm_set_cc_method(ch->ackm, ch->cc_method, ch->cc_data);
+    ossl_quic_tx_packetiser_set_cc_method(ch->txp, ch->cc_method, ch->cc_data);
+    return 1;
+}
+
+const OSSL_CC_METHOD *ossl_quic_channel_get_cc_method(const QUIC_CHANNEL *ch)
+{
+    return ch->cc_method;
+}
+
+int ossl_quic_channel_set_pacing(QUIC_CHANNEL *ch, int enable)
+{
+    if (!ossl_quic_tx_packetiser_set_pacing(ch->txp, enable))
+        return 0;
+
+    ch->pacing = (enable != 0);
+    return 1;
+}
+
+int ossl_quic_channel_get_pacing(const QUIC_CHANNEL *ch)
+{
+    return ch->pacing;
+}
+
+uint64_t ossl_quic_channel_get_pacing_burst(const QUIC_CHANNEL *ch)
+{
+    return ossl_quic_tx_packetiser_get_pacing_burst(ch->txp);
+}
+
 int ossl_quic_channel_set_disable_active_migration_request(QUIC_CHANNEL *ch, uint64_t disable)
 {
     if (ossl_quic_channel_have_generated_transport_params(ch))
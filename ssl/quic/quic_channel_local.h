@@ -503,6 +503,9 @@ struct quic_channel_st {
 
     /* Has qlog been requested? */
     unsigned int is_tserver_ch : 1;
+
+    /* Has pacing been requested? */
+    unsigned int pacing : 1;
     /*
      * RFC 9000 Section 9.2.1 says:
      *      However, an endpoint SHOULD NOT send multiple
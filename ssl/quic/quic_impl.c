@@ -19,6 +19,7 @@
 #include "internal/quic_error.h"
 #include "internal/quic_engine.h"
 #include "internal/quic_port.h"
+#include "internal/quic_cc.h"
 #include "internal/quic_reactor_wait_ctx.h"
 #include "internal/time.h"
 
@@ -733,6 +734,10 @@ static void qc_cleanup(QUIC_CONNECTION *qc, int have_lock)
 QUIC_TAKES_LOCK
 static void quic_free_listener(QCTX *ctx)
 {
+#if defined(OPENSSL_THREADS)
+    /* Other shards must stop ticking us before we tear anything down. */
+    ossl_quic_port_leave_shard_group(ctx->ql->port);
+#endif
     quic_unref_port_bios(ctx->ql->port);
     ossl_quic_port_drop_incoming(ctx->ql->port);
     ossl_quic_port_free(ctx->ql->port);
@@ -1809,7 +1814,8 @@ static int tls_wants_non_io_retry(QUIC_CONNECTION *qc)
 
     if (want == SSL_X509_LOOKUP
         || want == SSL_CLIENT_HELLO_CB
-        || want == SSL_RETRY_VERIFY)
+        || want == SSL_RETRY_VERIFY
+        || want == SSL_PRIVATE_KEY_OPERATION)
         return 1;
 
     return 0;
@@ -2473,6 +2479,9 @@ static int error_to_want(int error)
 
     case SSL_ERROR_WANT_X509_LOOKUP:
         return SSL_X509_LOOKUP;
+
+    case SSL_ERROR_WANT_PRIVATE_KEY_OPERATION:
+        return SSL_PRIVATE_KEY_OPERATION;
     }
 }
 
@@ -2946,6 +2955,77 @@ int ossl_quic_write(SSL *s, const void *buf, size_t len, size_t *written)
     return ossl_quic_write_flags(s, buf, len, 0, written);
 }
 
+/*
+ * SSL_write_ex_nocopy
+ * -------------------
+ *
+ * The buffer is referenced by the stream rather than copied into it, so the
+ * whole buffer is always accepted and there is no backpressure here; the TXP
+ * still only transmits the data as flow control permits.
+ */
+QUIC_TAKES_LOCK
+int ossl_quic_write_nocopy(SSL *s, const void *buf, size_t len,
+    uint64_t flags,
+    SSL_write_release_cb_fn release_cb,
+    void *arg)
+{
+    int ret, err;
+    size_t written;
+    QCTX ctx;
+
+    if (len == 0) {
+        if (!ossl_quic_write_flags(s, buf, 0, flags, &written))
+            return 0;
+
+        if (release_cb != NULL)
+            release_cb(buf, 0, arg);
+
+        return 1;
+    }
+
+    if (!expect_quic_with_stream_lock(s, /*remote_init=*/0, /*io=*/1, &ctx))
+        return 0;
+
+    if ((flags & ~SSL_WRITE_FLAG_CONCLUDE) != 0) {
+        ret = QUIC_RAISE_NON_NORMAL_ERROR(&ctx, SSL_R_UNSUPPORTED_WRITE_FLAG, NULL);
+        goto out;
+    }
+
+    if (!quic_mutation_allowed(ctx.qc, /*req_active=*/0)) {
+        ret = QUIC_RAISE_NON_NORMAL_ERROR(&ctx, SSL_R_PROTOCOL_IS_SHUTDOWN, NULL);
+        goto out;
+    }
+
+    if (quic_do_handshake(&ctx) < 1) {
+        ret = 0;
+        goto out;
+    }
+
+    if (!quic_validate_for_write(ctx.xso, &err)) {
+        ret = QUIC_RAISE_NON_NORMAL_ERROR(&ctx, err, NULL);
+        goto out;
+    }
+
+    /* The rest of an incomplete SSL_write() must be appended first. */
+    if (ctx.xso->aon_write_in_progress) {
+        ret = QUIC_RAISE_NON_NORMAL_ERROR(&ctx, SSL_R_BAD_WRITE_RETRY, NULL);
+        goto out;
+    }
+
+    if (!ossl_quic_sstream_append_nocopy(ctx.xso->stream->sstream, buf, len,
+            release_cb, arg)) {
+        ret = QUIC_RAISE_NON_NORMAL_ERROR(&ctx, ERR_R_INTERNAL_ERROR, NULL);
+        goto out;
+    }
+
+    quic_post_write(ctx.xso, 1, 1, flags, qctx_should_autotick(&ctx));
+    ret = 1;
+
+out:
+    qctx_unlock(&ctx);
+    return ret;
+}
+
 /*
  * SSL_read
  * --------
@@ -4026,6 +4106,105 @@ static int qc_getset_max_pending_channels(QCTX *ctx, uint32_t class_,
     return ret;
 }
 
+static const OSSL_CC_METHOD *const quic_cc_methods[] = {
+    &ossl_cc_newreno_method, /* SSL_VALUE_QUIC_CC_NEWRENO */
+    &ossl_cc_cubic_method, /* SSL_VALUE_QUIC_CC_CUBIC */
+    &ossl_cc_bbr_method, /* SSL_VALUE_QUIC_CC_BBR */
+};
+
+QUIC_TAKES_LOCK
+static int qc_getset_congestion_control(QCTX *ctx, uint32_t class_,
+    uint64_t *p_value_out, uint64_t *p_value_in)
+{
+    int ret = 0;
+    uint64_t value_out = 0;
+    const OSSL_CC_METHOD *cur;
+
+    if (class_ != SSL_VALUE_CLASS_GENERIC) {
+        QUIC_RAISE_NON_NORMAL_ERROR(ctx, SSL_R_UNSUPPORTED_CONFIG_VALUE_CLASS,
+            NULL);
+        return 0;
+    }
+
+    if (p_value_in != NULL && *p_value_in >= OSSL_NELEM(quic_cc_methods)) {
+        QUIC_RAISE_NON_NORMAL_ERROR(ctx, ERR_R_PASSED_INVALID_ARGUMENT, NULL);
+        return 0;
+    }
+
+    qctx_lock(ctx);
+
+    cur = ctx->is_listener
+        ? ossl_quic_port_get_cc_method(ctx->ql->port)
+        : ossl_quic_channel_get_cc_method(ctx->qc->ch);
+
+    for (value_out = 0; value_out < OSSL_NELEM(quic_cc_methods); ++value_out)
+        if (quic_cc_methods[value_out] == cur)
+            break;
+
+    if (p_value_in != NULL) {
+        if (ctx->is_listener) {
+            ossl_quic_port_set_cc_method(ctx->ql->port,
+                quic_cc_methods[*p_value_in]);
+        } else if (!ossl_quic_channel_set_cc_method(ctx->qc->ch,
+                       quic_cc_methods[*p_value_in])) {
+            QUIC_RAISE_NON_NORMAL_ERROR(ctx, SSL_R_FEATURE_NOT_RENEGOTIABLE,
+                NULL);
+            goto err;
+        }
+    }
+
+    ret = 1;
+err:
+    qctx_unlock(ctx);
+    if (ret && p_value_out != NULL)
+        *p_value_out = value_out;
+
+    return ret;
+}
+
+QUIC_TAKES_LOCK
+static int qc_getset_pacing(QCTX *ctx, uint32_t class_,
+    uint64_t *p_value_out, uint64_t *p_value_in)
+{
+    int ret = 0;
+    uint64_t value_out = 0;
+
+    if (class_ != SSL_VALUE_CLASS_GENERIC) {
+        QUIC_RAISE_NON_NORMAL_ERROR(ctx, SSL_R_UNSUPPORTED_CONFIG_VALUE_CLASS,
+            NULL);
+        return 0;
+    }
+
+    if (p_value_in != NULL && *p_value_in > 1) {
+        QUIC_RAISE_NON_NORMAL_ERROR(ctx, ERR_R_PASSED_INVALID_ARGUMENT, NULL);
+        return 0;
+    }
+
+    qctx_lock(ctx);
+
+    value_out = ctx->is_listener
+        ? ossl_quic_port_get_pacing(ctx->ql->port)
+        : ossl_quic_channel_get_pacing(ctx->qc->ch);
+
+    if (p_value_in != NULL) {
+        if (ctx->is_listener) {
+            ossl_quic_port_set_pacing(ctx->ql->port, (int)*p_value_in);
+        } else if (!ossl_quic_channel_set_pacing(ctx->qc->ch,
+                       (int)*p_value_in)) {
+            QUIC_RAISE_NON_NORMAL_ERROR(ctx, ERR_R_INTERNAL_ERROR, NULL);
+            goto err;
+        }
+    }
+
+    ret = 1;
+err:
+    qctx_unlock(ctx);
+    if (ret && p_value_out != NULL)
+        *p_value_out = value_out;
+
+    return ret;
+}
+
 QUIC_TAKES_LOCK
 static int qc_get_stream_avail(QCTX *ctx, uint32_t class_,
     int is_uni, int is_remote,
@@ -4169,6 +4348,8 @@ static int expect_quic_for_value(SSL *s, QCTX *ctx, uint32_t id)
     case SSL_VALUE_QUIC_ACK_DELAY_EXPONENT:
     case SSL_VALUE_QUIC_ACK_DELAY_MAX:
     case SSL_VALUE_QUIC_MAX_PENDING_CONNS:
+    case SSL_VALUE_QUIC_CONGESTION_CONTROL:
+    case SSL_VALUE_QUIC_PACING:
         return expect_quic_cl(s, ctx);
     default:
         return expect_quic_conn_only(s, ctx);
@@ -4205,6 +4386,10 @@ int ossl_quic_get_value_uint(SSL *s, uint32_t class_, uint32_t id,
         return qc_getset_max_ack_delay(&ctx, class_, value, NULL);
     case SSL_VALUE_QUIC_MAX_PENDING_CONNS:
         return qc_getset_max_pending_channels(&ctx, class_, value, NULL);
+    case SSL_VALUE_QUIC_CONGESTION_CONTROL:
+        return qc_getset_congestion_control(&ctx, class_, value, NULL);
+    case SSL_VALUE_QUIC_PACING:
+        return qc_getset_pacing(&ctx, class_, value, NULL);
 
     case SSL_VALUE_QUIC_STREAM_BIDI_LOCAL_AVAIL:
         return qc_get_stream_avail(&ctx, class_, /*uni=*/0, /*remote=*/0, value);
@@ -4265,6 +4450,10 @@ int ossl_quic_set_value_uint(SSL *s, uint32_t class_, uint32_t id,
         return qc_getset_max_ack_delay(&ctx, class_, NULL, &value);
     case SSL_VALUE_QUIC_MAX_PENDING_CONNS:
         return qc_getset_max_pending_channels(&ctx, class_, NULL, &value);
+    case SSL_VALUE_QUIC_CONGESTION_CONTROL:
+        return qc_getset_congestion_control(&ctx, class_, NULL, &value);
+    case SSL_VALUE_QUIC_PACING:
+        return qc_getset_pacing(&ctx, class_, NULL, &value);
 
     default:
         return QUIC_RAISE_NON_NORMAL_ERROR(&ctx,
@@ -4787,12 +4976,64 @@ err:
  * SSL_new_listener_from
  * ---------------------
  */
+#if defined(OPENSSL_THREADS)
+/*
+ * Creates a new listener with its own engine, mutex and port, and adds it to
+ * the shard group of the listener ssl.
+ */
+static SSL *quic_new_listener_shard(SSL *ssl, uint64_t flags)
+{
+    QCTX ctx, new_ctx;
+    SSL *new_ssl;
+    int ok;
+
+    if (!expect_quic_listener(ssl, &ctx))
+        return NULL;
+
+    /* Each shard needs an engine of its own, so a domain cannot be sharded. */
+    if (ctx.ql->domain != NULL) {
+        QUIC_RAISE_NON_NORMAL_ERROR(NULL, ERR_R_PASSED_INVALID_ARGUMENT, NULL);
+        return NULL;
+    }
+
+    new_ssl = ossl_quic_new_listener(ssl->ctx, flags & ~SSL_LISTENER_FLAG_SHARD);
+    if (new_ssl == NULL)
+        return NULL;
+
+    if (!expect_quic_listener(new_ssl, &new_ctx)) {
+        SSL_free(new_ssl);
+        return NULL;
+    }
+
+    qctx_lock(&ctx);
+    ok = ossl_quic_port_join_shard_group(new_ctx.ql->port, ctx.ql->port);
+    qctx_unlock(&ctx);
+
+    if (!ok) {
+        QUIC_RAISE_NON_NORMAL_ERROR(NULL, ERR_R_INTERNAL_ERROR, NULL);
+        SSL_free(new_ssl);
+        return NULL;
+    }
+
+    return new_ssl;
+}
+#endif
+
 SSL *ossl_quic_new_listener_from(SSL *ssl, uint64_t flags)
 {
     QCTX ctx;
     QUIC_LISTENER *ql = NULL;
     QUIC_PORT_ARGS port_args = { 0 };
 
+    if ((flags & SSL_LISTENER_FLAG_SHARD) != 0) {
+#if defined(OPENSSL_THREADS)
+        return quic_new_listener_shard(ssl, flags);
+#else
+        QUIC_RAISE_NON_NORMAL_ERROR(NULL, ERR_R_UNSUPPORTED, NULL);
+        return NULL;
+#endif
+    }
+
     if (!expect_quic_domain(ssl, &ctx))
         return NULL;
 
@@ -63,6 +63,8 @@ struct quic_lcidm_st {
     LHASH_OF(QUIC_LCID) *lcids; /* (QUIC_CONN_ID) -> (QUIC_LCID *)  */
     LHASH_OF(QUIC_LCIDM_CONN) *conns; /* (void *opaque) -> (QUIC_LCIDM_CONN *) */
     size_t lcid_len; /* Length in bytes for all LCIDs */
+    unsigned char shard; /* Shard index encoded in LCIDs if use_shard is set */
+    unsigned int use_shard : 1;
 #ifdef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
     QUIC_CONN_ID next_lcid;
 #endif
@@ -309,6 +311,25 @@ size_t ossl_quic_lcidm_get_num_active_lcid(const QUIC_LCIDM *lcidm,
     return conn->num_active_lcid;
 }
 
+int ossl_quic_lcidm_set_shard(QUIC_LCIDM *lcidm, unsigned char shard)
+{
+    if (lcidm->lcid_len == 0)
+        return 0;
+
+    lcidm->shard = shard;
+    lcidm->use_shard = 1;
+    return 1;
+}
+
+int ossl_quic_lcidm_get_cid_shard(const QUIC_LCIDM *lcidm,
+    const QUIC_CONN_ID *cid)
+{
+    if (!lcidm->use_shard || cid->id_len != lcidm->lcid_len)
+        return -1;
+
+    return cid->id[0];
+}
+
 static int lcidm_generate_cid(QUIC_LCIDM *lcidm,
     QUIC_CONN_ID *cid)
 {
@@ -321,11 +342,16 @@ static int lcidm_generate_cid(QUIC_LCIDM *lcidm,
     for (i = lcidm->lcid_len - 1; i >= 0; --i)
         if (++lcidm->next_lcid.id[i] != 0)
             break;
-
-    return 1;
 #else
-    return ossl_quic_gen_rand_conn_id(lcidm->libctx, lcidm->lcid_len, cid);
+    if (!ossl_quic_gen_rand_conn_id(lcidm->libctx, lcidm->lcid_len, cid))
+        return 0;
 #endif
+
+    /* The first byte of a sharded LCID steers it to the owning shard. */
+    if (lcidm->use_shard)
+        cid->id[0] = lcidm->shard;
+
+    return 1;
 }
 
 static int lcidm_generate(QUIC_LCIDM *lcidm,
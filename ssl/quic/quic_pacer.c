@@ -0,0 +1,151 @@
+/*
+ * Copyright 2026 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include "internal/quic_pacer.h"
+#include "internal/safe_math.h"
+
+OSSL_SAFE_MATH_UNSIGNED(u64, uint64_t)
+
+/*
+ * Minimum burst limit in datagrams. RFC 9002 s. 7.7 suggests limiting bursts to
+ * the initial congestion window, which is ten datagrams.
+ */
+#define PACER_MIN_BURST_DGRAMS 10
+
+/* Interval over which the burst limit is sized. */
+#define PACER_BURST_INTERVAL OSSL_TIME_MS
+
+/* Largest burst for which credit can be represented without overflow. */
+#define PACER_MAX_BURST (UINT64_MAX / OSSL_TIME_SECOND)
+
+void ossl_quic_pacer_init(QUIC_PACER *pacer)
+{
+    pacer->rate = UINT64_MAX;
+    pacer->burst = 0;
+    pacer->credit = 0;
+    pacer->last_update = ossl_time_zero();
+}
+
+/* Accrues credit for the time elapsed since the last update. */
+static void pacer_refill(QUIC_PACER *pacer, OSSL_TIME now)
+{
+    uint64_t elapsed, cap, room;
+
+    if (ossl_time_compare(now, pacer->last_update) <= 0)
+        return;
+
+    elapsed = ossl_time2ticks(ossl_time_subtract(now, pacer->last_update));
+    pacer->last_update = now;
+
+    if (pacer->rate == UINT64_MAX || pacer->rate == 0)
+        return;
+
+    cap = pacer->burst * OSSL_TIME_SECOND;
+    room = cap - pacer->credit;
+
+    if (elapsed > room / pacer->rate)
+        pacer->credit = cap;
+    else
+        pacer->credit += elapsed * pacer->rate;
+}
+
+void ossl_quic_pacer_set_rate(QUIC_PACER *pacer, uint64_t rate, size_t mdpl,
+    OSSL_TIME now)
+{
+    int err = 0, first = (pacer->rate == UINT64_MAX);
+    uint64_t burst;
+
+    pacer_refill(pacer, now);
+    pacer->last_update = now;
+    pacer->rate = rate;
+
+    if (rate == UINT64_MAX) {
+        pacer->burst = 0;
+        pacer->credit = 0;
+        return;
+    }
+
+    burst = safe_muldiv_u64(rate, PACER_BURST_INTERVAL, OSSL_TIME_SECOND,
+        &err);
+    if (err || burst > PACER_MAX_BURST)
+        burst = PACER_MAX_BURST;
+    if (burst < PACER_MIN_BURST_DGRAMS * (uint64_t)mdpl)
+        burst = PACER_MIN_BURST_DGRAMS * (uint64_t)mdpl;
+
+    pacer->burst = burst;
+    if (first || pacer->credit > burst * OSSL_TIME_SECOND)
+        pacer->credit = burst * OSSL_TIME_SECOND;
+}
+
+uint64_t ossl_quic_pacer_get_rate(const QUIC_PACER *pacer)
+{
+    return pacer->rate;
+}
+
+uint64_t ossl_quic_pacer_get_burst(const QUIC_PACER *pacer)
+{
+    return pacer->burst;
+}
+
+uint64_t ossl_quic_pacer_get_credit(QUIC_PACER *pacer, OSSL_TIME now)
+{
+    if (pacer->rate == UINT64_MAX)
+        return UINT64_MAX;
+
+    pacer_refill(pacer, now);
+    return pacer->credit / OSSL_TIME_SECOND;
+}
+
+void ossl_quic_pacer_consume_credit(QUIC_PACER *pacer, uint64_t num_bytes,
+    OSSL_TIME now)
+{
+    if (pacer->rate == UINT64_MAX)
+        return;
+
+    pacer_refill(pacer, now);
+
+    if (num_bytes >= pacer->credit / OSSL_TIME_SECOND)
+        pacer->credit = 0;
+    else
+        pacer->credit -= num_bytes * OSSL_TIME_SECOND;
+}
+
+OSSL_TIME ossl_quic_pacer_get_deadline(QUIC_PACER *pacer, uint64_t num_bytes,
+    OSSL_TIME now)
+{
+    int err = 0;
+    uint64_t need, wait;
+
+    if (ossl_quic_pacer_get_credit(pacer, now) >= num_bytes)
+        return now;
+
+    if (pacer->rate == 0)
+        return ossl_time_infinite();
+
+    need = safe_mul_u64(num_bytes, OSSL_TIME_SECOND, &err);
+    if (err)
+        return ossl_time_infinite();
+
+    /* Round up so that the credit is available when we wake. */
+    wait = (need - pacer->credit + pacer->rate - 1) / pacer->rate;
+    return ossl_time_add(now, ossl_ticks2time(wait));
+}
+
+uint64_t ossl_quic_pacer_rate_from_cwnd(uint64_t cwnd, OSSL_TIME srtt,
+    uint32_t gain_pct)
+{
+    int err = 0;
+    uint64_t srtt_us = ossl_time2us(srtt), rate;
+
+    if (srtt_us == 0)
+        return UINT64_MAX;
+
+    rate = safe_muldiv_u64(cwnd, (uint64_t)gain_pct * 10000, srtt_us, &err);
+    return err ? UINT64_MAX : rate;
+}
@@ -32,6 +32,11 @@ static OSSL_TIME get_time(void *arg);
 static void port_default_packet_handler(QUIC_URXE *e, void *arg,
     const QUIC_CONN_ID *dcid);
 static void port_rx_pre(QUIC_PORT *port);
+#if defined(OPENSSL_THREADS)
+static void port_drain_inbox(QUIC_PORT *port);
+static int port_try_handoff(QUIC_PORT *port, const QUIC_URXE *e,
+    const QUIC_CONN_ID *dcid);
+#endif
 
 /**
  * @struct validation_token
@@ -201,6 +206,7 @@ static int port_init(QUIC_PORT *port)
     port->max_ack_delay = QUIC_DEFAULT_MAX_ACK_DELAY;
     port->disable_active_migration = 1;
     port->active_conn_id_limit = QUIC_MIN_ACTIVE_CONN_ID_LIMIT;
+    port->cc_method = &ossl_cc_newreno_method;
 
     port->state = QUIC_PORT_STATE_RUNNING;
 
@@ -236,6 +242,10 @@ static void port_cleanup(QUIC_PORT *port)
 {
     assert(ossl_list_ch_num(&port->channel_list) == 0);
 
+#if defined(OPENSSL_THREADS)
+    ossl_quic_port_leave_shard_group(port);
+#endif
+
     ossl_quic_demux_free(port->demux);
     port->demux = NULL;
 
@@ -611,6 +621,8 @@ static QUIC_CHANNEL *port_make_channel(QUIC_PORT *port, SSL *tls, OSSL_QRX *qrx,
     args.max_ack_delay = port->max_ack_delay;
     args.disable_active_migration = port->disable_active_migration;
     args.active_conn_id_limit = port->active_conn_id_limit;
+    args.cc_method = port->cc_method;
+    args.pacing = port->pacing;
 
     /*
      * Creating a new channel is made a bit tricky here as there is a
@@ -836,6 +848,12 @@ static void port_rx_pre(QUIC_PORT *port)
     if (!port->allow_incoming && !port->have_sent_any_pkt)
         return;
 
+#if defined(OPENSSL_THREADS)
+    /* Process datagrams which other shards received on our behalf first. */
+    if (port->shard_group != NULL)
+        port_drain_inbox(port);
+#endif
+
     /*
      * Get DEMUX to BIO_recvmmsg from the network and queue incoming datagrams
      * to the appropriate QRX instances.
@@ -1639,6 +1657,13 @@ static void port_default_packet_handler(QUIC_URXE *e, void *arg,
         return;
     }
 
+#if defined(OPENSSL_THREADS)
+    /* The DCID may belong to a connection owned by another shard. */
+    if (dcid != NULL && port->shard_group != NULL
+        && port_try_handoff(port, e, dcid))
+        goto undesirable;
+#endif
+
     /*
      * If we have an incoming packet which doesn't match any existing connection
      * we assume this is an attempt to make a new connection.
@@ -2007,3 +2032,278 @@ void ossl_quic_port_set_max_pending_channels(QUIC_PORT *port, uint64_t max_pendi
 {
     port->max_pending_channels = max_pending_channels;
 }
+
+void ossl_quic_port_set_cc_method(QUIC_PORT *port,
+    const OSSL_CC_METHOD *cc_method)
+{
+    port->cc_method = cc_method;
+}
+
+const OSSL_CC_METHOD *ossl_quic_port_get_cc_method(const QUIC_PORT *port)
+{
+    return port->cc_method;
+}
+
+void ossl_quic_port_set_pacing(QUIC_PORT *port, int enable)
+{
+    port->pacing = (enable != 0);
+}
+
+int ossl_quic_port_get_pacing(const QUIC_PORT *port)
+{
+    return port->pacing;
+}
+
+#if defined(OPENSSL_THREADS)
+/*
+ * Shard Groups
+ * ============
+ */
+#define QUIC_PORT_MAX_SHARDS 256
+
+/* Maximum number of handed off datagrams queued for a single port. */
+#define QUIC_PORT_MAX_INBOX 256
+
+struct quic_port_handoff_st {
+    QUIC_PORT_HANDOFF *next;
+    BIO_ADDR peer, local;
+    size_t data_len;
+    /* Datagram data follows. */
+};
+
+struct quic_port_shard_group_st {
+    /* Protects the members of this structure and of the member ports. */
+    CRYPTO_MUTEX *mutex;
+    /* Signalled when the shard_busy count of a port drops to zero. */
+    CRYPTO_CONDVAR *idle_cv;
+    QUIC_PORT *ports[QUIC_PORT_MAX_SHARDS];
+    size_t num_ports;
+};
+
+static void shard_group_free(QUIC_PORT_SHARD_GROUP *group)
+{
+    if (group == NULL)
+        return;
+
+    ossl_crypto_condvar_free(&group->idle_cv);
+    ossl_crypto_mutex_free(&group->mutex);
+    OPENSSL_free(group);
+}
+
+int ossl_quic_port_join_shard_group(QUIC_PORT *port, QUIC_PORT *peer)
+{
+    QUIC_PORT_SHARD_GROUP *group = peer->shard_group, *new_group = NULL;
+    size_t i;
+    int ok = 0;
+
+    if (port->shard_group != NULL || !port->is_multi_conn
+        || !peer->is_multi_conn)
+        return 0;
+
+    if (group == NULL) {
+        if ((new_group = OPENSSL_zalloc(sizeof(*new_group))) == NULL
+            || (new_group->mutex = ossl_crypto_mutex_new()) == NULL
+            || (new_group->idle_cv = ossl_crypto_condvar_new()) == NULL
+            || !ossl_quic_lcidm_set_shard(peer->lcidm, 0)) {
+            shard_group_free(new_group);
+            return 0;
+        }
+
+        /*
+         * The peer is the first shard. It is safe to publish the group to the
+         * peer here as the caller holds the peer's engine mutex.
+         */
+        new_group->ports[0] = peer;
+        new_group->num_ports = 1;
+        peer->shard_idx = 0;
+        peer->shard_group = group = new_group;
+    }
+
+    ossl_crypto_mutex_lock(group->mutex);
+
+    for (i = 0; i < QUIC_PORT_MAX_SHARDS; ++i)
+        if (group->ports[i] == NULL)
+            break;
+
+    if (i < QUIC_PORT_MAX_SHARDS
+        && ossl_quic_lcidm_set_shard(port->lcidm, (unsigned char)i)) {
+        group->ports[i] = port;
+        ++group->num_ports;
+        port->shard_idx = (unsigned char)i;
+        port->shard_group = group;
+        ok = 1;
+    }
+
+    ossl_crypto_mutex_unlock(group->mutex);
+    return ok;
+}
+
+void ossl_quic_port_leave_shard_group(QUIC_PORT *port)
+{
+    QUIC_PORT_SHARD_GROUP *group = port->shard_group;
+    QUIC_PORT_HANDOFF *h, *hnext;
+    int last;
+
+    if (group == NULL)
+        return;
+
+    ossl_crypto_mutex_lock(group->mutex);
+
+    /* Wait for any other shard which is ticking us to finish doing so. */
+    while (port->shard_busy > 0)
+        ossl_crypto_condvar_wait(group->idle_cv, group->mutex);
+
+    group->ports[port->shard_idx] = NULL;
+    last = (--group->num_ports == 0);
+    port->shard_group = NULL;
+
+    h = port->inbox_head;
+    port->inbox_head = port->inbox_tail = NULL;
+    port->inbox_len = 0;
+
+    ossl_crypto_mutex_unlock(group->mutex);
+
+    for (; h != NULL; h = hnext) {
+        hnext = h->next;
+        OPENSSL_free(h);
+    }
+
+    /* No other port can reach the group once its last member has left. */
+    if (last)
+        shard_group_free(group);
+}
+
+int ossl_quic_port_get_shard_index(const QUIC_PORT *port)
+{
+    return port->shard_group != NULL ? port->shard_idx : -1;
+}
+
+/*
+ * Queues a datagram to |dst|, to be processed on its next tick. Returns 1 on
+ * success and 0 if its inbox is full.
+ */
+static int port_queue_handoff(QUIC_PORT_SHARD_GROUP *group, QUIC_PORT *dst,
+    const QUIC_URXE *e)
+{
+    QUIC_PORT_HANDOFF *h;
+
+    if ((h = OPENSSL_malloc(sizeof(*h) + e->data_len)) == NULL)
+        return 0;
+
+    h->next = NULL;
+    h->peer = e->peer;
+    h->local = e->local;
+    h->data_len = e->data_len;
+    memcpy(h + 1, ossl_quic_urxe_data(e), e->data_len);
+
+    ossl_crypto_mutex_lock(group->mutex);
+
+    if (dst->inbox_len >= QUIC_PORT_MAX_INBOX) {
+        ossl_crypto_mutex_unlock(group->mutex);
+        OPENSSL_free(h);
+        return 0;
+    }
+
+    if (dst->inbox_tail != NULL)
+        dst->inbox_tail->next = h;
+    else
+        dst->inbox_head = h;
+    dst->inbox_tail = h;
+    ++dst->inbox_len;
+
+    ossl_crypto_mutex_unlock(group->mutex);
+    return 1;
+}
+
+/*
+ * Called when a datagram arrives for a DCID we do not know. If the DCID was
+ * issued by another shard in our group, the datagram is given to that shard.
+ * If that shard is not busy, this happens immediately and only if the DCID
+ * belongs to one of its connections; otherwise the datagram is queued and
+ * will be processed on its next tick. Returns 1 if the datagram was handed
+ * off.
+ */
+static int port_try_handoff(QUIC_PORT *port, const QUIC_URXE *e,
+    const QUIC_CONN_ID *dcid)
+{
+    QUIC_PORT_SHARD_GROUP *group = port->shard_group;
+    QUIC_PORT *dst;
+    CRYPTO_MUTEX *dst_mutex;
+    const unsigned char *data = ossl_quic_urxe_data(e);
+    int shard, ret = 0;
+
+    /*
+     * Only 1-RTT and Handshake packets are necessarily addressed to a DCID
+     * issued by a shard. The DCID of Initial and 0-RTT packets may be chosen by
+     * the client, and these are left to the ordinary new connection logic.
+     */
+    if (e->data_len == 0
+        || ((data[0] & 0x80) != 0 && ((data[0] >> 4) & 0x3) != 2))
+        return 0;
+
+    shard = ossl_quic_lcidm_get_cid_shard(port->lcidm, dcid);
+    if (shard < 0 || shard == port->shard_idx)
+        return 0;
+
+    ossl_crypto_mutex_lock(group->mutex);
+    dst = group->ports[shard];
+    if (dst == NULL) {
+        ossl_crypto_mutex_unlock(group->mutex);
+        return 0;
+    }
+    /* Prevent dst from leaving the group while we use it. */
+    ++dst->shard_busy;
+    ossl_crypto_mutex_unlock(group->mutex);
+
+    /*
+     * Never block on another shard's engine mutex, as that shard may itself be
+     * waiting to hand off to us. Holding it lets us check that the DCID is
+     * known to dst before doing any work for it, so that datagrams with forged
+     * DCIDs are dropped as they would be without sharding. Only while dst is
+     * busy is the datagram queued unchecked, which the inbox limit bounds.
+     */
+    dst_mutex = dst->engine->mutex;
+    if (dst_mutex != NULL && ossl_crypto_mutex_try_lock(dst_mutex)) {
+        if (ossl_quic_lcidm_lookup(dst->lcidm, dcid, NULL, NULL)) {
+            ossl_quic_demux_inject(dst->demux, data, e->data_len,
+                &e->peer, &e->local);
+            ossl_quic_reactor_tick(&dst->engine->rtor, 0);
+            ret = 1;
+        }
+        ossl_crypto_mutex_unlock(dst_mutex);
+    } else {
+        ret = port_queue_handoff(group, dst, e);
+    }
+
+    ossl_crypto_mutex_lock(group->mutex);
+    if (--dst->shard_busy == 0)
+        ossl_crypto_condvar_broadcast(group->idle_cv);
+    ossl_crypto_mutex_unlock(group->mutex);
+
+    return ret;
+}
+
+/* Injects any datagrams handed off to us by other shards. */
+static void port_drain_inbox(QUIC_PORT *port)
+{
+    QUIC_PORT_SHARD_GROUP *group = port->shard_group;
+    QUIC_PORT_HANDOFF *h, *hnext;
+
+    ossl_crypto_mutex_lock(group->mutex);
+    h = port->inbox_head;
+    port->inbox_head = port->inbox_tail = NULL;
+    port->inbox_len = 0;
+    ossl_crypto_mutex_unlock(group->mutex);
+
+    /*
+     * The DCIDs of these datagrams encode our own shard index, so if they do
+     * not match a known connection they are not handed off again.
+     */
+    for (; h != NULL; h = hnext) {
+        hnext = h->next;
+        ossl_quic_demux_inject(port->demux, (const unsigned char *)(h + 1),
+            h->data_len, &h->peer, &h->local);
+        OPENSSL_free(h);
+    }
+}
+#endif
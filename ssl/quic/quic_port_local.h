@@ -28,6 +28,9 @@
 DECLARE_LIST_OF(ch, QUIC_CHANNEL);
 DECLARE_LIST_OF(incoming_ch, QUIC_CHANNEL);
 
+typedef struct quic_port_shard_group_st QUIC_PORT_SHARD_GROUP;
+typedef struct quic_port_handoff_st QUIC_PORT_HANDOFF;
+
 /* A port is always in one of the following states: */
 enum {
     /* Initial and steady state. */
@@ -136,6 +139,30 @@ struct quic_port_st {
     unsigned char ack_delay_exponent;
     unsigned char disable_active_migration;
     uint64_t max_pending_channels;
+
+    /* Congestion controller for new channels. */
+    const OSSL_CC_METHOD *cc_method;
+
+    /* Whether new channels use pacing. */
+    unsigned char pacing;
+
+#if defined(OPENSSL_THREADS)
+    /*
+     * Shard group this port belongs to, if any. The fields below other than
+     * shard_idx are protected by the group mutex.
+     */
+    QUIC_PORT_SHARD_GROUP *shard_group;
+
+    /* Datagrams handed off to us by other shards, awaiting injection. */
+    QUIC_PORT_HANDOFF *inbox_head, *inbox_tail;
+    size_t inbox_len;
+
+    /* Number of other shards currently ticking this port. */
+    size_t shard_busy;
+
+    /* Our index in the shard group, also encoded in our LCIDs. */
+    unsigned char shard_idx;
+#endif
 };
 
 #endif
@@ -1007,6 +1007,14 @@ void ossl_qtx_set_bio(OSSL_QTX *qtx, BIO *bio)
         mtu = BIO_dgram_get_mtu(bio);
         if (mtu >= QUIC_MIN_INITIAL_DGRAM_LEN)
             ossl_qtx_set_mtu(qtx, mtu); /* best effort */
+
+        /*
+         * Let the BIO send runs of our datagrams to the same peer as single
+         * segmented sends if it can (best effort).
+         */
+        if ((BIO_dgram_get_segmentation_cap(bio) & BIO_DGRAM_SEGMENT_TX) != 0)
+            (void)BIO_dgram_set_segmentation(bio,
+                BIO_dgram_get_segmentation(bio) | BIO_DGRAM_SEGMENT_TX);
     }
 }
 
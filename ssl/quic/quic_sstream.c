@@ -11,6 +11,27 @@
 #include "internal/uint_set.h"
 #include "internal/common.h"
 #include "internal/ring_buf.h"
+#include "internal/list.h"
+
+/*
+ * An application buffer appended to the stream without copying. It occupies
+ * the logical range [start, start + buf_len) of the stream but no space in the
+ * ring buffer.
+ */
+typedef struct sstream_xbuf_st SSTREAM_XBUF;
+
+struct sstream_xbuf_st {
+    OSSL_LIST_MEMBER(xbuf, SSTREAM_XBUF);
+    uint64_t start;
+    /* Ring buffer offset of any data appended after this buffer. */
+    uint64_t ring_offset;
+    const unsigned char *buf;
+    size_t buf_len;
+    SSL_write_release_cb_fn release_cb;
+    void *release_cb_arg;
+};
+
+DEFINE_LIST_OF(xbuf, SSTREAM_XBUF);
 
 /*
  * ==================================================================
@@ -19,6 +40,18 @@
 struct quic_sstream_st {
     struct ring_buf ring_buf;
 
+    /*
+     * Application buffers which have not yet been fully acknowledged, in
+     * ascending order of logical offset. Logical bytes not covered by these are
+     * stored in the ring buffer, so that a logical offset before the first
+     * buffer in this list maps to a ring buffer offset of (offset -
+     * xbuf_released), and an offset between two buffers maps relative to the
+     * ring_offset of the earlier one.
+     */
+    OSSL_LIST(xbuf) xbufs;
+    uint64_t xbuf_total; /* bytes ever appended as application buffers */
+    uint64_t xbuf_released; /* bytes of released application buffers */
+
     /*
      * Any logical byte in the stream is in one of these states:
      *
@@ -46,7 +79,7 @@ struct quic_sstream_st {
     UINT_SET new_set, acked_set;
 
     /*
-     * The current size of the stream is ring_buf.head_offset. If
+     * The current size of the stream is ring_buf.head_offset + xbuf_total. If
      * have_final_size is true, this is also the final size of the stream.
      */
     unsigned int have_final_size : 1;
@@ -57,6 +90,58 @@ struct quic_sstream_st {
 
 static void qss_cull(QUIC_SSTREAM *qss);
 
+static void qss_xbuf_release(SSTREAM_XBUF *xbuf)
+{
+    if (xbuf->release_cb != NULL)
+        xbuf->release_cb(xbuf->buf, xbuf->buf_len, xbuf->release_cb_arg);
+
+    OPENSSL_free(xbuf);
+}
+
+/*
+ * Finds the stored data at a logical offset which has not yet been culled.
+ * *buf and *buf_len are set to the longest run of contiguous memory starting at
+ * that offset, which has a length of 0 at the end of the stream.
+ */
+static int qss_get_buf_at(const QUIC_SSTREAM *qss, uint64_t offset,
+    const unsigned char **buf, size_t *buf_len)
+{
+    SSTREAM_XBUF *xbuf, *prev = NULL;
+    uint64_t ring_offset, limit = UINT64_MAX;
+
+    for (xbuf = ossl_list_xbuf_head(&qss->xbufs); xbuf != NULL;
+        xbuf = ossl_list_xbuf_next(xbuf)) {
+        if (xbuf->start > offset) {
+            limit = xbuf->start - offset;
+            break;
+        }
+
+        prev = xbuf;
+    }
+
+    if (prev != NULL && offset < prev->start + prev->buf_len) {
+        *buf = prev->buf + (offset - prev->start);
+        *buf_len = (size_t)(prev->start + prev->buf_len - offset);
+        return 1;
+    }
+
+    if (prev != NULL)
+        ring_offset = prev->ring_offset + offset - prev->start - prev->buf_len;
+    else if (offset >= qss->xbuf_released)
+        ring_offset = offset - qss->xbuf_released;
+    else
+        return 0;
+
+    if (!ring_buf_get_buf_at(&qss->ring_buf, ring_offset, buf, buf_len))
+        return 0;
+
+    /* Ring buffer data stops where the next application buffer starts. */
+    if (*buf_len > limit)
+        *buf_len = (size_t)limit;
+
+    return 1;
+}
+
 QUIC_SSTREAM *ossl_quic_sstream_new(size_t init_buf_size)
 {
     QUIC_SSTREAM *qss;
@@ -74,14 +159,24 @@ QUIC_SSTREAM *ossl_quic_sstream_new(size_t init_buf_size)
 
     ossl_uint_set_init(&qss->new_set);
     ossl_uint_set_init(&qss->acked_set);
+    ossl_list_xbuf_init(&qss->xbufs);
     return qss;
 }
 
 void ossl_quic_sstream_free(QUIC_SSTREAM *qss)
 {
+    SSTREAM_XBUF *xbuf, *xnext;
+
     if (qss == NULL)
         return;
 
+    /* Application buffers are no longer needed, whether acked or not. */
+    OSSL_LIST_FOREACH_DELSAFE(xbuf, xnext, xbuf, &qss->xbufs)
+    {
+        ossl_list_xbuf_remove(&qss->xbufs, xbuf);
+        qss_xbuf_release(xbuf);
+    }
+
     ossl_uint_set_destroy(&qss->new_set);
     ossl_uint_set_destroy(&qss->acked_set);
     ring_buf_destroy(&qss->ring_buf, qss->cleanse);
@@ -114,7 +209,7 @@ int ossl_quic_sstream_get_stream_frame(QUIC_SSTREAM *qss,
         if (!qss->have_final_size || qss->sent_final_size)
             return 0;
 
-        hdr->offset = qss->ring_buf.head_offset;
+        hdr->offset = ossl_quic_sstream_get_cur_size(qss);
         hdr->len = 0;
         hdr->is_fin = 1;
         *num_iov = 0;
@@ -127,23 +222,24 @@ int ossl_quic_sstream_get_stream_frame(QUIC_SSTREAM *qss,
      *
      * Set entries never have 'adjacent' entries so we don't have to worry
      * about them here.
+     *
+     * The range may span the ring buffer and any number of application
+     * buffers. If we run out of iovecs, we return a shorter frame and the rest
+     * of the range is returned by a later call.
      */
     max_len = range->range.end - range->range.start + 1;
 
-    for (i = 0;; ++i) {
+    for (i = 0; i < *num_iov; ++i) {
         if (total_len >= max_len)
             break;
 
-        if (!ring_buf_get_buf_at(&qss->ring_buf,
-                range->range.start + total_len,
+        if (!qss_get_buf_at(qss, range->range.start + total_len,
                 &src, &src_len))
             return 0;
 
         if (src_len == 0)
             break;
 
-        assert(i < 2);
-
         if (total_len + src_len > max_len)
             src_len = (size_t)(max_len - total_len);
 
@@ -157,7 +253,7 @@ int ossl_quic_sstream_get_stream_frame(QUIC_SSTREAM *qss,
     hdr->offset = range->range.start;
     hdr->len = total_len;
     hdr->is_fin = qss->have_final_size
-        && hdr->offset + hdr->len == qss->ring_buf.head_offset;
+        && hdr->offset + hdr->len == ossl_quic_sstream_get_cur_size(qss);
 
     *num_iov = num_iov_;
     return 1;
@@ -174,7 +270,7 @@ int ossl_quic_sstream_has_pending(QUIC_SSTREAM *qss)
 
 uint64_t ossl_quic_sstream_get_cur_size(QUIC_SSTREAM *qss)
 {
-    return qss->ring_buf.head_offset;
+    return qss->ring_buf.head_offset + qss->xbuf_total;
 }
 
 int ossl_quic_sstream_mark_transmitted(QUIC_SSTREAM *qss,
@@ -199,7 +295,8 @@ int ossl_quic_sstream_mark_transmitted_fin(QUIC_SSTREAM *qss,
      * We do not really need final_size since we already know the size of the
      * stream, but this serves as a sanity check.
      */
-    if (!qss->have_final_size || final_size != qss->ring_buf.head_offset)
+    if (!qss->have_final_size
+        || final_size != ossl_quic_sstream_get_cur_size(qss))
         return 0;
 
     qss->sent_final_size = 1;
@@ -274,7 +371,7 @@ int ossl_quic_sstream_get_final_size(QUIC_SSTREAM *qss, uint64_t *final_size)
         return 0;
 
     if (final_size != NULL)
-        *final_size = qss->ring_buf.head_offset;
+        *final_size = ossl_quic_sstream_get_cur_size(qss);
 
     return 1;
 }
@@ -286,6 +383,7 @@ int ossl_quic_sstream_append(QUIC_SSTREAM *qss,
 {
     size_t l, consumed_ = 0;
     UINT_RANGE r;
+    uint64_t old_size = ossl_quic_sstream_get_cur_size(qss);
     struct ring_buf old_ring_buf = qss->ring_buf;
 
     if (qss->have_final_size) {
@@ -301,8 +399,7 @@ int ossl_quic_sstream_append(QUIC_SSTREAM *qss,
      * the data here. We will later copy-and-encrypt the data during packet
      * encryption, so this is a two-copy design. Supporting a one-copy design in
      * the future will require applications to use a different kind of API.
-     * Supporting such changes in future will require corresponding enhancements
-     * to this code.
+     * ossl_quic_sstream_append_nocopy() provides such an API.
      */
     while (buf_len > 0) {
         l = ring_buf_push(&qss->ring_buf, buf, buf_len);
@@ -315,9 +412,9 @@ int ossl_quic_sstream_append(QUIC_SSTREAM *qss,
     }
 
     if (consumed_ > 0) {
-        r.start = old_ring_buf.head_offset;
+        r.start = old_size;
         r.end = r.start + consumed_ - 1;
-        assert(r.end + 1 == qss->ring_buf.head_offset);
+        assert(r.end + 1 == ossl_quic_sstream_get_cur_size(qss));
         if (!ossl_uint_set_insert(&qss->new_set, &r)) {
             qss->ring_buf = old_ring_buf;
             *consumed = 0;
@@ -329,9 +426,53 @@ int ossl_quic_sstream_append(QUIC_SSTREAM *qss,
     return 1;
 }
 
+int ossl_quic_sstream_append_nocopy(QUIC_SSTREAM *qss,
+    const unsigned char *buf,
+    size_t buf_len,
+    SSL_write_release_cb_fn release_cb,
+    void *release_cb_arg)
+{
+    SSTREAM_XBUF *xbuf;
+    UINT_RANGE r;
+
+    if (qss->have_final_size)
+        return 0;
+
+    if (buf_len == 0) {
+        if (release_cb != NULL)
+            release_cb(buf, buf_len, release_cb_arg);
+        return 1;
+    }
+
+    r.start = ossl_quic_sstream_get_cur_size(qss);
+    r.end = r.start + buf_len - 1;
+    if (r.end < r.start)
+        return 0;
+
+    if ((xbuf = OPENSSL_zalloc(sizeof(*xbuf))) == NULL)
+        return 0;
+
+    if (!ossl_uint_set_insert(&qss->new_set, &r)) {
+        OPENSSL_free(xbuf);
+        return 0;
+    }
+
+    xbuf->start = r.start;
+    xbuf->ring_offset = qss->ring_buf.head_offset;
+    xbuf->buf = buf;
+    xbuf->buf_len = buf_len;
+    xbuf->release_cb = release_cb;
+    xbuf->release_cb_arg = release_cb_arg;
+    ossl_list_xbuf_insert_tail(&qss->xbufs, xbuf);
+    qss->xbuf_total += buf_len;
+    return 1;
+}
+
 static void qss_cull(QUIC_SSTREAM *qss)
 {
     UINT_SET_ITEM *h = ossl_list_uint_set_head(&qss->acked_set);
+    SSTREAM_XBUF *xbuf;
+    uint64_t end, ring_end;
 
     /*
      * Potentially cull data from our ring buffer. This can happen once data has
@@ -348,10 +489,30 @@ static void qss_cull(QUIC_SSTREAM *qss)
     /*
      * We only need to check the first range entry in the integer set because we
      * can only cull contiguous areas at the start of the ring buffer anyway.
+     * Application buffers are likewise released in order, once every byte in
+     * them has been acknowledged.
      */
-    if (h != NULL)
-        ring_buf_cpop_range(&qss->ring_buf, h->range.start, h->range.end,
-            qss->cleanse);
+    if (h == NULL || h->range.start != 0)
+        return;
+
+    end = h->range.end + 1;
+
+    while ((xbuf = ossl_list_xbuf_head(&qss->xbufs)) != NULL
+        && xbuf->start + xbuf->buf_len <= end) {
+        ossl_list_xbuf_remove(&qss->xbufs, xbuf);
+        qss->xbuf_released += xbuf->buf_len;
+        qss_xbuf_release(xbuf);
+    }
+
+    /* Find the end of the acknowledged data in the ring buffer. */
+    if (xbuf != NULL && xbuf->start < end)
+        ring_end = xbuf->ring_offset;
+    else
+        ring_end = end - qss->xbuf_released;
+
+    if (ring_end > qss->ring_buf.ctail_offset)
+        ring_buf_cpop_range(&qss->ring_buf, qss->ring_buf.ctail_offset,
+            ring_end - 1, qss->cleanse);
 }
 
 int ossl_quic_sstream_set_buffer_size(QUIC_SSTREAM *qss, size_t num_bytes)
@@ -389,7 +550,7 @@ int ossl_quic_sstream_is_totally_acked(QUIC_SSTREAM *qss)
         return 0;
 
     r = ossl_list_uint_set_head(&qss->acked_set)->range;
-    cur_size = qss->ring_buf.head_offset;
+    cur_size = ossl_quic_sstream_get_cur_size(qss);
 
     /*
      * The invariants of UINT_SET guarantee a single list element if we have a
@@ -835,6 +835,7 @@ int ossl_quic_tls_tick(QUIC_TLS *qtls)
         case SSL_ERROR_WANT_CLIENT_HELLO_CB:
         case SSL_ERROR_WANT_X509_LOOKUP:
         case SSL_ERROR_WANT_RETRY_VERIFY:
+        case SSL_ERROR_WANT_PRIVATE_KEY_OPERATION:
             ERR_pop_to_mark();
             return 1;
 
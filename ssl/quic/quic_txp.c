@@ -9,6 +9,8 @@
 
 #include "internal/quic_txp.h"
 #include "internal/quic_fifd.h"
+#include "internal/quic_pacer.h"
+#include "internal/quic_statm.h"
 #include "internal/quic_stream_map.h"
 #include "internal/quic_error.h"
 #include "internal/common.h"
@@ -62,6 +64,7 @@ struct ossl_quic_tx_packetiser_st {
 
     /* Subcomponents of the TXP that we own. */
     QUIC_FIFD fifd; /* QUIC Frame-in-Flight Dispatcher */
+    QUIC_PACER pacer; /* QUIC Pacer, used if pacing is set */
 
     /* Internal state. */
     uint64_t next_pn[QUIC_PN_SPACE_NUM]; /* Next PN to use in given PN space. */
@@ -89,6 +92,9 @@ struct ossl_quic_tx_packetiser_st {
     /* Has the handshake been completed? */
     unsigned int handshake_complete : 1;
 
+    /* Are in-flight packets paced? */
+    unsigned int pacing : 1;
+
     OSSL_QUIC_FRAME_CONN_CLOSE conn_close_frame;
 
     /*
@@ -560,6 +566,7 @@ OSSL_QUIC_TX_PACKETISER *ossl_quic_tx_packetiser_new(const OSSL_QUIC_TX_PACKETIS
 
     txp->args = *args;
     txp->last_tx_time = ossl_time_zero();
+    ossl_quic_pacer_init(&txp->pacer);
 
     if (!ossl_quic_fifd_init(&txp->fifd,
             txp->args.cfq, txp->args.ackm, txp->args.txpim,
@@ -720,6 +727,61 @@ int ossl_quic_tx_packetiser_set_ack_delay_exponent(OSSL_QUIC_TX_PACKETISER *txp,
     return 1;
 }
 
+void ossl_quic_tx_packetiser_set_cc_method(OSSL_QUIC_TX_PACKETISER *txp,
+    const OSSL_CC_METHOD *cc_method,
+    OSSL_CC_DATA *cc_data)
+{
+    txp->args.cc_method = cc_method;
+    txp->args.cc_data = cc_data;
+}
+
+int ossl_quic_tx_packetiser_set_pacing(OSSL_QUIC_TX_PACKETISER *txp,
+    int enable)
+{
+    if (enable && txp->args.statm == NULL)
+        return 0;
+
+    if (!enable)
+        ossl_quic_pacer_init(&txp->pacer);
+
+    txp->pacing = (enable != 0);
+    return 1;
+}
+
+int ossl_quic_tx_packetiser_get_pacing(const OSSL_QUIC_TX_PACKETISER *txp)
+{
+    return txp->pacing;
+}
+
+uint64_t ossl_quic_tx_packetiser_get_pacing_burst(const OSSL_QUIC_TX_PACKETISER *txp)
+{
+    return txp->pacing ? ossl_quic_pacer_get_burst(&txp->pacer) : 0;
+}
+
+/*
+ * Updates the pacing rate from the congestion controller and returns the number
+ * of bytes of in-flight data which the pacer currently allows us to send.
+ */
+static uint64_t txp_get_pacer_credit(OSSL_QUIC_TX_PACKETISER *txp,
+    OSSL_TIME now)
+{
+    OSSL_RTT_INFO rtt_info;
+    uint64_t rate = UINT64_MAX;
+
+    if (!txp->pacing)
+        return UINT64_MAX;
+
+    if (txp->args.cc_method->get_pacing_rate != NULL) {
+        ossl_statm_get_rtt_info(txp->args.statm, &rtt_info);
+        rate = txp->args.cc_method->get_pacing_rate(txp->args.cc_data,
+            rtt_info.smoothed_rtt);
+    }
+
+    ossl_quic_pacer_set_rate(&txp->pacer, rate,
+        ossl_qtx_get_mdpl(txp->args.qtx), now);
+    return ossl_quic_pacer_get_credit(&txp->pacer, now);
+}
+
 void ossl_quic_tx_packetiser_set_ack_tx_cb(OSSL_QUIC_TX_PACKETISER *txp,
     void (*cb)(const OSSL_QUIC_FRAME_ACK *ack,
         uint32_t pn_space,
@@ -887,6 +949,15 @@ int ossl_quic_tx_packetiser_generate(OSSL_QUIC_TX_PACKETISER *txp,
      */
     ossl_qtx_finish_dgram(txp->args.qtx);
 
+    /*
+     * If the pacer does not yet allow a full datagram, treat this the same as
+     * being CC limited; ACK-only packets are not in flight and are not paced.
+     */
+    if (cc_limit > 0 && txp->pacing
+        && txp_get_pacer_credit(txp, txp->args.now(txp->args.now_arg))
+            < ossl_qtx_get_mdpl(txp->args.qtx))
+        cc_limit = 0;
+
     /* 1. Archetype Selection */
     archetype = txp_determine_archetype(txp, cc_limit);
 
@@ -3049,6 +3120,10 @@ static int txp_pkt_commit(OSSL_QUIC_TX_PACKETISER *txp,
     if (!ossl_qtx_write_pkt(txp->args.qtx, &txpkt))
         return 0;
 
+    if (txp->pacing && tpkt->ackm_pkt.is_inflight)
+        ossl_quic_pacer_consume_credit(&txp->pacer, tpkt->ackm_pkt.num_bytes,
+            tpkt->ackm_pkt.time);
+
     /*
      * Record FC and stream abort frames as sent; deactivate streams which no
      * longer have anything to do.
@@ -3248,9 +3323,18 @@ OSSL_TIME ossl_quic_tx_packetiser_get_deadline(OSSL_QUIC_TX_PACKETISER *txp)
         }
 
     /* When will CC let us send more? */
-    if (txp->args.cc_method->get_tx_allowance(txp->args.cc_data) == 0)
+    if (txp->args.cc_method->get_tx_allowance(txp->args.cc_data) == 0) {
         deadline = ossl_time_min(deadline,
             txp->args.cc_method->get_wakeup_deadline(txp->args.cc_data));
+    } else if (txp->pacing) {
+        /* When will the pacer let us send another datagram? */
+        OSSL_TIME now = txp->args.now(txp->args.now_arg);
+        size_t mdpl = ossl_qtx_get_mdpl(txp->args.qtx);
+
+        if (txp_get_pacer_credit(txp, now) < mdpl)
+            deadline = ossl_time_min(deadline,
+                ossl_quic_pacer_get_deadline(&txp->pacer, mdpl, now));
+    }
 
     return deadline;
 }
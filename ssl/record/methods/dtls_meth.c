@@ -313,7 +313,7 @@ static int dtls_rlayer_buffer_record(OSSL_RECORD_LAYER *rl, struct pqueue_st *qu
 
     if (!tls_setup_read_buffer(rl)) {
         /* RLAYERfatal() already called */
-        OPENSSL_free(rdata->rbuf.buf);
+        ossl_tls_buffer_release(rl, &rdata->rbuf);
         OPENSSL_free(rdata);
         pitem_free(item);
         return -1;
@@ -321,7 +321,7 @@ static int dtls_rlayer_buffer_record(OSSL_RECORD_LAYER *rl, struct pqueue_st *qu
 
     if (pqueue_insert(queue, item) == NULL) {
         /* Must be a duplicate so ignore it */
-        OPENSSL_free(rdata->rbuf.buf);
+        ossl_tls_buffer_release(rl, &rdata->rbuf);
         OPENSSL_free(rdata);
         pitem_free(item);
     }
@@ -336,7 +336,7 @@ static int dtls_copy_rlayer_record(OSSL_RECORD_LAYER *rl, pitem *item)
 
     rdata = (DTLS_RLAYER_RECORD_DATA *)item->data;
 
-    ossl_tls_buffer_release(&rl->rbuf);
+    ossl_tls_buffer_release(rl, &rl->rbuf);
 
     rl->packet = rdata->packet;
     rl->packet_length = rdata->packet_length;
@@ -607,7 +607,7 @@ static int dtls_free(OSSL_RECORD_LAYER *rl)
             /* Push to the next record layer */
             ret &= BIO_write_ex(rl->next, rdata->packet, rdata->packet_length,
                 &written);
-            OPENSSL_free(rdata->rbuf.buf);
+            ossl_tls_buffer_release(rl, &rdata->rbuf);
             OPENSSL_free(item->data);
             pitem_free(item);
         }
@@ -617,7 +617,7 @@ static int dtls_free(OSSL_RECORD_LAYER *rl)
     if (rl->processed_rcds != NULL) {
         while ((item = pqueue_pop(rl->processed_rcds)) != NULL) {
             rdata = (DTLS_RLAYER_RECORD_DATA *)item->data;
-            OPENSSL_free(rdata->rbuf.buf);
+            ossl_tls_buffer_release(rl, &rdata->rbuf);
             OPENSSL_free(item->data);
             pitem_free(item);
         }
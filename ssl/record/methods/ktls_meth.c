@@ -294,6 +294,19 @@ static int ktls_set_crypto_state(OSSL_RECORD_LAYER *rl, int level,
     COMP_METHOD *comp)
 {
     ktls_crypto_info_t crypto_info;
+    int rekey, err;
+
+    /*
+     * If the kernel is already handling this direction then this is a TLSv1.3
+     * key update and the new keys have to be pushed into the socket. There is
+     * no way to take the socket back from the kernel, so falling back to
+     * another record layer is not possible and any failure is fatal.
+     */
+    if (rl->direction == OSSL_RECORD_DIRECTION_WRITE)
+        rekey = BIO_get_ktls_send(rl->bio);
+    else
+        rekey = BIO_get_ktls_recv(rl->bio);
+    err = rekey ? OSSL_RECORD_RETURN_FATAL : OSSL_RECORD_RETURN_NON_FATAL_ERR;
 
     /*
      * Check if we are suitable for KTLS. If not suitable we return
@@ -302,34 +315,35 @@ static int ktls_set_crypto_state(OSSL_RECORD_LAYER *rl, int level,
      */
 
     if (comp != NULL)
-        return OSSL_RECORD_RETURN_NON_FATAL_ERR;
+        goto err;
 
     /* ktls supports only the maximum fragment size */
     if (rl->max_frag_len != SSL3_RT_MAX_PLAIN_LENGTH)
-        return OSSL_RECORD_RETURN_NON_FATAL_ERR;
+        goto err;
 
     /* check that cipher is supported */
     if (!ktls_int_check_supported_cipher(rl, ciph, md, taglen))
-        return OSSL_RECORD_RETURN_NON_FATAL_ERR;
+        goto err;
 
     /* All future data will get encrypted by ktls. Flush the BIO or skip ktls */
     if (rl->direction == OSSL_RECORD_DIRECTION_WRITE) {
         if (BIO_flush(rl->bio) <= 0)
-            return OSSL_RECORD_RETURN_NON_FATAL_ERR;
+            goto err;
 
         /* KTLS does not support record padding */
         if (rl->padding != NULL || rl->block_padding > 0)
-            return OSSL_RECORD_RETURN_NON_FATAL_ERR;
+            goto err;
     }
 
     if (!ktls_configure_crypto(rl->libctx, rl->version, ciph, md, rl->sequence,
             &crypto_info,
             rl->direction == OSSL_RECORD_DIRECTION_WRITE,
             iv, ivlen, key, keylen, mackey, mackeylen))
-        return OSSL_RECORD_RETURN_NON_FATAL_ERR;
+        goto err;
 
+    /* For a key update this relies on the kernel supporting rekeying */
     if (!BIO_set_ktls(rl->bio, &crypto_info, rl->direction))
-        return OSSL_RECORD_RETURN_NON_FATAL_ERR;
+        goto err;
 
     if (rl->direction == OSSL_RECORD_DIRECTION_WRITE && (rl->options & SSL_OP_ENABLE_KTLS_TX_ZEROCOPY_SENDFILE) != 0)
         /* Ignore errors. The application opts in to using the zerocopy
@@ -339,6 +353,11 @@ static int ktls_set_crypto_state(OSSL_RECORD_LAYER *rl, int level,
         BIO_set_ktls_tx_zerocopy_sendfile(rl->bio);
 
     return OSSL_RECORD_RETURN_SUCCESS;
+
+err:
+    if (rekey)
+        ERR_raise(ERR_LIB_SSL, SSL_R_KTLS_REKEY_FAILED);
+    return err;
 }
 
 static int ktls_read_n(OSSL_RECORD_LAYER *rl, size_t n, size_t max, int extend,
@@ -362,6 +381,15 @@ static int ktls_read_n(OSSL_RECORD_LAYER *rl, size_t n, size_t max, int extend,
             RLAYERfatal(rl, SSL_AD_PROTOCOL_VERSION,
                 SSL_R_WRONG_VERSION_NUMBER);
             break;
+#ifdef EKEYEXPIRED
+        case EKEYEXPIRED:
+            /*
+             * The kernel has seen a KeyUpdate and is waiting for the new keys
+             * before it decrypts any more records
+             */
+            RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, SSL_R_KTLS_REKEY_FAILED);
+            break;
+#endif
         default:
             break;
         }
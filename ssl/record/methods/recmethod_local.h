@@ -70,6 +70,13 @@ typedef struct tls_rl_record_st {
     /* where the decode bytes are */
     /* rw */
     unsigned char *input;
+    /*
+     * When writing with |input| != |data|: the number of plaintext bytes at
+     * |input|. The remaining |length| - |input_len| bytes (e.g. TLSv1.3 inner
+     * content type and padding) are already at |data| + |input_len|.
+     */
+    /* w */
+    size_t input_len;
     /* only used with decompression - malloc()ed */
     /* r */
     unsigned char *comp;
@@ -325,6 +332,20 @@ struct ossl_record_layer_st {
     size_t block_padding;
     size_t hs_padding;
 
+    /*
+     * Dynamic record sizing. Application data is sent in records of at most
+     * sizing_len bytes until sizing_threshold bytes have been sent, and again
+     * after the connection has been idle for sizing_idle. A sizing_len of 0
+     * disables it. libssl keeps its own count of the data sent, which seeds
+     * sizing_sent when a new write record layer is created, e.g. on a
+     * TLSv1.3 KeyUpdate.
+     */
+    size_t sizing_len;
+    size_t sizing_threshold;
+    OSSL_TIME sizing_idle;
+    size_t sizing_sent;
+    OSSL_TIME sizing_last_write;
+
     /* TLSv1.0/TLSv1.1/TLSv1.2 */
     int use_etm;
 
@@ -337,6 +358,37 @@ struct ossl_record_layer_st {
     unsigned char *nonce; /* part of static IV followed by sequence number */
     int allow_plain_alerts;
 
+    /*
+     * TLSv1.3 AEAD cipher details, fixed when |enc_ctx| is keyed so that they
+     * don't have to be looked up again for every record. The leading
+     * |aead_ivlen| - SEQ_NUM_SIZE bytes of |nonce| are also filled in then.
+     */
+    size_t aead_ivlen;
+    int aead_mode;
+
+    /*
+     * TLSv1.3 pipelined AEAD. Set if the cipher is provided with the pipeline
+     * API, in which case every call to the cipher function initialises
+     * |enc_ctx| again with the key below and one nonce per record.
+     */
+    EVP_CIPHER *pipeline_cipher;
+    unsigned char *pipeline_key;
+    size_t pipeline_keylen;
+    size_t pipeline_ivlen;
+    /*
+     * Plaintext buffer used when decrypting a batch of TLSv1.3 records. The
+     * batch is decrypted out of place so that the ciphertext is still in
+     * |rbuf| if we have to fall back to decrypting one record at a time.
+     */
+    unsigned char *pipeline_plain;
+    size_t pipeline_plain_len;
+
+    /*
+     * Set if the cipher function can read the plaintext straight from the
+     * record template rather than having it copied into |wbuf| first
+     */
+    int encrypt_from_template;
+
     /* TLS "any" fields */
     /* Set to true if this is the first record in a connection */
     unsigned int is_first_record;
@@ -363,6 +415,8 @@ struct ossl_record_layer_st {
     OSSL_FUNC_rlayer_msg_callback_fn *msg_callback;
     OSSL_FUNC_rlayer_security_fn *security;
     OSSL_FUNC_rlayer_padding_fn *padding;
+    OSSL_FUNC_rlayer_buffer_alloc_fn *buffer_alloc;
+    OSSL_FUNC_rlayer_buffer_free_fn *buffer_free;
 
     size_t max_pipelines;
 
@@ -531,6 +585,9 @@ int tls_write_records_default(OSSL_RECORD_LAYER *rl,
 #define TLS_BUFFER_set_app_buffer(b, l) ((b)->app_buffer = (l))
 #define TLS_BUFFER_is_app_buffer(b) ((b)->app_buffer)
 
-void ossl_tls_buffer_release(TLS_BUFFER *b);
+unsigned char *ossl_tls_buffer_alloc(OSSL_RECORD_LAYER *rl, size_t len);
+void ossl_tls_buffer_free(OSSL_RECORD_LAYER *rl, unsigned char *buf,
+    size_t len);
+void ossl_tls_buffer_release(OSSL_RECORD_LAYER *rl, TLS_BUFFER *b);
 
 #endif /* !defined(OSSL_SSL_RECORD_METHODS_RECMETHOD_LOCAL_H) */
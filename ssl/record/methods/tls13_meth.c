@@ -68,6 +68,26 @@ static int tls13_set_crypto_state(OSSL_RECORD_LAYER *rl, int level,
 
     mode = EVP_CIPHER_get_mode(ciph);
 
+    /*
+     * If the cipher supports the pipeline API then we use it for all records.
+     * The pipeline API takes the key and all the nonces at init time so we
+     * have to hang on to the key. CCM needs the plaintext length before the
+     * AAD, which the pipeline API cannot express, so is excluded.
+     */
+    if (mode != EVP_CIPH_CCM_MODE && EVP_CIPHER_can_pipeline(ciph, enc)) {
+        if (!EVP_CIPHER_up_ref((EVP_CIPHER *)ciph)) {
+            ERR_raise(ERR_LIB_SSL, ERR_R_INTERNAL_ERROR);
+            return OSSL_RECORD_RETURN_FATAL;
+        }
+        rl->pipeline_cipher = (EVP_CIPHER *)ciph;
+        rl->pipeline_key = OPENSSL_memdup(key, keylen);
+        if (rl->pipeline_key == NULL)
+            return OSSL_RECORD_RETURN_FATAL;
+        rl->pipeline_keylen = keylen;
+        rl->pipeline_ivlen = ivlen;
+        goto end;
+    }
+
     if (EVP_CipherInit_ex(ciph_ctx, ciph, NULL, NULL, NULL, enc) <= 0
         || EVP_CIPHER_CTX_ctrl(ciph_ctx, EVP_CTRL_AEAD_SET_IVLEN, (int)ivlen,
                NULL)
@@ -76,14 +96,190 @@ static int tls13_set_crypto_state(OSSL_RECORD_LAYER *rl, int level,
             && EVP_CIPHER_CTX_ctrl(ciph_ctx, EVP_CTRL_AEAD_SET_TAG, (int)taglen,
                    NULL)
                 <= 0)
-        || EVP_CipherInit_ex(ciph_ctx, NULL, NULL, key, NULL, enc) <= 0) {
+        || EVP_CipherInit_ex(ciph_ctx, NULL, NULL, key, NULL, enc) <= 0
+        || ivlen < SEQ_NUM_SIZE) {
         ERR_raise(ERR_LIB_SSL, ERR_R_INTERNAL_ERROR);
         return OSSL_RECORD_RETURN_FATAL;
     }
+
+    /*
+     * Only the trailing SEQ_NUM_SIZE bytes of the nonce change from one record
+     * to the next, so set up the rest of it now.
+     */
+    rl->aead_ivlen = ivlen;
+    rl->aead_mode = mode;
+    memcpy(rl->nonce, iv, ivlen - SEQ_NUM_SIZE);
+
+    /*
+     * When writing we can encrypt straight out of the caller's buffer instead
+     * of copying the plaintext into the write buffer first. CCM requires all
+     * of the plaintext to be passed in a single update so can't do this.
+     */
+    if (enc && mode != EVP_CIPH_CCM_MODE)
+        rl->encrypt_from_template = 1;
 end:
     return OSSL_RECORD_RETURN_SUCCESS;
 }
 
+/*
+ * The additional data for a TLSv1.3 record is its header, with the length
+ * field covering the tag as well as the inner plaintext.
+ */
+static int tls13_set_aad(OSSL_RECORD_LAYER *rl, TLS_RL_RECORD *rec,
+    unsigned char hdr[SSL3_RT_HEADER_LENGTH])
+{
+    size_t len = rec->length + rl->taglen;
+
+    if (len < rec->length || len > 0xffff) {
+        RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        return 0;
+    }
+    hdr[0] = (unsigned char)rec->type;
+    hdr[1] = (unsigned char)(rec->rec_version >> 8);
+    hdr[2] = (unsigned char)rec->rec_version;
+    hdr[3] = (unsigned char)(len >> 8);
+    hdr[4] = (unsigned char)len;
+
+    return 1;
+}
+
+/*
+ * Encrypt or decrypt |n_recs| records with consecutive sequence numbers in a
+ * single set of calls to the pipeline capable AEAD cipher.
+ */
+static int tls13_cipher_pipeline(OSSL_RECORD_LAYER *rl, TLS_RL_RECORD *recs,
+    size_t n_recs, int sending)
+{
+    EVP_CIPHER_CTX *enc_ctx = rl->enc_ctx;
+    unsigned char recheaders[SSL_MAX_PIPELINES][SSL3_RT_HEADER_LENGTH];
+    unsigned char nonces[SSL_MAX_PIPELINES][EVP_MAX_IV_LENGTH];
+    const unsigned char *nonceptrs[SSL_MAX_PIPELINES];
+    const unsigned char *in[SSL_MAX_PIPELINES];
+    unsigned char *out[SSL_MAX_PIPELINES];
+    unsigned char *tags[SSL_MAX_PIPELINES], **tagptr = tags;
+    size_t inl[SSL_MAX_PIPELINES], outl[SSL_MAX_PIPELINES];
+    size_t outsize[SSL_MAX_PIPELINES];
+    size_t nonce_len = rl->pipeline_ivlen, offset, loop, i;
+    unsigned char *seq = rl->sequence;
+    OSSL_PARAM params[2] = { OSSL_PARAM_END, OSSL_PARAM_END };
+    TLS_RL_RECORD *rec;
+
+    if (n_recs == 0 || n_recs > SSL_MAX_PIPELINES
+        || nonce_len < SEQ_NUM_SIZE || nonce_len > EVP_MAX_IV_LENGTH) {
+        /* Should not happen */
+        RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        return 0;
+    }
+
+    /* See the comment in tls13_cipher() about plaintext alerts */
+    if (recs[0].type == SSL3_RT_ALERT) {
+        if (n_recs != 1) {
+            /* Should not happen */
+            RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+            return 0;
+        }
+        memmove(recs[0].data, recs[0].input, recs[0].length);
+        recs[0].input = recs[0].data;
+        return 1;
+    }
+
+    offset = nonce_len - SEQ_NUM_SIZE;
+    for (i = 0; i < n_recs; i++) {
+        rec = &recs[i];
+
+        if (!sending) {
+            /* There must be at least one byte of content type and the tag */
+            if (rec->length < rl->taglen + 1)
+                return 0;
+            rec->length -= rl->taglen;
+        }
+
+        memcpy(nonces[i], rl->iv, offset);
+        for (loop = 0; loop < SEQ_NUM_SIZE; loop++)
+            nonces[i][offset + loop] = rl->iv[offset + loop] ^ seq[loop];
+        nonceptrs[i] = nonces[i];
+
+        if (!tls_increment_sequence_ctr(rl)) {
+            /* RLAYERfatal already called */
+            return 0;
+        }
+
+        if (!tls13_set_aad(rl, rec, recheaders[i])) {
+            /* RLAYERfatal already called */
+            return 0;
+        }
+
+        in[i] = recheaders[i];
+        inl[i] = SSL3_RT_HEADER_LENGTH;
+        /* When reading we may be decrypting out of place */
+        tags[i] = (sending ? rec->data : rec->input) + rec->length;
+    }
+
+    if (!EVP_CIPHER_CTX_reset(enc_ctx)
+        || (sending
+            && !EVP_CipherPipelineEncryptInit(enc_ctx, rl->pipeline_cipher,
+                rl->pipeline_key,
+                rl->pipeline_keylen,
+                n_recs, nonceptrs,
+                nonce_len))
+        || (!sending
+            && !EVP_CipherPipelineDecryptInit(enc_ctx, rl->pipeline_cipher,
+                rl->pipeline_key,
+                rl->pipeline_keylen,
+                n_recs, nonceptrs,
+                nonce_len))) {
+        RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        return 0;
+    }
+
+    params[0] = OSSL_PARAM_construct_octet_ptr(OSSL_CIPHER_PARAM_PIPELINE_AEAD_TAG,
+        (void **)&tagptr, rl->taglen);
+    if (!sending && !EVP_CIPHER_CTX_set_params(enc_ctx, params)) {
+        RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        return 0;
+    }
+
+    /* Add the AAD */
+    if (!EVP_CipherPipelineUpdate(enc_ctx, NULL, outl, NULL, in, inl))
+        return 0;
+
+    for (i = 0; i < n_recs; i++) {
+        in[i] = recs[i].input;
+        inl[i] = recs[i].length;
+        out[i] = recs[i].data;
+        outsize[i] = recs[i].length;
+    }
+    if (!EVP_CipherPipelineUpdate(enc_ctx, out, outl, outsize, in, inl))
+        return 0;
+
+    for (i = 0; i < n_recs; i++) {
+        if (outl[i] > recs[i].length)
+            return 0;
+        out[i] = recs[i].data + outl[i];
+        outsize[i] = recs[i].length - outl[i];
+        inl[i] = outl[i];
+    }
+    if (!EVP_CipherPipelineFinal(enc_ctx, out, outl, outsize))
+        return 0;
+
+    for (i = 0; i < n_recs; i++) {
+        if (inl[i] + outl[i] != recs[i].length)
+            return 0;
+    }
+
+    if (sending) {
+        /* Add the tags */
+        if (!EVP_CIPHER_CTX_get_params(enc_ctx, params)) {
+            RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+            return 0;
+        }
+        for (i = 0; i < n_recs; i++)
+            recs[i].length += rl->taglen;
+    }
+
+    return 1;
+}
+
 static int tls13_cipher(OSSL_RECORD_LAYER *rl, TLS_RL_RECORD *recs,
     size_t n_recs, int sending, SSL_MAC_BUF *mac,
     size_t macsize)
@@ -91,16 +287,16 @@ static int tls13_cipher(OSSL_RECORD_LAYER *rl, TLS_RL_RECORD *recs,
     EVP_CIPHER_CTX *enc_ctx;
     unsigned char recheader[SSL3_RT_HEADER_LENGTH];
     unsigned char tag[EVP_MAX_MD_SIZE];
-    size_t nonce_len, offset, loop, hdrlen, taglen;
+    size_t nonce_len, offset, loop, taglen;
     unsigned char *staticiv;
     unsigned char *nonce;
     unsigned char *seq = rl->sequence;
     int lenu, lenf;
     TLS_RL_RECORD *rec = &recs[0];
-    WPACKET wpkt;
-    const EVP_CIPHER *cipher;
     EVP_MAC_CTX *mac_ctx = NULL;
-    int mode;
+
+    if (rl->pipeline_cipher != NULL)
+        return tls13_cipher_pipeline(rl, recs, n_recs, sending);
 
     if (n_recs != 1) {
         /* Should not happen */
@@ -129,20 +325,6 @@ static int tls13_cipher(OSSL_RECORD_LAYER *rl, TLS_RL_RECORD *recs,
         return 1;
     }
 
-    /* For integrity-only ciphers, nonce_len is same as MAC size */
-    if (rl->mac_ctx != NULL) {
-        nonce_len = EVP_MAC_CTX_get_mac_size(rl->mac_ctx);
-    } else {
-        int ivlen = EVP_CIPHER_CTX_get_iv_length(enc_ctx);
-
-        if (ivlen < 0) {
-            /* Should not happen */
-            RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
-            return 0;
-        }
-        nonce_len = (size_t)ivlen;
-    }
-
     if (!sending) {
         /*
          * Take off tag. There must be at least one byte of content type as
@@ -154,13 +336,21 @@ static int tls13_cipher(OSSL_RECORD_LAYER *rl, TLS_RL_RECORD *recs,
     }
 
     /* Set up nonce: part of static IV followed by sequence number */
-    if (nonce_len < SEQ_NUM_SIZE) {
-        /* Should not happen */
-        RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
-        return 0;
+    if (rl->mac_ctx != NULL) {
+        /* For integrity-only ciphers, nonce_len is same as MAC size */
+        nonce_len = EVP_MAC_CTX_get_mac_size(rl->mac_ctx);
+        if (nonce_len < SEQ_NUM_SIZE) {
+            /* Should not happen */
+            RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+            return 0;
+        }
+        offset = nonce_len - SEQ_NUM_SIZE;
+        memcpy(nonce, staticiv, offset);
+    } else {
+        /* The leading part of the nonce was set up with the key */
+        nonce_len = rl->aead_ivlen;
+        offset = nonce_len - SEQ_NUM_SIZE;
     }
-    offset = nonce_len - SEQ_NUM_SIZE;
-    memcpy(nonce, staticiv, offset);
     for (loop = 0; loop < SEQ_NUM_SIZE; loop++)
         nonce[offset + loop] = staticiv[offset + loop] ^ seq[loop];
 
@@ -169,16 +359,8 @@ static int tls13_cipher(OSSL_RECORD_LAYER *rl, TLS_RL_RECORD *recs,
         return 0;
     }
 
-    /* Set up the AAD */
-    if (!WPACKET_init_static_len(&wpkt, recheader, sizeof(recheader), 0)
-        || !WPACKET_put_bytes_u8(&wpkt, rec->type)
-        || !WPACKET_put_bytes_u16(&wpkt, rec->rec_version)
-        || !WPACKET_put_bytes_u16(&wpkt, rec->length + rl->taglen)
-        || !WPACKET_get_total_written(&wpkt, &hdrlen)
-        || hdrlen != SSL3_RT_HEADER_LENGTH
-        || !WPACKET_finish(&wpkt)) {
-        RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
-        WPACKET_cleanup(&wpkt);
+    if (!tls13_set_aad(rl, rec, recheader)) {
+        /* RLAYERfatal already called */
         return 0;
     }
 
@@ -208,13 +390,6 @@ static int tls13_cipher(OSSL_RECORD_LAYER *rl, TLS_RL_RECORD *recs,
         return ret;
     }
 
-    cipher = EVP_CIPHER_CTX_get0_cipher(enc_ctx);
-    if (cipher == NULL) {
-        RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
-        return 0;
-    }
-    mode = EVP_CIPHER_get_mode(cipher);
-
     if (EVP_CipherInit_ex(enc_ctx, NULL, NULL, NULL, nonce, sending) <= 0
         || (!sending && EVP_CIPHER_CTX_ctrl(enc_ctx, EVP_CTRL_AEAD_SET_TAG, (int)rl->taglen, rec->data + rec->length) <= 0)) {
         RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
@@ -225,17 +400,42 @@ static int tls13_cipher(OSSL_RECORD_LAYER *rl, TLS_RL_RECORD *recs,
      * For CCM we must explicitly set the total plaintext length before we add
      * any AAD.
      */
-    if ((mode == EVP_CIPH_CCM_MODE
+    if ((rl->aead_mode == EVP_CIPH_CCM_MODE
             && EVP_CipherUpdate(enc_ctx, NULL, &lenu, NULL,
                    (unsigned int)rec->length)
                 <= 0)
         || EVP_CipherUpdate(enc_ctx, NULL, &lenu, recheader,
                sizeof(recheader))
-            <= 0
-        || EVP_CipherUpdate(enc_ctx, rec->data, &lenu, rec->input,
-               (unsigned int)rec->length)
-            <= 0
-        || EVP_CipherFinal_ex(enc_ctx, rec->data + lenu, &lenf) <= 0
+            <= 0) {
+        return 0;
+    }
+
+    if (sending && rec->input != rec->data) {
+        int lent;
+
+        /*
+         * The plaintext was left in the caller's buffer. Encrypt it from there
+         * followed by the content type and padding which are already in place.
+         */
+        if (EVP_CipherUpdate(enc_ctx, rec->data, &lenu, rec->input,
+                (unsigned int)rec->input_len)
+                <= 0
+            || EVP_CipherUpdate(enc_ctx, rec->data + lenu, &lent,
+                   rec->data + rec->input_len,
+                   (unsigned int)(rec->length - rec->input_len))
+                <= 0) {
+            RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+            return 0;
+        }
+        lenu += lent;
+        rec->input = rec->data;
+    } else if (EVP_CipherUpdate(enc_ctx, rec->data, &lenu, rec->input,
+                   (unsigned int)rec->length)
+        <= 0) {
+        return 0;
+    }
+
+    if (EVP_CipherFinal_ex(enc_ctx, rec->data + lenu, &lenf) <= 0
         || (size_t)lenu + lenf != rec->length) {
         return 0;
     }
@@ -253,6 +453,30 @@ static int tls13_cipher(OSSL_RECORD_LAYER *rl, TLS_RL_RECORD *recs,
     return 1;
 }
 
+static size_t tls13_get_max_records(OSSL_RECORD_LAYER *rl, uint8_t type,
+    size_t len, size_t maxfrag,
+    size_t *preffrag)
+{
+    /*
+     * With a pipeline capable AEAD cipher we can protect several application
+     * data records with one call to the cipher. They all use the same key and
+     * consecutive sequence numbers.
+     */
+    if (rl->max_pipelines > 1
+        && rl->pipeline_cipher != NULL
+        && type == SSL3_RT_APPLICATION_DATA) {
+        size_t pipes;
+
+        if (len == 0)
+            return 1;
+        pipes = ((len - 1) / *preffrag) + 1;
+
+        return (pipes < rl->max_pipelines) ? pipes : rl->max_pipelines;
+    }
+
+    return 1;
+}
+
 static int tls13_validate_record_header(OSSL_RECORD_LAYER *rl,
     TLS_RL_RECORD *rec)
 {
@@ -419,7 +643,7 @@ const struct record_functions_st tls_1_3_funcs = {
     tls_get_more_records,
     tls13_validate_record_header,
     tls13_post_process_record,
-    tls_get_max_records_default,
+    tls13_get_max_records,
     tls_write_records_default,
     tls_allocate_write_buffers_default,
     tls_initialise_write_packets_default,
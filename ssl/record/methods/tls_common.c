@@ -23,9 +23,30 @@
 
 static void tls_int_free(OSSL_RECORD_LAYER *rl);
 
-void ossl_tls_buffer_release(TLS_BUFFER *b)
+/*
+ * Allocate and free record buffers. These come from the SSL_CTX's buffer pool
+ * if the caller provided one.
+ */
+unsigned char *ossl_tls_buffer_alloc(OSSL_RECORD_LAYER *rl, size_t len)
+{
+    if (rl->buffer_alloc != NULL)
+        return rl->buffer_alloc(rl->cbarg, len);
+
+    return OPENSSL_malloc(len);
+}
+
+void ossl_tls_buffer_free(OSSL_RECORD_LAYER *rl, unsigned char *buf,
+    size_t len)
 {
-    OPENSSL_free(b->buf);
+    if (rl->buffer_free != NULL)
+        rl->buffer_free(rl->cbarg, buf, len);
+    else
+        OPENSSL_free(buf);
+}
+
+void ossl_tls_buffer_release(OSSL_RECORD_LAYER *rl, TLS_BUFFER *b)
+{
+    ossl_tls_buffer_free(rl, b->buf, b->len);
     b->buf = NULL;
 }
 
@@ -133,7 +154,7 @@ static void tls_release_write_buffer_int(OSSL_RECORD_LAYER *rl, size_t start)
         if (TLS_BUFFER_is_app_buffer(wb))
             TLS_BUFFER_set_app_buffer(wb, 0);
         else
-            OPENSSL_free(wb->buf);
+            ossl_tls_buffer_free(rl, wb->buf, wb->len);
         wb->buf = NULL;
         pipes--;
     }
@@ -187,13 +208,13 @@ int tls_setup_write_buffer(OSSL_RECORD_LAYER *rl, size_t numwpipes,
             len = defltlen;
 
         if (thiswb->len != len) {
-            OPENSSL_free(thiswb->buf);
+            ossl_tls_buffer_free(rl, thiswb->buf, thiswb->len);
             thiswb->buf = NULL; /* force reallocation */
         }
 
         p = thiswb->buf;
         if (p == NULL) {
-            p = OPENSSL_malloc(len);
+            p = ossl_tls_buffer_alloc(rl, len);
             if (p == NULL) {
                 if (rl->numwpipes < currpipe)
                     rl->numwpipes = currpipe;
@@ -258,7 +279,7 @@ int tls_setup_read_buffer(OSSL_RECORD_LAYER *rl)
         if (b->default_len > len)
             len = b->default_len;
 
-        if ((p = OPENSSL_malloc(len)) == NULL) {
+        if ((p = ossl_tls_buffer_alloc(rl, len)) == NULL) {
             /*
              * We've got a malloc failure, and we're still initialising buffers.
              * We assume we're so doomed that we won't even be able to send an
@@ -274,6 +295,24 @@ int tls_setup_read_buffer(OSSL_RECORD_LAYER *rl)
     return 1;
 }
 
+static int tls_setup_pipeline_plain_buffer(OSSL_RECORD_LAYER *rl)
+{
+    size_t len = TLS_BUFFER_get_len(&rl->rbuf);
+
+    if (rl->pipeline_plain != NULL && rl->pipeline_plain_len >= len)
+        return 1;
+
+    OPENSSL_clear_free(rl->pipeline_plain, rl->pipeline_plain_len);
+    rl->pipeline_plain_len = 0;
+    if ((rl->pipeline_plain = OPENSSL_malloc(len)) == NULL) {
+        RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_CRYPTO_LIB);
+        return 0;
+    }
+    rl->pipeline_plain_len = len;
+
+    return 1;
+}
+
 static int tls_release_read_buffer(OSSL_RECORD_LAYER *rl)
 {
     TLS_BUFFER *b;
@@ -281,8 +320,10 @@ static int tls_release_read_buffer(OSSL_RECORD_LAYER *rl)
     b = &rl->rbuf;
     if ((rl->options & SSL_OP_CLEANSE_PLAINTEXT) != 0)
         OPENSSL_cleanse(b->buf, b->len);
-    OPENSSL_free(b->buf);
-    b->buf = NULL;
+    ossl_tls_buffer_release(rl, b);
+    OPENSSL_clear_free(rl->pipeline_plain, rl->pipeline_plain_len);
+    rl->pipeline_plain = NULL;
+    rl->pipeline_plain_len = 0;
     rl->packet = NULL;
     rl->packet_length = 0;
     return 1;
@@ -494,6 +535,27 @@ static int tls_record_app_data_waiting(OSSL_RECORD_LAYER *rl)
     return 1;
 }
 
+/*
+ * Returns 1 if we can decrypt several records with one call to the cipher
+ * function, or 0 otherwise.
+ */
+static int tls_can_pipeline_read(OSSL_RECORD_LAYER *rl)
+{
+    /*
+     * TLSv1.3 with a pipeline capable AEAD cipher. We don't batch records
+     * before the application protection level to keep things simple: the
+     * records following a Finished are protected with different keys.
+     */
+    if (rl->pipeline_cipher != NULL)
+        return rl->level == OSSL_RECORD_PROTECTION_LEVEL_APPLICATION;
+
+    return RLAYER_USE_EXPLICIT_IV(rl)
+        && rl->enc_ctx != NULL
+        && (EVP_CIPHER_get_flags(EVP_CIPHER_CTX_get0_cipher(rl->enc_ctx))
+               & EVP_CIPH_FLAG_PIPELINE)
+        != 0;
+}
+
 static int rlayer_early_data_count_ok(OSSL_RECORD_LAYER *rl, size_t length,
     size_t overhead, int send)
 {
@@ -551,6 +613,7 @@ int tls_get_more_records(OSSL_RECORD_LAYER *rl)
     size_t mac_size = 0;
     int imac_size;
     size_t num_recs = 0, max_recs, j;
+    unsigned char seq[SEQ_NUM_SIZE];
     PACKET pkt;
     SSL_MAC_BUF *macbufs = NULL;
     int ret = OSSL_RECORD_RETURN_FATAL;
@@ -667,11 +730,7 @@ int tls_get_more_records(OSSL_RECORD_LAYER *rl)
         rl->is_first_record = 0;
     } while (num_recs < max_recs
         && thisrr->type == SSL3_RT_APPLICATION_DATA
-        && RLAYER_USE_EXPLICIT_IV(rl)
-        && rl->enc_ctx != NULL
-        && (EVP_CIPHER_get_flags(EVP_CIPHER_CTX_get0_cipher(rl->enc_ctx))
-               & EVP_CIPH_FLAG_PIPELINE)
-            != 0
+        && tls_can_pipeline_read(rl)
         && tls_record_app_data_waiting(rl));
 
     if (num_recs == 1
@@ -758,9 +817,53 @@ int tls_get_more_records(OSSL_RECORD_LAYER *rl)
         }
     }
 
+    if (num_recs > 1 && rl->pipeline_cipher != NULL) {
+        /*
+         * A batch of TLSv1.3 records. Decrypt them out of place so that we
+         * still have the ciphertext if we need to fall back (see below).
+         */
+        if (!tls_setup_pipeline_plain_buffer(rl)) {
+            /* RLAYERfatal() already called */
+            goto end;
+        }
+        p = rl->pipeline_plain;
+        for (j = 0; j < num_recs; j++) {
+            rr[j].data = p;
+            p += rr[j].length;
+        }
+        memcpy(seq, rl->sequence, SEQ_NUM_SIZE);
+    }
+
     ERR_set_mark();
     enc_err = rl->funcs->cipher(rl, rr, num_recs, 0, macbufs, mac_size);
 
+    if (enc_err == 0
+        && num_recs > 1
+        && rl->pipeline_cipher != NULL
+        && rl->alert == SSL_AD_NO_ALERT) {
+        size_t unread;
+
+        /*
+         * A record in the batch failed to decrypt. That is expected if an
+         * earlier record in the batch contained a KeyUpdate, because the
+         * records after it are protected with the next key. Put all but the
+         * first record back into the read buffer and decrypt just that one,
+         * in place. Any genuinely bad record will fail once it is first in
+         * the batch.
+         */
+        ERR_pop_to_mark();
+        ERR_set_mark();
+        memcpy(rl->sequence, seq, SEQ_NUM_SIZE);
+        unread = (size_t)(rbuf->buf + rbuf->offset
+            - (rr[1].input - SSL3_RT_HEADER_LENGTH));
+        rbuf->offset -= unread;
+        rbuf->left += unread;
+        num_recs = 1;
+        rr[0].data = rr[0].input;
+        rr[0].length = rr[0].orig_len;
+        enc_err = rl->funcs->cipher(rl, rr, num_recs, 0, macbufs, mac_size);
+    }
+
     /*-
      * enc_err is:
      *    0: if the record is publicly invalid, or an internal error, or AEAD
@@ -1170,6 +1273,38 @@ int tls_set_options(OSSL_RECORD_LAYER *rl, const OSSL_PARAM *options)
             ERR_raise(ERR_LIB_SSL, SSL_R_FAILED_TO_GET_PARAMETER);
             return 0;
         }
+        p = OSSL_PARAM_locate_const(options,
+            OSSL_LIBSSL_RECORD_LAYER_PARAM_SIZING_LEN);
+        if (p != NULL && !OSSL_PARAM_get_size_t(p, &rl->sizing_len)) {
+            ERR_raise(ERR_LIB_SSL, SSL_R_FAILED_TO_GET_PARAMETER);
+            return 0;
+        }
+        p = OSSL_PARAM_locate_const(options,
+            OSSL_LIBSSL_RECORD_LAYER_PARAM_SIZING_THRESHOLD);
+        if (p != NULL && !OSSL_PARAM_get_size_t(p, &rl->sizing_threshold)) {
+            ERR_raise(ERR_LIB_SSL, SSL_R_FAILED_TO_GET_PARAMETER);
+            return 0;
+        }
+        p = OSSL_PARAM_locate_const(options,
+            OSSL_LIBSSL_RECORD_LAYER_PARAM_SIZING_IDLE);
+        if (p != NULL) {
+            uint64_t idle_ms;
+
+            if (!OSSL_PARAM_get_uint64(p, &idle_ms)) {
+                ERR_raise(ERR_LIB_SSL, SSL_R_FAILED_TO_GET_PARAMETER);
+                return 0;
+            }
+            rl->sizing_idle = ossl_ms2time(idle_ms);
+        }
+        p = OSSL_PARAM_locate_const(options,
+            OSSL_LIBSSL_RECORD_LAYER_PARAM_SIZING_SENT);
+        if (p != NULL) {
+            if (!OSSL_PARAM_get_size_t(p, &rl->sizing_sent)) {
+                ERR_raise(ERR_LIB_SSL, SSL_R_FAILED_TO_GET_PARAMETER);
+                return 0;
+            }
+            rl->sizing_last_write = ossl_time_now();
+        }
     }
 
     if (rl->level == OSSL_RECORD_PROTECTION_LEVEL_APPLICATION) {
@@ -1298,6 +1433,13 @@ int tls_int_new_record_layer(OSSL_LIB_CTX *libctx, const char *propq, int vers,
                 break;
             case OSSL_FUNC_RLAYER_PADDING:
                 rl->padding = OSSL_FUNC_rlayer_padding(fns);
+                break;
+            case OSSL_FUNC_RLAYER_BUFFER_ALLOC:
+                rl->buffer_alloc = OSSL_FUNC_rlayer_buffer_alloc(fns);
+                break;
+            case OSSL_FUNC_RLAYER_BUFFER_FREE:
+                rl->buffer_free = OSSL_FUNC_rlayer_buffer_free(fns);
+                break;
             default:
                 /* Just ignore anything we don't understand */
                 break;
@@ -1389,7 +1531,7 @@ static void tls_int_free(OSSL_RECORD_LAYER *rl)
     BIO_free(rl->prev);
     BIO_free_all(rl->bio);
     BIO_free(rl->next);
-    ossl_tls_buffer_release(&rl->rbuf);
+    ossl_tls_buffer_release(rl, &rl->rbuf);
 
     tls_release_write_buffer(rl);
 
@@ -1401,6 +1543,9 @@ static void tls_int_free(OSSL_RECORD_LAYER *rl)
 #endif
     OPENSSL_free(rl->iv);
     OPENSSL_free(rl->nonce);
+    EVP_CIPHER_free(rl->pipeline_cipher);
+    OPENSSL_clear_free(rl->pipeline_key, rl->pipeline_keylen);
+    OPENSSL_clear_free(rl->pipeline_plain, rl->pipeline_plain_len);
 
     TLS_RL_RECORD_release(rl->rrec, SSL_MAX_PIPELINES);
 
@@ -1483,6 +1628,25 @@ size_t tls_get_max_records_default(OSSL_RECORD_LAYER *rl, uint8_t type,
 size_t tls_get_max_records(OSSL_RECORD_LAYER *rl, uint8_t type, size_t len,
     size_t maxfrag, size_t *preffrag)
 {
+    /*
+     * With dynamic record sizing we keep application data records small
+     * while the connection is new, or has been idle for a while, so that the
+     * peer can start decrypting before a full sized record has arrived.
+     */
+    if (rl->sizing_len > 0 && type == SSL3_RT_APPLICATION_DATA) {
+        if (rl->sizing_sent > 0
+            && !ossl_time_is_zero(rl->sizing_idle)
+            && ossl_time_compare(ossl_time_subtract(ossl_time_now(),
+                                     rl->sizing_last_write),
+                   rl->sizing_idle)
+                > 0)
+            rl->sizing_sent = 0;
+
+        if (rl->sizing_sent < rl->sizing_threshold
+            && *preffrag > rl->sizing_len)
+            *preffrag = rl->sizing_len;
+    }
+
     return rl->funcs->get_max_records(rl, type, len, maxfrag, preffrag);
 }
 
@@ -1612,7 +1776,9 @@ int tls_prepare_for_encryption_default(OSSL_RECORD_LAYER *rl,
     /* Get a pointer to the start of this record excluding header */
     recordstart = WPACKET_get_curr(thispkt) - len;
     TLS_RL_RECORD_set_data(thiswr, recordstart);
-    TLS_RL_RECORD_reset_input(thiswr);
+    /* Unless the plaintext was left in the template, encrypt in place */
+    if (thiswr->input_len == 0)
+        TLS_RL_RECORD_reset_input(thiswr);
     TLS_RL_RECORD_set_length(thiswr, len);
 
     return 1;
@@ -1766,6 +1932,18 @@ int tls_write_records_default(OSSL_RECORD_LAYER *rl,
                 RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, SSL_R_COMPRESSION_FAILURE);
                 goto err;
             }
+        } else if (compressdata != NULL && rl->encrypt_from_template
+            && thiswr->length > 0) {
+            /*
+             * Leave the plaintext in the template buffer. The cipher reads it
+             * from there and writes the ciphertext into our buffer, which
+             * saves copying it.
+             */
+            if (!WPACKET_allocate_bytes(thispkt, thiswr->length, NULL)) {
+                RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+                goto err;
+            }
+            thiswr->input_len = thiswr->length;
         } else if (compressdata != NULL) {
             if (!WPACKET_memcpy(thispkt, thiswr->input, thiswr->length)) {
                 RLAYERfatal(rl, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
@@ -1840,6 +2018,17 @@ int tls_write_records(OSSL_RECORD_LAYER *rl, OSSL_RECORD_TEMPLATE *templates,
         return OSSL_RECORD_RETURN_FATAL;
     }
 
+    if (rl->sizing_len > 0) {
+        size_t i;
+
+        for (i = 0; i < numtempl; i++) {
+            if (templates[i].type == SSL3_RT_APPLICATION_DATA
+                && rl->sizing_sent < rl->sizing_threshold)
+                rl->sizing_sent += templates[i].buflen;
+        }
+        rl->sizing_last_write = ossl_time_now();
+    }
+
     rl->nextwbuf = 0;
     /* we now just need to write the buffers */
     return tls_retry_write_records(rl);
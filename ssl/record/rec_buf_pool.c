@@ -0,0 +1,217 @@
+/*
+ * Copyright 2026 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <string.h>
+#include <openssl/crypto.h>
+#include "../ssl_local.h"
+#include "record_local.h"
+
+/*
+ * A pool of record layer buffers shared between all the connections created
+ * from an SSL_CTX. Buffers are grouped into a small number of size classes.
+ * Requested lengths are rounded up to a multiple of RECORD_BUF_POOL_GRANULE so
+ * that buffers whose exact sizes differ slightly (e.g. because of different
+ * cipher overheads) still end up in the same class. Free buffers are kept on a
+ * singly linked list threaded through the buffers themselves.
+ *
+ * Every buffer handed out by the pool is an ordinary OPENSSL_malloc()
+ * allocation, so it is always safe to OPENSSL_free() one rather than return it.
+ * The reverse is not true: only buffers obtained from
+ * ossl_record_buffer_pool_get() may be returned, because they are the only ones
+ * known to be as large as their size class. A NULL pool is accepted by both
+ * functions so that connections can move between SSL_CTXs with and without a
+ * pool.
+ */
+
+#define RECORD_BUF_POOL_CLASSES 4
+#define RECORD_BUF_POOL_GRANULE 1024
+
+typedef struct {
+    /* Rounded length of the buffers in this class, 0 if the class is unused */
+    size_t len;
+    /* The free list and the number of buffers on it */
+    unsigned char *head;
+    size_t num;
+} RECORD_BUF_POOL_CLASS;
+
+struct ossl_record_buffer_pool_st {
+    CRYPTO_RWLOCK *lock;
+    /* Maximum number of free buffers to retain in each class */
+    size_t max_free;
+    RECORD_BUF_POOL_CLASS classes[RECORD_BUF_POOL_CLASSES];
+    uint64_t hits;
+    uint64_t misses;
+};
+
+static ossl_inline size_t pool_round_len(size_t len)
+{
+    if (len > SIZE_MAX - (RECORD_BUF_POOL_GRANULE - 1))
+        return 0;
+    return (len + RECORD_BUF_POOL_GRANULE - 1)
+        & ~((size_t)RECORD_BUF_POOL_GRANULE - 1);
+}
+
+static ossl_inline unsigned char *pool_next(unsigned char *buf)
+{
+    unsigned char *next;
+
+    memcpy(&next, buf, sizeof(next));
+    return next;
+}
+
+/* Free all but |keep| of the buffers on a class's free list */
+static void pool_trim_class(RECORD_BUF_POOL_CLASS *cls, size_t keep)
+{
+    unsigned char *buf;
+
+    while (cls->num > keep) {
+        buf = cls->head;
+        cls->head = pool_next(buf);
+        cls->num--;
+        OPENSSL_free(buf);
+    }
+    if (cls->num == 0)
+        cls->len = 0;
+}
+
+OSSL_RECORD_BUFFER_POOL *ossl_record_buffer_pool_new(void)
+{
+    OSSL_RECORD_BUFFER_POOL *pool = OPENSSL_zalloc(sizeof(*pool));
+
+    if (pool == NULL)
+        return NULL;
+
+    pool->lock = CRYPTO_THREAD_lock_new();
+    if (pool->lock == NULL) {
+        OPENSSL_free(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+void ossl_record_buffer_pool_free(OSSL_RECORD_BUFFER_POOL *pool)
+{
+    size_t i;
+
+    if (pool == NULL)
+        return;
+
+    for (i = 0; i < RECORD_BUF_POOL_CLASSES; i++)
+        pool_trim_class(&pool->classes[i], 0);
+    CRYPTO_THREAD_lock_free(pool->lock);
+    OPENSSL_free(pool);
+}
+
+int ossl_record_buffer_pool_set_size(OSSL_RECORD_BUFFER_POOL *pool,
+    size_t max_free)
+{
+    size_t i;
+
+    if (!CRYPTO_THREAD_write_lock(pool->lock))
+        return 0;
+    pool->max_free = max_free;
+    for (i = 0; i < RECORD_BUF_POOL_CLASSES; i++)
+        pool_trim_class(&pool->classes[i], max_free);
+    CRYPTO_THREAD_unlock(pool->lock);
+
+    return 1;
+}
+
+size_t ossl_record_buffer_pool_get_size(const OSSL_RECORD_BUFFER_POOL *pool)
+{
+    return pool->max_free;
+}
+
+unsigned char *ossl_record_buffer_pool_get(OSSL_RECORD_BUFFER_POOL *pool,
+    size_t len)
+{
+    size_t i, rlen = pool_round_len(len);
+    unsigned char *buf = NULL;
+
+    if (rlen == 0)
+        return NULL;
+    if (pool == NULL)
+        return OPENSSL_malloc(rlen);
+
+    if (!CRYPTO_THREAD_write_lock(pool->lock))
+        return NULL;
+    for (i = 0; i < RECORD_BUF_POOL_CLASSES; i++) {
+        RECORD_BUF_POOL_CLASS *cls = &pool->classes[i];
+
+        if (cls->len == rlen && cls->head != NULL) {
+            buf = cls->head;
+            cls->head = pool_next(buf);
+            cls->num--;
+            break;
+        }
+    }
+    if (buf != NULL)
+        pool->hits++;
+    else
+        pool->misses++;
+    CRYPTO_THREAD_unlock(pool->lock);
+
+    if (buf == NULL)
+        buf = OPENSSL_malloc(rlen);
+
+    return buf;
+}
+
+void ossl_record_buffer_pool_put(OSSL_RECORD_BUFFER_POOL *pool,
+    unsigned char *buf, size_t len)
+{
+    size_t i, rlen = pool_round_len(len);
+    RECORD_BUF_POOL_CLASS *cls = NULL;
+
+    if (buf == NULL)
+        return;
+
+    if (pool != NULL && rlen != 0 && CRYPTO_THREAD_write_lock(pool->lock)) {
+        for (i = 0; i < RECORD_BUF_POOL_CLASSES; i++) {
+            if (pool->classes[i].len == rlen) {
+                cls = &pool->classes[i];
+                break;
+            }
+            if (cls == NULL && pool->classes[i].num == 0)
+                cls = &pool->classes[i];
+        }
+        if (cls != NULL && cls->num < pool->max_free) {
+            cls->len = rlen;
+            memcpy(buf, &cls->head, sizeof(cls->head));
+            cls->head = buf;
+            cls->num++;
+            buf = NULL;
+        }
+        CRYPTO_THREAD_unlock(pool->lock);
+    }
+
+    OPENSSL_free(buf);
+}
+
+int ossl_record_buffer_pool_get_stats(OSSL_RECORD_BUFFER_POOL *pool,
+    uint64_t *hits, uint64_t *misses,
+    size_t *idle)
+{
+    size_t i, num = 0;
+
+    if (!CRYPTO_THREAD_read_lock(pool->lock))
+        return 0;
+    for (i = 0; i < RECORD_BUF_POOL_CLASSES; i++)
+        num += pool->classes[i].num;
+    if (hits != NULL)
+        *hits = pool->hits;
+    if (misses != NULL)
+        *misses = pool->misses;
+    if (idle != NULL)
+        *idle = num;
+    CRYPTO_THREAD_unlock(pool->lock);
+
+    return 1;
+}
@@ -48,6 +48,11 @@ int RECORD_LAYER_clear(RECORD_LAYER *rl)
     rl->alert_count = 0;
     rl->num_recs = 0;
     rl->curr_rec = 0;
+    rl->ktls_read_bytes = 0;
+    rl->ktls_written_bytes = 0;
+    rl->user_read_bytes = 0;
+    rl->user_written_bytes = 0;
+    rl->sizing_sent = 0;
 
     BIO_free(rl->rrlnext);
     rl->rrlnext = NULL;
@@ -260,6 +265,50 @@ static int tls_write_check_pending(SSL_CONNECTION *s, uint8_t type,
     return 1;
 }
 
+static ossl_inline int rlayer_is_ktls(const OSSL_RECORD_METHOD *meth)
+{
+#ifndef OPENSSL_NO_KTLS
+    return meth == &ossl_ktls_record_method;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * The amount of application data that counts towards the dynamic record
+ * sizing threshold, which starts again once the connection has been idle
+ */
+static size_t rlayer_sizing_sent(SSL_CONNECTION *s)
+{
+    RECORD_LAYER *rl = &s->rlayer;
+
+    if (rl->sizing_sent > 0 && rl->sizing_idle_ms > 0
+        && ossl_time_compare(ossl_time_subtract(ossl_time_now(),
+                                 rl->sizing_last_write),
+               ossl_ms2time(rl->sizing_idle_ms))
+            > 0)
+        return 0;
+    return rl->sizing_sent;
+}
+
+static void rlayer_count_written(SSL_CONNECTION *s, uint8_t type, size_t len)
+{
+    if (type != SSL3_RT_APPLICATION_DATA)
+        return;
+
+    if (rlayer_is_ktls(s->rlayer.wrlmethod))
+        s->rlayer.ktls_written_bytes += len;
+    else
+        s->rlayer.user_written_bytes += len;
+
+    if (s->rlayer.sizing_len > 0) {
+        s->rlayer.sizing_sent = rlayer_sizing_sent(s);
+        if (s->rlayer.sizing_sent < s->rlayer.sizing_threshold)
+            s->rlayer.sizing_sent += len;
+        s->rlayer.sizing_last_write = ossl_time_now();
+    }
+}
+
 /*
  * Call this to write data in records of type 'type' It will return <= 0 if
  * not all data has been sent or non-blocking IO.
@@ -269,7 +318,8 @@ int ssl3_write_bytes(SSL *ssl, uint8_t type, const void *buf_, size_t len,
 {
     const unsigned char *buf = buf_;
     size_t tot;
-    size_t n, max_send_fragment, split_send_fragment, maxpipes;
+    size_t n, max_send_fragment, split_send_fragment, pref_send_fragment;
+    size_t maxpipes;
     int i;
     SSL_CONNECTION *s = SSL_CONNECTION_FROM_SSL_ONLY(ssl);
     OSSL_RECORD_TEMPLATE tmpls[SSL_MAX_PIPELINES];
@@ -340,6 +390,7 @@ int ssl3_write_bytes(SSL *ssl, uint8_t type, const void *buf_, size_t len,
             s->rlayer.wnum = tot;
             return i;
         }
+        rlayer_count_written(s, s->rlayer.wpend_type, s->rlayer.wpend_tot);
         tot += s->rlayer.wpend_tot;
         s->rlayer.wpend_tot = 0;
     } /* else no retry required */
@@ -373,11 +424,11 @@ int ssl3_write_bytes(SSL *ssl, uint8_t type, const void *buf_, size_t len,
     n = (len - tot);
 
     max_send_fragment = ssl_get_max_send_fragment(s);
-    split_send_fragment = ssl_get_split_send_fragment(s);
+    pref_send_fragment = ssl_get_split_send_fragment(s);
 
     if (max_send_fragment == 0
-        || split_send_fragment == 0
-        || split_send_fragment > max_send_fragment) {
+        || pref_send_fragment == 0
+        || pref_send_fragment > max_send_fragment) {
         /*
          * We should have prevented this when we set/get the split and max send
          * fragments so we shouldn't get here
@@ -404,7 +455,9 @@ int ssl3_write_bytes(SSL *ssl, uint8_t type, const void *buf_, size_t len,
         /*
          * Ask the record layer how it would like to split the amount of data
          * that we have, and how many of those records it would like in one go.
+         * The answer may change from one batch of records to the next.
          */
+        split_send_fragment = pref_send_fragment;
         maxpipes = s->rlayer.wrlmethod->get_max_records(s->rlayer.wrl, type, n,
             max_send_fragment,
             &split_send_fragment);
@@ -468,6 +521,7 @@ int ssl3_write_bytes(SSL *ssl, uint8_t type, const void *buf_, size_t len,
             s->rlayer.wnum = tot;
             return i;
         }
+        rlayer_count_written(s, type, s->rlayer.wpend_tot);
 
         if (s->rlayer.wpend_tot == n
             || (type == SSL3_RT_APPLICATION_DATA
@@ -705,6 +759,12 @@ start:
                 return ret;
             }
             rr->off = 0;
+            if (rr->type == SSL3_RT_APPLICATION_DATA) {
+                if (rlayer_is_ktls(s->rlayer.rrlmethod))
+                    s->rlayer.ktls_read_bytes += rr->length;
+                else
+                    s->rlayer.user_read_bytes += rr->length;
+            }
             s->rlayer.num_recs++;
         } while (s->rlayer.rrlmethod->processed_read_pending(s->rlayer.rrl)
             && s->rlayer.num_recs < SSL_MAX_PIPELINES);
@@ -1146,11 +1206,30 @@ static size_t rlayer_padding_wrapper(void *cbarg, int type, size_t len)
         s->rlayer.record_padding_arg);
 }
 
+static OSSL_FUNC_rlayer_buffer_alloc_fn rlayer_buffer_alloc_wrapper;
+static unsigned char *rlayer_buffer_alloc_wrapper(void *cbarg, size_t len)
+{
+    SSL_CONNECTION *s = cbarg;
+
+    return ossl_record_buffer_pool_get(SSL_CONNECTION_GET_CTX(s)->bufpool, len);
+}
+
+static OSSL_FUNC_rlayer_buffer_free_fn rlayer_buffer_free_wrapper;
+static void rlayer_buffer_free_wrapper(void *cbarg, unsigned char *buf,
+    size_t len)
+{
+    SSL_CONNECTION *s = cbarg;
+
+    ossl_record_buffer_pool_put(SSL_CONNECTION_GET_CTX(s)->bufpool, buf, len);
+}
+
 static const OSSL_DISPATCH rlayer_dispatch[] = {
     { OSSL_FUNC_RLAYER_SKIP_EARLY_DATA, (void (*)(void))ossl_statem_skip_early_data },
     { OSSL_FUNC_RLAYER_MSG_CALLBACK, (void (*)(void))rlayer_msg_callback_wrapper },
     { OSSL_FUNC_RLAYER_SECURITY, (void (*)(void))rlayer_security_wrapper },
     { OSSL_FUNC_RLAYER_PADDING, (void (*)(void))rlayer_padding_wrapper },
+    { OSSL_FUNC_RLAYER_BUFFER_ALLOC, (void (*)(void))rlayer_buffer_alloc_wrapper },
+    { OSSL_FUNC_RLAYER_BUFFER_FREE, (void (*)(void))rlayer_buffer_free_wrapper },
     OSSL_DISPATCH_END
 };
 
@@ -1231,7 +1310,7 @@ int ssl_set_new_record_layer(SSL_CONNECTION *s, int version,
     int mactype, const EVP_MD *md,
     const SSL_COMP *comp, const EVP_MD *kdfdigest)
 {
-    OSSL_PARAM options[5], *opts = options;
+    OSSL_PARAM options[9], *opts = options;
     OSSL_PARAM settings[6], *set = settings;
     const OSSL_RECORD_METHOD **thismethod;
     OSSL_RECORD_LAYER **thisrl, *newrl = NULL;
@@ -1244,6 +1323,7 @@ int ssl_set_new_record_layer(SSL_CONNECTION *s, int version,
         : SSL3_RT_MAX_PLAIN_LENGTH;
     int use_early_data = 0;
     uint32_t max_early_data;
+    size_t sizing_sent;
     COMP_METHOD *compm = (comp == NULL) ? NULL : comp->method;
 
     if (direction == OSSL_RECORD_DIRECTION_READ) {
@@ -1306,6 +1386,16 @@ int ssl_set_new_record_layer(SSL_CONNECTION *s, int version,
             &s->rlayer.block_padding);
         *opts++ = OSSL_PARAM_construct_size_t(OSSL_LIBSSL_RECORD_LAYER_PARAM_HS_PADDING,
             &s->rlayer.hs_padding);
+        *opts++ = OSSL_PARAM_construct_size_t(OSSL_LIBSSL_RECORD_LAYER_PARAM_SIZING_LEN,
+            &s->rlayer.sizing_len);
+        *opts++ = OSSL_PARAM_construct_size_t(OSSL_LIBSSL_RECORD_LAYER_PARAM_SIZING_THRESHOLD,
+            &s->rlayer.sizing_threshold);
+        *opts++ = OSSL_PARAM_construct_uint64(OSSL_LIBSSL_RECORD_LAYER_PARAM_SIZING_IDLE,
+            &s->rlayer.sizing_idle_ms);
+        /* Carry on from where the previous record layer had got to */
+        sizing_sent = rlayer_sizing_sent(s);
+        *opts++ = OSSL_PARAM_construct_size_t(OSSL_LIBSSL_RECORD_LAYER_PARAM_SIZING_SENT,
+            &sizing_sent);
     }
     *opts = OSSL_PARAM_construct_end();
 
@@ -1418,6 +1508,11 @@ int ssl_set_new_record_layer(SSL_CONNECTION *s, int version,
                 if (s->rlayer.record_padding_cb == NULL)
                     continue;
                 break;
+            case OSSL_FUNC_RLAYER_BUFFER_ALLOC:
+            case OSSL_FUNC_RLAYER_BUFFER_FREE:
+                if (SSL_CONNECTION_GET_CTX(s)->bufpool == NULL)
+                    continue;
+                break;
             default:
                 break;
             }
@@ -120,6 +120,17 @@ typedef struct record_layer_st {
     size_t block_padding;
     size_t hs_padding;
 
+    /* Dynamic record sizing, see SSL_set_record_sizing() */
+    size_t sizing_len;
+    size_t sizing_threshold;
+    uint64_t sizing_idle_ms;
+    /*
+     * Application data written since small records were last started on,
+     * kept here so that it survives a change of write record layer
+     */
+    size_t sizing_sent;
+    OSSL_TIME sizing_last_write;
+
     /* How many records we have read from the record layer */
     size_t num_recs;
     /* The next record from the record layer that we need to process */
@@ -127,6 +138,14 @@ typedef struct record_layer_st {
     /* Record layer data to be processed */
     TLS_RECORD tlsrecs[SSL_MAX_PIPELINES];
 
+    /*
+     * Application data bytes read and written, split by whether kernel TLS or
+     * our own record layer did the work
+     */
+    uint64_t ktls_read_bytes;
+    uint64_t ktls_written_bytes;
+    uint64_t user_read_bytes;
+    uint64_t user_written_bytes;
 } RECORD_LAYER;
 
 /*****************************************************************************
@@ -194,5 +213,24 @@ OSSL_CORE_MAKE_FUNC(void, rlayer_msg_callback, (int write_p, int version, int co
 OSSL_CORE_MAKE_FUNC(int, rlayer_security, (void *cbarg, int op, int bits, int nid, void *other))
 #define OSSL_FUNC_RLAYER_PADDING 4
 OSSL_CORE_MAKE_FUNC(size_t, rlayer_padding, (void *cbarg, int type, size_t len))
+#define OSSL_FUNC_RLAYER_BUFFER_ALLOC 5
+OSSL_CORE_MAKE_FUNC(unsigned char *, rlayer_buffer_alloc, (void *cbarg, size_t len))
+#define OSSL_FUNC_RLAYER_BUFFER_FREE 6
+OSSL_CORE_MAKE_FUNC(void, rlayer_buffer_free, (void *cbarg, unsigned char *buf, size_t len))
+
+typedef struct ossl_record_buffer_pool_st OSSL_RECORD_BUFFER_POOL;
+
+OSSL_RECORD_BUFFER_POOL *ossl_record_buffer_pool_new(void);
+void ossl_record_buffer_pool_free(OSSL_RECORD_BUFFER_POOL *pool);
+int ossl_record_buffer_pool_set_size(OSSL_RECORD_BUFFER_POOL *pool,
+    size_t max_free);
+size_t ossl_record_buffer_pool_get_size(const OSSL_RECORD_BUFFER_POOL *pool);
+unsigned char *ossl_record_buffer_pool_get(OSSL_RECORD_BUFFER_POOL *pool,
+    size_t len);
+void ossl_record_buffer_pool_put(OSSL_RECORD_BUFFER_POOL *pool,
+    unsigned char *buf, size_t len);
+int ossl_record_buffer_pool_get_stats(OSSL_RECORD_BUFFER_POOL *pool,
+    uint64_t *hits, uint64_t *misses,
+    size_t *idle);
 
 #endif /* !defined(OSSL_SSL_RECORD_RECORD_H) */
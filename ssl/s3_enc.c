@@ -22,6 +22,103 @@ void ssl3_cleanup_key_block(SSL_CONNECTION *s)
     s->s3.tmp.key_block_length = 0;
 }
 
+/*
+ * The transcript lanes hash the handshake buffer as it is written with the
+ * digests that are used by all TLSv1.3 and most TLSv1.2 cipher suites. When
+ * the handshake digest is determined the lane for it, if any, becomes the
+ * handshake digest and the buffer does not have to be hashed again. The
+ * buffer itself is still kept for the messages that need the raw transcript,
+ * e.g. a TLSv1.2 CertificateVerify or the PSK binders.
+ *
+ * A lane is only ever used if it has hashed everything in the buffer, so code
+ * that changes the buffer other than through ssl3_finish_mac() must call
+ * ssl3_free_transcript_lanes().
+ */
+static const int transcript_lane_md[SSL_TRANSCRIPT_LANES] = {
+    SSL_MD_SHA256_IDX,
+    SSL_MD_SHA384_IDX
+};
+
+void ssl3_free_transcript_lanes(SSL_CONNECTION *s)
+{
+    size_t i;
+
+    for (i = 0; i < SSL_TRANSCRIPT_LANES; i++) {
+        EVP_MD_CTX_free(s->s3.handshake_lanes[i]);
+        s->s3.handshake_lanes[i] = NULL;
+    }
+}
+
+/*
+ * Lanes are only an optimisation, failing to set one up is not an error: the
+ * handshake digest then hashes the buffer as it would without lanes.
+ */
+static void transcript_lanes_init(SSL_CONNECTION *s)
+{
+    SSL_CTX *sctx = SSL_CONNECTION_GET_CTX(s);
+    const EVP_MD *md;
+    EVP_MD_CTX *lane;
+    size_t i;
+
+    ERR_set_mark();
+    for (i = 0; i < SSL_TRANSCRIPT_LANES; i++) {
+        if ((md = ssl_md(sctx, transcript_lane_md[i])) == NULL
+            || (lane = EVP_MD_CTX_new()) == NULL)
+            continue;
+        if (!EVP_DigestInit_ex(lane, md, NULL)) {
+            EVP_MD_CTX_free(lane);
+            continue;
+        }
+        s->s3.handshake_lanes[i] = lane;
+    }
+    ERR_pop_to_mark();
+}
+
+static void transcript_lanes_update(SSL_CONNECTION *s,
+    const unsigned char *buf, size_t len)
+{
+    const EVP_MD *md = NULL;
+    size_t i;
+
+    /*
+     * Once the cipher suite is known only the lane for its handshake digest
+     * is still of use
+     */
+    if (s->s3.tmp.new_cipher != NULL)
+        md = ssl_handshake_md(s);
+
+    for (i = 0; i < SSL_TRANSCRIPT_LANES; i++) {
+        EVP_MD_CTX *lane = s->s3.handshake_lanes[i];
+
+        if (lane == NULL)
+            continue;
+        if ((s->s3.tmp.new_cipher != NULL && EVP_MD_CTX_get0_md(lane) != md)
+            || !EVP_DigestUpdate(lane, buf, len)) {
+            EVP_MD_CTX_free(lane);
+            s->s3.handshake_lanes[i] = NULL;
+        }
+    }
+}
+
+/* Take the lane for |md| if it is still there */
+static EVP_MD_CTX *transcript_lanes_take(SSL_CONNECTION *s, const EVP_MD *md)
+{
+    EVP_MD_CTX *ret = NULL;
+    size_t i;
+
+    for (i = 0; i < SSL_TRANSCRIPT_LANES; i++) {
+        EVP_MD_CTX *lane = s->s3.handshake_lanes[i];
+
+        if (lane != NULL && EVP_MD_CTX_get0_md(lane) == md) {
+            ret = lane;
+            s->s3.handshake_lanes[i] = NULL;
+            break;
+        }
+    }
+    ssl3_free_transcript_lanes(s);
+    return ret;
+}
+
 int ssl3_init_finished_mac(SSL_CONNECTION *s)
 {
     BIO *buf = BIO_new(BIO_s_mem());
@@ -33,12 +130,13 @@ int ssl3_init_finished_mac(SSL_CONNECTION *s)
     ssl3_free_digest_list(s);
     s->s3.handshake_buffer = buf;
     (void)BIO_set_close(s->s3.handshake_buffer, BIO_CLOSE);
+    transcript_lanes_init(s);
     return 1;
 }
 
 /*
- * Free digest list. Also frees handshake buffer since they are always freed
- * together.
+ * Free digest list. Also frees handshake buffer and transcript lanes since
+ * they are always freed together.
  */
 
 void ssl3_free_digest_list(SSL_CONNECTION *s)
@@ -47,6 +145,7 @@ void ssl3_free_digest_list(SSL_CONNECTION *s)
     s->s3.handshake_buffer = NULL;
     EVP_MD_CTX_free(s->s3.handshake_dgst);
     s->s3.handshake_dgst = NULL;
+    ssl3_free_transcript_lanes(s);
 }
 
 int ssl3_finish_mac(SSL_CONNECTION *s, const unsigned char *buf, size_t len)
@@ -64,6 +163,7 @@ int ssl3_finish_mac(SSL_CONNECTION *s, const unsigned char *buf, size_t len)
             SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
             return 0;
         }
+        transcript_lanes_update(s, buf, len);
     } else {
         ret = EVP_DigestUpdate(s->s3.handshake_dgst, buf, len);
         if (!ret) {
@@ -87,24 +187,31 @@ int ssl3_digest_cached_records(SSL_CONNECTION *s, int keep)
             return 0;
         }
 
-        s->s3.handshake_dgst = EVP_MD_CTX_new();
-        if (s->s3.handshake_dgst == NULL) {
-            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_EVP_LIB);
-            return 0;
-        }
-
         md = ssl_handshake_md(s);
         if (md == NULL) {
             SSLfatal(s, SSL_AD_INTERNAL_ERROR,
                 SSL_R_NO_SUITABLE_DIGEST_ALGORITHM);
             return 0;
         }
+
+        /* The lane for |md| has already hashed the buffer */
+        s->s3.handshake_dgst = transcript_lanes_take(s, md);
+        if (s->s3.handshake_dgst != NULL)
+            goto done;
+
+        s->s3.handshake_dgst = EVP_MD_CTX_new();
+        if (s->s3.handshake_dgst == NULL) {
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_EVP_LIB);
+            return 0;
+        }
+
         if (!EVP_DigestInit_ex(s->s3.handshake_dgst, md, NULL)
             || !EVP_DigestUpdate(s->s3.handshake_dgst, hdata, hdatalen)) {
             SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
             return 0;
         }
     }
+done:
     if (keep == 0) {
         BIO_free(s->s3.handshake_buffer);
         s->s3.handshake_buffer = NULL;
@@ -4463,32 +4463,21 @@ long ssl3_ctx_ctrl(SSL_CTX *ctx, int cmd, long larg, void *parg)
     case SSL_CTRL_SET_TLSEXT_TICKET_KEYS:
     case SSL_CTRL_GET_TLSEXT_TICKET_KEYS: {
         unsigned char *keys = parg;
-        long tick_keylen = (sizeof(ctx->ext.tick_key_name) + sizeof(ctx->ext.secure->tick_hmac_key) + sizeof(ctx->ext.secure->tick_aes_key));
+        unsigned char ring[SSL_TICKET_KEY_LENGTH * SSL_TICKET_KEYS_MAX];
+
         if (keys == NULL)
-            return tick_keylen;
-        if (larg != tick_keylen) {
+            return SSL_TICKET_KEY_LENGTH;
+        if (larg != SSL_TICKET_KEY_LENGTH) {
             ERR_raise(ERR_LIB_SSL, SSL_R_INVALID_TICKET_KEYS_LENGTH);
             return 0;
         }
-        if (cmd == SSL_CTRL_SET_TLSEXT_TICKET_KEYS) {
-            memcpy(ctx->ext.tick_key_name, keys,
-                sizeof(ctx->ext.tick_key_name));
-            memcpy(ctx->ext.secure->tick_hmac_key,
-                keys + sizeof(ctx->ext.tick_key_name),
-                sizeof(ctx->ext.secure->tick_hmac_key));
-            memcpy(ctx->ext.secure->tick_aes_key,
-                keys + sizeof(ctx->ext.tick_key_name) + sizeof(ctx->ext.secure->tick_hmac_key),
-                sizeof(ctx->ext.secure->tick_aes_key));
-        } else {
-            memcpy(keys, ctx->ext.tick_key_name,
-                sizeof(ctx->ext.tick_key_name));
-            memcpy(keys + sizeof(ctx->ext.tick_key_name),
-                ctx->ext.secure->tick_hmac_key,
-                sizeof(ctx->ext.secure->tick_hmac_key));
-            memcpy(keys + sizeof(ctx->ext.tick_key_name) + sizeof(ctx->ext.secure->tick_hmac_key),
-                ctx->ext.secure->tick_aes_key,
-                sizeof(ctx->ext.secure->tick_aes_key));
-        }
+        /* These only deal with the current key of the ticket key ring */
+        if (cmd == SSL_CTRL_SET_TLSEXT_TICKET_KEYS)
+            return ssl_ctx_set_ticket_key_current(ctx, keys);
+        if (SSL_CTX_get_ticket_keys(ctx, ring, sizeof(ring)) == 0)
+            return 0;
+        memcpy(keys, ring, SSL_TICKET_KEY_LENGTH);
+        OPENSSL_cleanse(ring, sizeof(ring));
         return 1;
     }
 
@@ -5398,6 +5387,9 @@ EVP_PKEY *ssl_generate_pkey_group(SSL_CONNECTION *s, uint16_t id)
         goto err;
     }
 
+    if ((pkey = ssl_keyshare_pool_get(s, id)) != NULL)
+        return pkey;
+
     pctx = EVP_PKEY_CTX_new_from_name(sctx->libctx, ginf->algorithm,
         sctx->propq);
 
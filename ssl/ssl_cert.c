@@ -165,6 +165,11 @@ CERT *ssl_cert_dup(CERT *cert)
             }
         }
 #endif
+        if (cpk->cert_enc != NULL) {
+            if (!ssl_cert_enc_up_ref(cpk->cert_enc))
+                goto err;
+            rpk->cert_enc = cpk->cert_enc;
+        }
     }
 
     /* Configured sigalgs copied across */
@@ -264,6 +269,8 @@ void ssl_cert_clear_certs(CERT *c)
             cpk->cert_comp_used = 0;
         }
 #endif
+        ssl_cert_enc_free(cpk->cert_enc);
+        cpk->cert_enc = NULL;
     }
 }
 
@@ -296,6 +303,111 @@ void ssl_cert_free(CERT *c)
     OPENSSL_free(c);
 }
 
+void ssl_cert_enc_free(SSL_CERT_ENC *enc)
+{
+    int i;
+
+    if (enc == NULL)
+        return;
+
+    CRYPTO_DOWN_REF(&enc->references, &i);
+    REF_PRINT_COUNT("SSL_CERT_ENC", i, enc);
+    if (i > 0)
+        return;
+    REF_ASSERT_ISNT(i < 0);
+
+    OSSL_STACK_OF_X509_free(enc->certs);
+    OPENSSL_free(enc->data);
+    CRYPTO_FREE_REF(&enc->references);
+    OPENSSL_free(enc);
+}
+
+int ssl_cert_enc_up_ref(SSL_CERT_ENC *enc)
+{
+    int i;
+
+    if (!CRYPTO_UP_REF(&enc->references, &i))
+        return 0;
+
+    REF_PRINT_COUNT("SSL_CERT_ENC", i, enc);
+    REF_ASSERT_ISNT(i < 2);
+    return ((i > 1) ? 1 : 0);
+}
+
+/*
+ * Check that |enc| is the encoding of |x| followed by |chain|. The
+ * certificates are compared by identity: |enc| holds references to the ones
+ * it encoded so their addresses can't be reused.
+ */
+int ssl_cert_enc_matches(const SSL_CERT_ENC *enc, X509 *x,
+    STACK_OF(X509) *chain)
+{
+    int i, num = chain != NULL ? sk_X509_num(chain) : 0;
+
+    if (enc == NULL || x == NULL
+        || sk_X509_num(enc->certs) != num + 1
+        || sk_X509_value(enc->certs, 0) != x)
+        return 0;
+    for (i = 0; i < num; i++)
+        if (sk_X509_value(enc->certs, i + 1) != sk_X509_value(chain, i))
+            return 0;
+    return 1;
+}
+
+/*
+ * (Re)compute the cached encoding of the certificate and chain of |cpk|.
+ * This is an optimisation only: on failure the cache is left empty and the
+ * chain is encoded on every handshake instead.
+ */
+void ssl_cert_pkey_encode(CERT_PKEY *cpk)
+{
+    SSL_CERT_ENC *enc = NULL;
+    unsigned char *p;
+    size_t len = 0;
+    int i, l;
+
+    ssl_cert_enc_free(cpk->cert_enc);
+    cpk->cert_enc = NULL;
+    if (cpk->x509 == NULL)
+        return;
+
+    ERR_set_mark();
+    if ((enc = OPENSSL_zalloc(sizeof(*enc))) == NULL
+        || !CRYPTO_NEW_REF(&enc->references, 1)) {
+        OPENSSL_free(enc);
+        enc = NULL;
+        goto err;
+    }
+    if ((enc->certs = sk_X509_new_null()) == NULL
+        || !X509_add_cert(enc->certs, cpk->x509, X509_ADD_FLAG_UP_REF)
+        || !X509_add_certs(enc->certs, cpk->chain, X509_ADD_FLAG_UP_REF))
+        goto err;
+
+    for (i = 0; i < sk_X509_num(enc->certs); i++) {
+        if ((l = i2d_X509(sk_X509_value(enc->certs, i), NULL)) <= 0
+            || (size_t)l > 0xffffff)
+            goto err;
+        len += 3 + (size_t)l;
+    }
+    if ((enc->data = p = OPENSSL_malloc(len)) == NULL)
+        goto err;
+    for (i = 0; i < sk_X509_num(enc->certs); i++) {
+        unsigned char *der = p + 3;
+
+        l = i2d_X509(sk_X509_value(enc->certs, i), &der);
+        l2n3(l, p);
+        p = der;
+    }
+    enc->len = len;
+    cpk->cert_enc = enc;
+    ERR_pop_to_mark();
+    return;
+
+err:
+    ERR_pop_to_mark();
+    ssl_cert_enc_free(enc);
+}
+
 int ssl_cert_set0_chain(SSL_CONNECTION *s, SSL_CTX *ctx, STACK_OF(X509) *chain)
 {
     int i, r;
@@ -314,6 +426,7 @@ int ssl_cert_set0_chain(SSL_CONNECTION *s, SSL_CTX *ctx, STACK_OF(X509) *chain)
     }
     OSSL_STACK_OF_X509_free(cpk->chain);
     cpk->chain = chain;
+    ssl_cert_pkey_encode(cpk);
     return 1;
 }
 
@@ -349,6 +462,7 @@ int ssl_cert_add0_chain_cert(SSL_CONNECTION *s, SSL_CTX *ctx, X509 *x)
         cpk->chain = sk_X509_new_null();
     if (!cpk->chain || !sk_X509_push(cpk->chain, x))
         return 0;
+    ssl_cert_pkey_encode(cpk);
     return 1;
 }
 
@@ -1185,6 +1299,7 @@ int ssl_build_cert_chain(SSL_CONNECTION *s, SSL_CTX *ctx, int flags)
     }
     OSSL_STACK_OF_X509_free(cpk->chain);
     cpk->chain = chain;
+    ssl_cert_pkey_encode(cpk);
     if (rv == 0)
         rv = 1;
 err:
@@ -721,6 +721,59 @@ out:
     return rv;
 }
 
+/*
+ * Dynamic record sizing: "off", "on" for the defaults, or up to three comma
+ * separated values for the small record length, the ramp up threshold and the
+ * idle timeout in milliseconds.
+ */
+static int cmd_RecordSizing(SSL_CONF_CTX *cctx, const char *value)
+{
+    int rv = 0, i;
+    unsigned long vals[3] = {
+        SSL_RECORD_SIZING_DEFAULT_LEN,
+        SSL_RECORD_SIZING_DEFAULT_THRESHOLD,
+        SSL_RECORD_SIZING_DEFAULT_IDLE_MS
+    };
+    char *copy = NULL, *p, *commap, *endptr = NULL;
+
+    if (OPENSSL_strcasecmp(value, "off") == 0) {
+        vals[0] = 0;
+    } else if (OPENSSL_strcasecmp(value, "on") != 0) {
+        copy = OPENSSL_strdup(value);
+        if (copy == NULL)
+            goto out;
+        for (i = 0, p = copy; p != NULL; i++) {
+            if (i == 3)
+                goto out;
+            commap = strchr(p, ',');
+            if (commap != NULL)
+                *commap++ = '\0';
+            if (!OPENSSL_strtoul(p, &endptr, 0, &vals[i]) || *endptr != '\0')
+                goto out;
+            p = commap;
+        }
+    }
+
+    /* Like RecordPadding this does not apply to QUIC, so silently ignore it */
+    if (cctx->ctx) {
+        if (SSL_CTX_is_quic(cctx->ctx))
+            rv = 1;
+        else
+            rv = SSL_CTX_set_record_sizing(cctx->ctx, (size_t)vals[0],
+                (size_t)vals[1], (uint64_t)vals[2]);
+    }
+    if (cctx->ssl) {
+        if (SSL_is_quic(cctx->ssl))
+            rv = 1;
+        else
+            rv = SSL_set_record_sizing(cctx->ssl, (size_t)vals[0],
+                (size_t)vals[1], (uint64_t)vals[2]);
+    }
+out:
+    OPENSSL_free(copy);
+    return rv;
+}
+
 static int cmd_NumTickets(SSL_CONF_CTX *cctx, const char *value)
 {
     int rv = 0;
@@ -840,6 +893,7 @@ static const ssl_conf_cmd_tbl ssl_conf_cmds[] = {
         SSL_CONF_FLAG_SERVER | SSL_CONF_FLAG_CERTIFICATE,
         SSL_CONF_TYPE_FILE),
     SSL_CONF_CMD_STRING(RecordPadding, "record_padding", 0),
+    SSL_CONF_CMD_STRING(RecordSizing, "record_sizing", 0),
     SSL_CONF_CMD_STRING(NumTickets, "num_tickets", SSL_CONF_FLAG_SERVER),
 };
 
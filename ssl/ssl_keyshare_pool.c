@@ -0,0 +1,324 @@
+/*
+ * Copyright 2026 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <openssl/err.h>
+#include "ssl_local.h"
+#include "internal/e_os.h"
+#include "internal/ssl_unwrap.h"
+#include "internal/thread_arch.h"
+
+/*
+ * Key share pool
+ * ==============
+ *
+ * An SSL_CTX can keep a pool of ephemeral keys for the groups that are used
+ * in its handshakes, so that generating the key share is not part of the
+ * handshake latency. A worker thread owned by the pool keeps up to |depth|
+ * keys ready for each group, and ssl_keyshare_pool_get() hands them out.
+ *
+ * Groups are added to the pool the first time a key is asked for them, that
+ * handshake and any handshake that finds the pool empty generates its key
+ * inline as before.
+ *
+ * A key is handed out |max_uses| times before it is dropped from the pool.
+ * The handshake code holds its own reference to the key, the keys are never
+ * modified once generated so sharing them between connections is safe.
+ */
+
+#if defined(OPENSSL_THREADS) && !defined(OPENSSL_NO_THREAD_POOL)
+
+#define KEYSHARE_POOL_MAX_GROUPS 8
+#define KEYSHARE_POOL_MAX_DEPTH 1024
+
+typedef struct {
+    uint16_t group_id;
+    /* Set when generating a key failed, the group is no longer refilled */
+    int failed;
+    /* Owned by the group list of the SSL_CTX */
+    const char *algorithm;
+    const char *realname;
+    EVP_PKEY **keys;
+    size_t num_keys;
+    /* Number of times keys[num_keys - 1] was handed out so far */
+    unsigned int uses;
+} KEYSHARE_POOL_GROUP;
+
+struct ssl_keyshare_pool_st {
+    SSL_CTX *ctx;
+    size_t depth;
+    unsigned int max_uses;
+    /* The worker does not exist in a child process after fork() */
+    int pid;
+
+    CRYPTO_MUTEX *lock;
+    CRYPTO_CONDVAR *cv;
+    CRYPTO_THREAD *worker;
+    int teardown;
+
+    size_t num_groups;
+    KEYSHARE_POOL_GROUP groups[KEYSHARE_POOL_MAX_GROUPS];
+};
+
+static EVP_PKEY *keyshare_pool_generate(SSL_CTX *ctx,
+    const KEYSHARE_POOL_GROUP *g)
+{
+    EVP_PKEY_CTX *pctx;
+    EVP_PKEY *pkey = NULL;
+
+    pctx = EVP_PKEY_CTX_new_from_name(ctx->libctx, g->algorithm, ctx->propq);
+    if (pctx == NULL
+        || EVP_PKEY_keygen_init(pctx) <= 0
+        || EVP_PKEY_CTX_set_group_name(pctx, g->realname) <= 0
+        || EVP_PKEY_keygen(pctx, &pkey) <= 0) {
+        EVP_PKEY_free(pkey);
+        pkey = NULL;
+    }
+    EVP_PKEY_CTX_free(pctx);
+    return pkey;
+}
+
+/* Must be called with the lock held */
+static KEYSHARE_POOL_GROUP *keyshare_pool_next_group(SSL_KEYSHARE_POOL *pool)
+{
+    KEYSHARE_POOL_GROUP *best = NULL;
+    size_t i;
+
+    /* Refill the emptiest group first */
+    for (i = 0; i < pool->num_groups; i++) {
+        KEYSHARE_POOL_GROUP *g = &pool->groups[i];
+
+        if (g->failed || g->num_keys >= pool->depth)
+            continue;
+        if (best == NULL || g->num_keys < best->num_keys)
+            best = g;
+    }
+    return best;
+}
+
+static unsigned int keyshare_pool_worker(void *arg)
+{
+    SSL_KEYSHARE_POOL *pool = arg;
+    KEYSHARE_POOL_GROUP *g;
+    EVP_PKEY *pkey;
+
+    ossl_crypto_mutex_lock(pool->lock);
+    for (;;) {
+        if (pool->teardown)
+            break;
+
+        if ((g = keyshare_pool_next_group(pool)) == NULL) {
+            ossl_crypto_condvar_wait(pool->cv, pool->lock);
+            continue;
+        }
+
+        /*
+         * Only this thread adds keys and registered groups do not change, so
+         * the group still has room when the key is ready.
+         */
+        ossl_crypto_mutex_unlock(pool->lock);
+        pkey = keyshare_pool_generate(pool->ctx, g);
+        ossl_crypto_mutex_lock(pool->lock);
+
+        if (pkey == NULL) {
+            g->failed = 1;
+            ERR_clear_error();
+            continue;
+        }
+        g->keys[g->num_keys++] = pkey;
+    }
+    ossl_crypto_mutex_unlock(pool->lock);
+
+    OPENSSL_thread_stop();
+    return 1;
+}
+
+void ssl_keyshare_pool_free(SSL_KEYSHARE_POOL *pool)
+{
+    CRYPTO_THREAD_RETVAL rv;
+    size_t i, j;
+
+    if (pool == NULL)
+        return;
+
+    if (pool->worker != NULL && pool->pid == (int)getpid()) {
+        ossl_crypto_mutex_lock(pool->lock);
+        pool->teardown = 1;
+        ossl_crypto_condvar_signal(pool->cv);
+        ossl_crypto_mutex_unlock(pool->lock);
+        ossl_crypto_thread_native_join(pool->worker, &rv);
+        ossl_crypto_thread_native_clean(pool->worker);
+    }
+
+    for (i = 0; i < pool->num_groups; i++) {
+        KEYSHARE_POOL_GROUP *g = &pool->groups[i];
+
+        for (j = 0; j < g->num_keys; j++)
+            EVP_PKEY_free(g->keys[j]);
+        OPENSSL_free(g->keys);
+    }
+    ossl_crypto_condvar_free(&pool->cv);
+    ossl_crypto_mutex_free(&pool->lock);
+    OPENSSL_free(pool);
+}
+
+static SSL_KEYSHARE_POOL *keyshare_pool_new(SSL_CTX *ctx, size_t depth,
+    unsigned int max_uses)
+{
+    SSL_KEYSHARE_POOL *pool;
+
+    if ((pool = OPENSSL_zalloc(sizeof(*pool))) == NULL)
+        return NULL;
+
+    pool->ctx = ctx;
+    pool->depth = depth;
+    pool->max_uses = max_uses;
+    pool->pid = (int)getpid();
+
+    if ((pool->lock = ossl_crypto_mutex_new()) == NULL
+        || (pool->cv = ossl_crypto_condvar_new()) == NULL) {
+        ssl_keyshare_pool_free(pool);
+        return NULL;
+    }
+
+    pool->worker = ossl_crypto_thread_native_start(keyshare_pool_worker, pool,
+        /*joinable=*/1);
+    if (pool->worker == NULL) {
+        ssl_keyshare_pool_free(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+/* Must be called with the lock held */
+static KEYSHARE_POOL_GROUP *keyshare_pool_find_group(SSL_KEYSHARE_POOL *pool,
+    uint16_t group_id)
+{
+    const TLS_GROUP_INFO *ginf;
+    KEYSHARE_POOL_GROUP *g;
+    size_t i;
+
+    for (i = 0; i < pool->num_groups; i++)
+        if (pool->groups[i].group_id == group_id)
+            return &pool->groups[i];
+
+    if (pool->num_groups == KEYSHARE_POOL_MAX_GROUPS
+        || (ginf = tls1_group_id_lookup(pool->ctx, group_id)) == NULL)
+        return NULL;
+
+    g = &pool->groups[pool->num_groups];
+    if ((g->keys = OPENSSL_malloc_array(pool->depth, sizeof(*g->keys))) == NULL)
+        return NULL;
+    g->group_id = group_id;
+    g->algorithm = ginf->algorithm;
+    g->realname = ginf->realname;
+    pool->num_groups++;
+    return g;
+}
+
+/*
+ * Take a key for |group_id| from the pool of the SSL_CTX of |s|. Returns
+ * NULL without raising an error when there is no pool or it has no key ready,
+ * the caller then generates the key itself.
+ */
+EVP_PKEY *ssl_keyshare_pool_get(SSL_CONNECTION *s, uint16_t group_id)
+{
+    SSL_KEYSHARE_POOL *pool = SSL_CONNECTION_GET_CTX(s)->keyshare_pool;
+    KEYSHARE_POOL_GROUP *g;
+    EVP_PKEY *pkey = NULL;
+
+    /* Keys generated before a fork() must not be used by both processes */
+    if (pool == NULL || pool->pid != (int)getpid())
+        return NULL;
+
+    ossl_crypto_mutex_lock(pool->lock);
+    if ((g = keyshare_pool_find_group(pool, group_id)) == NULL)
+        goto end;
+
+    if (g->num_keys > 0) {
+        pkey = g->keys[g->num_keys - 1];
+        if (++g->uses < pool->max_uses) {
+            /* The key stays in the pool for the next handshake */
+            if (!EVP_PKEY_up_ref(pkey))
+                pkey = NULL;
+            goto end;
+        }
+        g->keys[--g->num_keys] = NULL;
+        g->uses = 0;
+    }
+    ossl_crypto_condvar_signal(pool->cv);
+
+end:
+    ossl_crypto_mutex_unlock(pool->lock);
+    return pkey;
+}
+
+int SSL_CTX_set_key_share_pool(SSL_CTX *ctx, size_t depth,
+    unsigned int max_uses)
+{
+    SSL_KEYSHARE_POOL *pool = NULL;
+
+    if (depth > KEYSHARE_POOL_MAX_DEPTH || (depth > 0 && max_uses == 0)) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_PASSED_INVALID_ARGUMENT);
+        return 0;
+    }
+
+    if (depth > 0 && (pool = keyshare_pool_new(ctx, depth, max_uses)) == NULL) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_INIT_FAIL);
+        return 0;
+    }
+
+    ssl_keyshare_pool_free(ctx->keyshare_pool);
+    ctx->keyshare_pool = pool;
+    return 1;
+}
+
+size_t SSL_CTX_get_key_share_pool_count(SSL_CTX *ctx)
+{
+    SSL_KEYSHARE_POOL *pool = ctx->keyshare_pool;
+    size_t i, count = 0;
+
+    if (pool == NULL)
+        return 0;
+
+    ossl_crypto_mutex_lock(pool->lock);
+    for (i = 0; i < pool->num_groups; i++)
+        count += pool->groups[i].num_keys;
+    ossl_crypto_mutex_unlock(pool->lock);
+    return count;
+}
+
+#else
+
+void ssl_keyshare_pool_free(SSL_KEYSHARE_POOL *pool)
+{
+}
+
+EVP_PKEY *ssl_keyshare_pool_get(SSL_CONNECTION *s, uint16_t group_id)
+{
+    return NULL;
+}
+
+int SSL_CTX_set_key_share_pool(SSL_CTX *ctx, size_t depth,
+    unsigned int max_uses)
+{
+    if (depth == 0)
+        return 1;
+
+    /* There is no thread to fill the pool */
+    ERR_raise(ERR_LIB_SSL, ERR_R_UNSUPPORTED);
+    return 0;
+}
+
+size_t SSL_CTX_get_key_share_pool_count(SSL_CTX *ctx)
+{
+    return 0;
+}
+
+#endif
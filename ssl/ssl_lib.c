@@ -554,6 +554,17 @@ static int ssl_check_allowed_versions(int min_version, int max_version)
 void OPENSSL_VPROC_FUNC(void) { }
 #endif
 
+/* Discard any data that SSL_MODE_COALESCE_WRITES is holding back */
+static void ssl_coalesce_clear(SSL_CONNECTION *sc)
+{
+    OPENSSL_free(sc->coalesce.buf);
+    sc->coalesce.buf = NULL;
+    sc->coalesce.size = 0;
+    sc->coalesce.off = 0;
+    sc->coalesce.len = 0;
+    sc->coalesce.retry = 0;
+}
+
 int SSL_clear(SSL *s)
 {
     if (s->method == NULL) {
@@ -602,6 +613,13 @@ int ossl_ssl_connection_reset(SSL *s)
     sc->version = s->method->version;
     sc->client_version = sc->version;
     sc->rwstate = SSL_NOTHING;
+    ssl_splice_clear(sc);
+    ssl_sign_batch_remove(sc);
+    sc->pkey_sign_state = SSL_PKEY_SIGN_NONE;
+    OPENSSL_clear_free(sc->pkey_sig, sc->pkey_siglen);
+    sc->pkey_sig = NULL;
+    sc->pkey_siglen = 0;
+    ssl_coalesce_clear(sc);
 
     BUF_MEM_free(sc->init_buf);
     sc->init_buf = NULL;
@@ -744,6 +762,7 @@ SSL *ossl_ssl_connection_new_int(SSL_CTX *ctx, SSL *user_ssl,
     }
 
     RECORD_LAYER_init(&s->rlayer, s);
+    s->splice.pipefd[0] = s->splice.pipefd[1] = -1;
 
     s->options = ctx->options;
 
@@ -788,6 +807,9 @@ SSL *ossl_ssl_connection_new_int(SSL_CTX *ctx, SSL *user_ssl,
     s->rlayer.record_padding_arg = ctx->record_padding_arg;
     s->rlayer.block_padding = ctx->block_padding;
     s->rlayer.hs_padding = ctx->hs_padding;
+    s->rlayer.sizing_len = ctx->record_sizing_len;
+    s->rlayer.sizing_threshold = ctx->record_sizing_threshold;
+    s->rlayer.sizing_idle_ms = ctx->record_sizing_idle_ms;
     s->sid_ctx_length = ctx->sid_ctx_length;
     if (!ossl_assert(s->sid_ctx_length <= sizeof(s->sid_ctx)))
         goto err;
@@ -1087,6 +1109,7 @@ int SSL_has_matching_session_id(const SSL *ssl, const unsigned char *id,
      * by this SSL.
      */
     SSL_SESSION r, *p;
+    SSL_SESSION_CACHE_SHARD *shard;
     const SSL_CONNECTION *sc = SSL_CONNECTION_FROM_CONST_SSL(ssl);
 
     if (sc == NULL || id_len > sizeof(r.session_id))
@@ -1096,10 +1119,11 @@ int SSL_has_matching_session_id(const SSL *ssl, const unsigned char *id,
     r.session_id_length = id_len;
     memcpy(r.session_id, id, id_len);
 
-    if (!CRYPTO_THREAD_read_lock(sc->session_ctx->lock))
+    shard = ssl_session_cache_shard(sc->session_ctx, &r);
+    if (!CRYPTO_THREAD_read_lock(shard->lock))
         return 0;
-    p = lh_SSL_SESSION_retrieve(sc->session_ctx->sessions, &r);
-    CRYPTO_THREAD_unlock(sc->session_ctx->lock);
+    p = lh_SSL_SESSION_retrieve(shard->sessions, &r);
+    CRYPTO_THREAD_unlock(shard->lock);
     return (p != NULL);
 }
 
@@ -1549,6 +1573,8 @@ void ossl_ssl_connection_free(SSL *ssl)
     if (s->clienthello != NULL)
         OPENSSL_free(s->clienthello->pre_proc_exts);
     OPENSSL_free(s->clienthello);
+    ssl_sign_batch_remove(s);
+    OPENSSL_free(s->pkey_sig);
     OPENSSL_free(s->pha_context);
     EVP_MD_CTX_free(s->pha_dgst);
 
@@ -1587,6 +1613,8 @@ void ossl_ssl_connection_free(SSL *ssl)
 #ifndef OPENSSL_NO_ECH
     ossl_ech_conn_clear(&s->ext.ech);
 #endif
+    ssl_splice_clear(s);
+    ssl_coalesce_clear(s);
 }
 
 void SSL_set0_rbio(SSL *s, BIO *rbio)
@@ -2238,7 +2266,7 @@ int SSL_get_async_status(SSL *s, int *status)
  * It returns 0 if the state machine is in the MSG_FLOW_ERROR state,
  * in this case the calling function can and should return immediately.
  */
-static int ssl_reset_error_state(SSL_CONNECTION *sc)
+int ssl_reset_error_state(SSL_CONNECTION *sc)
 {
     if (sc == NULL)
         return 1;
@@ -2404,6 +2432,100 @@ static int ssl_io_intern(void *vargs)
     return -1;
 }
 
+/* Pass |buf| to the method's write function, in an async job if need be */
+static int ssl_write_dispatch(SSL *s, SSL_CONNECTION *sc, const void *buf,
+    size_t num, size_t *written)
+{
+    int ret;
+
+    if ((sc->mode & SSL_MODE_ASYNC) && ASYNC_get_current_job() == NULL) {
+        struct ssl_async_args args;
+
+        args.s = s;
+        args.buf = (void *)buf;
+        args.num = num;
+        args.type = WRITEFUNC;
+        args.f.func_write = s->method->ssl_write;
+
+        ret = ssl_start_async_job(s, &args, ssl_io_intern);
+        *written = sc->asyncrw;
+    } else {
+        ret = s->method->ssl_write(s, buf, num, written);
+    }
+    ssl_update_error_state(sc);
+    return ret;
+}
+
+/*
+ * Write out the application data held back by SSL_MODE_COALESCE_WRITES.
+ * Returns 1 once all of it has been written, or the return value of the failed
+ * write otherwise. The data stays where it is in the meantime, so retrying the
+ * write passes the record layer the same buffer again.
+ */
+static int ssl_flush_coalesced(SSL *s, SSL_CONNECTION *sc)
+{
+    size_t written;
+    int ret;
+
+    while (sc->coalesce.len > 0) {
+        ret = ssl_write_dispatch(s, sc, sc->coalesce.buf + sc->coalesce.off,
+            sc->coalesce.len, &written);
+        if (ret <= 0) {
+            sc->coalesce.retry = 1;
+            return ret;
+        }
+        sc->coalesce.off += written;
+        sc->coalesce.len -= written;
+    }
+    sc->coalesce.off = 0;
+    sc->coalesce.retry = 0;
+
+    return 1;
+}
+
+/*
+ * Hold back a small write with SSL_MODE_COALESCE_WRITES so that it can share
+ * a record with the writes that follow it. Anything that is held back already
+ * is written first if the new data doesn't fit after it, if the mode has been
+ * turned off since, or if an earlier attempt to write it has to be retried.
+ * The held back data is never moved while it is there, as a write that is
+ * being retried refers to it.
+ */
+static int ssl_write_coalesced(SSL *s, SSL_CONNECTION *sc, const void *buf,
+    size_t num, size_t *written)
+{
+    size_t max = 0;
+    int ret;
+
+    if ((sc->mode & SSL_MODE_COALESCE_WRITES) != 0)
+        max = ssl_get_max_send_fragment(sc);
+
+    if (sc->coalesce.len > 0
+        && (sc->coalesce.retry
+            || sc->coalesce.len + num > max
+            || sc->coalesce.off + sc->coalesce.len + num > sc->coalesce.size)
+        && (ret = ssl_flush_coalesced(s, sc)) <= 0)
+        return ret;
+
+    if (num == 0 || num >= max)
+        return ssl_write_dispatch(s, sc, buf, num, written);
+
+    /* Only (re)allocate the buffer when nothing is held back */
+    if (sc->coalesce.len == 0 && sc->coalesce.size < max) {
+        unsigned char *tmp = OPENSSL_realloc(sc->coalesce.buf, max);
+
+        if (tmp == NULL)
+            return -1;
+        sc->coalesce.buf = tmp;
+        sc->coalesce.size = max;
+    }
+    memcpy(sc->coalesce.buf + sc->coalesce.off + sc->coalesce.len, buf, num);
+    sc->coalesce.len += num;
+    *written = num;
+
+    return 1;
+}
+
 int ssl_read_internal(SSL *s, void *buf, size_t num, size_t *readbytes)
 {
     int ret;
@@ -2444,6 +2566,10 @@ int ssl_read_internal(SSL *s, void *buf, size_t num, size_t *readbytes)
     if (!ossl_statem_check_finish_init(sc, 0))
         return -1;
 
+    /* The peer may be waiting for data that we are holding back */
+    if (sc->coalesce.len > 0 && (ret = ssl_flush_coalesced(s, sc)) <= 0)
+        return ret;
+
     if ((sc->mode & SSL_MODE_ASYNC) && ASYNC_get_current_job() == NULL) {
         struct ssl_async_args args;
 
@@ -2602,6 +2728,10 @@ static int ssl_peek_internal(SSL *s, void *buf, size_t num, size_t *readbytes)
     if (sc->shutdown & SSL_RECEIVED_SHUTDOWN) {
         return 0;
     }
+
+    if (sc->coalesce.len > 0 && (ret = ssl_flush_coalesced(s, sc)) <= 0)
+        return ret;
+
     if ((sc->mode & SSL_MODE_ASYNC) && ASYNC_get_current_job() == NULL) {
         struct ssl_async_args args;
 
@@ -2661,7 +2791,6 @@ int SSL_peek_ex(SSL *s, void *buf, size_t num, size_t *readbytes)
 int ssl_write_internal(SSL *s, const void *buf, size_t num,
     uint64_t flags, size_t *written)
 {
-    int ret;
     SSL_CONNECTION *sc = SSL_CONNECTION_FROM_SSL(s);
 
 #ifndef OPENSSL_NO_QUIC
@@ -2705,24 +2834,13 @@ int ssl_write_internal(SSL *s, const void *buf, size_t num,
     if (!ossl_statem_check_finish_init(sc, 1))
         return -1;
 
-    if ((sc->mode & SSL_MODE_ASYNC) && ASYNC_get_current_job() == NULL) {
-        struct ssl_async_args args;
-
-        args.s = s;
-        args.buf = (void *)buf;
-        args.num = num;
-        args.type = WRITEFUNC;
-        args.f.func_write = s->method->ssl_write;
+    if (sc->coalesce.len > 0
+        || ((sc->mode & SSL_MODE_COALESCE_WRITES) != 0
+            && !SSL_CONNECTION_IS_DTLS(sc)
+            && !SSL_in_init(s)))
+        return ssl_write_coalesced(s, sc, buf, num, written);
 
-        ret = ssl_start_async_job(s, &args, ssl_io_intern);
-        *written = sc->asyncrw;
-        ssl_update_error_state(sc);
-        return ret;
-    } else {
-        ret = s->method->ssl_write(s, buf, num, written);
-        ssl_update_error_state(sc);
-        return ret;
-    }
+    return ssl_write_dispatch(s, sc, buf, num, written);
 }
 
 ossl_ssize_t SSL_sendfile(SSL *s, int fd, off_t offset, size_t size, int flags)
@@ -2758,6 +2876,10 @@ ossl_ssize_t SSL_sendfile(SSL *s, int fd, off_t offset, size_t size, int flags)
         return -1;
     }
 
+    /* Data held back by SSL_MODE_COALESCE_WRITES must go first */
+    if (sc->coalesce.len > 0 && ssl_flush_coalesced(s, sc) <= 0)
+        return -1;
+
     /* If we have an alert to send, lets send it */
     if (sc->s3.alert_dispatch > 0) {
         ret = (ossl_ssize_t)s->method->ssl_dispatch_alert(s);
@@ -2802,10 +2924,31 @@ ossl_ssize_t SSL_sendfile(SSL *s, int fd, off_t offset, size_t size, int flags)
         return ret;
     }
     sc->rwstate = SSL_NOTHING;
+    sc->rlayer.ktls_written_bytes += sbytes;
     return sbytes;
 #endif
 }
 
+int SSL_get_ktls_stats(const SSL *s, uint64_t *ktls_read, uint64_t *ktls_written,
+    uint64_t *user_read, uint64_t *user_written)
+{
+    const SSL_CONNECTION *sc = SSL_CONNECTION_FROM_CONST_SSL_ONLY(s);
+
+    if (sc == NULL)
+        return 0;
+
+    if (ktls_read != NULL)
+        *ktls_read = sc->rlayer.ktls_read_bytes;
+    if (ktls_written != NULL)
+        *ktls_written = sc->rlayer.ktls_written_bytes;
+    if (user_read != NULL)
+        *user_read = sc->rlayer.user_read_bytes;
+    if (user_written != NULL)
+        *user_written = sc->rlayer.user_written_bytes;
+
+    return 1;
+}
+
 int SSL_write(SSL *s, const void *buf, int num)
 {
     int ret;
@@ -2848,6 +2991,43 @@ int SSL_write_ex2(SSL *s, const void *buf, size_t num, uint64_t flags,
     return ret;
 }
 
+int SSL_write_ex_nocopy(SSL *s, const void *buf, size_t num, uint64_t flags,
+    SSL_write_release_cb_fn release_cb, void *arg)
+{
+#ifndef OPENSSL_NO_QUIC
+    if (IS_QUIC(s))
+        return ossl_quic_write_nocopy(s, buf, num, flags, release_cb, arg);
+#endif
+
+    ERR_raise(ERR_LIB_SSL, ERR_R_SHOULD_NOT_HAVE_BEEN_CALLED);
+    return 0;
+}
+
+int SSL_flush(SSL *s)
+{
+    SSL_CONNECTION *sc = SSL_CONNECTION_FROM_SSL_ONLY(s);
+
+    if (sc == NULL) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_PASSED_INVALID_ARGUMENT);
+        return -1;
+    }
+
+    if (ssl_reset_error_state(sc) == 0)
+        return -1;
+
+    return ssl_flush_coalesced(s, sc);
+}
+
+size_t SSL_get_coalesced_bytes(const SSL *s)
+{
+    const SSL_CONNECTION *sc = SSL_CONNECTION_FROM_CONST_SSL_ONLY(s);
+
+    if (sc == NULL)
+        return 0;
+
+    return sc->coalesce.len;
+}
+
 int SSL_write_early_data(SSL *s, const void *buf, size_t num, size_t *written)
 {
     int ret, early_data_state;
@@ -2998,6 +3178,10 @@ int SSL_shutdown(SSL *s)
         return -1;
     }
 
+    /* Send any data that is being held back before the close_notify */
+    if (sc->coalesce.len > 0 && (ret = ssl_flush_coalesced(s, sc)) <= 0)
+        return ret;
+
     if (!SSL_in_init(s)) {
         if ((sc->mode & SSL_MODE_ASYNC) && ASYNC_get_current_job() == NULL) {
             struct ssl_async_args args;
@@ -3293,9 +3477,16 @@ long SSL_callback_ctrl(SSL *s, int cmd, void (*fp)(void))
     return s->method->ssl_callback_ctrl(s, cmd, fp);
 }
 
+/*
+ * The returned table has to hold the whole internal session cache, so the
+ * cache is no longer sharded once it has been asked for.
+ */
 LHASH_OF(SSL_SESSION) *SSL_CTX_sessions(SSL_CTX *ctx)
 {
-    return ctx->sessions;
+    ctx->sess_cache_exported = 1;
+    if (ctx->sess_num_shards > 1)
+        (void)ssl_session_cache_unshard(ctx);
+    return ctx->sess_shards[0].sessions;
 }
 
 static int ssl_tsan_load(SSL_CTX *ctx, TSAN_QUALIFIER int *stat)
@@ -3362,8 +3553,14 @@ long SSL_CTX_ctrl(SSL_CTX *ctx, int cmd, long larg, void *parg)
     case SSL_CTRL_GET_SESS_CACHE_MODE:
         return ctx->session_cache_mode;
 
-    case SSL_CTRL_SESS_NUMBER:
-        return lh_SSL_SESSION_num_items(ctx->sessions);
+    case SSL_CTRL_SESS_NUMBER: {
+        unsigned long num = 0;
+        size_t i;
+
+        for (i = 0; i < ctx->sess_num_shards; i++)
+            num += lh_SSL_SESSION_num_items(ctx->sess_shards[i].sessions);
+        return (long)num;
+    }
     case SSL_CTRL_SESS_CONNECT:
         return ssl_tsan_load(ctx, &ctx->stats.sess_connect);
     case SSL_CTRL_SESS_CONNECT_GOOD:
@@ -3380,6 +3577,8 @@ long SSL_CTX_ctrl(SSL_CTX *ctx, int cmd, long larg, void *parg)
         return ssl_tsan_load(ctx, &ctx->stats.sess_hit);
     case SSL_CTRL_SESS_CB_HIT:
         return ssl_tsan_load(ctx, &ctx->stats.sess_cb_hit);
+    case SSL_CTRL_SESS_SHARED_HIT:
+        return ssl_tsan_load(ctx, &ctx->stats.sess_shared_hit);
     case SSL_CTRL_SESS_MISSES:
         return ssl_tsan_load(ctx, &ctx->stats.sess_miss);
     case SSL_CTRL_SESS_TIMEOUTS:
@@ -4139,6 +4338,73 @@ static int ssl_session_cmp(const SSL_SESSION *a, const SSL_SESSION *b)
     return memcmp(a->session_id, b->session_id, a->session_id_length);
 }
 
+static void ssl_session_cache_free(SSL_SESSION_CACHE_SHARD *shards, size_t num)
+{
+    size_t i;
+
+    if (shards == NULL)
+        return;
+    for (i = 0; i < num; i++) {
+        lh_SSL_SESSION_free(shards[i].sessions);
+        CRYPTO_THREAD_lock_free(shards[i].lock);
+    }
+    OPENSSL_free(shards);
+}
+
+/* Replace the empty internal session cache of |ctx| with |num| shards */
+static int ssl_session_cache_new(SSL_CTX *ctx, size_t num)
+{
+    SSL_SESSION_CACHE_SHARD *shards;
+    size_t i;
+
+    shards = OPENSSL_calloc(num, sizeof(*shards));
+    if (shards == NULL)
+        return 0;
+    for (i = 0; i < num; i++) {
+        shards[i].sessions = lh_SSL_SESSION_new(ssl_session_hash,
+            ssl_session_cmp);
+        if (shards[i].sessions == NULL) {
+            ERR_raise(ERR_LIB_SSL, ERR_R_CRYPTO_LIB);
+            goto err;
+        }
+        shards[i].lock = CRYPTO_THREAD_lock_new();
+        if (shards[i].lock == NULL) {
+            ERR_raise(ERR_LIB_SSL, ERR_R_CRYPTO_LIB);
+            goto err;
+        }
+    }
+
+    ssl_session_cache_free(ctx->sess_shards, ctx->sess_num_shards);
+    ctx->sess_shards = shards;
+    ctx->sess_num_shards = num;
+    return 1;
+err:
+    ssl_session_cache_free(shards, num);
+    return 0;
+}
+
+int SSL_CTX_sess_set_cache_shards(SSL_CTX *ctx, size_t num)
+{
+    if (num == 0 || num > SSL_SESSION_CACHE_MAX_SHARDS) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_PASSED_INVALID_ARGUMENT);
+        return 0;
+    }
+    if (SSL_CTX_sess_number(ctx) != 0
+        || (num > 1 && ctx->sess_cache_exported)) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_SHOULD_NOT_HAVE_BEEN_CALLED);
+        return 0;
+    }
+    if (num == ctx->sess_num_shards)
+        return 1;
+
+    return ssl_session_cache_new(ctx, num);
+}
+
+size_t SSL_CTX_sess_get_cache_shards(const SSL_CTX *ctx)
+{
+    return ctx->sess_num_shards;
+}
+
 #ifndef OPENSSL_NO_SSLKEYLOG
 /**
  * @brief Static initialization for a one-time action to initialize the SSL key log.
@@ -4318,13 +4584,11 @@ SSL_CTX *SSL_CTX_new_ex(OSSL_LIB_CTX *libctx, const char *propq,
     /* We take the system default. */
     ret->session_timeout = meth->get_timeout();
     ret->max_cert_list = SSL_MAX_CERT_LIST_DEFAULT;
+    ret->sign_batch_timeout = ossl_ms2time(SSL_SIGN_BATCH_DEFAULT_TIMEOUT_MS);
     ret->verify_mode = SSL_VERIFY_NONE;
 
-    ret->sessions = lh_SSL_SESSION_new(ssl_session_hash, ssl_session_cmp);
-    if (ret->sessions == NULL) {
-        ERR_raise(ERR_LIB_SSL, ERR_R_CRYPTO_LIB);
+    if (!ssl_session_cache_new(ret, 1))
         goto err;
-    }
     ret->cert_store = X509_STORE_new();
     if (ret->cert_store == NULL) {
         ERR_raise(ERR_LIB_SSL, ERR_R_X509_LIB);
@@ -4412,16 +4676,13 @@ SSL_CTX *SSL_CTX_new_ex(OSSL_LIB_CTX *libctx, const char *propq,
     ret->split_send_fragment = SSL3_RT_MAX_PLAIN_LENGTH;
 
     /* Setup RFC5077 ticket keys */
-    if ((RAND_bytes_ex(libctx, ret->ext.tick_key_name,
-             sizeof(ret->ext.tick_key_name), 0)
-            <= 0)
-        || (RAND_priv_bytes_ex(libctx, ret->ext.secure->tick_hmac_key,
-                sizeof(ret->ext.secure->tick_hmac_key), 0)
-            <= 0)
-        || (RAND_priv_bytes_ex(libctx, ret->ext.secure->tick_aes_key,
-                sizeof(ret->ext.secure->tick_aes_key), 0)
-            <= 0))
+    if (!ssl_ctx_ticket_key_init(ret)) {
+        if (ret->ext.tick_key_lock == NULL) {
+            ERR_raise(ERR_LIB_SSL, ERR_R_CRYPTO_LIB);
+            goto err;
+        }
         ret->options |= SSL_OP_NO_TICKET;
+    }
 
     if (RAND_priv_bytes_ex(libctx, ret->ext.cookie_hmac_key,
             sizeof(ret->ext.cookie_hmac_key), 0)
@@ -4603,6 +4864,11 @@ void SSL_CTX_free(SSL_CTX *a)
         return;
     REF_ASSERT_ISNT(i < 0);
 
+    /* Stop the pool worker before anything it uses goes away */
+    ssl_keyshare_pool_free(a->keyshare_pool);
+    ssl_sign_batch_free(a->sign_batch);
+    ssl_shared_sess_cache_free(a->shared_sess_cache);
+
 #ifndef OPENSSL_NO_SSLKEYLOG
     if (keylog_lock != NULL && CRYPTO_THREAD_write_lock(keylog_lock)) {
         if (a->do_sslkeylog == 1)
@@ -4624,7 +4890,7 @@ void SSL_CTX_free(SSL_CTX *a)
      * free ex_data, then finally free the cache.
      * (See ticket [openssl.org #212].)
      */
-    if (a->sessions != NULL)
+    if (a->sess_shards != NULL)
         SSL_CTX_flush_sessions_ex(a, 0);
 
     EVP_MAC_free(a->hmac);
@@ -4635,7 +4901,7 @@ void SSL_CTX_free(SSL_CTX *a)
 #endif
 
     CRYPTO_free_ex_data(CRYPTO_EX_INDEX_SSL_CTX, a, &a->ex_data);
-    lh_SSL_SESSION_free(a->sessions);
+    ssl_session_cache_free(a->sess_shards, a->sess_num_shards);
     X509_STORE_free(a->cert_store);
 #ifndef OPENSSL_NO_CT
     CTLOG_STORE_free(a->ctlog_store);
@@ -4660,6 +4926,7 @@ void SSL_CTX_free(SSL_CTX *a)
     OPENSSL_free(a->ext.tuples);
     OPENSSL_free(a->ext.alpn);
     OPENSSL_secure_clear_free(a->ext.secure, sizeof(*a->ext.secure));
+    CRYPTO_THREAD_lock_free(a->ext.tick_key_lock);
 
     for (j = 0; j < SSL_ENC_NUM_IDX; j++)
         ssl_evp_cipher_free(a->ssl_cipher_methods[j]);
@@ -4691,6 +4958,8 @@ void SSL_CTX_free(SSL_CTX *a)
     OPENSSL_free(a->client_cert_type);
     OPENSSL_free(a->server_cert_type);
 
+    ossl_record_buffer_pool_free(a->bufpool);
+
     CRYPTO_THREAD_lock_free(a->lock);
     CRYPTO_FREE_REF(&a->references);
 #ifdef TSAN_REQUIRES_LOCKING
@@ -5009,6 +5278,17 @@ void ssl_update_cache(SSL_CONNECTION *s, int mode)
                 || (s->options & SSL_OP_NO_TICKET) != 0))
             SSL_CTX_add_session(s->session_ctx, s->session);
 
+        /*
+         * Share the session with the other processes if it can be looked up
+         * by its id. Sessions that allow early data are kept out so that the
+         * replay check above stays within one process's cache.
+         */
+        if (s->server && s->session_ctx->shared_sess_cache != NULL
+            && (!SSL_CONNECTION_IS_TLS13(s)
+                || (s->options & SSL_OP_NO_TICKET) != 0)
+            && s->session->ext.max_early_data == 0)
+            ssl_shared_sess_cache_add(s->session_ctx, s->session);
+
         /*
          * Add the session to the external cache. We do this even in server side
          * TLSv1.3 without early data because some applications just want to
@@ -5172,6 +5452,8 @@ int ossl_ssl_get_error(const SSL *s, int i, int check_err)
         return SSL_ERROR_WANT_ASYNC_JOB;
     if (SSL_want_client_hello_cb(s))
         return SSL_ERROR_WANT_CLIENT_HELLO_CB;
+    if (SSL_want_private_key_operation(s))
+        return SSL_ERROR_WANT_PRIVATE_KEY_OPERATION;
 
     if ((sc->shutdown & SSL_RECEIVED_SHUTDOWN) && (sc->s3.warn_alert == SSL_AD_CLOSE_NOTIFY))
         return SSL_ERROR_ZERO_RETURN;
@@ -6317,6 +6599,87 @@ int SSL_set_block_padding(SSL *ssl, size_t block_size)
     return SSL_set_block_padding_ex(ssl, block_size, block_size);
 }
 
+int SSL_CTX_set_record_sizing(SSL_CTX *ctx, size_t len, size_t threshold,
+    uint64_t idle_ms)
+{
+    if ((IS_QUIC_CTX(ctx) && len > 0) || len > SSL3_RT_MAX_PLAIN_LENGTH)
+        return 0;
+
+    ctx->record_sizing_len = len;
+    ctx->record_sizing_threshold = threshold;
+    ctx->record_sizing_idle_ms = idle_ms;
+    return 1;
+}
+
+int SSL_set_record_sizing(SSL *ssl, size_t len, size_t threshold,
+    uint64_t idle_ms)
+{
+    SSL_CONNECTION *sc = SSL_CONNECTION_FROM_SSL(ssl);
+
+    if (sc == NULL
+        || (IS_QUIC(ssl) && len > 0)
+        || len > SSL3_RT_MAX_PLAIN_LENGTH)
+        return 0;
+
+    sc->rlayer.sizing_len = len;
+    sc->rlayer.sizing_threshold = threshold;
+    sc->rlayer.sizing_idle_ms = idle_ms;
+
+    /* Apply the new settings to the current record layer too */
+    if (sc->rlayer.wrl != NULL) {
+        OSSL_PARAM options[4], *opts = options;
+
+        *opts++ = OSSL_PARAM_construct_size_t(OSSL_LIBSSL_RECORD_LAYER_PARAM_SIZING_LEN,
+            &sc->rlayer.sizing_len);
+        *opts++ = OSSL_PARAM_construct_size_t(OSSL_LIBSSL_RECORD_LAYER_PARAM_SIZING_THRESHOLD,
+            &sc->rlayer.sizing_threshold);
+        *opts++ = OSSL_PARAM_construct_uint64(OSSL_LIBSSL_RECORD_LAYER_PARAM_SIZING_IDLE,
+            &sc->rlayer.sizing_idle_ms);
+        *opts = OSSL_PARAM_construct_end();
+        if (!sc->rlayer.wrlmethod->set_options(sc->rlayer.wrl, options))
+            return 0;
+    }
+    return 1;
+}
+
+int SSL_CTX_set_record_buffer_pool_size(SSL_CTX *ctx, size_t num)
+{
+    if (ctx->bufpool == NULL) {
+        if (num == 0)
+            return 1;
+        if ((ctx->bufpool = ossl_record_buffer_pool_new()) == NULL) {
+            ERR_raise(ERR_LIB_SSL, ERR_R_SSL_LIB);
+            return 0;
+        }
+    }
+
+    return ossl_record_buffer_pool_set_size(ctx->bufpool, num);
+}
+
+size_t SSL_CTX_get_record_buffer_pool_size(const SSL_CTX *ctx)
+{
+    if (ctx->bufpool == NULL)
+        return 0;
+
+    return ossl_record_buffer_pool_get_size(ctx->bufpool);
+}
+
+int SSL_CTX_get_record_buffer_pool_stats(SSL_CTX *ctx, uint64_t *hits,
+    uint64_t *misses, size_t *idle)
+{
+    if (ctx->bufpool == NULL) {
+        if (hits != NULL)
+            *hits = 0;
+        if (misses != NULL)
+            *misses = 0;
+        if (idle != NULL)
+            *idle = 0;
+        return 1;
+    }
+
+    return ossl_record_buffer_pool_get_stats(ctx->bufpool, hits, misses, idle);
+}
+
 int SSL_set_num_tickets(SSL *s, size_t num_tickets)
 {
     SSL_CONNECTION *sc = SSL_CONNECTION_FROM_SSL(s);
@@ -7028,6 +7391,47 @@ void SSL_CTX_set_client_hello_cb(SSL_CTX *c, SSL_client_hello_cb_fn cb,
     c->client_hello_cb_arg = arg;
 }
 
+void SSL_CTX_set_private_key_sign_cb(SSL_CTX *c, SSL_private_key_sign_cb_fn cb,
+    void *arg)
+{
+    c->private_key_sign_cb = cb;
+    c->private_key_sign_cb_arg = arg;
+}
+
+int SSL_set1_private_key_signature(SSL *s, const unsigned char *sig,
+    size_t siglen)
+{
+    SSL_CONNECTION *sc = SSL_CONNECTION_FROM_SSL(s);
+
+    if (sc == NULL)
+        return 0;
+
+    /*
+     * A signature queued in a batch is made by whichever thread flushes the
+     * batch, which updates pkey_sign_state under the batch lock. The state is
+     * therefore only looked at once it is known that |s| is not queued, as
+     * nothing else changes it then.
+     */
+    if (sc->pkey_sign_batch_ctx != NULL
+        || sc->pkey_sign_state != SSL_PKEY_SIGN_PENDING) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_SHOULD_NOT_HAVE_BEEN_CALLED);
+        return 0;
+    }
+
+    /* A NULL signature reports a failure, the handshake will then fail */
+    if (sig != NULL) {
+        if (siglen == 0 || siglen > 0xffff) {
+            ERR_raise(ERR_LIB_SSL, ERR_R_PASSED_INVALID_ARGUMENT);
+            return 0;
+        }
+        if ((sc->pkey_sig = OPENSSL_memdup(sig, siglen)) == NULL)
+            return 0;
+        sc->pkey_siglen = siglen;
+    }
+    sc->pkey_sign_state = SSL_PKEY_SIGN_DONE;
+    return 1;
+}
+
 void SSL_CTX_set_new_pending_conn_cb(SSL_CTX *c, SSL_new_pending_conn_cb_fn cb,
     void *arg)
 {
@@ -7213,6 +7617,122 @@ int SSL_client_hello_get0_ext(SSL *s, unsigned int type, const unsigned char **o
     return 0;
 }
 
+/*
+ * Find the extensions of the ClientHello in the first TLS record of |data|,
+ * without an SSL object. Returns 1 on success, -1 if more data is needed and
+ * -2 if |data| does not start with a ClientHello that can be inspected, which
+ * includes a ClientHello split over several records.
+ */
+static int client_hello_peek_exts(const unsigned char *data, size_t len,
+    PACKET *exts)
+{
+    PACKET pkt, rec, msg, tmp;
+    unsigned int type, version;
+    size_t reclen, reclen_avail, msglen;
+
+    if (!PACKET_buf_init(&pkt, data, len))
+        return -2;
+
+    if (!PACKET_get_1(&pkt, &type)
+        || !PACKET_get_net_2(&pkt, &version)
+        || !PACKET_get_net_2_len(&pkt, &reclen))
+        return -1;
+    if (type != SSL3_RT_HANDSHAKE || (version >> 8) != SSL3_VERSION_MAJOR
+        || reclen > SSL3_RT_MAX_PLAIN_LENGTH)
+        return -2;
+
+    /* Only the bytes of the ClientHello have to be there */
+    if (reclen > PACKET_remaining(&pkt))
+        reclen_avail = PACKET_remaining(&pkt);
+    else
+        reclen_avail = reclen;
+    if (!PACKET_get_sub_packet(&pkt, &rec, reclen_avail)
+        || !PACKET_get_1(&rec, &type)
+        || !PACKET_get_net_3_len(&rec, &msglen))
+        return reclen < SSL3_HM_HEADER_LENGTH ? -2 : -1;
+    if (type != SSL3_MT_CLIENT_HELLO || msglen > reclen - SSL3_HM_HEADER_LENGTH)
+        return -2;
+    if (!PACKET_get_sub_packet(&rec, &msg, msglen))
+        return -1;
+
+    if (!PACKET_forward(&msg, 2 + SSL3_RANDOM_SIZE)
+        || !PACKET_get_length_prefixed_1(&msg, &tmp)
+        || PACKET_remaining(&tmp) > SSL_MAX_SSL_SESSION_ID_LENGTH
+        || !PACKET_get_length_prefixed_2(&msg, &tmp)
+        || !PACKET_get_length_prefixed_1(&msg, &tmp))
+        return -2;
+
+    /* A ClientHello without extensions has an empty extensions block */
+    if (PACKET_remaining(&msg) == 0) {
+        PACKET_null_init(exts);
+        return 1;
+    }
+    if (!PACKET_as_length_prefixed_2(&msg, exts))
+        return -2;
+    return 1;
+}
+
+int SSL_client_hello_peek_ext(const unsigned char *data, size_t len,
+    unsigned int type, const unsigned char **out, size_t *outlen)
+{
+    PACKET exts, ext;
+    unsigned int t;
+    int ret;
+
+    if (data == NULL) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_PASSED_NULL_PARAMETER);
+        return -2;
+    }
+
+    if ((ret = client_hello_peek_exts(data, len, &exts)) != 1)
+        return ret;
+
+    while (PACKET_remaining(&exts) > 0) {
+        if (!PACKET_get_net_2(&exts, &t)
+            || !PACKET_get_length_prefixed_2(&exts, &ext))
+            return -2;
+        if (t == type) {
+            if (out != NULL)
+                *out = PACKET_data(&ext);
+            if (outlen != NULL)
+                *outlen = PACKET_remaining(&ext);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int SSL_client_hello_peek_servername(const unsigned char *data, size_t len,
+    const unsigned char **name, size_t *namelen)
+{
+    const unsigned char *ext;
+    size_t extlen;
+    PACKET pkt, list, host;
+    unsigned int type;
+    int ret;
+
+    ret = SSL_client_hello_peek_ext(data, len, TLSEXT_TYPE_server_name,
+        &ext, &extlen);
+    if (ret != 1)
+        return ret;
+
+    /* Same checks as tls_parse_ctos_server_name() */
+    if (!PACKET_buf_init(&pkt, ext, extlen)
+        || !PACKET_as_length_prefixed_2(&pkt, &list)
+        || !PACKET_get_1(&list, &type)
+        || type != TLSEXT_NAMETYPE_host_name
+        || !PACKET_as_length_prefixed_2(&list, &host)
+        || PACKET_remaining(&host) == 0
+        || PACKET_remaining(&host) > TLSEXT_MAXLEN_host_name)
+        return -2;
+
+    if (name != NULL)
+        *name = PACKET_data(&host);
+    if (namelen != NULL)
+        *namelen = PACKET_remaining(&host);
+    return 1;
+}
+
 int SSL_free_buffers(SSL *ssl)
 {
     RECORD_LAYER *rl;
@@ -7245,6 +7765,69 @@ int SSL_alloc_buffers(SSL *ssl)
         && rl->wrlmethod->alloc_buffers(rl->wrl);
 }
 
+/*
+ * Release the state that an established connection does not need until it
+ * next sends or receives data, or does not need at all any more. Returns 0
+ * without releasing anything if the connection is in the middle of a
+ * handshake, or has data buffered.
+ */
+int ossl_ssl_connection_hibernate(SSL_CONNECTION *s)
+{
+    RECORD_LAYER *rl = &s->rlayer;
+    size_t i;
+
+    if (!SSL_is_init_finished(SSL_CONNECTION_GET_SSL(s))
+        || s->init_num != 0
+        || rl->handshake_fragment_len != 0)
+        return 0;
+
+    if (s->coalesce.len != 0
+        || !rl->rrlmethod->free_buffers(rl->rrl)
+        || !rl->wrlmethod->free_buffers(rl->wrl))
+        return 0;
+
+    OPENSSL_free(s->coalesce.buf);
+    s->coalesce.buf = NULL;
+    s->coalesce.size = 0;
+
+    /* DTLS may need the init_buf for retransmissions */
+    if (!SSL_CONNECTION_IS_DTLS(s)) {
+        BUF_MEM_free(s->init_buf);
+        s->init_buf = NULL;
+    }
+
+    /*
+     * TLSv1.3 only needs the transcript after the handshake for post-handshake
+     * authentication. Earlier versions keep it for renegotiation.
+     */
+    if (SSL_CONNECTION_IS_TLS13(s) && s->post_handshake_auth == SSL_PHA_NONE)
+        ssl3_free_digest_list(s);
+
+    /* Our ephemeral keys are of no further use */
+    for (i = 0; i < s->s3.tmp.num_ks_pkey; i++) {
+        if (s->s3.tmp.pkey == s->s3.tmp.ks_pkey[i])
+            s->s3.tmp.pkey = NULL;
+        EVP_PKEY_free(s->s3.tmp.ks_pkey[i]);
+        s->s3.tmp.ks_pkey[i] = NULL;
+    }
+    s->s3.tmp.num_ks_pkey = 0;
+    EVP_PKEY_free(s->s3.tmp.pkey);
+    s->s3.tmp.pkey = NULL;
+
+    return 1;
+}
+
+int SSL_hibernate(SSL *ssl)
+{
+    SSL_CONNECTION *sc = SSL_CONNECTION_FROM_SSL_ONLY(ssl);
+
+    /* QUIC manages its own buffers */
+    if (sc == NULL)
+        return 0;
+
+    return ossl_ssl_connection_hibernate(sc);
+}
+
 void SSL_CTX_set_keylog_callback(SSL_CTX *ctx, SSL_CTX_keylog_cb_func cb)
 {
     ctx->keylog_callback = cb;
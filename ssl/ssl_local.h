@@ -212,6 +212,9 @@
 
 #define SSL_MD_NUM_IDX SSL_MAX_DIGEST
 
+/* Digests the transcript is hashed with before the handshake digest is known */
+#define SSL_TRANSCRIPT_LANES 2
+
 /* Bits for algorithm2 (handshake digests and other extra flags) */
 
 /* Bits 0-7 are handshake MAC */
@@ -575,13 +578,16 @@ struct ssl_session_st {
     unsigned char *ticket_appdata;
     size_t ticket_appdata_len;
     uint32_t flags;
-    SSL_CTX *owner;
+    /* The session cache shard this session is in, or NULL */
+    struct ssl_session_cache_shard_st *owner;
 
     /*
-     * These are used to make removal of session-ids more efficient and to
-     * implement a maximum cache size. Access requires protection of ctx->lock.
+     * These link the session into slot |timer_pos| of the owner's expiry timer
+     * wheel; |prev| is NULL for the first session in a slot. Access requires
+     * protection of the owner's lock.
      */
     struct ssl_session_st *prev, *next;
+    size_t timer_pos;
     CRYPTO_REF_COUNT references;
 };
 
@@ -732,9 +738,21 @@ DEFINE_LHASH_OF_EX(X509_NAME);
 #define TLSEXT_KEYNAME_LENGTH 16
 #define TLSEXT_TICK_KEY_LENGTH 32
 
+/* A session ticket key, identified in the tickets it encrypts by its name */
+typedef struct ssl_ticket_key_st {
+    unsigned char name[TLSEXT_KEYNAME_LENGTH];
+    unsigned char hmac_key[TLSEXT_TICK_KEY_LENGTH];
+    unsigned char aes_key[TLSEXT_TICK_KEY_LENGTH];
+} SSL_TICKET_KEY;
+
 typedef struct ssl_ctx_ext_secure_st {
-    unsigned char tick_hmac_key[TLSEXT_TICK_KEY_LENGTH];
-    unsigned char tick_aes_key[TLSEXT_TICK_KEY_LENGTH];
+    /*
+     * The ticket key ring, newest key first. The first key encrypts new
+     * tickets and all of them decrypt tickets. Access requires protection of
+     * ext.tick_key_lock.
+     */
+    SSL_TICKET_KEY tick_keys[SSL_TICKET_KEYS_MAX];
+    size_t num_tick_keys;
 } SSL_CTX_EXT_SECURE;
 
 /*
@@ -816,6 +834,45 @@ typedef struct {
 #define OPENSSL_HAVE_TLS1PRF
 #endif
 
+/*
+ * Session expiry is tracked with a hierarchical timer wheel of
+ * SSL_SESS_TIMER_LEVELS levels of SSL_SESS_TIMER_SLOTS slots each. A slot on
+ * level n covers 2^(n * SSL_SESS_TIMER_BITS) seconds, so the wheel spans about
+ * 194 days; later expiry times are parked in the furthest slot and moved again
+ * when it comes due.
+ */
+#define SSL_SESS_TIMER_BITS 6
+#define SSL_SESS_TIMER_SLOTS (1 << SSL_SESS_TIMER_BITS)
+#define SSL_SESS_TIMER_LEVELS 4
+
+/* Maximum number of sessions that a session cache flush handles per lock hold */
+#define SSL_SESS_FLUSH_BATCH 64
+
+/*
+ * The internal session cache is split into shards, each with its own lock, so
+ * that connections resuming different sessions don't all contend for one
+ * lock. A session always lives in the shard that its session ID selects.
+ */
+typedef struct ssl_session_cache_shard_st {
+    CRYPTO_RWLOCK *lock;
+    LHASH_OF(SSL_SESSION) *sessions;
+    /* Unordered lists of the sessions due in each slot of the timer wheel */
+    struct ssl_session_st *timer_slots[SSL_SESS_TIMER_LEVELS
+        * SSL_SESS_TIMER_SLOTS];
+    /* One bit per slot of each level, set if the slot is not empty */
+    uint64_t timer_occupied[SSL_SESS_TIMER_LEVELS];
+    /* The second up to which the wheel has been advanced */
+    uint64_t timer_tick;
+} SSL_SESSION_CACHE_SHARD;
+
+/* Pool of pre-generated ephemeral keys, see ssl_keyshare_pool.c */
+typedef struct ssl_keyshare_pool_st SSL_KEYSHARE_POOL;
+/* Queue of CertificateVerify signatures, see ssl_sign_batch.c */
+typedef struct ssl_sign_batch_st SSL_SIGN_BATCH;
+#define SSL_SIGN_BATCH_DEFAULT_TIMEOUT_MS 10
+/* Session cache in memory shared between processes, see ssl_sess_shared.c */
+typedef struct ssl_shared_sess_cache_st SSL_SHARED_SESS_CACHE;
+
 struct ssl_ctx_st {
     OSSL_LIB_CTX *libctx;
 
@@ -826,7 +883,11 @@ struct ssl_ctx_st {
     /* TLSv1.3 specific ciphersuites */
     STACK_OF(SSL_CIPHER) *tls13_ciphersuites;
     struct x509_store_st /* X509_STORE */ *cert_store;
-    LHASH_OF(SSL_SESSION) *sessions;
+    SSL_SESSION_CACHE_SHARD *sess_shards;
+    size_t sess_num_shards;
+    /* Set once SSL_CTX_sessions() has handed out the cache, see there */
+    int sess_cache_exported;
+    SSL_SHARED_SESS_CACHE *shared_sess_cache;
     EVP_MAC *hmac;
     EVP_MD *sha256;
     EVP_CIPHER *tktenc;
@@ -838,8 +899,6 @@ struct ssl_ctx_st {
      * SSL_SESSION_CACHE_MAX_SIZE_DEFAULT. 0 is unlimited.
      */
     size_t session_cache_size;
-    struct ssl_session_st *session_cache_head;
-    struct ssl_session_st *session_cache_tail;
     /*
      * This can have one of 2 values, ored together, SSL_SESS_CACHE_CLIENT,
      * SSL_SESS_CACHE_SERVER, Default is SSL_SESSION_CACHE_SERVER, which
@@ -884,6 +943,8 @@ struct ssl_ctx_st {
                                          * supplying session-id's from
                                          * other processes - spooky
                                          * :-) */
+        TSAN_QUALIFIER int sess_shared_hit; /* session-id found in the
+                                             * shared session cache */
     } stats;
 #ifdef TSAN_REQUIRES_LOCKING
     CRYPTO_RWLOCK *tsan_lock;
@@ -1006,6 +1067,18 @@ struct ssl_ctx_st {
     SSL_client_hello_cb_fn client_hello_cb;
     void *client_hello_cb_arg;
 
+    /* Callback to sign with the private key outside of the handshake */
+    SSL_private_key_sign_cb_fn private_key_sign_cb;
+    void *private_key_sign_cb_arg;
+
+    /* Ephemeral keys generated ahead of the handshakes that need them */
+    SSL_KEYSHARE_POOL *keyshare_pool;
+
+    /* CertificateVerify signatures waiting to be made together */
+    SSL_SIGN_BATCH *sign_batch;
+    /* How long a queued signature may wait for the batch to fill */
+    OSSL_TIME sign_batch_timeout;
+
     /* Callback to announce new pending ssl objects in the accept queue */
     SSL_new_pending_conn_cb_fn new_pending_conn_cb;
     void *new_pending_conn_arg;
@@ -1016,8 +1089,14 @@ struct ssl_ctx_st {
         int (*servername_cb)(SSL *, int *, void *);
         void *servername_arg;
         /* RFC 4507 session ticket keys */
-        unsigned char tick_key_name[TLSEXT_KEYNAME_LENGTH];
         SSL_CTX_EXT_SECURE *secure;
+        CRYPTO_RWLOCK *tick_key_lock;
+        /* When the current ticket key was made */
+        OSSL_TIME tick_key_time;
+        /* Interval for automatic ticket key rotation, or 0 for none */
+        OSSL_TIME tick_key_interval;
+        /* Number of ticket keys kept on rotation */
+        size_t tick_key_max;
 #ifndef OPENSSL_NO_DEPRECATED_3_0
         /* Callback to support customisation of ticket key setting */
         int (*ticket_key_cb)(SSL *ssl,
@@ -1156,6 +1235,14 @@ struct ssl_ctx_st {
     size_t block_padding;
     size_t hs_padding;
 
+    /* Dynamic record sizing, see SSL_CTX_set_record_sizing() */
+    size_t record_sizing_len;
+    size_t record_sizing_threshold;
+    uint64_t record_sizing_idle_ms;
+
+    /* Pool of record buffers shared by connections, NULL if not in use */
+    OSSL_RECORD_BUFFER_POOL *bufpool;
+
     /* Session ticket appdata */
     SSL_CTX_generate_session_ticket_fn generate_ticket_cb;
     SSL_CTX_decrypt_session_ticket_fn decrypt_ticket_cb;
@@ -1342,6 +1429,12 @@ struct ssl_connection_st {
          * freed and MD_CTX for the required digest is stored here.
          */
         EVP_MD_CTX *handshake_dgst;
+        /*
+         * While the handshake digest is not known the buffered messages are
+         * also hashed with the digests it is likely to be, so that the one
+         * that is picked does not have to hash the buffer again.
+         */
+        EVP_MD_CTX *handshake_lanes[SSL_TRANSCRIPT_LANES];
         /*
          * Set whenever an expected ChangeCipherSpec message is processed.
          * Unset when the peer's Finished message is received.
@@ -1809,6 +1902,16 @@ struct ssl_connection_st {
      */
     CLIENTHELLO_MSG *clienthello;
 
+    /*
+     * A signature that the private key sign callback asked to retry, see
+     * SSL_set1_private_key_signature()
+     */
+    int pkey_sign_state;
+    unsigned char *pkey_sig;
+    size_t pkey_siglen;
+    /* The SSL_CTX whose batch holds the pending signature, if any */
+    SSL_CTX *pkey_sign_batch_ctx;
+
     /*-
      * no further mod of servername
      * 0 : call the servername extension callback.
@@ -1868,6 +1971,34 @@ struct ssl_connection_st {
     /* Record layer data */
     RECORD_LAYER rlayer;
 
+    /* State for SSL_splice() */
+    struct {
+        /* Pipe for moving KTLS plaintext between descriptors, or -1 */
+        int pipefd[2];
+        /* Bounce buffer used when the data has to pass through user space */
+        unsigned char *buf;
+        size_t off;
+        /* Bytes read but not yet written to the destination */
+        size_t pending;
+        /* Whether the pending bytes are in the pipe rather than in buf */
+        int in_pipe;
+    } splice;
+
+    /* Application data held back by SSL_MODE_COALESCE_WRITES */
+    struct {
+        unsigned char *buf;
+        size_t size;
+        /* The held back data is |len| bytes starting at |off| */
+        size_t off;
+        size_t len;
+        /*
+         * Set while a write of the held back data is waiting to be retried.
+         * The record layer then refers to |buf| + |off|, so the data must not
+         * move until the write has completed.
+         */
+        int retry;
+    } coalesce;
+
     /* Default password callback. */
     pem_password_cb *default_passwd_callback;
     /* Default password callback user data. */
@@ -2072,6 +2203,22 @@ void OSSL_COMP_CERT_free(OSSL_COMP_CERT *c);
 int OSSL_COMP_CERT_up_ref(OSSL_COMP_CERT *c);
 #endif
 
+/*
+ * The DER encoding of a certificate and its chain as it appears in the
+ * certificate_list of a Certificate message: each certificate is preceded
+ * by its 24-bit length, the end-entity certificate first. It is computed
+ * when the certificate or the chain is set, and shared by all copies of the
+ * CERT_PKEY so that handshakes don't have to re-encode the chain. |certs|
+ * holds references to the certificates that were encoded, so that a stale
+ * encoding can be recognised and ignored.
+ */
+typedef struct ssl_cert_enc_st {
+    STACK_OF(X509) *certs;
+    unsigned char *data;
+    size_t len;
+    CRYPTO_REF_COUNT references;
+} SSL_CERT_ENC;
+
 struct cert_pkey_st {
     X509 *x509;
     EVP_PKEY *privatekey;
@@ -2091,7 +2238,14 @@ struct cert_pkey_st {
     OSSL_COMP_CERT *comp_cert[TLSEXT_comp_cert_limit];
     int cert_comp_used;
 #endif
+    /* Encoded |x509| and |chain|, may be NULL */
+    SSL_CERT_ENC *cert_enc;
 };
+/* Values of pkey_sign_state in SSL_CONNECTION */
+#define SSL_PKEY_SIGN_NONE 0
+#define SSL_PKEY_SIGN_PENDING 1
+#define SSL_PKEY_SIGN_DONE 2
+
 /* Retrieve Suite B flags */
 #define tls1_suiteb(s) (s->cert->cert_flags & SSL_CERT_FLAG_SUITEB_128_LOS)
 /* Uses to check strict mode: suite B modes are always strict */
@@ -2474,7 +2628,10 @@ __owur SSL *ossl_ssl_connection_new_int(SSL_CTX *ctx, SSL *user_ssl,
 __owur SSL *ossl_ssl_connection_new(SSL_CTX *ctx);
 void ossl_ssl_connection_free(SSL *ssl);
 __owur int ossl_ssl_connection_reset(SSL *ssl);
+int ossl_ssl_connection_hibernate(SSL_CONNECTION *s);
 
+__owur int ssl_reset_error_state(SSL_CONNECTION *sc);
+void ssl_splice_clear(SSL_CONNECTION *sc);
 __owur int ssl_read_internal(SSL *s, void *buf, size_t num, size_t *readbytes);
 __owur int ssl_write_internal(SSL *s, const void *buf, size_t num,
     uint64_t flags, size_t *written);
@@ -2482,13 +2639,34 @@ int ssl_clear_bad_session(SSL_CONNECTION *s);
 __owur CERT *ssl_cert_new(size_t ssl_pkey_num);
 __owur CERT *ssl_cert_dup(CERT *cert);
 void ssl_cert_clear_certs(CERT *c);
+void ssl_cert_pkey_encode(CERT_PKEY *cpk);
+int ssl_cert_enc_matches(const SSL_CERT_ENC *enc, X509 *x,
+    STACK_OF(X509) *chain);
+int ssl_cert_enc_up_ref(SSL_CERT_ENC *enc);
+void ssl_cert_enc_free(SSL_CERT_ENC *enc);
 void ssl_cert_free(CERT *c);
 __owur int ssl_generate_session_id(SSL_CONNECTION *s, SSL_SESSION *ss);
 __owur int ssl_get_new_session(SSL_CONNECTION *s, int session);
+__owur int ssl_ctx_ticket_key_init(SSL_CTX *ctx);
+__owur int ssl_ctx_ticket_key_current(SSL_CTX *ctx, SSL_TICKET_KEY *key);
+__owur int ssl_ctx_ticket_key_find(SSL_CTX *ctx, const unsigned char *name,
+    SSL_TICKET_KEY *key, int *current);
+__owur int ssl_ctx_set_ticket_key_current(SSL_CTX *ctx,
+    const unsigned char *keys);
+SSL_SESSION_CACHE_SHARD *ssl_session_cache_shard(const SSL_CTX *ctx,
+    const SSL_SESSION *s);
+int ssl_session_cache_unshard(SSL_CTX *ctx);
 __owur SSL_SESSION *lookup_sess_in_cache(SSL_CONNECTION *s,
     const unsigned char *sess_id,
     size_t sess_id_len);
 __owur int ssl_get_prev_session(SSL_CONNECTION *s, CLIENTHELLO_MSG *hello);
+void ssl_shared_sess_cache_free(SSL_SHARED_SESS_CACHE *cache);
+void ssl_shared_sess_cache_add(SSL_CTX *ctx, SSL_SESSION *sess);
+SSL_SESSION *ssl_shared_sess_cache_get(SSL_CTX *ctx, const unsigned char *id,
+    size_t id_len);
+void ssl_shared_sess_cache_remove(SSL_CTX *ctx, const SSL_SESSION *sess);
+void ssl_shared_sess_cache_debug_abandon(SSL_CTX *ctx,
+    const SSL_SESSION *sess, time_t since);
 __owur SSL_SESSION *ssl_session_dup(const SSL_SESSION *src, int ticket);
 __owur int ssl_cipher_id_cmp(const SSL_CIPHER *a, const SSL_CIPHER *b);
 DECLARE_OBJ_BSEARCH_GLOBAL_CMP_FN(SSL_CIPHER, SSL_CIPHER, ssl_cipher_id);
@@ -2613,6 +2791,7 @@ __owur int ssl3_dispatch_alert(SSL *s);
 __owur int ssl3_finish_mac(SSL_CONNECTION *s, const unsigned char *buf,
     size_t len);
 void ssl3_free_digest_list(SSL_CONNECTION *s);
+void ssl3_free_transcript_lanes(SSL_CONNECTION *s);
 __owur unsigned long ssl3_output_cert_chain(SSL_CONNECTION *s, WPACKET *pkt,
     CERT_PKEY *cpk, int for_comp);
 __owur const SSL_CIPHER *ssl3_choose_cipher(SSL_CONNECTION *s,
@@ -2802,6 +2981,14 @@ __owur int tls1_set_groups_list(SSL_CTX *ctx,
     size_t **tplext, size_t *tplextlen,
     const char *str);
 __owur EVP_PKEY *ssl_generate_pkey_group(SSL_CONNECTION *s, uint16_t id);
+EVP_PKEY *ssl_keyshare_pool_get(SSL_CONNECTION *s, uint16_t group_id);
+void ssl_keyshare_pool_free(SSL_KEYSHARE_POOL *pool);
+void ssl_sign_batch_free(SSL_SIGN_BATCH *b);
+int ssl_sign_batch_applies(SSL_CONNECTION *s, const SIGALG_LOOKUP *lu);
+int ssl_sign_batch_add(SSL_CONNECTION *s, const SIGALG_LOOKUP *lu,
+    EVP_PKEY *pkey, const unsigned char *tbs, size_t tbslen);
+int ssl_sign_batch_poll(SSL_CONNECTION *s);
+void ssl_sign_batch_remove(SSL_CONNECTION *s);
 __owur int tls_valid_group(SSL_CONNECTION *s, uint16_t group_id, int minversion,
     int maxversion, int *okfortls13, const TLS_GROUP_INFO **giptr);
 __owur EVP_PKEY *ssl_generate_param_group(SSL_CONNECTION *s, uint16_t id);
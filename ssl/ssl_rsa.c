@@ -304,6 +304,7 @@ static int ssl_set_cert(CERT *c, X509 *x, SSL_CTX *ctx)
     X509_free(c->pkeys[i].x509);
     c->pkeys[i].x509 = x;
     c->key = &(c->pkeys[i]);
+    ssl_cert_pkey_encode(c->key);
 
     return 1;
 }
@@ -1081,6 +1082,7 @@ static int ssl_set_cert_and_key(SSL *ssl, SSL_CTX *ctx, X509 *x509, EVP_PKEY *pr
     c->pkeys[i].privatekey = privatekey;
 
     c->key = &(c->pkeys[i]);
+    ssl_cert_pkey_encode(c->key);
 
     ret = 1;
 out:
@@ -20,26 +20,26 @@
 #include "ssl_local.h"
 #include "statem/statem_local.h"
 
-static void SSL_SESSION_list_remove(SSL_CTX *ctx, SSL_SESSION *s);
-static void SSL_SESSION_list_add(SSL_CTX *ctx, SSL_SESSION *s);
-static SSL_SESSION *remove_session_locked(SSL_CTX *ctx, SSL_SESSION *c);
+static void SSL_SESSION_list_remove(SSL_SESSION_CACHE_SHARD *shard,
+    SSL_SESSION *s);
+static void SSL_SESSION_list_add(SSL_SESSION_CACHE_SHARD *shard,
+    SSL_SESSION *s);
+static SSL_SESSION *remove_session_locked(SSL_SESSION_CACHE_SHARD *shard,
+    SSL_SESSION *c);
+static SSL_SESSION *timer_first(const SSL_SESSION_CACHE_SHARD *shard);
 
 DEFINE_STACK_OF(SSL_SESSION)
 
+static int timer_expire(SSL_SESSION_CACHE_SHARD *shard, OSSL_TIME t,
+    STACK_OF(SSL_SESSION) *sk, size_t *budget);
+static int timer_drain(SSL_SESSION_CACHE_SHARD *shard,
+    STACK_OF(SSL_SESSION) *sk, size_t *budget);
+
 __owur static ossl_inline int sess_timedout(OSSL_TIME t, SSL_SESSION *ss)
 {
     return ossl_time_compare(t, ss->calc_timeout) > 0;
 }
 
-/*
- * Returns -1/0/+1 as other XXXcmp-type functions
- * Takes calculated timeout into consideration
- */
-__owur static ossl_inline int timeoutcmp(SSL_SESSION *a, SSL_SESSION *b)
-{
-    return ossl_time_compare(a->calc_timeout, b->calc_timeout);
-}
-
 /*
  * Calculates effective timeout
  * Locking must be done by the caller of this function
@@ -496,6 +496,29 @@ int ssl_get_new_session(SSL_CONNECTION *s, int session)
     return 1;
 }
 
+/*
+ * Returns the internal session cache shard that a session with the ID of |s|
+ * lives in. The lhash inside the shard hashes the first four bytes of the ID,
+ * so the shard is chosen with a hash over the whole ID instead; callers that
+ * construct a search key must therefore fill in the complete ID.
+ */
+SSL_SESSION_CACHE_SHARD *ssl_session_cache_shard(const SSL_CTX *ctx,
+    const SSL_SESSION *s)
+{
+    uint32_t h = 2166136261U;
+    size_t i;
+
+    if (ctx->sess_num_shards == 1)
+        return ctx->sess_shards;
+
+    /* FNV-1a */
+    for (i = 0; i < s->session_id_length; i++) {
+        h ^= s->session_id[i];
+        h *= 16777619U;
+    }
+    return &ctx->sess_shards[h % ctx->sess_num_shards];
+}
+
 SSL_SESSION *lookup_sess_in_cache(SSL_CONNECTION *s,
     const unsigned char *sess_id,
     size_t sess_id_len)
@@ -506,6 +529,7 @@ SSL_SESSION *lookup_sess_in_cache(SSL_CONNECTION *s,
             & SSL_SESS_CACHE_NO_INTERNAL_LOOKUP)
         == 0) {
         SSL_SESSION data;
+        SSL_SESSION_CACHE_SHARD *shard;
 
         data.ssl_version = s->version;
         if (!ossl_assert(sess_id_len <= SSL_MAX_SSL_SESSION_ID_LENGTH))
@@ -514,19 +538,33 @@ SSL_SESSION *lookup_sess_in_cache(SSL_CONNECTION *s,
         memcpy(data.session_id, sess_id, sess_id_len);
         data.session_id_length = sess_id_len;
 
-        if (!CRYPTO_THREAD_read_lock(s->session_ctx->lock))
+        shard = ssl_session_cache_shard(s->session_ctx, &data);
+        if (!CRYPTO_THREAD_read_lock(shard->lock))
             return NULL;
-        ret = lh_SSL_SESSION_retrieve(s->session_ctx->sessions, &data);
+        ret = lh_SSL_SESSION_retrieve(shard->sessions, &data);
         if (ret != NULL) {
             /* don't allow other threads to steal it: */
             if (!SSL_SESSION_up_ref(ret)) {
-                CRYPTO_THREAD_unlock(s->session_ctx->lock);
+                CRYPTO_THREAD_unlock(shard->lock);
                 return NULL;
             }
         }
-        CRYPTO_THREAD_unlock(s->session_ctx->lock);
+        CRYPTO_THREAD_unlock(shard->lock);
         if (ret == NULL)
             ssl_tsan_counter(s->session_ctx, &s->session_ctx->stats.sess_miss);
+
+        /* The shared cache backs the internal cache for lookups */
+        if (ret == NULL && s->session_ctx->shared_sess_cache != NULL) {
+            ret = ssl_shared_sess_cache_get(s->session_ctx, sess_id,
+                sess_id_len);
+            if (ret != NULL) {
+                ssl_tsan_counter(s->session_ctx,
+                    &s->session_ctx->stats.sess_shared_hit);
+                if ((s->session_ctx->session_cache_mode & SSL_SESS_CACHE_NO_INTERNAL_STORE) == 0)
+                    (void)SSL_CTX_add_session(s->session_ctx, ret);
+                return ret;
+            }
+        }
     }
 
     if (ret == NULL && s->session_ctx->get_session_cb != NULL) {
@@ -764,6 +802,7 @@ int SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
 {
     int ret = 0;
     SSL_SESSION *s;
+    SSL_SESSION_CACHE_SHARD *shard = ssl_session_cache_shard(ctx, c);
 
     /*
      * add just 1 reference count for the SSL_CTX's session cache even though
@@ -776,20 +815,20 @@ int SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
      * if session c is in already in cache, we take back the increment later
      */
 
-    if (!CRYPTO_THREAD_write_lock(ctx->lock)) {
+    if (!CRYPTO_THREAD_write_lock(shard->lock)) {
         SSL_SESSION_free(c);
         return 0;
     }
-    s = lh_SSL_SESSION_insert(ctx->sessions, c);
+    s = lh_SSL_SESSION_insert(shard->sessions, c);
 
     /*
      * s != NULL iff we already had a session with the given PID. In this
      * case, s == c should hold (then we did not really modify
-     * ctx->sessions), or we're in trouble.
+     * shard->sessions), or we're in trouble.
      */
     if (s != NULL && s != c) {
         /* We *are* in trouble ... */
-        SSL_SESSION_list_remove(ctx, s);
+        SSL_SESSION_list_remove(shard, s);
         SSL_SESSION_free(s);
         /*
          * ... so pretend the other session did not exist in cache (we cannot
@@ -798,7 +837,7 @@ int SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
          * obtain the same session from an external cache)
          */
         s = NULL;
-    } else if (s == NULL && lh_SSL_SESSION_retrieve(ctx->sessions, c) == NULL) {
+    } else if (s == NULL && lh_SSL_SESSION_retrieve(shard->sessions, c) == NULL) {
         /* s == NULL can also mean OOM error in lh_SSL_SESSION_insert ... */
 
         /*
@@ -831,8 +870,17 @@ int SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
         ret = 1;
 
         if (SSL_CTX_sess_get_cache_size(ctx) > 0) {
-            while (SSL_CTX_sess_number(ctx) >= SSL_CTX_sess_get_cache_size(ctx)) {
-                SSL_SESSION *r = remove_session_locked(ctx, ctx->session_cache_tail);
+            /*
+             * Each shard holds its share of the cache size, so that eviction
+             * only ever needs the lock of the shard being added to.
+             */
+            unsigned long limit = (unsigned long)
+                ((SSL_CTX_sess_get_cache_size(ctx) + ctx->sess_num_shards - 1)
+                    / ctx->sess_num_shards);
+
+            while (lh_SSL_SESSION_num_items(shard->sessions) >= limit) {
+                SSL_SESSION *r = remove_session_locked(shard,
+                    timer_first(shard));
 
                 if (r == NULL)
                     break;
@@ -842,7 +890,7 @@ int SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
             }
         }
 
-        SSL_SESSION_list_add(ctx, c);
+        SSL_SESSION_list_add(shard, c);
     }
 
     if (s != NULL) {
@@ -854,7 +902,7 @@ int SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
         SSL_SESSION_free(s); /* s == c */
         ret = 0;
     }
-    CRYPTO_THREAD_unlock(ctx->lock);
+    CRYPTO_THREAD_unlock(shard->lock);
 
     while (evicted_head != NULL) {
         SSL_SESSION *next = evicted_head->next;
@@ -872,13 +920,18 @@ int SSL_CTX_add_session(SSL_CTX *ctx, SSL_SESSION *c)
 int SSL_CTX_remove_session(SSL_CTX *ctx, SSL_SESSION *c)
 {
     SSL_SESSION *r;
+    SSL_SESSION_CACHE_SHARD *shard;
 
     if (c == NULL || c->session_id_length == 0)
         return 0;
-    if (!CRYPTO_THREAD_write_lock(ctx->lock))
+    shard = ssl_session_cache_shard(ctx, c);
+    if (!CRYPTO_THREAD_write_lock(shard->lock))
         return 0;
-    r = remove_session_locked(ctx, c);
-    CRYPTO_THREAD_unlock(ctx->lock);
+    r = remove_session_locked(shard, c);
+    CRYPTO_THREAD_unlock(shard->lock);
+
+    if (ctx->shared_sess_cache != NULL)
+        ssl_shared_sess_cache_remove(ctx, c);
 
     /*
      * The callback is invoked even when the session is not in the internal
@@ -891,19 +944,20 @@ int SSL_CTX_remove_session(SSL_CTX *ctx, SSL_SESSION *c)
 }
 
 /*
- * Removes c from the session cache. Caller must hold ctx->lock.
- * Returns the removed session (caller must invoke remove_session_cb and
- * SSL_SESSION_free), or NULL if not found.
+ * Removes c from the session cache shard it hashes to. Caller must hold
+ * shard->lock. Returns the removed session (caller must invoke
+ * remove_session_cb and SSL_SESSION_free), or NULL if not found.
  */
-static SSL_SESSION *remove_session_locked(SSL_CTX *ctx, SSL_SESSION *c)
+static SSL_SESSION *remove_session_locked(SSL_SESSION_CACHE_SHARD *shard,
+    SSL_SESSION *c)
 {
     SSL_SESSION *r = NULL;
 
     if (c != NULL && c->session_id_length != 0) {
-        r = lh_SSL_SESSION_retrieve(ctx->sessions, c);
+        r = lh_SSL_SESSION_retrieve(shard->sessions, c);
         if (r != NULL) {
-            r = lh_SSL_SESSION_delete(ctx->sessions, r);
-            SSL_SESSION_list_remove(ctx, r);
+            r = lh_SSL_SESSION_delete(shard->sessions, r);
+            SSL_SESSION_list_remove(shard, r);
         }
         c->not_resumable = 1;
     }
@@ -1000,16 +1054,20 @@ int SSL_SESSION_set1_id(SSL_SESSION *s, const unsigned char *sid,
 long SSL_SESSION_set_timeout(SSL_SESSION *s, long t)
 {
     OSSL_TIME new_timeout = ossl_seconds2time(t);
+    SSL_SESSION_CACHE_SHARD *shard;
 
     if (s == NULL || t < 0)
         return 0;
-    if (s->owner != NULL) {
-        if (!CRYPTO_THREAD_write_lock(s->owner->lock))
+    shard = s->owner;
+    if (shard != NULL) {
+        if (!CRYPTO_THREAD_write_lock(shard->lock))
             return 0;
         s->timeout = new_timeout;
         ssl_session_calculate_timeout(s);
-        SSL_SESSION_list_add(s->owner, s);
-        CRYPTO_THREAD_unlock(s->owner->lock);
+        /* The session may have left the cache before we got the lock */
+        if (s->owner == shard)
+            SSL_SESSION_list_add(shard, s);
+        CRYPTO_THREAD_unlock(shard->lock);
     } else {
         s->timeout = new_timeout;
         ssl_session_calculate_timeout(s);
@@ -1041,16 +1099,20 @@ time_t SSL_SESSION_get_time_ex(const SSL_SESSION *s)
 time_t SSL_SESSION_set_time_ex(SSL_SESSION *s, time_t t)
 {
     OSSL_TIME new_time = ossl_time_from_time_t(t);
+    SSL_SESSION_CACHE_SHARD *shard;
 
     if (s == NULL)
         return 0;
-    if (s->owner != NULL) {
-        if (!CRYPTO_THREAD_write_lock(s->owner->lock))
+    shard = s->owner;
+    if (shard != NULL) {
+        if (!CRYPTO_THREAD_write_lock(shard->lock))
             return 0;
         s->time = new_time;
         ssl_session_calculate_timeout(s);
-        SSL_SESSION_list_add(s->owner, s);
-        CRYPTO_THREAD_unlock(s->owner->lock);
+        /* The session may have left the cache before we got the lock */
+        if (s->owner == shard)
+            SSL_SESSION_list_add(shard, s);
+        CRYPTO_THREAD_unlock(shard->lock);
     } else {
         s->time = new_time;
         ssl_session_calculate_timeout(s);
@@ -1270,43 +1332,41 @@ void SSL_CTX_flush_sessions(SSL_CTX *s, long t)
 }
 #endif
 
-void SSL_CTX_flush_sessions_ex(SSL_CTX *s, time_t t)
+/*
+ * Removes the sessions of |shard| that have timed out at |t|, or all of them
+ * if |t| is 0, and runs the remove callback on them. At most |*budget|
+ * sessions are handled, and the lock is only held while doing so.
+ * Returns 1 once there is nothing left to remove, 0 if the budget ran out and
+ * -1 on error.
+ */
+static int flush_shard(SSL_CTX *s, SSL_SESSION_CACHE_SHARD *shard, time_t t,
+    size_t *budget)
 {
     STACK_OF(SSL_SESSION) *sk;
     SSL_SESSION *current;
     unsigned long i;
-    const OSSL_TIME timeout = ossl_time_from_time_t(t);
+    int ret;
 
-    if (!CRYPTO_THREAD_write_lock(s->lock))
-        return;
-
-    sk = sk_SSL_SESSION_new_null();
-    i = lh_SSL_SESSION_get_down_load(s->sessions);
-    lh_SSL_SESSION_set_down_load(s->sessions, 0);
+    if (!CRYPTO_THREAD_write_lock(shard->lock))
+        return -1;
 
     /*
-     * Iterate over the list from the back (oldest), and stop
-     * when a session can no longer be removed.
      * Collect removed sessions on a stack to be processed outside the lock,
-     * so that remove_session_cb is never invoked while holding ctx->lock.
+     * so that remove_session_cb is never invoked while holding a shard lock.
      * If the stack failed to create, or a push fails, free the session
      * immediately (without invoking the callback).
      */
-    while (s->session_cache_tail != NULL) {
-        current = s->session_cache_tail;
-        if (t == 0 || sess_timedout(timeout, current)) {
-            lh_SSL_SESSION_delete(s->sessions, current);
-            SSL_SESSION_list_remove(s, current);
-            current->not_resumable = 1;
-            if (sk == NULL || !sk_SSL_SESSION_push(sk, current))
-                SSL_SESSION_free(current);
-        } else {
-            break;
-        }
-    }
+    sk = sk_SSL_SESSION_new_null();
+    i = lh_SSL_SESSION_get_down_load(shard->sessions);
+    lh_SSL_SESSION_set_down_load(shard->sessions, 0);
 
-    lh_SSL_SESSION_set_down_load(s->sessions, i);
-    CRYPTO_THREAD_unlock(s->lock);
+    if (t == 0)
+        ret = timer_drain(shard, sk, budget);
+    else
+        ret = timer_expire(shard, ossl_time_from_time_t(t), sk, budget);
+
+    lh_SSL_SESSION_set_down_load(shard->sessions, i);
+    CRYPTO_THREAD_unlock(shard->lock);
 
     while (sk_SSL_SESSION_num(sk) > 0) {
         current = sk_SSL_SESSION_pop(sk);
@@ -1315,6 +1375,88 @@ void SSL_CTX_flush_sessions_ex(SSL_CTX *s, time_t t)
         SSL_SESSION_free(current);
     }
     sk_SSL_SESSION_free(sk);
+    return ret;
+}
+
+void SSL_CTX_flush_sessions_ex(SSL_CTX *s, time_t t)
+{
+    size_t n, budget;
+    int ret;
+
+    for (n = 0; n < s->sess_num_shards; n++) {
+        do {
+            budget = SSL_SESS_FLUSH_BATCH;
+            ret = flush_shard(s, &s->sess_shards[n], t, &budget);
+        } while (ret == 0);
+    }
+}
+
+int SSL_CTX_flush_sessions_batch(SSL_CTX *s, time_t t, size_t max)
+{
+    size_t n, budget;
+    int ret;
+
+    for (n = 0; n < s->sess_num_shards; n++) {
+        do {
+            if (max == 0)
+                return 0;
+            budget = max < SSL_SESS_FLUSH_BATCH ? max : SSL_SESS_FLUSH_BATCH;
+            max -= budget;
+            ret = flush_shard(s, &s->sess_shards[n], t, &budget);
+            if (ret < 0)
+                return -1;
+            max += budget;
+        } while (ret == 0);
+    }
+    return 1;
+}
+
+/*
+ * Moves the sessions of all of the shards of the internal session cache into
+ * the first one, which then holds the whole cache, and stops sharding it.
+ * Sessions that cannot be moved are dropped from the cache without running
+ * the remove callback. Returns 1 if no session was dropped and 0 otherwise.
+ */
+int ssl_session_cache_unshard(SSL_CTX *ctx)
+{
+    SSL_SESSION_CACHE_SHARD *dst = ctx->sess_shards, *src;
+    SSL_SESSION *s;
+    size_t n, pos;
+    int ret = 1;
+
+    for (n = 1; n < ctx->sess_num_shards; n++) {
+        src = &ctx->sess_shards[n];
+        if (!CRYPTO_THREAD_write_lock(dst->lock))
+            return 0;
+        if (!CRYPTO_THREAD_write_lock(src->lock)) {
+            CRYPTO_THREAD_unlock(dst->lock);
+            return 0;
+        }
+        for (pos = 0; pos < OSSL_NELEM(src->timer_slots); pos++) {
+            while ((s = src->timer_slots[pos]) != NULL) {
+                lh_SSL_SESSION_delete(src->sessions, s);
+                SSL_SESSION_list_remove(src, s);
+                /* The shards never hold two sessions with the same ID */
+                lh_SSL_SESSION_insert(dst->sessions, s);
+                if (lh_SSL_SESSION_error(dst->sessions)) {
+                    s->not_resumable = 1;
+                    SSL_SESSION_free(s);
+                    ret = 0;
+                    continue;
+                }
+                SSL_SESSION_list_add(dst, s);
+            }
+        }
+        CRYPTO_THREAD_unlock(src->lock);
+        CRYPTO_THREAD_unlock(dst->lock);
+    }
+
+    for (n = 1; n < ctx->sess_num_shards; n++) {
+        lh_SSL_SESSION_free(ctx->sess_shards[n].sessions);
+        CRYPTO_THREAD_lock_free(ctx->sess_shards[n].lock);
+    }
+    ctx->sess_num_shards = 1;
+    return ret;
 }
 
 int ssl_clear_bad_session(SSL_CONNECTION *s)
@@ -1326,84 +1468,218 @@ int ssl_clear_bad_session(SSL_CONNECTION *s)
         return 0;
 }
 
-/* locked by SSL_CTX in the calling function */
-static void SSL_SESSION_list_remove(SSL_CTX *ctx, SSL_SESSION *s)
+/*
+ * Session expiry timer wheel. A session due at second |e| sits in the slot of
+ * the lowest level on which |e| is fewer than SSL_SESS_TIMER_SLOTS slots away
+ * from |timer_tick|, or in the slot of |timer_tick| on level 0 if it is due
+ * already. Advancing the wheel visits the slots that come due in turn,
+ * removes the sessions in them that have timed out and files the others
+ * again, now on a lower level. All of this is locked by the shard in the
+ * calling function.
+ */
+#define TIMER_SHIFT(lvl) ((lvl) * SSL_SESS_TIMER_BITS)
+#define TIMER_POS(lvl, sec) ((lvl) * SSL_SESS_TIMER_SLOTS \
+    + (size_t)(((sec) >> TIMER_SHIFT(lvl)) & (SSL_SESS_TIMER_SLOTS - 1)))
+
+static void timer_insert(SSL_SESSION_CACHE_SHARD *shard, SSL_SESSION *s,
+    uint64_t base)
 {
-    if ((s->next == NULL) || (s->prev == NULL))
-        return;
+    uint64_t due = ossl_time2seconds(s->calc_timeout);
+    size_t lvl, pos;
 
-    if (s->next == (SSL_SESSION *)&(ctx->session_cache_tail)) {
-        /* last element in list */
-        if (s->prev == (SSL_SESSION *)&(ctx->session_cache_head)) {
-            /* only one element in list */
-            ctx->session_cache_head = NULL;
-            ctx->session_cache_tail = NULL;
-        } else {
-            ctx->session_cache_tail = s->prev;
-            s->prev->next = (SSL_SESSION *)&(ctx->session_cache_tail);
-        }
+    if (due <= base) {
+        pos = TIMER_POS(0, base);
     } else {
-        if (s->prev == (SSL_SESSION *)&(ctx->session_cache_head)) {
-            /* first element in list */
-            ctx->session_cache_head = s->next;
-            s->next->prev = (SSL_SESSION *)&(ctx->session_cache_head);
-        } else {
-            /* middle of list */
-            s->next->prev = s->prev;
-            s->prev->next = s->next;
-        }
+        for (lvl = 0; lvl < SSL_SESS_TIMER_LEVELS - 1; lvl++)
+            if ((due >> TIMER_SHIFT(lvl)) - (base >> TIMER_SHIFT(lvl))
+                < SSL_SESS_TIMER_SLOTS)
+                break;
+        if ((due >> TIMER_SHIFT(lvl)) - (base >> TIMER_SHIFT(lvl))
+            >= SSL_SESS_TIMER_SLOTS)
+            due = ((base >> TIMER_SHIFT(lvl)) + SSL_SESS_TIMER_SLOTS - 1)
+                << TIMER_SHIFT(lvl);
+        pos = TIMER_POS(lvl, due);
     }
-    s->prev = s->next = NULL;
-    s->owner = NULL;
+
+    s->timer_pos = pos;
+    s->prev = NULL;
+    s->next = shard->timer_slots[pos];
+    if (s->next != NULL)
+        s->next->prev = s;
+    shard->timer_slots[pos] = s;
+    shard->timer_occupied[pos / SSL_SESS_TIMER_SLOTS]
+        |= (uint64_t)1 << (pos % SSL_SESS_TIMER_SLOTS);
+}
+
+/*
+ * Returns the first second after |timer_tick| at which a slot that is not
+ * empty comes due, or UINT64_MAX if the wheel is empty.
+ */
+static uint64_t timer_next(const SSL_SESSION_CACHE_SHARD *shard)
+{
+    uint64_t next = UINT64_MAX, occupied, granule, due;
+    size_t lvl, first, dist;
+
+    for (lvl = 0; lvl < SSL_SESS_TIMER_LEVELS; lvl++) {
+        occupied = shard->timer_occupied[lvl];
+        if (occupied == 0)
+            continue;
+        granule = (shard->timer_tick >> TIMER_SHIFT(lvl)) + 1;
+        /* Rotate the bitmap so that bit 0 is the slot of |granule| */
+        first = (size_t)(granule & (SSL_SESS_TIMER_SLOTS - 1));
+        if (first != 0)
+            occupied = (occupied >> first)
+                | (occupied << (SSL_SESS_TIMER_SLOTS - first));
+        for (dist = 0; (occupied & 1) == 0; dist++)
+            occupied >>= 1;
+        due = (granule + dist) << TIMER_SHIFT(lvl);
+        if (due < next)
+            next = due;
+    }
+    return next;
+}
+
+/* Returns a session that is among the first to expire, or NULL */
+static SSL_SESSION *timer_first(const SSL_SESSION_CACHE_SHARD *shard)
+{
+    uint64_t next;
+    size_t lvl;
+
+    if (shard->timer_slots[TIMER_POS(0, shard->timer_tick)] != NULL)
+        return shard->timer_slots[TIMER_POS(0, shard->timer_tick)];
+    if ((next = timer_next(shard)) == UINT64_MAX)
+        return NULL;
+    for (lvl = SSL_SESS_TIMER_LEVELS; lvl-- > 0;)
+        if ((next & (((uint64_t)1 << TIMER_SHIFT(lvl)) - 1)) == 0
+            && shard->timer_slots[TIMER_POS(lvl, next)] != NULL)
+            return shard->timer_slots[TIMER_POS(lvl, next)];
+    return NULL;
 }
 
-static void SSL_SESSION_list_add(SSL_CTX *ctx, SSL_SESSION *s)
+static void timer_expire_one(SSL_SESSION_CACHE_SHARD *shard, SSL_SESSION *s,
+    STACK_OF(SSL_SESSION) *sk)
 {
-    SSL_SESSION *next;
+    lh_SSL_SESSION_delete(shard->sessions, s);
+    SSL_SESSION_list_remove(shard, s);
+    s->not_resumable = 1;
+    if (sk == NULL || !sk_SSL_SESSION_push(sk, s))
+        SSL_SESSION_free(s);
+}
 
-    if ((s->next != NULL) && (s->prev != NULL))
-        SSL_SESSION_list_remove(ctx, s);
+/*
+ * Advances the wheel of |shard| to |t| and removes the sessions that have
+ * timed out, handling at most |*budget| of them. Returns 1 when done and 0 if
+ * the budget ran out first.
+ */
+static int timer_expire(SSL_SESSION_CACHE_SHARD *shard, OSSL_TIME t,
+    STACK_OF(SSL_SESSION) *sk, size_t *budget)
+{
+    uint64_t target = ossl_time2seconds(t), next;
+    SSL_SESSION *s, *n;
+    size_t lvl, pos;
 
-    if (ctx->session_cache_head == NULL) {
-        ctx->session_cache_head = s;
-        ctx->session_cache_tail = s;
-        s->prev = (SSL_SESSION *)&(ctx->session_cache_head);
-        s->next = (SSL_SESSION *)&(ctx->session_cache_tail);
-    } else {
-        if (timeoutcmp(s, ctx->session_cache_head) >= 0) {
-            /*
-             * if we timeout after (or the same time as) the first
-             * session, put us first - usual case
-             */
-            s->next = ctx->session_cache_head;
-            s->next->prev = s;
-            s->prev = (SSL_SESSION *)&(ctx->session_cache_head);
-            ctx->session_cache_head = s;
-        } else if (timeoutcmp(s, ctx->session_cache_tail) < 0) {
-            /* if we timeout before the last session, put us last */
-            s->prev = ctx->session_cache_tail;
-            s->prev->next = s;
-            s->next = (SSL_SESSION *)&(ctx->session_cache_tail);
-            ctx->session_cache_tail = s;
-        } else {
-            /*
-             * we timeout somewhere in-between - if there is only
-             * one session in the cache it will be caught above
-             */
-            next = ctx->session_cache_head->next;
-            while (next != (SSL_SESSION *)&(ctx->session_cache_tail)) {
-                if (timeoutcmp(s, next) >= 0) {
-                    s->next = next;
-                    s->prev = next->prev;
-                    next->prev->next = s;
-                    next->prev = s;
-                    break;
+    for (;;) {
+        /*
+         * Sessions due in the current second may or may not have timed out
+         * yet; only the ones that have are counted against the budget.
+         */
+        for (s = shard->timer_slots[TIMER_POS(0, shard->timer_tick)];
+            s != NULL; s = n) {
+            n = s->next;
+            if (!sess_timedout(t, s))
+                continue;
+            if (*budget == 0)
+                return 0;
+            --*budget;
+            timer_expire_one(shard, s, sk);
+        }
+
+        if ((next = timer_next(shard)) > target)
+            return 1;
+
+        /*
+         * Empty the higher level slots that come due at |next| first. Their
+         * sessions that are still valid end up on a lower level.
+         */
+        for (lvl = SSL_SESS_TIMER_LEVELS - 1; lvl > 0; lvl--) {
+            if ((next & (((uint64_t)1 << TIMER_SHIFT(lvl)) - 1)) != 0)
+                continue;
+            pos = TIMER_POS(lvl, next);
+            while ((s = shard->timer_slots[pos]) != NULL) {
+                if (*budget == 0)
+                    return 0;
+                --*budget;
+                if (sess_timedout(t, s)) {
+                    timer_expire_one(shard, s, sk);
+                } else {
+                    SSL_SESSION_list_remove(shard, s);
+                    timer_insert(shard, s, next);
+                    s->owner = shard;
                 }
-                next = next->next;
             }
         }
+        shard->timer_tick = next;
+    }
+}
+
+/* Removes up to |*budget| sessions, returns 1 if the wheel is empty after */
+static int timer_drain(SSL_SESSION_CACHE_SHARD *shard,
+    STACK_OF(SSL_SESSION) *sk, size_t *budget)
+{
+    SSL_SESSION *s;
+    size_t pos;
+
+    for (pos = 0; pos < OSSL_NELEM(shard->timer_slots); pos++) {
+        while ((s = shard->timer_slots[pos]) != NULL) {
+            if (*budget == 0)
+                return 0;
+            --*budget;
+            timer_expire_one(shard, s, sk);
+        }
     }
-    s->owner = ctx;
+    return 1;
+}
+
+static void SSL_SESSION_list_remove(SSL_SESSION_CACHE_SHARD *shard,
+    SSL_SESSION *s)
+{
+    size_t pos = s->timer_pos;
+
+    if (s->owner == NULL)
+        return;
+
+    if (s->next != NULL)
+        s->next->prev = s->prev;
+    if (s->prev == NULL) {
+        /* first element in its slot */
+        shard->timer_slots[pos] = s->next;
+        if (s->next == NULL)
+            shard->timer_occupied[pos / SSL_SESS_TIMER_SLOTS]
+                &= ~((uint64_t)1 << (pos % SSL_SESS_TIMER_SLOTS));
+    } else {
+        s->prev->next = s->next;
+    }
+    s->prev = s->next = NULL;
+    s->owner = NULL;
+}
+
+static void SSL_SESSION_list_add(SSL_SESSION_CACHE_SHARD *shard,
+    SSL_SESSION *s)
+{
+    size_t lvl;
+
+    if (s->owner != NULL)
+        SSL_SESSION_list_remove(shard, s);
+
+    /* An empty wheel can be moved to the present at no cost */
+    for (lvl = 0; lvl < SSL_SESS_TIMER_LEVELS; lvl++)
+        if (shard->timer_occupied[lvl] != 0)
+            break;
+    if (lvl == SSL_SESS_TIMER_LEVELS)
+        shard->timer_tick = ossl_time2seconds(ossl_time_now());
+
+    timer_insert(shard, s, shard->timer_tick);
+    s->owner = shard;
 }
 
 void SSL_CTX_sess_set_new_cb(SSL_CTX *ctx,
@@ -0,0 +1,523 @@
+/*
+ * Copyright 2026 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <errno.h>
+#include <time.h>
+#include <openssl/err.h>
+#include "ssl_local.h"
+
+/*
+ * Shared session cache
+ * ====================
+ *
+ * A server session cache that the processes of a multi-process server share,
+ * so that a session created by one worker can be resumed by any other. The
+ * sessions are stored in their i2d_SSL_SESSION() encoding in a table of fixed
+ * size slots in a shared memory mapping, either anonymous and inherited over
+ * fork() or backed by a file that unrelated processes map.
+ *
+ * No lock is shared between the processes. Each slot is a sequence lock: a
+ * writer makes |seq| odd while it changes the slot and readers discard what
+ * they copied if |seq| changed meanwhile. Writers exclude each other with the
+ * |writers| count, a writer that finds the slot busy does not store its
+ * session, the cache is allowed to lose entries.
+ *
+ * A process may die while it holds a slot, leaving |seq| odd or |writers| set
+ * for good. A writer holds a slot for microseconds and changes |seq| as it
+ * takes and releases it, so a writer that finds the slot busy notes in
+ * |busy_since| when it first saw the current |seq| there. A writer that finds
+ * the slot still busy with that |seq| more than SHARED_SESS_STALE seconds
+ * later takes the slot over; |takeovers| makes sure only one of them does.
+ *
+ * Every word of a slot is read and written with the CRYPTO_atomic_*()
+ * functions, whose loads acquire and whose stores release, so a reader's
+ * second load of |seq| cannot be ordered before its copy of the slot and a
+ * writer's stores cannot become visible before |seq| is made odd.
+ *
+ * A session id hashes to SHARED_SESS_PROBES consecutive slots. A new session
+ * goes to the slot that already holds its id, or else an empty or expired
+ * slot, or else the slot that expires first.
+ */
+
+#if defined(OPENSSL_SYS_UNIX)
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if !defined(MAP_ANON) && defined(MAP_ANONYMOUS)
+#define MAP_ANON MAP_ANONYMOUS
+#endif
+
+#define SHARED_SESS_MAGIC 0x4f53534c53455353ULL /* "OSSLSESS" */
+#define SHARED_SESS_VERSION 3
+#define SHARED_SESS_PROBES 4
+#define SHARED_SESS_STALE 10
+#define SHARED_SESS_MAX_SLOTS (1 << 20)
+#define SHARED_SESS_DATA_SIZE 1984
+#define SHARED_SESS_WORDS(n) (((n) + sizeof(uint64_t) - 1) / sizeof(uint64_t))
+#define SHARED_SESS_ID_WORDS SHARED_SESS_WORDS(SSL_MAX_SSL_SESSION_ID_LENGTH)
+#define SHARED_SESS_DATA_WORDS SHARED_SESS_WORDS(SHARED_SESS_DATA_SIZE)
+
+typedef struct {
+    uint64_t magic;
+    uint64_t version;
+    uint64_t slot_size;
+    uint64_t num_slots;
+    unsigned char reserved[32];
+} SHARED_SESS_HEADER;
+
+typedef struct {
+    /* Odd while the slot is being written */
+    uint64_t seq;
+    /* Number of writers trying to get the slot, only the first one gets it */
+    uint64_t writers;
+    /*
+     * When a writer found the slot busy, in seconds since the epoch in the
+     * upper half, and the lower half of |seq| at that time in the lower half
+     */
+    uint64_t busy_since;
+    /* Number of times the slot was taken over from a writer that died */
+    uint64_t takeovers;
+    /* Seconds since the epoch, 0 if the slot is empty */
+    uint64_t expires;
+    uint64_t len;
+    uint64_t id_len;
+    uint64_t id[SHARED_SESS_ID_WORDS];
+    uint64_t data[SHARED_SESS_DATA_WORDS];
+} SHARED_SESS_SLOT;
+
+struct ssl_shared_sess_cache_st {
+    void *map;
+    size_t map_size;
+    SHARED_SESS_SLOT *slots;
+    size_t num_slots;
+};
+
+static size_t shared_sess_hash(const SSL_SHARED_SESS_CACHE *cache,
+    const unsigned char *id, size_t id_len)
+{
+    uint32_t h = 2166136261U;
+    size_t i;
+
+    for (i = 0; i < id_len; i++) {
+        h ^= id[i];
+        h *= 16777619U;
+    }
+    return h % cache->num_slots;
+}
+
+static SHARED_SESS_SLOT *shared_sess_slot(const SSL_SHARED_SESS_CACHE *cache,
+    size_t first, size_t probe)
+{
+    return &cache->slots[(first + probe) % cache->num_slots];
+}
+
+static uint64_t shared_sess_busy_mark(uint64_t now, uint64_t seq)
+{
+    return (now & 0xffffffff) << 32 | (seq & 0xffffffff);
+}
+
+/*
+ * Called by a writer that found |slot| busy. Returns 1 if the writer holding
+ * the slot has not changed it for too long and the caller took it over, which
+ * leaves |seq| odd and the caller's count in |writers|.
+ */
+static int shared_sess_take_over(SHARED_SESS_SLOT *slot)
+{
+    uint64_t now = (uint64_t)time(NULL), gen, seq, busy, n;
+
+    if (!CRYPTO_atomic_load(&slot->takeovers, &gen, NULL)
+        || !CRYPTO_atomic_load(&slot->seq, &seq, NULL)
+        || !CRYPTO_atomic_load(&slot->busy_since, &busy, NULL))
+        return 0;
+
+    if ((busy & 0xffffffff) != (seq & 0xffffffff)) {
+        (void)CRYPTO_atomic_store(&slot->busy_since,
+            shared_sess_busy_mark(now, seq), NULL);
+        return 0;
+    }
+    if ((uint32_t)(now - (busy >> 32)) <= SHARED_SESS_STALE)
+        return 0;
+
+    /*
+     * Whoever else loads |takeovers| after our increment sees the slot as
+     * recently busy, whoever loaded it before gets a different count.
+     */
+    (void)CRYPTO_atomic_store(&slot->busy_since,
+        shared_sess_busy_mark(now, seq), NULL);
+    if (!CRYPTO_atomic_add64(&slot->takeovers, 1, &n, NULL) || n != gen + 1)
+        return 0;
+
+    /* Our count replaces the one the dead writer left */
+    (void)CRYPTO_atomic_add64(&slot->writers, (uint64_t)-1, &n, NULL);
+    if ((seq & 1) == 0)
+        (void)CRYPTO_atomic_add64(&slot->seq, 1, &n, NULL);
+    return 1;
+}
+
+static int shared_sess_claim(SHARED_SESS_SLOT *slot)
+{
+    uint64_t n;
+
+    if (!CRYPTO_atomic_add64(&slot->writers, 1, &n, NULL))
+        return 0;
+    if (n == 1 ? CRYPTO_atomic_add64(&slot->seq, 1, &n, NULL)
+               : shared_sess_take_over(slot))
+        return 1;
+    (void)CRYPTO_atomic_add64(&slot->writers, (uint64_t)-1, &n, NULL);
+    return 0;
+}
+
+static void shared_sess_release(SHARED_SESS_SLOT *slot)
+{
+    uint64_t n;
+
+    (void)CRYPTO_atomic_add64(&slot->seq, 1, &n, NULL);
+    (void)CRYPTO_atomic_add64(&slot->writers, (uint64_t)-1, &n, NULL);
+}
+
+static int shared_sess_load(uint64_t *dst, uint64_t *src, size_t words)
+{
+    size_t i;
+
+    for (i = 0; i < words; i++)
+        if (!CRYPTO_atomic_load(&src[i], &dst[i], NULL))
+            return 0;
+    return 1;
+}
+
+static void shared_sess_store(uint64_t *dst, const uint64_t *src,
+    size_t words)
+{
+    size_t i;
+
+    for (i = 0; i < words; i++)
+        (void)CRYPTO_atomic_store(&dst[i], src[i], NULL);
+}
+
+static int shared_sess_id_eq(SHARED_SESS_SLOT *slot,
+    const unsigned char *id, size_t id_len)
+{
+    uint64_t slot_id[SHARED_SESS_ID_WORDS], slot_id_len;
+
+    return CRYPTO_atomic_load(&slot->id_len, &slot_id_len, NULL)
+        && slot_id_len == id_len
+        && shared_sess_load(slot_id, slot->id, SHARED_SESS_WORDS(id_len))
+        && memcmp(slot_id, id, id_len) == 0;
+}
+
+void ssl_shared_sess_cache_free(SSL_SHARED_SESS_CACHE *cache)
+{
+    if (cache == NULL)
+        return;
+    munmap(cache->map, cache->map_size);
+    OPENSSL_free(cache);
+}
+
+void ssl_shared_sess_cache_add(SSL_CTX *ctx, SSL_SESSION *sess)
+{
+    SSL_SHARED_SESS_CACHE *cache = ctx->shared_sess_cache;
+    SHARED_SESS_SLOT *slot, *victim = NULL;
+    uint64_t id[SHARED_SESS_ID_WORDS] = { 0 };
+    uint64_t buf[SHARED_SESS_DATA_WORDS];
+    unsigned char *p = (unsigned char *)buf;
+    uint64_t now = (uint64_t)time(NULL), expires, victim_expires = 0;
+    size_t first, i;
+    int len;
+
+    if (sess->session_id_length == 0 || sess->not_resumable)
+        return;
+
+    /* Sessions that do not fit in a slot, e.g. with a large peer certificate */
+    len = i2d_SSL_SESSION(sess, NULL);
+    if (len <= 0 || len > (int)sizeof(buf))
+        return;
+    buf[SHARED_SESS_WORDS(len) - 1] = 0;
+    if (i2d_SSL_SESSION(sess, &p) != len)
+        return;
+
+    first = shared_sess_hash(cache, sess->session_id, sess->session_id_length);
+    for (i = 0; i < SHARED_SESS_PROBES; i++) {
+        slot = shared_sess_slot(cache, first, i);
+        if (!CRYPTO_atomic_load(&slot->expires, &expires, NULL))
+            return;
+        /* Unclaimed peek, the slot is only changed once it is claimed */
+        if (expires <= now
+            || shared_sess_id_eq(slot, sess->session_id,
+                sess->session_id_length)) {
+            victim = slot;
+            break;
+        }
+        if (victim == NULL || expires < victim_expires) {
+            victim = slot;
+            victim_expires = expires;
+        }
+    }
+
+    if (!shared_sess_claim(victim))
+        return;
+    memcpy(id, sess->session_id, sess->session_id_length);
+    (void)CRYPTO_atomic_store(&victim->expires,
+        (uint64_t)ossl_time2seconds(sess->calc_timeout), NULL);
+    (void)CRYPTO_atomic_store(&victim->id_len, sess->session_id_length, NULL);
+    shared_sess_store(victim->id, id, SHARED_SESS_ID_WORDS);
+    (void)CRYPTO_atomic_store(&victim->len, (uint64_t)len, NULL);
+    shared_sess_store(victim->data, buf, SHARED_SESS_WORDS(len));
+    shared_sess_release(victim);
+}
+
+SSL_SESSION *ssl_shared_sess_cache_get(SSL_CTX *ctx, const unsigned char *id,
+    size_t id_len)
+{
+    SSL_SHARED_SESS_CACHE *cache = ctx->shared_sess_cache;
+    SHARED_SESS_SLOT *slot;
+    uint64_t buf[SHARED_SESS_DATA_WORDS];
+    const unsigned char *p;
+    uint64_t seq1, seq2, expires, len, now = (uint64_t)time(NULL);
+    size_t first, i;
+
+    first = shared_sess_hash(cache, id, id_len);
+    for (i = 0; i < SHARED_SESS_PROBES; i++) {
+        slot = shared_sess_slot(cache, first, i);
+        if (!CRYPTO_atomic_load(&slot->seq, &seq1, NULL) || (seq1 & 1) != 0)
+            continue;
+
+        if (!shared_sess_id_eq(slot, id, id_len)
+            || !CRYPTO_atomic_load(&slot->expires, &expires, NULL)
+            || !CRYPTO_atomic_load(&slot->len, &len, NULL)
+            || len > sizeof(buf)
+            || !shared_sess_load(buf, slot->data, SHARED_SESS_WORDS(len))
+            || !CRYPTO_atomic_load(&slot->seq, &seq2, NULL)
+            || seq1 != seq2)
+            continue;
+
+        if (expires <= now)
+            return NULL;
+        p = (unsigned char *)buf;
+        return d2i_SSL_SESSION_ex(NULL, &p, (long)len, ctx->libctx,
+            ctx->propq);
+    }
+    return NULL;
+}
+
+void ssl_shared_sess_cache_remove(SSL_CTX *ctx, const SSL_SESSION *sess)
+{
+    SSL_SHARED_SESS_CACHE *cache = ctx->shared_sess_cache;
+    SHARED_SESS_SLOT *slot;
+    size_t first, i;
+
+    first = shared_sess_hash(cache, sess->session_id, sess->session_id_length);
+    for (i = 0; i < SHARED_SESS_PROBES; i++) {
+        slot = shared_sess_slot(cache, first, i);
+        if (!shared_sess_id_eq(slot, sess->session_id,
+                sess->session_id_length)
+            || !shared_sess_claim(slot))
+            continue;
+        /* The slot may have been reused before it was claimed */
+        if (shared_sess_id_eq(slot, sess->session_id,
+                sess->session_id_length)) {
+            (void)CRYPTO_atomic_store(&slot->expires, 0, NULL);
+            (void)CRYPTO_atomic_store(&slot->id_len, 0, NULL);
+        }
+        shared_sess_release(slot);
+    }
+}
+
+/*
+ * For testing: leaves the slots that |sess| may be stored in as if a writer had
+ * died while holding them and another writer had found them busy at |since|.
+ */
+void ssl_shared_sess_cache_debug_abandon(SSL_CTX *ctx,
+    const SSL_SESSION *sess, time_t since)
+{
+    SSL_SHARED_SESS_CACHE *cache = ctx->shared_sess_cache;
+    SHARED_SESS_SLOT *slot;
+    uint64_t writers, seq;
+    size_t first, i;
+
+    first = shared_sess_hash(cache, sess->session_id, sess->session_id_length);
+    for (i = 0; i < SHARED_SESS_PROBES; i++) {
+        slot = shared_sess_slot(cache, first, i);
+        if (!CRYPTO_atomic_load(&slot->writers, &writers, NULL)
+            || (writers == 0 && !shared_sess_claim(slot))
+            || !CRYPTO_atomic_load(&slot->seq, &seq, NULL))
+            continue;
+        (void)CRYPTO_atomic_store(&slot->busy_since,
+            shared_sess_busy_mark((uint64_t)since, seq), NULL);
+    }
+}
+
+static SSL_SHARED_SESS_CACHE *shared_sess_cache_new(const char *path,
+    size_t num_slots)
+{
+    SSL_SHARED_SESS_CACHE *cache;
+    SHARED_SESS_HEADER *hdr;
+    size_t map_size = sizeof(*hdr) + num_slots * sizeof(SHARED_SESS_SLOT);
+    struct stat st;
+    uint64_t magic, version, slot_size, slots;
+    int fd = -1;
+
+    if ((cache = OPENSSL_zalloc(sizeof(*cache))) == NULL)
+        return NULL;
+    cache->map = MAP_FAILED;
+
+    if (path == NULL) {
+#ifdef MAP_ANON
+        cache->map = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANON, -1, 0);
+#endif
+    } else {
+        /*
+         * The sessions hold master secrets, so the file must be private to
+         * this user: a file or symbolic link planted by someone else at
+         * |path| is refused rather than used
+         */
+        fd = open(path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            ERR_raise_data(ERR_LIB_SYS, errno, "calling open(%s)", path);
+            goto err;
+        }
+        if (!S_ISREG(st.st_mode) || st.st_uid != geteuid()
+            || (st.st_mode & (S_IRWXG | S_IRWXO)) != 0) {
+            ERR_raise_data(ERR_LIB_SSL, ERR_R_PASSED_INVALID_ARGUMENT,
+                "%s is not a regular file accessible only by its owner",
+                path);
+            goto err;
+        }
+        /* Whoever creates the file sizes it, the mapping starts zeroed */
+        if (st.st_size == 0 && ftruncate(fd, (off_t)map_size) != 0) {
+            ERR_raise_data(ERR_LIB_SYS, errno, "calling ftruncate(%s)", path);
+            goto err;
+        }
+        if (st.st_size != 0 && (size_t)st.st_size != map_size) {
+            ERR_raise_data(ERR_LIB_SSL, ERR_R_PASSED_INVALID_ARGUMENT,
+                "%s holds a cache with a different number of slots", path);
+            goto err;
+        }
+        cache->map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+            fd, 0);
+        close(fd);
+        fd = -1;
+    }
+    if (cache->map == MAP_FAILED) {
+        ERR_raise_data(ERR_LIB_SYS, errno, "calling mmap()");
+        goto err;
+    }
+    cache->map_size = map_size;
+    cache->slots = (SHARED_SESS_SLOT *)((unsigned char *)cache->map
+        + sizeof(*hdr));
+    cache->num_slots = num_slots;
+
+    /*
+     * Processes that map a new file at the same time all write the same
+     * header. The magic is stored last, so a process that sees it also sees
+     * the rest of the header.
+     */
+    hdr = cache->map;
+    if (!CRYPTO_atomic_load(&hdr->magic, &magic, NULL))
+        goto err;
+    if (magic == 0) {
+        (void)CRYPTO_atomic_store(&hdr->version, SHARED_SESS_VERSION, NULL);
+        (void)CRYPTO_atomic_store(&hdr->slot_size, sizeof(SHARED_SESS_SLOT),
+            NULL);
+        (void)CRYPTO_atomic_store(&hdr->num_slots, num_slots, NULL);
+        (void)CRYPTO_atomic_store(&hdr->magic, SHARED_SESS_MAGIC, NULL);
+    }
+    if (!CRYPTO_atomic_load(&hdr->magic, &magic, NULL)
+        || !CRYPTO_atomic_load(&hdr->version, &version, NULL)
+        || !CRYPTO_atomic_load(&hdr->slot_size, &slot_size, NULL)
+        || !CRYPTO_atomic_load(&hdr->num_slots, &slots, NULL)
+        || magic != SHARED_SESS_MAGIC
+        || version != SHARED_SESS_VERSION
+        || slot_size != sizeof(SHARED_SESS_SLOT)
+        || slots != num_slots) {
+        ERR_raise_data(ERR_LIB_SSL, ERR_R_PASSED_INVALID_ARGUMENT,
+            "%s does not hold a compatible session cache",
+            path != NULL ? path : "the mapping");
+        goto err;
+    }
+    return cache;
+
+err:
+    if (fd >= 0)
+        close(fd);
+    if (cache->map != MAP_FAILED)
+        munmap(cache->map, map_size);
+    OPENSSL_free(cache);
+    return NULL;
+}
+
+int SSL_CTX_sess_set_shared_cache(SSL_CTX *ctx, const char *path,
+    size_t num_slots)
+{
+    SSL_SHARED_SESS_CACHE *cache = NULL;
+    uint64_t v = 0, r;
+
+    if (num_slots > SHARED_SESS_MAX_SLOTS
+        || (num_slots > 0 && num_slots < SHARED_SESS_PROBES)) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_PASSED_INVALID_ARGUMENT);
+        return 0;
+    }
+
+    if (num_slots > 0) {
+        /* The slots are only safe to share with lock-free atomics */
+        if (!CRYPTO_atomic_add64(&v, 1, &r, NULL)) {
+            ERR_raise(ERR_LIB_SSL, ERR_R_UNSUPPORTED);
+            return 0;
+        }
+        if ((cache = shared_sess_cache_new(path, num_slots)) == NULL) {
+            ERR_raise(ERR_LIB_SSL, ERR_R_INIT_FAIL);
+            return 0;
+        }
+    }
+
+    ssl_shared_sess_cache_free(ctx->shared_sess_cache);
+    ctx->shared_sess_cache = cache;
+    return 1;
+}
+
+#else
+
+void ssl_shared_sess_cache_free(SSL_SHARED_SESS_CACHE *cache)
+{
+}
+
+void ssl_shared_sess_cache_add(SSL_CTX *ctx, SSL_SESSION *sess)
+{
+}
+
+SSL_SESSION *ssl_shared_sess_cache_get(SSL_CTX *ctx, const unsigned char *id,
+    size_t id_len)
+{
+    return NULL;
+}
+
+void ssl_shared_sess_cache_remove(SSL_CTX *ctx, const SSL_SESSION *sess)
+{
+}
+
+void ssl_shared_sess_cache_debug_abandon(SSL_CTX *ctx,
+    const SSL_SESSION *sess, time_t since)
+{
+}
+
+int SSL_CTX_sess_set_shared_cache(SSL_CTX *ctx, const char *path,
+    size_t num_slots)
+{
+    if (num_slots == 0)
+        return 1;
+
+    /* There is no shared memory mapping */
+    ERR_raise(ERR_LIB_SSL, ERR_R_UNSUPPORTED);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,379 @@
+/*
+ * Copyright 2026 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/rsa.h>
+#include "ssl_local.h"
+#include "internal/ssl_unwrap.h"
+
+/*
+ * CertificateVerify batching
+ * ==========================
+ *
+ * A TLSv1.3 server with many handshakes in flight makes many signatures with
+ * the same key. When batching is enabled on the SSL_CTX, the signature of the
+ * CertificateVerify message is not made right away: the digest to be signed
+ * is queued on the SSL_CTX and the handshake returns
+ * SSL_ERROR_WANT_PRIVATE_KEY_OPERATION, as with a private key sign callback
+ * that asked to retry. Once the queue is full, or when the application calls
+ * SSL_CTX_flush_cert_verify_batch(), all queued digests are signed with
+ * EVP_PKEY_sign_batch(), which lets the provider share work between them.
+ * So that a handshake is not left waiting for a batch that does not fill,
+ * the batch is also signed by the next handshake that queues a signature or
+ * retries once the oldest queued signature has waited for longer than the
+ * timeout of the SSL_CTX.
+ * The signatures are handed to the connections through the same fields that
+ * SSL_set1_private_key_signature() uses.
+ *
+ * The queue and the signature state of the queued connections are protected
+ * by the lock of the batch. The lock is held while signing, so a connection
+ * cannot be freed while its signature is being made.
+ */
+
+#define SSL_SIGN_BATCH_MAX 256
+
+typedef struct {
+    SSL_CONNECTION *s;
+    EVP_PKEY *pkey;
+    const EVP_MD *md;
+    /* EVP_PKEY_RSA_PSS or EVP_PKEY_EC */
+    int sig;
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    size_t digestlen;
+} SSL_SIGN_BATCH_ENTRY;
+
+struct ssl_sign_batch_st {
+    CRYPTO_RWLOCK *lock;
+    size_t max;
+    size_t num;
+    /* When the first of the queued signatures was queued */
+    OSSL_TIME oldest;
+    SSL_SIGN_BATCH_ENTRY *entries;
+};
+
+void ssl_sign_batch_free(SSL_SIGN_BATCH *b)
+{
+    if (b == NULL)
+        return;
+
+    CRYPTO_THREAD_lock_free(b->lock);
+    OPENSSL_free(b->entries);
+    OPENSSL_free(b);
+}
+
+/*
+ * Sign the queued entries from |first| on that use the same key and
+ * signature algorithm as |first|. Must be called with the lock held.
+ */
+static size_t sign_batch_sign_group(SSL_CTX *ctx, SSL_SIGN_BATCH *b,
+    size_t first, size_t *idx, unsigned char **sigs, size_t *siglens,
+    const unsigned char **tbs, size_t *tbslens)
+{
+    SSL_SIGN_BATCH_ENTRY *e = &b->entries[first];
+    EVP_PKEY *pkey = e->pkey;
+    EVP_PKEY_CTX *pctx = NULL;
+    int sigsize = EVP_PKEY_get_size(pkey);
+    size_t i, n = 0;
+    int ok = sigsize > 0;
+
+    for (i = first; i < b->num; i++) {
+        SSL_SIGN_BATCH_ENTRY *f = &b->entries[i];
+
+        if (f->s == NULL || f->pkey != pkey || f->md != e->md
+            || f->sig != e->sig)
+            continue;
+        idx[n] = i;
+        tbs[n] = f->digest;
+        tbslens[n] = f->digestlen;
+        siglens[n] = (size_t)sigsize;
+        if (ok && (sigs[n] = OPENSSL_malloc(sigsize)) == NULL)
+            ok = 0;
+        n++;
+    }
+
+    if (ok) {
+        pctx = EVP_PKEY_CTX_new_from_pkey(ctx->libctx, pkey, ctx->propq);
+        ok = pctx != NULL
+            && EVP_PKEY_sign_init(pctx) > 0
+            && EVP_PKEY_CTX_set_signature_md(pctx, e->md) > 0;
+        if (ok && e->sig == EVP_PKEY_RSA_PSS)
+            ok = EVP_PKEY_CTX_set_rsa_padding(pctx, RSA_PKCS1_PSS_PADDING) > 0
+                && EVP_PKEY_CTX_set_rsa_pss_saltlen(pctx,
+                       RSA_PSS_SALTLEN_DIGEST)
+                    > 0;
+        ok = ok && EVP_PKEY_sign_batch(pctx, n, sigs, siglens, tbs, tbslens) > 0;
+        EVP_PKEY_CTX_free(pctx);
+    }
+
+    /* A connection without a signature fails when it continues */
+    for (i = 0; i < n; i++) {
+        SSL_SIGN_BATCH_ENTRY *f = &b->entries[idx[i]];
+
+        if (ok) {
+            f->s->pkey_sig = sigs[i];
+            f->s->pkey_siglen = siglens[i];
+        } else {
+            OPENSSL_free(sigs[i]);
+        }
+        sigs[i] = NULL;
+        f->s->pkey_sign_state = SSL_PKEY_SIGN_DONE;
+        f->s = NULL;
+        EVP_PKEY_free(f->pkey);
+        f->pkey = NULL;
+    }
+    return n;
+}
+
+/* Sign everything in the queue. Must be called with the lock held. */
+static size_t sign_batch_flush_locked(SSL_CTX *ctx, SSL_SIGN_BATCH *b)
+{
+    size_t *idx, *siglens, *tbslens, i, done = 0;
+    unsigned char **sigs;
+    const unsigned char **tbs;
+
+    if (b->num == 0)
+        return 0;
+
+    idx = OPENSSL_malloc_array(b->num, sizeof(*idx));
+    siglens = OPENSSL_malloc_array(b->num, sizeof(*siglens));
+    tbslens = OPENSSL_malloc_array(b->num, sizeof(*tbslens));
+    sigs = OPENSSL_calloc(b->num, sizeof(*sigs));
+    tbs = OPENSSL_malloc_array(b->num, sizeof(*tbs));
+
+    /* Errors are reported by the connections, not by whoever flushed */
+    ERR_set_mark();
+    for (i = 0; i < b->num; i++) {
+        SSL_SIGN_BATCH_ENTRY *e = &b->entries[i];
+
+        if (e->s == NULL)
+            continue;
+        if (idx == NULL || siglens == NULL || tbslens == NULL || sigs == NULL
+            || tbs == NULL) {
+            e->s->pkey_sign_state = SSL_PKEY_SIGN_DONE;
+            e->s = NULL;
+            EVP_PKEY_free(e->pkey);
+            e->pkey = NULL;
+            done++;
+            continue;
+        }
+        done += sign_batch_sign_group(ctx, b, i, idx, sigs, siglens, tbs,
+            tbslens);
+    }
+    ERR_pop_to_mark();
+    b->num = 0;
+
+    OPENSSL_free(idx);
+    OPENSSL_free(siglens);
+    OPENSSL_free(tbslens);
+    OPENSSL_free(sigs);
+    OPENSSL_free(tbs);
+    return done;
+}
+
+/*
+ * Whether the queued signatures have waited long enough to be made without
+ * waiting for the batch to fill. Must be called with the lock held.
+ */
+static int sign_batch_due(const SSL_CTX *ctx, const SSL_SIGN_BATCH *b)
+{
+    return b->num > 0
+        && ossl_time_compare(ossl_time_subtract(ossl_time_now(), b->oldest),
+               ctx->sign_batch_timeout)
+        >= 0;
+}
+
+/*
+ * Whether the CertificateVerify signature of |s| with |lu| is made as part
+ * of a batch
+ */
+int ssl_sign_batch_applies(SSL_CONNECTION *s, const SIGALG_LOOKUP *lu)
+{
+    return s->server && SSL_CONNECTION_IS_TLS13(s)
+        && SSL_CONNECTION_GET_CTX(s)->sign_batch != NULL
+        && (lu->sig == EVP_PKEY_RSA_PSS || lu->sig == EVP_PKEY_EC)
+        && lu->hash != NID_undef;
+}
+
+/*
+ * Queue the signature of |tbs| with |pkey| for |s|. Returns 1 when the
+ * signature is pending, 2 when the queue was full or had waited for too long
+ * and the signature has been made already, and 0 on error.
+ */
+int ssl_sign_batch_add(SSL_CONNECTION *s, const SIGALG_LOOKUP *lu,
+    EVP_PKEY *pkey, const unsigned char *tbs, size_t tbslen)
+{
+    SSL_CTX *sctx = SSL_CONNECTION_GET_CTX(s);
+    SSL_SIGN_BATCH *b = sctx->sign_batch;
+    SSL_SIGN_BATCH_ENTRY *e;
+    const EVP_MD *md;
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digestlen;
+    int ret = 1;
+
+    if (!tls1_lookup_md(sctx, lu, &md) || md == NULL
+        || !EVP_Digest(tbs, tbslen, digest, &digestlen, md, NULL))
+        return 0;
+
+    if (!EVP_PKEY_up_ref(pkey))
+        return 0;
+    if (!SSL_CTX_up_ref(sctx)) {
+        EVP_PKEY_free(pkey);
+        return 0;
+    }
+
+    if (!CRYPTO_THREAD_write_lock(b->lock)) {
+        EVP_PKEY_free(pkey);
+        SSL_CTX_free(sctx);
+        return 0;
+    }
+    if (b->num == 0)
+        b->oldest = ossl_time_now();
+    e = &b->entries[b->num++];
+    e->s = s;
+    e->pkey = pkey;
+    e->md = md;
+    e->sig = lu->sig;
+    memcpy(e->digest, digest, digestlen);
+    e->digestlen = digestlen;
+    s->pkey_sign_state = SSL_PKEY_SIGN_PENDING;
+    s->pkey_sign_batch_ctx = sctx;
+
+    if (b->num == b->max || sign_batch_due(sctx, b)) {
+        sign_batch_flush_locked(sctx, b);
+        s->pkey_sign_batch_ctx = NULL;
+        ret = 2;
+    }
+    CRYPTO_THREAD_unlock(b->lock);
+
+    if (ret == 2)
+        SSL_CTX_free(sctx);
+    return ret;
+}
+
+/*
+ * Check whether the queued signature of |s| has been made, making the
+ * queued signatures if they have waited for too long. Returns 1 once it is
+ * available through s->pkey_sig, or has failed, and 0 while it is pending.
+ */
+int ssl_sign_batch_poll(SSL_CONNECTION *s)
+{
+    SSL_CTX *sctx = s->pkey_sign_batch_ctx;
+    SSL_SIGN_BATCH *b;
+    int pending = 1, due = 0;
+
+    if (sctx == NULL)
+        return 1;
+
+    b = sctx->sign_batch;
+    if (CRYPTO_THREAD_read_lock(b->lock)) {
+        pending = s->pkey_sign_state == SSL_PKEY_SIGN_PENDING;
+        due = pending && sign_batch_due(sctx, b);
+        CRYPTO_THREAD_unlock(b->lock);
+    }
+    /* Another thread may have flushed in between, which is harmless */
+    if (due && CRYPTO_THREAD_write_lock(b->lock)) {
+        if (sign_batch_due(sctx, b))
+            sign_batch_flush_locked(sctx, b);
+        pending = s->pkey_sign_state == SSL_PKEY_SIGN_PENDING;
+        CRYPTO_THREAD_unlock(b->lock);
+    }
+    if (pending)
+        return 0;
+
+    s->pkey_sign_batch_ctx = NULL;
+    SSL_CTX_free(sctx);
+    return 1;
+}
+
+/* Take |s| out of the queue when it is cleared or freed */
+void ssl_sign_batch_remove(SSL_CONNECTION *s)
+{
+    SSL_CTX *sctx = s->pkey_sign_batch_ctx;
+    SSL_SIGN_BATCH *b;
+    size_t i;
+
+    if (sctx == NULL)
+        return;
+
+    b = sctx->sign_batch;
+    if (CRYPTO_THREAD_write_lock(b->lock)) {
+        for (i = 0; i < b->num; i++) {
+            if (b->entries[i].s != s)
+                continue;
+            EVP_PKEY_free(b->entries[i].pkey);
+            memmove(&b->entries[i], &b->entries[i + 1],
+                (b->num - i - 1) * sizeof(*b->entries));
+            b->num--;
+            break;
+        }
+        CRYPTO_THREAD_unlock(b->lock);
+    }
+    s->pkey_sign_batch_ctx = NULL;
+    SSL_CTX_free(sctx);
+}
+
+int SSL_CTX_set_cert_verify_batch(SSL_CTX *ctx, size_t max)
+{
+    SSL_SIGN_BATCH *b = NULL;
+
+    if (max > SSL_SIGN_BATCH_MAX) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_PASSED_INVALID_ARGUMENT);
+        return 0;
+    }
+
+    /* Queued connections hold a reference to |ctx|, so none are queued */
+    if (max > 0) {
+        if ((b = OPENSSL_zalloc(sizeof(*b))) == NULL)
+            return 0;
+        b->max = max;
+        if ((b->lock = CRYPTO_THREAD_lock_new()) == NULL
+            || (b->entries = OPENSSL_malloc_array(max,
+                    sizeof(*b->entries)))
+                == NULL) {
+            ssl_sign_batch_free(b);
+            return 0;
+        }
+    }
+
+    if (ctx->sign_batch != NULL) {
+        size_t num = 1;
+
+        if (CRYPTO_THREAD_read_lock(ctx->sign_batch->lock)) {
+            num = ctx->sign_batch->num;
+            CRYPTO_THREAD_unlock(ctx->sign_batch->lock);
+        }
+        if (num > 0) {
+            ERR_raise(ERR_LIB_SSL, ERR_R_SHOULD_NOT_HAVE_BEEN_CALLED);
+            ssl_sign_batch_free(b);
+            return 0;
+        }
+    }
+    ssl_sign_batch_free(ctx->sign_batch);
+    ctx->sign_batch = b;
+    return 1;
+}
+
+size_t SSL_CTX_flush_cert_verify_batch(SSL_CTX *ctx)
+{
+    SSL_SIGN_BATCH *b = ctx->sign_batch;
+    size_t done;
+
+    if (b == NULL || !CRYPTO_THREAD_write_lock(b->lock))
+        return 0;
+    done = sign_batch_flush_locked(ctx, b);
+    CRYPTO_THREAD_unlock(b->lock);
+    return done;
+}
+
+int SSL_CTX_set_cert_verify_batch_timeout(SSL_CTX *ctx, uint64_t timeout_ms)
+{
+    ctx->sign_batch_timeout = ossl_ms2time(timeout_ms);
+    return 1;
+}
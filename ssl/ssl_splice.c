@@ -0,0 +1,191 @@
+/*
+ * Copyright 2026 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * splice() is only declared with _GNU_SOURCE, which is kept to this file so
+ * that it does not change the feature macros of the rest of libssl
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "internal/e_os.h"
+#include "ssl_local.h"
+#include "internal/ktls.h"
+#include "internal/ssl_unwrap.h"
+
+#include <openssl/err.h>
+
+#if defined(OPENSSL_SYS_UNIX)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* Discard any data that SSL_splice() has read but not yet written */
+void ssl_splice_clear(SSL_CONNECTION *sc)
+{
+#ifdef OPENSSL_KTLS_SPLICE
+    if (sc->splice.pipefd[0] != -1) {
+        close(sc->splice.pipefd[0]);
+        close(sc->splice.pipefd[1]);
+        sc->splice.pipefd[0] = sc->splice.pipefd[1] = -1;
+    }
+#endif
+    OPENSSL_free(sc->splice.buf);
+    sc->splice.buf = NULL;
+    sc->splice.off = 0;
+    sc->splice.pending = 0;
+    sc->splice.in_pipe = 0;
+}
+
+#if defined(OPENSSL_SYS_UNIX)
+
+#ifdef OPENSSL_KTLS_SPLICE
+/* splice() only waits for a descriptor that is in blocking mode */
+static int ssl_splice_nonblocking(int fd)
+{
+    int fl = fcntl(fd, F_GETFL);
+
+    return fl != -1 && (fl & O_NONBLOCK) != 0;
+}
+#endif
+
+/*
+ * Write out the data that SSL_splice() is holding on behalf of |fd|. Returns
+ * the number of bytes written, or -1 if nothing could be written.
+ */
+static ossl_ssize_t ssl_splice_flush(SSL_CONNECTION *sc, int fd)
+{
+    ossl_ssize_t ret;
+
+    BIO_clear_retry_flags(sc->wbio);
+    sc->rwstate = SSL_WRITING;
+    clear_sys_error();
+#ifdef OPENSSL_KTLS_SPLICE
+    if (sc->splice.in_pipe)
+        ret = ktls_splice(sc->splice.pipefd[0], fd, sc->splice.pending,
+            ssl_splice_nonblocking(fd));
+    else
+#endif
+        ret = write(fd, sc->splice.buf + sc->splice.off, sc->splice.pending);
+
+    if (ret <= 0) {
+        if (ret < 0 && BIO_sock_should_retry((int)ret)) {
+            BIO_set_retry_write(sc->wbio);
+        } else {
+            ERR_raise_data(ERR_LIB_SYS, get_last_sys_error(),
+                "SSL_splice write failure");
+            sc->statem.error_state = ERROR_STATE_SYSCALL;
+        }
+        return -1;
+    }
+
+    sc->splice.off += ret;
+    sc->splice.pending -= ret;
+    if (sc->splice.pending == 0) {
+        sc->splice.off = 0;
+        sc->splice.in_pipe = 0;
+    }
+    sc->rwstate = SSL_NOTHING;
+    return ret;
+}
+
+ossl_ssize_t SSL_splice(SSL *s, int fd, size_t size, int flags)
+{
+    SSL_CONNECTION *sc = SSL_CONNECTION_FROM_SSL_ONLY(s);
+    int len;
+#ifdef OPENSSL_KTLS_SPLICE
+    ossl_ssize_t ret;
+    int rfd;
+#endif
+
+    if (sc == NULL)
+        return 0;
+
+    if (ssl_reset_error_state(sc) == 0)
+        return -1;
+
+    if (flags != 0) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_PASSED_INVALID_ARGUMENT);
+        sc->statem.error_state = ERROR_STATE_SSL;
+        return -1;
+    }
+
+    if (sc->handshake_func == NULL) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_UNINITIALIZED);
+        sc->statem.error_state = ERROR_STATE_SSL;
+        return -1;
+    }
+
+    /* Data read by an earlier call has to be written out first */
+    if (sc->splice.pending > 0)
+        return ssl_splice_flush(sc, fd);
+
+    if (size > SSL3_RT_MAX_PLAIN_LENGTH)
+        size = SSL3_RT_MAX_PLAIN_LENGTH;
+
+#ifdef OPENSSL_KTLS_SPLICE
+    /*
+     * If the kernel is decrypting the records and nothing has been buffered
+     * in user space we can move the plaintext straight from the socket into
+     * our pipe and from there to |fd|. Anything other than application data
+     * makes splice() fail with EINVAL, in which case the record is left for
+     * SSL_read() below to deal with. The pipe is empty here, so only the
+     * socket can make the call wait, and only if it is in blocking mode.
+     */
+    if (BIO_get_ktls_recv(sc->rbio) && !SSL_has_pending(s)
+        && (rfd = SSL_get_rfd(s)) != -1
+        && (sc->splice.pipefd[0] != -1 || pipe(sc->splice.pipefd) == 0)) {
+        BIO_clear_retry_flags(sc->rbio);
+        sc->rwstate = SSL_READING;
+        clear_sys_error();
+        ret = ktls_splice(rfd, sc->splice.pipefd[1], size,
+            ssl_splice_nonblocking(rfd));
+        if (ret > 0) {
+            sc->rlayer.ktls_read_bytes += ret;
+            sc->splice.pending = ret;
+            sc->splice.in_pipe = 1;
+            return ssl_splice_flush(sc, fd);
+        }
+        if (ret < 0 && BIO_sock_should_retry((int)ret)) {
+            BIO_set_retry_read(sc->rbio);
+            return -1;
+        }
+        sc->rwstate = SSL_NOTHING;
+    }
+#endif
+
+    if (sc->splice.buf == NULL) {
+        sc->splice.buf = OPENSSL_malloc(SSL3_RT_MAX_PLAIN_LENGTH);
+        if (sc->splice.buf == NULL) {
+            sc->statem.error_state = ERROR_STATE_SSL;
+            return -1;
+        }
+    }
+
+    len = SSL_read(s, sc->splice.buf, (int)size);
+    if (len <= 0)
+        return len;
+
+    sc->splice.off = 0;
+    sc->splice.pending = len;
+    sc->splice.in_pipe = 0;
+    return ssl_splice_flush(sc, fd);
+}
+
+#else
+
+ossl_ssize_t SSL_splice(SSL *s, int fd, size_t size, int flags)
+{
+    /* There is no write() for the descriptor */
+    ERR_raise(ERR_LIB_SSL, ERR_R_UNSUPPORTED);
+    return -1;
+}
+
+#endif
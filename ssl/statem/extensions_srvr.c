@@ -2041,7 +2041,8 @@ EXT_RETURN tls_construct_stoc_key_share(SSL_CONNECTION *s, WPACKET *pkt,
 
     if (!ginf->is_kem) {
         /* Regular KEX */
-        skey = ssl_generate_pkey(s, ckey);
+        if ((skey = ssl_keyshare_pool_get(s, s->s3.group_id)) == NULL)
+            skey = ssl_generate_pkey(s, ckey);
         if (skey == NULL) {
             SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_SSL_LIB);
             return EXT_RETURN_FAIL;
@@ -907,6 +907,15 @@ static SUB_STATE_RETURN write_state_machine(SSL_CONNECTION *s)
                     WPACKET_cleanup(&pkt);
                     check_fatal(s);
                     return SUB_STATE_ERROR;
+                } else if (tmpret == CON_FUNC_RETRY) {
+                    /*
+                     * The construction function is waiting for the
+                     * application. It will be called again from the start.
+                     */
+                    WPACKET_cleanup(&pkt);
+                    st->write_state = WRITE_STATE_PRE_WORK;
+                    st->write_state_work = WORK_MORE_A;
+                    return SUB_STATE_ERROR;
                 } else if (tmpret == CON_FUNC_DONT_SEND) {
                     /*
                      * The construction function decided not to construct the
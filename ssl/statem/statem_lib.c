@@ -311,6 +311,99 @@ static int get_cert_verify_tbs_data(SSL_CONNECTION *s, unsigned char *tls13tbs,
     return 1;
 }
 
+/*
+ * Add a signature of |tbs| made by the private key sign callback to |pkt|.
+ * If the callback asks to retry then CON_FUNC_RETRY is returned, and the
+ * construction function is called again once the application has provided
+ * the signature with SSL_set1_private_key_signature(). The signature is then
+ * taken from there instead of calling the callback again.
+ *
+ * Without a callback the signature is queued to be made in a batch with
+ * other connections, see ssl_sign_batch.c, and the signature is picked up
+ * the same way.
+ */
+CON_FUNC_RETURN tls_construct_private_key_sig(SSL_CONNECTION *s,
+    WPACKET *pkt, const SIGALG_LOOKUP *lu, EVP_PKEY *pkey,
+    const unsigned char *tbs, size_t tbslen)
+{
+    SSL_CTX *sctx = SSL_CONNECTION_GET_CTX(s);
+    unsigned char *sigbytes1, *sigbytes2;
+    size_t siglen = 0;
+    int sigsize, ok;
+
+    if (!ssl_sign_batch_poll(s)) {
+        s->rwstate = SSL_PRIVATE_KEY_OPERATION;
+        return CON_FUNC_RETRY;
+    }
+
+    switch (s->pkey_sign_state) {
+    case SSL_PKEY_SIGN_PENDING:
+        s->rwstate = SSL_PRIVATE_KEY_OPERATION;
+        return CON_FUNC_RETRY;
+
+    case SSL_PKEY_SIGN_DONE:
+        ok = s->pkey_sig != NULL
+            && WPACKET_sub_memcpy_u16(pkt, s->pkey_sig, s->pkey_siglen);
+        OPENSSL_free(s->pkey_sig);
+        s->pkey_sig = NULL;
+        s->pkey_siglen = 0;
+        s->pkey_sign_state = SSL_PKEY_SIGN_NONE;
+        s->rwstate = SSL_NOTHING;
+        if (!ok) {
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR,
+                sctx->private_key_sign_cb != NULL ? SSL_R_CALLBACK_FAILED
+                                                  : ERR_R_EVP_LIB);
+            return CON_FUNC_ERROR;
+        }
+        return CON_FUNC_SUCCESS;
+    }
+
+    if (sctx->private_key_sign_cb == NULL) {
+        switch (ssl_sign_batch_add(s, lu, pkey, tbs, tbslen)) {
+        case 1:
+            s->rwstate = SSL_PRIVATE_KEY_OPERATION;
+            return CON_FUNC_RETRY;
+        case 2:
+            /* This connection filled the queue, the signature is ready */
+            return tls_construct_private_key_sig(s, pkt, lu, pkey, tbs,
+                tbslen);
+        default:
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+            return CON_FUNC_ERROR;
+        }
+    }
+
+    sigsize = EVP_PKEY_get_size(pkey);
+    if (sigsize <= 0
+        || !WPACKET_sub_reserve_bytes_u16(pkt, (size_t)sigsize, &sigbytes1)) {
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        return CON_FUNC_ERROR;
+    }
+
+    switch (sctx->private_key_sign_cb(SSL_CONNECTION_GET_USER_SSL(s),
+        lu->sigalg, sigbytes1, &siglen, (size_t)sigsize, tbs, tbslen,
+        sctx->private_key_sign_cb_arg)) {
+    case SSL_PRIVATE_KEY_SUCCESS:
+        if (siglen == 0 || siglen > (size_t)sigsize
+            || !WPACKET_sub_allocate_bytes_u16(pkt, siglen, &sigbytes2)
+            || sigbytes1 != sigbytes2) {
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, SSL_R_CALLBACK_FAILED);
+            return CON_FUNC_ERROR;
+        }
+        return CON_FUNC_SUCCESS;
+
+    case SSL_PRIVATE_KEY_RETRY:
+        s->pkey_sign_state = SSL_PKEY_SIGN_PENDING;
+        s->rwstate = SSL_PRIVATE_KEY_OPERATION;
+        return CON_FUNC_RETRY;
+
+    case SSL_PRIVATE_KEY_FAILURE:
+    default:
+        SSLfatal(s, SSL_AD_INTERNAL_ERROR, SSL_R_CALLBACK_FAILED);
+        return CON_FUNC_ERROR;
+    }
+}
+
 CON_FUNC_RETURN tls_construct_cert_verify(SSL_CONNECTION *s, WPACKET *pkt)
 {
     EVP_PKEY *pkey = NULL;
@@ -353,6 +446,19 @@ CON_FUNC_RETURN tls_construct_cert_verify(SSL_CONNECTION *s, WPACKET *pkt)
         goto err;
     }
 
+    if ((sctx->private_key_sign_cb != NULL || ssl_sign_batch_applies(s, lu))
+        && SSL_USE_SIGALGS(s)) {
+        CON_FUNC_RETURN ret = tls_construct_private_key_sig(s, pkt, lu, pkey,
+            hdata, hdatalen);
+
+        if (ret != CON_FUNC_SUCCESS) {
+            /* SSLfatal() already called if this is an error */
+            EVP_MD_CTX_free(mctx);
+            return ret;
+        }
+        goto sig_done;
+    }
+
     /*
      * To avoid problems with older RSA providers we must also pass the digest
      * name when passing any other parameters.
@@ -412,6 +518,7 @@ CON_FUNC_RETURN tls_construct_cert_verify(SSL_CONNECTION *s, WPACKET *pkt)
         goto err;
     }
 
+sig_done:
     /* Digest cached records and discard handshake buffer */
     if (!ssl3_digest_cached_records(s, 0)) {
         /* SSLfatal() already called */
@@ -1001,6 +1108,52 @@ static int ssl_add_cert_to_wpacket(SSL_CONNECTION *s, WPACKET *pkt,
     return 1;
 }
 
+/*
+ * Add the certificates in |enc| to the WPACKET. Before TLSv1.3 the encoding
+ * is used verbatim, otherwise each certificate is followed by its extensions
+ * so those are still constructed on every handshake.
+ */
+static int ssl_add_cert_enc_to_wpacket(SSL_CONNECTION *s, WPACKET *pkt,
+    const SSL_CERT_ENC *enc, int for_comp)
+{
+    PACKET certs, cert;
+    size_t i;
+    int context = SSL_EXT_TLS1_3_CERTIFICATE;
+
+    if (!SSL_CONNECTION_IS_TLS13(s) && !for_comp) {
+        if (!WPACKET_memcpy(pkt, enc->data, enc->len)) {
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+            return 0;
+        }
+        return 1;
+    }
+
+    if (for_comp)
+        context |= SSL_EXT_TLS1_3_CERTIFICATE_COMPRESSION;
+
+    if (!PACKET_buf_init(&certs, enc->data, enc->len)) {
+        if (!for_comp)
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+        return 0;
+    }
+    for (i = 0; PACKET_remaining(&certs) > 0; i++) {
+        if (!PACKET_get_length_prefixed_3(&certs, &cert)
+            || !WPACKET_sub_memcpy_u24(pkt, PACKET_data(&cert),
+                PACKET_remaining(&cert))) {
+            if (!for_comp)
+                SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+            return 0;
+        }
+        if (!tls_construct_extensions(s, pkt, context,
+                sk_X509_value(enc->certs, (int)i), i)) {
+            /* SSLfatal() already called */
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
 /* Add certificate chain to provided WPACKET */
 static int ssl_add_cert_chain(SSL_CONNECTION *s, WPACKET *pkt, CERT_PKEY *cpk, int for_comp)
 {
@@ -1087,6 +1240,10 @@ static int ssl_add_cert_chain(SSL_CONNECTION *s, WPACKET *pkt, CERT_PKEY *cpk, i
                 SSLfatal(s, SSL_AD_INTERNAL_ERROR, i);
             return 0;
         }
+        /* Use the encoding computed when the chain was set if it's current */
+        if (extra_certs == cpk->chain
+            && ssl_cert_enc_matches(cpk->cert_enc, x, extra_certs))
+            return ssl_add_cert_enc_to_wpacket(s, pkt, cpk->cert_enc, for_comp);
         if (!ssl_add_cert_to_wpacket(s, pkt, x, 0, for_comp)) {
             /* SSLfatal() already called */
             return 0;
@@ -1532,6 +1689,10 @@ WORK_STATE tls_finish_handshake(SSL_CONNECTION *s, ossl_unused WORK_STATE wst,
         return WORK_FINISHED_CONTINUE;
     }
 
+    /* This fails harmlessly if there is still data buffered */
+    if ((s->mode & SSL_MODE_AUTO_HIBERNATE) != 0)
+        ossl_ssl_connection_hibernate(s);
+
     return WORK_FINISHED_STOP;
 }
 
@@ -167,6 +167,9 @@ __owur MSG_PROCESS_RETURN tls_process_server_done(SSL_CONNECTION *s,
     PACKET *pkt);
 __owur CON_FUNC_RETURN tls_construct_cert_verify(SSL_CONNECTION *s,
     WPACKET *pkt);
+__owur CON_FUNC_RETURN tls_construct_private_key_sig(SSL_CONNECTION *s,
+    WPACKET *pkt, const SIGALG_LOOKUP *lu, EVP_PKEY *pkey,
+    const unsigned char *tbs, size_t tbslen);
 __owur WORK_STATE tls_prepare_client_certificate(SSL_CONNECTION *s,
     WORK_STATE wst);
 __owur CON_FUNC_RETURN tls_construct_client_certificate(SSL_CONNECTION *s,
@@ -2869,6 +2869,11 @@ CON_FUNC_RETURN tls_construct_server_key_exchange(SSL_CONNECTION *s,
     int freer = 0;
     CON_FUNC_RETURN ret = CON_FUNC_ERROR;
     SSL_CTX *sctx = SSL_CONNECTION_GET_CTX(s);
+    /*
+     * When the signature was offloaded to the application we're called again
+     * to finish the message, with the key generated the first time.
+     */
+    int resume = s->pkey_sign_state != SSL_PKEY_SIGN_NONE;
 
     if (!WPACKET_get_total_written(pkt, &paramoffset)) {
         SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
@@ -2899,12 +2904,13 @@ CON_FUNC_RETURN tls_construct_server_key_exchange(SSL_CONNECTION *s,
                 /* Cache the group used in the SSL_SESSION */
                 s->session->kex_group = group_id;
 
-                s->s3.tmp.pkey = ssl_generate_pkey_group(s, group_id);
+                if (!resume)
+                    s->s3.tmp.pkey = ssl_generate_pkey_group(s, group_id);
                 if (s->s3.tmp.pkey == NULL) {
                     SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
                     goto err;
                 }
-            } else {
+            } else if (!resume) {
 
                 if (s->cert->dh_tmp_auto) {
                     pkdh = ssl_get_auto_dh(s);
@@ -2964,7 +2970,7 @@ CON_FUNC_RETURN tls_construct_server_key_exchange(SSL_CONNECTION *s,
             }
         } else if (type & (SSL_kECDHE | SSL_kECDHEPSK)) {
 
-            if (s->s3.tmp.pkey != NULL) {
+            if ((s->s3.tmp.pkey != NULL) != resume) {
                 SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
                 goto err;
             }
@@ -2980,7 +2986,8 @@ CON_FUNC_RETURN tls_construct_server_key_exchange(SSL_CONNECTION *s,
             /* Cache the group used in the SSL_SESSION */
             s->session->kex_group = group_id;
             /* Generate a new key for this curve */
-            s->s3.tmp.pkey = ssl_generate_pkey_group(s, group_id);
+            if (!resume)
+                s->s3.tmp.pkey = ssl_generate_pkey_group(s, group_id);
             if (s->s3.tmp.pkey == NULL) {
                 /* SSLfatal() already called */
                 goto err;
@@ -3129,6 +3136,19 @@ CON_FUNC_RETURN tls_construct_server_key_exchange(SSL_CONNECTION *s,
             goto err;
         }
 
+        if (sctx->private_key_sign_cb != NULL && SSL_USE_SIGALGS(s)) {
+            tbslen = construct_key_exchange_tbs(s, &tbs,
+                s->init_buf->data + paramoffset,
+                paramlen);
+            if (tbslen == 0) {
+                /* SSLfatal() already called */
+                goto err;
+            }
+            ret = tls_construct_private_key_sig(s, pkt, lu, pkey, tbs, tbslen);
+            OPENSSL_free(tbs);
+            goto err;
+        }
+
         if (EVP_DigestSignInit_ex(md_ctx, &pctx,
                 md == NULL ? NULL : EVP_MD_get0_name(md),
                 sctx->libctx, sctx->propq, pkey,
@@ -4415,19 +4435,24 @@ static CON_FUNC_RETURN construct_stateless_ticket(SSL_CONNECTION *s,
             goto err;
         }
     } else {
+        SSL_TICKET_KEY key;
+
         iv_len = EVP_CIPHER_get_iv_length(sctx->tktenc);
         if (iv_len < 0
             || RAND_bytes_ex(sctx->libctx, iv, iv_len, 0) <= 0
-            || !EVP_EncryptInit_ex(ctx, sctx->tktenc, NULL,
-                tctx->ext.secure->tick_aes_key, iv)
-            || !ssl_hmac_init(&hctx, tctx->ext.secure->tick_hmac_key,
-                sizeof(tctx->ext.secure->tick_hmac_key),
+            || !ssl_ctx_ticket_key_current(tctx, &key)) {
+            SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
+            goto err;
+        }
+        if (!EVP_EncryptInit_ex(ctx, sctx->tktenc, NULL, key.aes_key, iv)
+            || !ssl_hmac_init(&hctx, key.hmac_key, sizeof(key.hmac_key),
                 "SHA256")) {
+            OPENSSL_cleanse(&key, sizeof(key));
             SSLfatal(s, SSL_AD_INTERNAL_ERROR, ERR_R_INTERNAL_ERROR);
             goto err;
         }
-        memcpy(key_name, tctx->ext.tick_key_name,
-            sizeof(tctx->ext.tick_key_name));
+        memcpy(key_name, key.name, sizeof(key.name));
+        OPENSSL_cleanse(&key, sizeof(key));
     }
 
     if (!create_ticket_prequel(s, pkt, age_add, tick_nonce)) {
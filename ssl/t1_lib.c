@@ -20,6 +20,7 @@
 #include <openssl/dh.h>
 #include <openssl/bn.h>
 #include <openssl/provider.h>
+#include <openssl/rand.h>
 #include <openssl/param_build.h>
 #include "internal/nelem.h"
 #include "internal/sizes.h"
@@ -3117,6 +3118,253 @@ int tls1_set_server_sigalgs(SSL_CONNECTION *s)
     return 0;
 }
 
+/*
+ * Session ticket key ring. Handshakes only ever take the ring lock for reading
+ * and for long enough to copy one key out; callers must cleanse the copy once
+ * the key has been installed in the cipher and MAC contexts.
+ */
+
+static void ticket_key_from_bytes(SSL_TICKET_KEY *key,
+    const unsigned char *bytes)
+{
+    memcpy(key->name, bytes, sizeof(key->name));
+    bytes += sizeof(key->name);
+    memcpy(key->hmac_key, bytes, sizeof(key->hmac_key));
+    bytes += sizeof(key->hmac_key);
+    memcpy(key->aes_key, bytes, sizeof(key->aes_key));
+}
+
+static void ticket_key_to_bytes(const SSL_TICKET_KEY *key,
+    unsigned char *bytes)
+{
+    memcpy(bytes, key->name, sizeof(key->name));
+    bytes += sizeof(key->name);
+    memcpy(bytes, key->hmac_key, sizeof(key->hmac_key));
+    bytes += sizeof(key->hmac_key);
+    memcpy(bytes, key->aes_key, sizeof(key->aes_key));
+}
+
+static int ticket_key_generate(SSL_CTX *ctx, SSL_TICKET_KEY *key)
+{
+    return RAND_bytes_ex(ctx->libctx, key->name, sizeof(key->name), 0) > 0
+        && RAND_priv_bytes_ex(ctx->libctx, key->hmac_key,
+               sizeof(key->hmac_key), 0)
+        > 0
+        && RAND_priv_bytes_ex(ctx->libctx, key->aes_key,
+               sizeof(key->aes_key), 0)
+        > 0;
+}
+
+/* Is the current ticket key due for rotation? Requires ext.tick_key_lock */
+static int ticket_key_rotation_due(const SSL_CTX *ctx, OSSL_TIME now)
+{
+    return !ossl_time_is_zero(ctx->ext.tick_key_interval)
+        && ossl_time_compare(now, ossl_time_add(ctx->ext.tick_key_time,
+                                      ctx->ext.tick_key_interval))
+        >= 0;
+}
+
+/*
+ * Makes a new current ticket key, keeping the newest ext.tick_key_max - 1
+ * of the existing keys for decryption. If |if_due| is set this is only done
+ * if the current key is due for rotation, so that of several threads that
+ * noticed it is only one rotates the ring.
+ */
+static int ticket_key_rotate(SSL_CTX *ctx, int if_due)
+{
+    SSL_CTX_EXT_SECURE *sec = ctx->ext.secure;
+    SSL_TICKET_KEY key;
+    OSSL_TIME now = ossl_time_now();
+    size_t old, num;
+
+    /* Do the expensive part before taking the lock */
+    if (!ticket_key_generate(ctx, &key)) {
+        OPENSSL_cleanse(&key, sizeof(key));
+        return 0;
+    }
+
+    if (!CRYPTO_THREAD_write_lock(ctx->ext.tick_key_lock)) {
+        OPENSSL_cleanse(&key, sizeof(key));
+        return 0;
+    }
+    if (!if_due || ticket_key_rotation_due(ctx, now)) {
+        old = sec->num_tick_keys;
+        num = old < ctx->ext.tick_key_max ? old : ctx->ext.tick_key_max - 1;
+        memmove(&sec->tick_keys[1], &sec->tick_keys[0], num * sizeof(key));
+        if (old > num + 1)
+            OPENSSL_cleanse(&sec->tick_keys[num + 1],
+                (old - num - 1) * sizeof(key));
+        sec->tick_keys[0] = key;
+        sec->num_tick_keys = num + 1;
+        ctx->ext.tick_key_time = now;
+    }
+    CRYPTO_THREAD_unlock(ctx->ext.tick_key_lock);
+
+    OPENSSL_cleanse(&key, sizeof(key));
+    return 1;
+}
+
+/* Sets up the ticket key ring of a new SSL_CTX with one random key */
+int ssl_ctx_ticket_key_init(SSL_CTX *ctx)
+{
+    ctx->ext.tick_key_lock = CRYPTO_THREAD_lock_new();
+    if (ctx->ext.tick_key_lock == NULL)
+        return 0;
+    ctx->ext.tick_key_max = 1;
+    ctx->ext.tick_key_time = ossl_time_now();
+    if (!ticket_key_generate(ctx, &ctx->ext.secure->tick_keys[0]))
+        return 0;
+    ctx->ext.secure->num_tick_keys = 1;
+    return 1;
+}
+
+/*
+ * Copies the key that new tickets are encrypted with into |key|, rotating
+ * the ring first if that is due. Returns 1 on success or 0 on error.
+ */
+int ssl_ctx_ticket_key_current(SSL_CTX *ctx, SSL_TICKET_KEY *key)
+{
+    int due;
+
+    if (!CRYPTO_THREAD_read_lock(ctx->ext.tick_key_lock))
+        return 0;
+    due = ticket_key_rotation_due(ctx, ossl_time_now());
+    CRYPTO_THREAD_unlock(ctx->ext.tick_key_lock);
+
+    /* A failure to rotate leaves the current key in use */
+    if (due)
+        (void)ticket_key_rotate(ctx, 1);
+
+    if (!CRYPTO_THREAD_read_lock(ctx->ext.tick_key_lock))
+        return 0;
+    if (ctx->ext.secure->num_tick_keys == 0) {
+        CRYPTO_THREAD_unlock(ctx->ext.tick_key_lock);
+        return 0;
+    }
+    *key = ctx->ext.secure->tick_keys[0];
+    CRYPTO_THREAD_unlock(ctx->ext.tick_key_lock);
+    return 1;
+}
+
+/*
+ * Copies the ticket key called |name| into |key| and sets |*current| to
+ * whether it is the key new tickets are encrypted with. Returns 1 if the key
+ * was found, 0 if it was not and -1 on error.
+ */
+int ssl_ctx_ticket_key_find(SSL_CTX *ctx, const unsigned char *name,
+    SSL_TICKET_KEY *key, int *current)
+{
+    SSL_CTX_EXT_SECURE *sec = ctx->ext.secure;
+    size_t i;
+    int found = 0;
+
+    if (!CRYPTO_THREAD_read_lock(ctx->ext.tick_key_lock))
+        return -1;
+    for (i = 0; i < sec->num_tick_keys; i++) {
+        if (memcmp(name, sec->tick_keys[i].name, TLSEXT_KEYNAME_LENGTH) == 0) {
+            *key = sec->tick_keys[i];
+            *current = i == 0;
+            found = 1;
+            break;
+        }
+    }
+    CRYPTO_THREAD_unlock(ctx->ext.tick_key_lock);
+    return found;
+}
+
+/*
+ * Replaces the key that new tickets are encrypted with by the key in |keys|,
+ * leaving the older keys of the ring to decrypt the tickets issued with them
+ */
+int ssl_ctx_set_ticket_key_current(SSL_CTX *ctx, const unsigned char *keys)
+{
+    SSL_CTX_EXT_SECURE *sec = ctx->ext.secure;
+
+    if (!CRYPTO_THREAD_write_lock(ctx->ext.tick_key_lock))
+        return 0;
+    OPENSSL_cleanse(&sec->tick_keys[0], sizeof(sec->tick_keys[0]));
+    ticket_key_from_bytes(&sec->tick_keys[0], keys);
+    if (sec->num_tick_keys == 0)
+        sec->num_tick_keys = 1;
+    ctx->ext.tick_key_time = ossl_time_now();
+    CRYPTO_THREAD_unlock(ctx->ext.tick_key_lock);
+    return 1;
+}
+
+/* Replaces the ticket key ring with the |num| keys in |keys| */
+static int ssl_ctx_set_ticket_keys(SSL_CTX *ctx, const unsigned char *keys,
+    size_t num)
+{
+    SSL_CTX_EXT_SECURE *sec = ctx->ext.secure;
+    size_t i;
+
+    if (!CRYPTO_THREAD_write_lock(ctx->ext.tick_key_lock))
+        return 0;
+    OPENSSL_cleanse(sec->tick_keys, sizeof(sec->tick_keys));
+    for (i = 0; i < num; i++)
+        ticket_key_from_bytes(&sec->tick_keys[i],
+            keys + i * SSL_TICKET_KEY_LENGTH);
+    sec->num_tick_keys = num;
+    ctx->ext.tick_key_time = ossl_time_now();
+    CRYPTO_THREAD_unlock(ctx->ext.tick_key_lock);
+    return 1;
+}
+
+int SSL_CTX_set1_ticket_keys(SSL_CTX *ctx, const unsigned char *keys,
+    size_t keyslen)
+{
+    if (keys == NULL || keyslen == 0
+        || keyslen % SSL_TICKET_KEY_LENGTH != 0
+        || keyslen / SSL_TICKET_KEY_LENGTH > SSL_TICKET_KEYS_MAX) {
+        ERR_raise(ERR_LIB_SSL, SSL_R_INVALID_TICKET_KEYS_LENGTH);
+        return 0;
+    }
+    return ssl_ctx_set_ticket_keys(ctx, keys, keyslen / SSL_TICKET_KEY_LENGTH);
+}
+
+size_t SSL_CTX_get_ticket_keys(SSL_CTX *ctx, unsigned char *keys,
+    size_t keyslen)
+{
+    SSL_CTX_EXT_SECURE *sec = ctx->ext.secure;
+    size_t i, len;
+
+    if (!CRYPTO_THREAD_read_lock(ctx->ext.tick_key_lock))
+        return 0;
+    len = sec->num_tick_keys * SSL_TICKET_KEY_LENGTH;
+    if (keys != NULL) {
+        if (keyslen < len) {
+            CRYPTO_THREAD_unlock(ctx->ext.tick_key_lock);
+            ERR_raise(ERR_LIB_SSL, SSL_R_INVALID_TICKET_KEYS_LENGTH);
+            return 0;
+        }
+        for (i = 0; i < sec->num_tick_keys; i++)
+            ticket_key_to_bytes(&sec->tick_keys[i],
+                keys + i * SSL_TICKET_KEY_LENGTH);
+    }
+    CRYPTO_THREAD_unlock(ctx->ext.tick_key_lock);
+    return len;
+}
+
+int SSL_CTX_set_ticket_key_rotation(SSL_CTX *ctx, time_t interval,
+    size_t num_keys)
+{
+    if (interval < 0 || num_keys == 0 || num_keys > SSL_TICKET_KEYS_MAX) {
+        ERR_raise(ERR_LIB_SSL, ERR_R_PASSED_INVALID_ARGUMENT);
+        return 0;
+    }
+    if (!CRYPTO_THREAD_write_lock(ctx->ext.tick_key_lock))
+        return 0;
+    ctx->ext.tick_key_interval = ossl_time_from_time_t(interval);
+    ctx->ext.tick_key_max = num_keys;
+    CRYPTO_THREAD_unlock(ctx->ext.tick_key_lock);
+    return 1;
+}
+
+int SSL_CTX_rotate_ticket_keys(SSL_CTX *ctx)
+{
+    return ticket_key_rotate(ctx, 0);
+}
+
 /*-
  * Gets the ticket information supplied by the client if any.
  *
@@ -3263,25 +3511,28 @@ SSL_TICKET_STATUS tls_decrypt_ticket(SSL_CONNECTION *s,
         if (rv == 2)
             renew_ticket = 1;
     } else {
-        /* Check key name matches */
-        if (memcmp(etick, tctx->ext.tick_key_name,
-                TLSEXT_KEYNAME_LENGTH)
-            != 0) {
-            ret = SSL_TICKET_NO_DECRYPT;
+        SSL_TICKET_KEY key;
+        int current = 0, rv;
+
+        /* Look the key up by name in the ticket key ring */
+        rv = ssl_ctx_ticket_key_find(tctx, etick, &key, &current);
+        if (rv <= 0) {
+            ret = rv == 0 ? SSL_TICKET_NO_DECRYPT : SSL_TICKET_FATAL_ERR_OTHER;
             goto end;
         }
 
-        if (ssl_hmac_init(&hctx, tctx->ext.secure->tick_hmac_key,
-                sizeof(tctx->ext.secure->tick_hmac_key), "SHA256")
-                <= 0
-            || EVP_DecryptInit_ex(ctx, tctx->tktenc, NULL,
-                   tctx->ext.secure->tick_aes_key,
+        rv = ssl_hmac_init(&hctx, key.hmac_key, sizeof(key.hmac_key), "SHA256")
+                > 0
+            && EVP_DecryptInit_ex(ctx, tctx->tktenc, NULL, key.aes_key,
                    etick + TLSEXT_KEYNAME_LENGTH)
-                <= 0) {
+                > 0;
+        OPENSSL_cleanse(&key, sizeof(key));
+        if (!rv) {
             ret = SSL_TICKET_FATAL_ERR_OTHER;
             goto end;
         }
-        if (SSL_CONNECTION_IS_TLS13(s))
+        /* Move clients with tickets under an older key to the current one */
+        if (SSL_CONNECTION_IS_TLS13(s) || !current)
             renew_ticket = 1;
     }
     /*
@@ -452,6 +452,95 @@ static int test_bio_dgram(int idx)
         bio_dgram_cases[idx].local);
 }
 
+/*
+ * Sends a train of same-sized datagrams with transmit segmentation enabled and
+ * checks they arrive intact as individual datagrams.
+ */
+static int test_bio_dgram_segmentation(void)
+{
+    int testresult = 0;
+    BIO *b1 = NULL, *b2 = NULL;
+    int fd1 = -1, fd2 = -1;
+    BIO_ADDR *addr1 = NULL, *addr2 = NULL;
+    struct in_addr ina;
+    union BIO_sock_info_u info1 = { 0 }, info2 = { 0 };
+    static unsigned char tx_buf[10][1000], rx_buf[1500];
+    BIO_MSG tx_msg[OSSL_NELEM(tx_buf)], rx_msg;
+    size_t i, num_processed = 0, num_rx;
+    uint32_t caps;
+
+    ina.s_addr = htonl(0x7f000001UL);
+    if (!TEST_ptr(addr1 = BIO_ADDR_new())
+        || !TEST_ptr(addr2 = BIO_ADDR_new())
+        || !TEST_int_eq(BIO_ADDR_rawmake(addr1, AF_INET, &ina, sizeof(ina), 0), 1)
+        || !TEST_int_eq(BIO_ADDR_rawmake(addr2, AF_INET, &ina, sizeof(ina), 0), 1)
+        || !TEST_int_ge(fd1 = BIO_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP, 0), 0)
+        || !TEST_int_ge(fd2 = BIO_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP, 0), 0))
+        goto err;
+
+    if (BIO_bind(fd1, addr1, 0) <= 0 || BIO_bind(fd2, addr2, 0) <= 0) {
+        testresult = TEST_skip("BIO_bind() failed");
+        goto err;
+    }
+
+    info1.addr = addr1;
+    info2.addr = addr2;
+    if (!TEST_int_gt(BIO_sock_info(fd1, BIO_SOCK_INFO_ADDRESS, &info1), 0)
+        || !TEST_int_gt(BIO_sock_info(fd2, BIO_SOCK_INFO_ADDRESS, &info2), 0)
+        || !TEST_ptr(b1 = BIO_new_dgram(fd1, 0))
+        || !TEST_ptr(b2 = BIO_new_dgram(fd2, 0)))
+        goto err;
+
+    caps = BIO_dgram_get_segmentation_cap(b1);
+    if ((caps & BIO_DGRAM_SEGMENT_TX) == 0) {
+        testresult = TEST_skip("UDP segmentation offload not supported");
+        goto err;
+    }
+
+    if (!TEST_true(BIO_dgram_set_segmentation(b1, BIO_DGRAM_SEGMENT_TX))
+        || !TEST_uint_eq(BIO_dgram_get_segmentation(b1), BIO_DGRAM_SEGMENT_TX))
+        goto err;
+
+    /* All datagrams but the last are of the same size. */
+    for (i = 0; i < OSSL_NELEM(tx_msg); ++i) {
+        memset(tx_buf[i], (int)i, sizeof(tx_buf[i]));
+        tx_msg[i].data = tx_buf[i];
+        tx_msg[i].data_len = i < OSSL_NELEM(tx_msg) - 1 ? sizeof(tx_buf[i]) : 300;
+        tx_msg[i].peer = addr2;
+        tx_msg[i].local = NULL;
+        tx_msg[i].flags = 0;
+    }
+
+    if (!TEST_true(do_sendmmsg(b1, tx_msg, OSSL_NELEM(tx_msg), 0,
+            &num_processed))
+        || !TEST_size_t_eq(num_processed, OSSL_NELEM(tx_msg))
+        || !TEST_size_t_eq(tx_msg[0].data_len, sizeof(tx_buf[0]))
+        || !TEST_size_t_eq(tx_msg[OSSL_NELEM(tx_msg) - 1].data_len, 300))
+        goto err;
+
+    for (num_rx = 0; num_rx < OSSL_NELEM(tx_msg); ++num_rx) {
+        memset(&rx_msg, 0, sizeof(rx_msg));
+        rx_msg.data = rx_buf;
+        rx_msg.data_len = sizeof(rx_buf);
+        if (!TEST_true(do_recvmmsg(b2, &rx_msg, 1, 0, &num_processed))
+            || !TEST_mem_eq(rx_buf, rx_msg.data_len,
+                tx_msg[num_rx].data, tx_msg[num_rx].data_len))
+            goto err;
+    }
+
+    testresult = 1;
+err:
+    BIO_free(b1);
+    BIO_free(b2);
+    if (fd1 >= 0)
+        BIO_closesocket(fd1);
+    if (fd2 >= 0)
+        BIO_closesocket(fd2);
+    BIO_ADDR_free(addr1);
+    BIO_ADDR_free(addr2);
+    return testresult;
+}
+
 #if !defined(OPENSSL_NO_CHACHA)
 static int random_data(const uint32_t *key, uint8_t *data, size_t data_len, size_t offset)
 {
@@ -803,6 +892,7 @@ int setup_tests(void)
 
 #if !defined(OPENSSL_NO_DGRAM) && !defined(OPENSSL_NO_SOCK)
     ADD_ALL_TESTS(test_bio_dgram, OSSL_NELEM(bio_dgram_cases));
+    ADD_TEST(test_bio_dgram_segmentation);
 #if !defined(OPENSSL_NO_CHACHA)
     ADD_ALL_TESTS(test_bio_dgram_pair, 3);
 #endif
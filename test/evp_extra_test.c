@@ -1790,6 +1790,91 @@ out:
     return ret;
 }
 
+/*
+ * Test signing several digests in one call
+ * Test 0: RSA, signed one by one
+ * Test 1: ECDSA, signed as a batch
+ */
+static int test_EVP_PKEY_sign_batch(int tst)
+{
+    int ret = 0;
+    EVP_PKEY *pkey = NULL;
+    EVP_PKEY_CTX *ctx = NULL;
+    unsigned char tbsbuf[5][32];
+    unsigned char *sigs[5] = { NULL };
+    const unsigned char *tbs[5];
+    size_t siglens[5], tbslens[5], sig_len = 0, i;
+
+    if (tst == 0) {
+        if (!TEST_ptr(pkey = load_example_rsa_key()))
+            goto out;
+    } else {
+#ifndef OPENSSL_NO_EC
+        if (!TEST_ptr(pkey = load_example_ec_key()))
+            goto out;
+#else
+        ret = 1;
+        goto out;
+#endif
+    }
+
+    ctx = EVP_PKEY_CTX_new_from_pkey(testctx, pkey, NULL);
+    if (!TEST_ptr(ctx)
+        || !TEST_int_gt(EVP_PKEY_sign_init(ctx), 0)
+        || !TEST_int_gt(EVP_PKEY_CTX_set_signature_md(ctx, EVP_sha256()), 0)
+        || !TEST_int_gt(EVP_PKEY_sign(ctx, NULL, &sig_len, tbsbuf[0],
+                            sizeof(tbsbuf[0])),
+            0)
+        || !TEST_int_eq(EVP_PKEY_sign_batch(ctx, 0, NULL, NULL, NULL, NULL),
+            1))
+        goto out;
+
+    for (i = 0; i < OSSL_NELEM(sigs); i++) {
+        memset(tbsbuf[i], (int)i, sizeof(tbsbuf[i]));
+        tbs[i] = tbsbuf[i];
+        tbslens[i] = sizeof(tbsbuf[i]);
+        siglens[i] = sig_len;
+        if (!TEST_ptr(sigs[i] = OPENSSL_malloc(sig_len)))
+            goto out;
+    }
+
+    /* A signature buffer that is too short fails the batch */
+    siglens[3] = 1;
+    if (!TEST_int_le(EVP_PKEY_sign_batch(ctx, OSSL_NELEM(sigs), sigs, siglens,
+                         tbs, tbslens),
+            0))
+        goto out;
+    for (i = 0; i < OSSL_NELEM(sigs); i++)
+        siglens[i] = sig_len;
+
+    if (!TEST_int_gt(EVP_PKEY_sign_batch(ctx, OSSL_NELEM(sigs), sigs, siglens,
+                         tbs, tbslens),
+            0)
+        || !TEST_int_gt(EVP_PKEY_verify_init(ctx), 0)
+        || !TEST_int_gt(EVP_PKEY_CTX_set_signature_md(ctx, EVP_sha256()), 0))
+        goto out;
+
+    /* Each signature verifies with its own digest only */
+    for (i = 0; i < OSSL_NELEM(sigs); i++) {
+        if (!TEST_size_t_le(siglens[i], sig_len)
+            || !TEST_int_gt(EVP_PKEY_verify(ctx, sigs[i], siglens[i], tbs[i],
+                                tbslens[i]),
+                0)
+            || !TEST_int_le(EVP_PKEY_verify(ctx, sigs[i], siglens[i],
+                                tbs[(i + 1) % OSSL_NELEM(tbs)], tbslens[i]),
+                0))
+            goto out;
+    }
+
+    ret = 1;
+out:
+    for (i = 0; i < OSSL_NELEM(sigs); i++)
+        OPENSSL_free(sigs[i]);
+    EVP_PKEY_CTX_free(ctx);
+    EVP_PKEY_free(pkey);
+    return ret;
+}
+
 #ifndef OPENSSL_NO_DEPRECATED_3_0
 static int test_EVP_PKEY_sign_with_app_method(int tst)
 {
@@ -9488,6 +9573,7 @@ int setup_tests(void)
     ADD_TEST(test_evp_mac_poly1305_no_key);
 #endif
     ADD_ALL_TESTS(test_EVP_PKEY_sign, 3);
+    ADD_ALL_TESTS(test_EVP_PKEY_sign_batch, 2);
 #ifndef OPENSSL_NO_DEPRECATED_3_0
     ADD_ALL_TESTS(test_EVP_PKEY_sign_with_app_method, 2);
 #endif
@@ -13,6 +13,7 @@
 #include "testutil.h"
 #include <openssl/ssl.h>
 #include "internal/quic_cc.h"
+#include "internal/quic_pacer.h"
 #include "internal/priority_queue.h"
 
 /*
@@ -33,6 +34,12 @@ static void step_time(uint32_t ms)
     fake_time = ossl_time_add(fake_time, ossl_ms2time(ms));
 }
 
+static const OSSL_CC_METHOD *cc_methods[] = {
+    &ossl_cc_newreno_method,
+    &ossl_cc_cubic_method,
+    &ossl_cc_bbr_method,
+};
+
 /*
  * Network Simulation
  * ==================
@@ -46,6 +53,10 @@ static void step_time(uint32_t ms)
  * congestion controller of ack/loss events automatically but the caller is
  * responsible for querying the congestion controller and choosing the size of
  * simulated transmitted packets.
+ *
+ * Optionally, a fraction of packets can also be dropped at random (for example
+ * to model a lossy long-haul or wireless link) using a deterministic
+ * pseudorandom sequence so that results are reproducible.
  */
 typedef struct net_pkt_st {
     /*
@@ -104,6 +115,9 @@ struct net_sim {
     uint64_t spare_capacity;
     PRIORITY_QUEUE_OF(NET_PKT) * pkts;
 
+    uint32_t loss_rate; /* random loss, in packets per 10000 */
+    uint32_t rand_state;
+
     uint64_t total_acked, total_lost; /* bytes */
 };
 
@@ -119,6 +133,9 @@ static int net_sim_init(struct net_sim *s,
 
     s->spare_capacity = capacity;
 
+    s->loss_rate = 0;
+    s->rand_state = 1;
+
     s->total_acked = 0;
     s->total_lost = 0;
 
@@ -140,6 +157,15 @@ static void net_sim_cleanup(struct net_sim *s)
 
 static int net_sim_process(struct net_sim *s, size_t skip_forward);
 
+static int net_sim_random_loss(struct net_sim *s)
+{
+    if (s->loss_rate == 0)
+        return 0;
+
+    s->rand_state = s->rand_state * 1103515245 + 12345;
+    return ((s->rand_state >> 16) % 10000) < s->loss_rate;
+}
+
 static int net_sim_send(struct net_sim *s, size_t sz)
 {
     NET_PKT *pkt = OPENSSL_zalloc(sizeof(*pkt));
@@ -156,7 +182,7 @@ static int net_sim_send(struct net_sim *s, size_t sz)
         goto err;
 
     /* Do we have room for the packet in the network? */
-    success = (sz <= s->spare_capacity);
+    success = (sz <= s->spare_capacity) && !net_sim_random_loss(s);
 
     pkt->tx_time = fake_time;
     pkt->success = success;
@@ -328,12 +354,12 @@ static int dump_state(const OSSL_CC_METHOD *ccm, OSSL_CC_DATA *cc,
  * capacity. The average estimated channel capacity should not be too far from
  * the actual channel capacity.
  */
-static int test_simulate(void)
+static int test_simulate(int idx)
 {
     int testresult = 0;
     int rc;
     int have_sim = 0;
-    const OSSL_CC_METHOD *ccm = &ossl_cc_newreno_method;
+    const OSSL_CC_METHOD *ccm = cc_methods[idx];
     OSSL_CC_DATA *cc = NULL;
     size_t mdpl = 1472;
     uint64_t total_sent = 0, total_to_send, allowance;
@@ -477,17 +503,111 @@ err:
     return testresult;
 }
 
+/*
+ * Goodput Test
+ * ============
+ *
+ * Simulates bulk transfer over a long fat link with random loss for a fixed
+ * period and compares the goodput achieved by each congestion controller.
+ * With rare loss, CUBIC should recover from each loss much faster than
+ * NewReno; with a loss rate that is low but high enough to keep the loss-based
+ * controllers at a small window, the model-based controller should do better
+ * than both.
+ */
+#define GOODPUT_SIM_SECS 30
+
+static int simulate_goodput(const OSSL_CC_METHOD *ccm, uint32_t loss_rate,
+    uint64_t *goodput)
+{
+    int testresult = 0;
+    int have_sim = 0;
+    OSSL_CC_DATA *cc = NULL;
+    size_t mdpl = 1472;
+    struct net_sim sim;
+    OSSL_PARAM params[2];
+    OSSL_TIME end_time;
+
+    fake_time = TIME_BASE;
+    end_time = ossl_time_add(fake_time, ossl_seconds2time(GOODPUT_SIM_SECS));
+
+    if (!TEST_ptr(cc = ccm->new(fake_now, NULL)))
+        goto err;
+
+    /* 500 kB in the pipe each way, 50 ms one-way latency: 10 MB/s. */
+    if (!TEST_true(net_sim_init(&sim, ccm, cc, 500000, 50)))
+        goto err;
+
+    have_sim = 1;
+    sim.loss_rate = loss_rate;
+
+    params[0] = OSSL_PARAM_construct_size_t(OSSL_CC_OPTION_MAX_DGRAM_PAYLOAD_LEN,
+        &mdpl);
+    params[1] = OSSL_PARAM_construct_end();
+
+    if (!TEST_true(ccm->set_input_params(cc, params)))
+        goto err;
+
+    ccm->reset(cc);
+
+    while (ossl_time_compare(fake_time, end_time) < 0) {
+        /* Send full-sized packets back to back while we have allowance. */
+        while (ccm->get_tx_allowance(cc) >= mdpl) {
+            fake_time = ossl_time_add(fake_time, ossl_us2time(50));
+            if (!TEST_true(net_sim_send(&sim, mdpl)))
+                goto err;
+        }
+
+        if (!TEST_int_gt(net_sim_process(&sim, 1), 0))
+            goto err;
+    }
+
+    *goodput = sim.total_acked / GOODPUT_SIM_SECS;
+    testresult = 1;
+err:
+    if (have_sim)
+        net_sim_cleanup(&sim);
+
+    if (cc != NULL)
+        ccm->free(cc);
+
+    return testresult;
+}
+
+static int test_goodput(int idx)
+{
+    /* Random loss rate per 10000 packets: 0.01% and 1%. */
+    uint32_t loss_rate = idx == 0 ? 1 : 100;
+    uint64_t newreno, cubic, bbr;
+
+    if (!TEST_true(simulate_goodput(&ossl_cc_newreno_method, loss_rate,
+            &newreno))
+        || !TEST_true(simulate_goodput(&ossl_cc_cubic_method, loss_rate,
+            &cubic))
+        || !TEST_true(simulate_goodput(&ossl_cc_bbr_method, loss_rate, &bbr)))
+        return 0;
+
+    TEST_info("loss %u/10000: newreno=%llu cubic=%llu bbr=%llu B/s",
+        loss_rate, (unsigned long long)newreno, (unsigned long long)cubic,
+        (unsigned long long)bbr);
+
+    if (idx == 0)
+        return TEST_uint64_t_gt(cubic, newreno);
+
+    return TEST_uint64_t_gt(bbr, newreno)
+        && TEST_uint64_t_gt(bbr, cubic);
+}
+
 /*
  * Sanity Test
  * ===========
  *
  * Basic test of the congestion control APIs.
  */
-static int test_sanity(void)
+static int test_sanity(int idx)
 {
     int testresult = 0;
     OSSL_CC_DATA *cc = NULL;
-    const OSSL_CC_METHOD *ccm = &ossl_cc_newreno_method;
+    const OSSL_CC_METHOD *ccm = cc_methods[idx];
     OSSL_CC_LOSS_INFO loss_info = { 0 };
     OSSL_CC_ACK_INFO ack_info = { 0 };
     uint64_t allowance, allowance2;
@@ -611,6 +731,128 @@ err:
     return testresult;
 }
 
+/*
+ * Pacing Tests
+ * ============
+ *
+ * Checks the pacing rates reported by the congestion controllers and the
+ * behaviour of the token bucket used to apply them.
+ */
+static int test_pacing_rate(int idx)
+{
+    int testresult = 0;
+    OSSL_CC_DATA *cc = NULL;
+    const OSSL_CC_METHOD *ccm = cc_methods[idx];
+    uint64_t cwnd, rate;
+
+    fake_time = TIME_BASE;
+
+    if (!TEST_ptr(ccm->get_pacing_rate)
+        || !TEST_ptr(cc = ccm->new(fake_now, NULL)))
+        goto err;
+
+    /* Nothing is in flight, so the allowance is the whole initial window. */
+    cwnd = ccm->get_tx_allowance(cc);
+
+    /* Without an RTT estimate there is no basis for pacing. */
+    if (!TEST_uint64_t_eq(ccm->get_pacing_rate(cc, ossl_time_zero()),
+            UINT64_MAX))
+        goto err;
+
+    /*
+     * During startup, all of the controllers pace at no less than twice the
+     * window per round trip, so that pacing does not slow down window growth.
+     */
+    rate = ccm->get_pacing_rate(cc, ossl_ms2time(100));
+    if (!TEST_uint64_t_ge(rate, cwnd * 10 * 2)
+        || !TEST_uint64_t_lt(rate, cwnd * 10 * 3))
+        goto err;
+
+    testresult = 1;
+err:
+    if (cc != NULL)
+        ccm->free(cc);
+
+    return testresult;
+}
+
+static int test_pacer(void)
+{
+    QUIC_PACER pacer;
+    OSSL_TIME now = TIME_BASE;
+    const size_t mdpl = 1200;
+
+    ossl_quic_pacer_init(&pacer);
+
+    /* A new pacer does not restrict sending. */
+    if (!TEST_uint64_t_eq(ossl_quic_pacer_get_credit(&pacer, now), UINT64_MAX)
+        || !TEST_true(ossl_time_is_zero(
+            ossl_time_subtract(ossl_quic_pacer_get_deadline(&pacer, mdpl, now),
+                now))))
+        return 0;
+
+    /*
+     * At 1.2 MB/s, 1ms of sending is a single datagram, so the burst limit is
+     * the minimum of ten datagrams. The bucket starts out full.
+     */
+    ossl_quic_pacer_set_rate(&pacer, 1200000, mdpl, now);
+    if (!TEST_uint64_t_eq(ossl_quic_pacer_get_rate(&pacer), 1200000)
+        || !TEST_uint64_t_eq(ossl_quic_pacer_get_credit(&pacer, now),
+            10 * mdpl))
+        return 0;
+
+    /* Sending a full burst empties the bucket. */
+    ossl_quic_pacer_consume_credit(&pacer, 10 * mdpl, now);
+    if (!TEST_uint64_t_eq(ossl_quic_pacer_get_credit(&pacer, now), 0))
+        return 0;
+
+    /* The next datagram can be sent after 1ms. */
+    if (!TEST_uint64_t_eq(
+            ossl_time2ticks(ossl_quic_pacer_get_deadline(&pacer, mdpl, now)),
+            ossl_time2ticks(ossl_time_add(now, ossl_ms2time(1)))))
+        return 0;
+
+    now = ossl_time_add(now, ossl_us2time(500));
+    if (!TEST_uint64_t_eq(ossl_quic_pacer_get_credit(&pacer, now), mdpl / 2))
+        return 0;
+
+    now = ossl_time_add(now, ossl_us2time(500));
+    if (!TEST_uint64_t_eq(ossl_quic_pacer_get_credit(&pacer, now), mdpl))
+        return 0;
+
+    /* Credit does not accumulate beyond the burst limit. */
+    now = ossl_time_add(now, ossl_ms2time(1000));
+    if (!TEST_uint64_t_eq(ossl_quic_pacer_get_credit(&pacer, now), 10 * mdpl))
+        return 0;
+
+    /* At higher rates the burst limit is 1ms of sending. */
+    ossl_quic_pacer_set_rate(&pacer, 100000000, mdpl, now);
+    now = ossl_time_add(now, ossl_ms2time(1000));
+    if (!TEST_uint64_t_eq(ossl_quic_pacer_get_credit(&pacer, now), 100000))
+        return 0;
+
+    /* Overspending never leaves the bucket in debt. */
+    ossl_quic_pacer_consume_credit(&pacer, 200000, now);
+    if (!TEST_uint64_t_eq(ossl_quic_pacer_get_credit(&pacer, now), 0))
+        return 0;
+
+    /* Turning pacing off lifts the restriction. */
+    ossl_quic_pacer_set_rate(&pacer, UINT64_MAX, mdpl, now);
+    if (!TEST_uint64_t_eq(ossl_quic_pacer_get_credit(&pacer, now), UINT64_MAX))
+        return 0;
+
+    /* A window of 12000 bytes per 100ms is 120000 bytes per second. */
+    if (!TEST_uint64_t_eq(ossl_quic_pacer_rate_from_cwnd(12000,
+                              ossl_ms2time(100), 100),
+            120000)
+        || !TEST_uint64_t_eq(ossl_quic_pacer_rate_from_cwnd(12000,
+                                 ossl_ms2time(100), 125),
+            150000))
+        return 0;
+
+    return 1;
+}
+
 int setup_tests(void)
 {
 
@@ -626,7 +868,10 @@ int setup_tests(void)
         "\"State\"\n");
 #endif
 
-    ADD_TEST(test_simulate);
-    ADD_TEST(test_sanity);
+    ADD_ALL_TESTS(test_simulate, OSSL_NELEM(cc_methods));
+    ADD_ALL_TESTS(test_sanity, OSSL_NELEM(cc_methods));
+    ADD_ALL_TESTS(test_goodput, 2);
+    ADD_ALL_TESTS(test_pacing_rate, OSSL_NELEM(cc_methods));
+    ADD_TEST(test_pacer);
     return 1;
 }
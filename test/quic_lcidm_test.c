@@ -99,8 +99,43 @@ err:
     return testresult;
 }
 
+static int test_lcidm_shard(void)
+{
+    int testresult = 0;
+    QUIC_LCIDM *lcidm = NULL, *lcidm0 = NULL;
+    QUIC_CONN_ID lcid_init, lcid_unused;
+    OSSL_QUIC_FRAME_NEW_CONN_ID ncid_frame;
+
+    /* Zero-length LCIDs cannot carry a shard index */
+    if (!TEST_ptr(lcidm0 = ossl_quic_lcidm_new(NULL, 0))
+        || !TEST_false(ossl_quic_lcidm_set_shard(lcidm0, 1)))
+        goto err;
+
+    if (!TEST_ptr(lcidm = ossl_quic_lcidm_new(NULL, 8))
+        || !TEST_int_eq(ossl_quic_lcidm_get_cid_shard(lcidm, &cid8_3), -1)
+        || !TEST_true(ossl_quic_lcidm_set_shard(lcidm, 3))
+        || !TEST_int_eq(ossl_quic_lcidm_get_cid_shard(lcidm, &cid8_3), 3))
+        goto err;
+
+    if (!TEST_true(ossl_quic_lcidm_generate_initial(lcidm, ptrs + 0, &lcid_init))
+        || !TEST_true(ossl_quic_lcidm_generate(lcidm, ptrs + 0, &ncid_frame))
+        || !TEST_true(ossl_quic_lcidm_get_unused_cid(lcidm, &lcid_unused))
+        || !TEST_int_eq(ossl_quic_lcidm_get_cid_shard(lcidm, &lcid_init), 3)
+        || !TEST_int_eq(ossl_quic_lcidm_get_cid_shard(lcidm,
+            &ncid_frame.conn_id), 3)
+        || !TEST_int_eq(ossl_quic_lcidm_get_cid_shard(lcidm, &lcid_unused), 3))
+        goto err;
+
+    testresult = 1;
+err:
+    ossl_quic_lcidm_free(lcidm);
+    ossl_quic_lcidm_free(lcidm0);
+    return testresult;
+}
+
 int setup_tests(void)
 {
     ADD_TEST(test_lcidm);
+    ADD_TEST(test_lcidm_shard);
     return 1;
 }
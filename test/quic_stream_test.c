@@ -213,6 +213,189 @@ err:
     return testresult;
 }
 
+static const unsigned char data_2[] = {
+    0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9
+};
+
+static const unsigned char data_3[] = {
+    0xb0, 0xb1, 0xb2, 0xb3, 0xb4
+};
+
+static const unsigned char *released[4];
+static size_t num_released;
+
+static void release_cb(const void *buf, size_t len, void *arg)
+{
+    if (num_released < OSSL_NELEM(released))
+        released[num_released] = buf;
+
+    ++num_released;
+}
+
+/*
+ * Test a stream made up of copied data interleaved with application buffers
+ * which are referenced rather than copied.
+ */
+static int test_sstream_nocopy(void)
+{
+    int testresult = 0;
+    QUIC_SSTREAM *sstream = NULL;
+    OSSL_QUIC_FRAME_STREAM hdr;
+    OSSL_QTX_IOVEC iov[4];
+    unsigned char ref[23];
+    size_t num_iov, wr = 0;
+    uint64_t final_size = 0;
+
+    num_released = 0;
+
+    /* 4 copied bytes, data_2, 4 copied bytes, data_3 */
+    memcpy(ref, data_1, 4);
+    memcpy(ref + 4, data_2, sizeof(data_2));
+    memcpy(ref + 14, data_1 + 4, 4);
+    memcpy(ref + 18, data_3, sizeof(data_3));
+
+    if (!TEST_ptr(sstream = ossl_quic_sstream_new(8)))
+        goto err;
+
+    if (!TEST_true(ossl_quic_sstream_append(sstream, data_1, 4, &wr))
+        || !TEST_size_t_eq(wr, 4)
+        || !TEST_true(ossl_quic_sstream_append_nocopy(sstream, data_2,
+            sizeof(data_2),
+            release_cb, NULL))
+        || !TEST_true(ossl_quic_sstream_append(sstream, data_1 + 4, 4, &wr))
+        || !TEST_size_t_eq(wr, 4)
+        || !TEST_true(ossl_quic_sstream_append_nocopy(sstream, data_3,
+            sizeof(data_3),
+            release_cb, NULL)))
+        goto err;
+
+    /* Application buffers do not use the ring buffer. */
+    if (!TEST_uint64_t_eq(ossl_quic_sstream_get_cur_size(sstream), sizeof(ref))
+        || !TEST_size_t_eq(ossl_quic_sstream_get_buffer_used(sstream), 8))
+        goto err;
+
+    ossl_quic_sstream_fin(sstream);
+
+    /* No more data can be appended, and the buffer is not referenced. */
+    if (!TEST_false(ossl_quic_sstream_append_nocopy(sstream, data_3,
+            sizeof(data_3),
+            release_cb, NULL))
+        || !TEST_size_t_eq(num_released, 0)
+        || !TEST_true(ossl_quic_sstream_get_final_size(sstream, &final_size))
+        || !TEST_uint64_t_eq(final_size, sizeof(ref)))
+        goto err;
+
+    /* With two iovecs, the frame stops at the end of data_2. */
+    num_iov = 2;
+    if (!TEST_true(ossl_quic_sstream_get_stream_frame(sstream, 0, &hdr, iov,
+            &num_iov))
+        || !TEST_size_t_eq(num_iov, 2)
+        || !TEST_uint64_t_eq(hdr.offset, 0)
+        || !TEST_uint64_t_eq(hdr.len, 14)
+        || !TEST_false(hdr.is_fin)
+        || !TEST_true(compare_iov(ref, 14, iov, num_iov))
+        || !TEST_ptr_eq(iov[1].buf, data_2))
+        goto err;
+
+    /* With enough iovecs, the whole stream is returned. */
+    num_iov = OSSL_NELEM(iov);
+    if (!TEST_true(ossl_quic_sstream_get_stream_frame(sstream, 0, &hdr, iov,
+            &num_iov))
+        || !TEST_size_t_eq(num_iov, 4)
+        || !TEST_uint64_t_eq(hdr.len, sizeof(ref))
+        || !TEST_true(hdr.is_fin)
+        || !TEST_true(compare_iov(ref, sizeof(ref), iov, num_iov)))
+        goto err;
+
+    if (!TEST_true(ossl_quic_sstream_mark_transmitted(sstream, 0, 9)))
+        goto err;
+
+    /* Start part way through data_2. */
+    num_iov = OSSL_NELEM(iov);
+    if (!TEST_true(ossl_quic_sstream_get_stream_frame(sstream, 0, &hdr, iov,
+            &num_iov))
+        || !TEST_uint64_t_eq(hdr.offset, 10)
+        || !TEST_uint64_t_eq(hdr.len, sizeof(ref) - 10)
+        || !TEST_true(hdr.is_fin)
+        || !TEST_true(compare_iov(ref + 10, sizeof(ref) - 10, iov, num_iov)))
+        goto err;
+
+    if (!TEST_true(ossl_quic_sstream_mark_transmitted(sstream, 10,
+            sizeof(ref) - 1))
+        || !TEST_true(ossl_quic_sstream_mark_transmitted_fin(sstream,
+            sizeof(ref))))
+        goto err;
+
+    /*
+     * Acknowledging part of data_2 frees the copied data before it but does not
+     * release data_2.
+     */
+    if (!TEST_true(ossl_quic_sstream_mark_acked(sstream, 0, 9))
+        || !TEST_size_t_eq(num_released, 0)
+        || !TEST_size_t_eq(ossl_quic_sstream_get_buffer_used(sstream), 4))
+        goto err;
+
+    /* Out of order acknowledgement does not release data_3 either. */
+    if (!TEST_true(ossl_quic_sstream_mark_acked(sstream, 14, sizeof(ref) - 1))
+        || !TEST_size_t_eq(num_released, 0))
+        goto err;
+
+    /* Retransmission of the rest of data_2 still reads from it. */
+    if (!TEST_true(ossl_quic_sstream_mark_lost(sstream, 10, 13)))
+        goto err;
+
+    num_iov = OSSL_NELEM(iov);
+    if (!TEST_true(ossl_quic_sstream_get_stream_frame(sstream, 0, &hdr, iov,
+            &num_iov))
+        || !TEST_uint64_t_eq(hdr.offset, 10)
+        || !TEST_uint64_t_eq(hdr.len, 4)
+        || !TEST_false(hdr.is_fin)
+        || !TEST_true(compare_iov(data_2 + 6, 4, iov, num_iov)))
+        goto err;
+
+    if (!TEST_true(ossl_quic_sstream_mark_transmitted(sstream, 10, 13)))
+        goto err;
+
+    /* Once everything is acknowledged, both buffers are released in order. */
+    if (!TEST_true(ossl_quic_sstream_mark_acked(sstream, 10, 13))
+        || !TEST_size_t_eq(num_released, 2)
+        || !TEST_ptr_eq(released[0], data_2)
+        || !TEST_ptr_eq(released[1], data_3)
+        || !TEST_size_t_eq(ossl_quic_sstream_get_buffer_used(sstream), 0)
+        || !TEST_true(ossl_quic_sstream_mark_acked_fin(sstream))
+        || !TEST_true(ossl_quic_sstream_is_totally_acked(sstream)))
+        goto err;
+
+    ossl_quic_sstream_free(sstream);
+    sstream = NULL;
+
+    /* Buffers are not released twice. */
+    if (!TEST_size_t_eq(num_released, 2))
+        goto err;
+
+    /* Freeing a stream releases buffers which were never acknowledged. */
+    if (!TEST_ptr(sstream = ossl_quic_sstream_new(8))
+        || !TEST_true(ossl_quic_sstream_append_nocopy(sstream, data_2,
+            sizeof(data_2),
+            release_cb, NULL))
+        || !TEST_true(ossl_quic_sstream_append_nocopy(sstream, data_3,
+            sizeof(data_3),
+            NULL, NULL)))
+        goto err;
+
+    ossl_quic_sstream_free(sstream);
+    sstream = NULL;
+
+    if (!TEST_size_t_eq(num_released, 3)
+        || !TEST_ptr_eq(released[2], data_2))
+        goto err;
+
+    testresult = 1;
+err:
+    ossl_quic_sstream_free(sstream);
+    return testresult;
+}
+
 static int test_sstream_bulk(int idx)
 {
     int testresult = 0;
@@ -598,6 +781,7 @@ err:
 int setup_tests(void)
 {
     ADD_TEST(test_sstream_simple);
+    ADD_TEST(test_sstream_nocopy);
     ADD_ALL_TESTS(test_sstream_bulk, 100);
     ADD_ALL_TESTS(test_rstream_simple, 4);
     ADD_ALL_TESTS(test_rstream_random, 100);
@@ -1195,6 +1195,93 @@ err:
     return testresult;
 }
 
+static size_t nocopy_released;
+static const void *nocopy_released_buf;
+
+static void nocopy_release_cb(const void *buf, size_t len, void *arg)
+{
+    nocopy_released += len;
+    nocopy_released_buf = buf;
+    ++*(int *)arg;
+}
+
+/*
+ * Test that SSL_write_ex_nocopy() sends the data of the buffer and releases
+ * it once the peer has acknowledged all of it, or when the stream is freed
+ */
+static int test_write_nocopy(void)
+{
+    SSL_CTX *cctx = SSL_CTX_new_ex(libctx, NULL, OSSL_QUIC_client_method());
+    SSL *clientquic = NULL;
+    QUIC_TSERVER *qtserv = NULL;
+    int testresult = 0, calls = 0, i;
+    unsigned char *msg = NULL, *buf = NULL;
+    const size_t msglen = 100 * 1024;
+    size_t readbytes, total = 0;
+
+    nocopy_released = 0;
+    nocopy_released_buf = NULL;
+
+    if (!TEST_ptr(cctx)
+        || !TEST_ptr(msg = OPENSSL_malloc(msglen))
+        || !TEST_ptr(buf = OPENSSL_malloc(msglen))
+        || !TEST_int_eq(RAND_bytes_ex(libctx, msg, msglen, 0), 1)
+        || !TEST_true(qtest_create_quic_objects(libctx, cctx, NULL, cert,
+            privkey, 0, &qtserv,
+            &clientquic, NULL, NULL))
+        || !TEST_true(qtest_create_quic_connection(qtserv, clientquic)))
+        goto err;
+
+    /* An empty buffer is released straight away */
+    if (!TEST_true(SSL_write_ex_nocopy(clientquic, msg, 0, 0,
+            nocopy_release_cb, &calls))
+        || !TEST_int_eq(calls, 1)
+        || !TEST_size_t_eq(nocopy_released, 0))
+        goto err;
+
+    if (!TEST_true(SSL_write_ex_nocopy(clientquic, msg, msglen, 0,
+            nocopy_release_cb, &calls))
+        || !TEST_int_eq(calls, 1))
+        goto err;
+
+    for (i = 0; i < 2000 && (total < msglen || calls < 2); i++) {
+        ossl_quic_tserver_tick(qtserv);
+        if (!TEST_true(ossl_quic_tserver_read(qtserv, 0, buf + total,
+                msglen - total, &readbytes)))
+            goto err;
+        total += readbytes;
+        if (!TEST_true(SSL_handle_events(clientquic)))
+            goto err;
+        OSSL_sleep(1);
+    }
+    if (!TEST_mem_eq(buf, total, msg, msglen)
+        || !TEST_int_eq(calls, 2)
+        || !TEST_size_t_eq(nocopy_released, msglen)
+        || !TEST_ptr_eq(nocopy_released_buf, msg))
+        goto err;
+
+    /* A buffer still queued when the connection is freed is released */
+    if (!TEST_true(SSL_write_ex_nocopy(clientquic, msg + 1, msglen - 1, 0,
+            nocopy_release_cb, &calls)))
+        goto err;
+    SSL_free(clientquic);
+    clientquic = NULL;
+    if (!TEST_int_eq(calls, 3)
+        || !TEST_size_t_eq(nocopy_released, 2 * msglen - 1)
+        || !TEST_ptr_eq(nocopy_released_buf, msg + 1))
+        goto err;
+
+    testresult = 1;
+err:
+    SSL_free(clientquic);
+    ossl_quic_tserver_free(qtserv);
+    SSL_CTX_free(cctx);
+    OPENSSL_free(msg);
+    OPENSSL_free(buf);
+
+    return testresult;
+}
+
 static int dgram_ctr = 0;
 
 static void dgram_cb(int write_p, int version, int content_type,
@@ -3064,6 +3151,196 @@ err:
     return testresult;
 }
 
+#if defined(OPENSSL_THREADS)
+/*
+ * Test that a packet for a connection owned by one listener shard which is
+ * received by another shard in the same group is handed off to the owner.
+ */
+static int test_listener_shard(void)
+{
+    SSL_CTX *cctx = NULL, *sctx = NULL;
+    SSL *clientssl = NULL, *serverssl = NULL, *qlistener = NULL;
+    SSL *shard = NULL;
+    BIO *cbio = NULL, *sbio = NULL;
+    BIO_ADDR *addr = NULL;
+    struct in_addr ina;
+    static const char msg[] = "handed off";
+    char buf[sizeof(msg)];
+    size_t written, readbytes = 0;
+    int testresult = 0;
+    int ret, i;
+
+    ina.s_addr = htonl(0x1f000001);
+
+    if (!TEST_ptr(sctx = create_server_ctx())
+        || !TEST_ptr(cctx = create_client_ctx()))
+        goto err;
+
+    if (!create_quic_ssl_objects(sctx, cctx, &qlistener, &clientssl))
+        goto err;
+
+    /* Only listeners can be sharded */
+    if (!TEST_ptr_null(SSL_new_listener_from(clientssl,
+            SSL_LISTENER_FLAG_SHARD)))
+        goto err;
+
+    if (!TEST_ptr(shard = SSL_new_listener_from(qlistener,
+                      SSL_LISTENER_FLAG_SHARD))
+        || !TEST_true(SSL_is_listener(shard)))
+        goto err;
+
+    /*
+     * The shard is a separate "socket" bound to the same address, as with
+     * SO_REUSEPORT.
+     */
+    if (!TEST_true(BIO_new_bio_dgram_pair(&cbio, 0, &sbio, 0))
+        || !TEST_ptr(addr = create_addr(&ina, 8040))
+        || !TEST_true(bio_addr_bind(sbio, addr)))
+        goto err;
+    addr = NULL;
+    if (!TEST_ptr(addr = create_addr(&ina, 8040))
+        || !TEST_true(bio_addr_bind(cbio, addr)))
+        goto err;
+    addr = NULL;
+
+    SSL_set_bio(shard, sbio, sbio);
+    sbio = NULL;
+    if (!TEST_true(SSL_listen(shard)))
+        goto err;
+
+    /* Send ClientHello and server retry */
+    for (i = 0; i < 2; i++) {
+        ret = SSL_connect(clientssl);
+        if (!TEST_int_le(ret, 0)
+            || !TEST_int_eq(SSL_get_error(clientssl, ret), SSL_ERROR_WANT_READ))
+            goto err;
+        SSL_handle_events(qlistener);
+    }
+
+    if (!TEST_ptr(serverssl = SSL_accept_connection(qlistener, 0))
+        || !TEST_true(create_bare_ssl_connection(serverssl, clientssl,
+            SSL_ERROR_NONE, 0, 0)))
+        goto err;
+
+    /*
+     * Route the client's subsequent packets to the shard, which does not know
+     * the connection, as if the client's path had changed.
+     */
+    SSL_set0_wbio(clientssl, cbio);
+    cbio = NULL;
+
+    if (!TEST_true(SSL_write_ex(clientssl, msg, sizeof(msg), &written)))
+        goto err;
+
+    for (i = 0; i < 10 && readbytes == 0; i++) {
+        SSL_handle_events(clientssl);
+        SSL_handle_events(shard);
+        if (!SSL_read_ex(serverssl, buf, sizeof(buf), &readbytes)
+            && !TEST_int_eq(SSL_get_error(serverssl, 0), SSL_ERROR_WANT_READ))
+            goto err;
+    }
+
+    if (!TEST_mem_eq(buf, readbytes, msg, sizeof(msg)))
+        goto err;
+
+    testresult = 1;
+
+err:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_free(shard);
+    SSL_free(qlistener);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    BIO_free(cbio);
+    BIO_free(sbio);
+    BIO_ADDR_free(addr);
+
+    return testresult;
+}
+#endif
+
+/*
+ * Test that the congestion controller can be selected on a listener (for the
+ * connections it accepts) and on a client connection before it is started.
+ */
+static int test_congestion_control(int idx)
+{
+    SSL_CTX *cctx = NULL, *sctx = NULL;
+    SSL *clientssl = NULL, *serverssl = NULL, *qlistener = NULL;
+    int testresult = 0;
+    int ret, i;
+    uint64_t v;
+
+    if (!TEST_ptr(sctx = create_server_ctx())
+        || !TEST_ptr(cctx = create_client_ctx()))
+        goto err;
+
+    if (!create_quic_ssl_objects(sctx, cctx, &qlistener, &clientssl))
+        goto err;
+
+    /* NewReno is the default */
+    if (!TEST_true(SSL_get_generic_value_uint(qlistener,
+            SSL_VALUE_QUIC_CONGESTION_CONTROL, &v))
+        || !TEST_uint64_t_eq(v, SSL_VALUE_QUIC_CC_NEWRENO)
+        || !TEST_true(SSL_get_generic_value_uint(clientssl,
+            SSL_VALUE_QUIC_CONGESTION_CONTROL, &v))
+        || !TEST_uint64_t_eq(v, SSL_VALUE_QUIC_CC_NEWRENO))
+        goto err;
+
+    /* Unknown algorithms are rejected */
+    if (!TEST_false(SSL_set_generic_value_uint(qlistener,
+            SSL_VALUE_QUIC_CONGESTION_CONTROL,
+            SSL_VALUE_QUIC_CC_BBR + 1)))
+        goto err;
+
+    if (!TEST_true(SSL_set_generic_value_uint(qlistener,
+            SSL_VALUE_QUIC_CONGESTION_CONTROL, idx))
+        || !TEST_true(SSL_set_generic_value_uint(clientssl,
+            SSL_VALUE_QUIC_CONGESTION_CONTROL, idx))
+        || !TEST_true(SSL_get_generic_value_uint(clientssl,
+            SSL_VALUE_QUIC_CONGESTION_CONTROL, &v))
+        || !TEST_uint64_t_eq(v, (uint64_t)idx))
+        goto err;
+
+    /* Send ClientHello and server retry */
+    for (i = 0; i < 2; i++) {
+        ret = SSL_connect(clientssl);
+        if (!TEST_int_le(ret, 0)
+            || !TEST_int_eq(SSL_get_error(clientssl, ret), SSL_ERROR_WANT_READ))
+            goto err;
+        SSL_handle_events(qlistener);
+    }
+
+    if (!TEST_ptr(serverssl = SSL_accept_connection(qlistener, 0))
+        || !TEST_true(create_bare_ssl_connection(serverssl, clientssl,
+            SSL_ERROR_NONE, 0, 0)))
+        goto err;
+
+    /* The accepted connection inherits the listener's setting */
+    if (!TEST_true(SSL_get_generic_value_uint(serverssl,
+            SSL_VALUE_QUIC_CONGESTION_CONTROL, &v))
+        || !TEST_uint64_t_eq(v, (uint64_t)idx))
+        goto err;
+
+    /* The algorithm cannot be changed once the connection has started */
+    if (!TEST_false(SSL_set_generic_value_uint(clientssl,
+            SSL_VALUE_QUIC_CONGESTION_CONTROL,
+            (idx + 1) % (SSL_VALUE_QUIC_CC_BBR + 1))))
+        goto err;
+
+    testresult = 1;
+
+err:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_free(qlistener);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+
+    return testresult;
+}
+
 static SSL *quic_verify_ssl = NULL;
 
 static int quic_verify_cb(int ok, X509_STORE_CTX *ctx)
@@ -3659,6 +3936,179 @@ err:
     return ret;
 }
 
+/*
+ * Test that pacing can be enabled on a listener (for the connections it
+ * accepts) and on a connection at any time, and that a paced transfer using
+ * each congestion controller completes promptly. The fake clock is stepped by
+ * 1ms at a time so that the pacer can release data.
+ */
+#define PACING_XFER_LEN (256 * 1024)
+#define PACING_ACK_SLACK 100
+
+static size_t pacing_step_bytes;
+
+static void pacing_dgram_cb(int write_p, int version, int content_type,
+    const void *buf, size_t msglen, SSL *ssl, void *arg)
+{
+    if (write_p && content_type == SSL3_RT_QUIC_DATAGRAM)
+        pacing_step_bytes += msglen;
+}
+
+static int test_pacing(int idx)
+{
+    SSL_CTX *cctx = NULL, *sctx = NULL;
+    SSL *clientssl = NULL, *serverssl = NULL, *qlistener = NULL;
+    unsigned char *sbuf = NULL, *rbuf = NULL;
+    size_t written = 0, readbytes = 0, n;
+    QUIC_CHANNEL *cch;
+    int testresult = 0;
+    int ret, i, paced_steps = 0;
+    uint64_t v, burst;
+
+    if (!TEST_ptr(sbuf = OPENSSL_malloc(PACING_XFER_LEN))
+        || !TEST_ptr(rbuf = OPENSSL_malloc(PACING_XFER_LEN)))
+        goto err;
+
+    for (n = 0; n < PACING_XFER_LEN; n++)
+        sbuf[n] = (unsigned char)(n * 7);
+
+    if (!TEST_ptr(sctx = create_server_ctx())
+        || !TEST_ptr(cctx = create_client_ctx()))
+        goto err;
+
+    if (!create_quic_ssl_objects_ex(sctx, cctx, &qlistener, &clientssl, 1))
+        goto err;
+
+    /* Pacing is off by default */
+    if (!TEST_true(SSL_get_generic_value_uint(qlistener,
+            SSL_VALUE_QUIC_PACING, &v))
+        || !TEST_uint64_t_eq(v, 0)
+        || !TEST_true(SSL_get_generic_value_uint(clientssl,
+            SSL_VALUE_QUIC_PACING, &v))
+        || !TEST_uint64_t_eq(v, 0))
+        goto err;
+
+    /* Only 0 and 1 are accepted */
+    if (!TEST_false(SSL_set_generic_value_uint(qlistener,
+            SSL_VALUE_QUIC_PACING, 2)))
+        goto err;
+
+    if (!TEST_true(SSL_set_generic_value_uint(qlistener,
+            SSL_VALUE_QUIC_CONGESTION_CONTROL, idx))
+        || !TEST_true(SSL_set_generic_value_uint(clientssl,
+            SSL_VALUE_QUIC_CONGESTION_CONTROL, idx))
+        || !TEST_true(SSL_set_generic_value_uint(qlistener,
+            SSL_VALUE_QUIC_PACING, 1)))
+        goto err;
+
+    /* Send ClientHello and server retry */
+    for (i = 0; i < 2; i++) {
+        ret = SSL_connect(clientssl);
+        if (!TEST_int_le(ret, 0)
+            || !TEST_int_eq(SSL_get_error(clientssl, ret), SSL_ERROR_WANT_READ))
+            goto err;
+        SSL_handle_events(qlistener);
+    }
+
+    if (!TEST_ptr(serverssl = SSL_accept_connection(qlistener, 0)))
+        goto err;
+
+    /*
+     * Complete the handshake, letting time pass so that the server's pacer
+     * can release its flight.
+     */
+    for (i = 0; i < 1000; i++) {
+        ret = SSL_do_handshake(clientssl);
+        if (ret <= 0
+            && !TEST_int_eq(SSL_get_error(clientssl, ret), SSL_ERROR_WANT_READ))
+            goto err;
+        SSL_handle_events(serverssl);
+        if (ret == 1 && SSL_is_init_finished(serverssl))
+            break;
+        fake_now = ossl_time_add(fake_now, ossl_ms2time(1));
+    }
+    if (!TEST_int_lt(i, 1000))
+        goto err;
+
+    /* The accepted connection inherits the listener's setting */
+    if (!TEST_true(SSL_get_generic_value_uint(serverssl,
+            SSL_VALUE_QUIC_PACING, &v))
+        || !TEST_uint64_t_eq(v, 1))
+        goto err;
+
+    /* Pacing can be enabled after the connection has started */
+    if (!TEST_true(SSL_set_generic_value_uint(clientssl,
+            SSL_VALUE_QUIC_PACING, 1))
+        || !TEST_ptr(cch = ossl_quic_conn_get_channel(clientssl))
+        || !TEST_true(ossl_quic_channel_get_pacing(cch)))
+        goto err;
+
+    /*
+     * Without pacing this takes a few tens of iterations. With pacing, no
+     * more than one bucket of data goes out per 1ms step, as the clock stands
+     * still during a step. The client's ACK-only packets are not paced, so
+     * allow for one of those too.
+     */
+    SSL_set_msg_callback(clientssl, pacing_dgram_cb);
+    for (i = 0; i < 500 && readbytes < PACING_XFER_LEN; i++) {
+        burst = ossl_quic_channel_get_pacing_burst(cch);
+        pacing_step_bytes = 0;
+
+        if (written < PACING_XFER_LEN
+            && !SSL_write_ex(clientssl, sbuf + written,
+                PACING_XFER_LEN - written, &n)) {
+            if (!TEST_int_eq(SSL_get_error(clientssl, 0), SSL_ERROR_WANT_WRITE))
+                goto err;
+            n = 0;
+        }
+        written += n;
+
+        SSL_handle_events(clientssl);
+        SSL_handle_events(serverssl);
+
+        if (!SSL_read_ex(serverssl, rbuf + readbytes,
+                PACING_XFER_LEN - readbytes, &n)) {
+            if (!TEST_int_eq(SSL_get_error(serverssl, 0), SSL_ERROR_WANT_READ))
+                goto err;
+            n = 0;
+        }
+        readbytes += n;
+
+        if (burst != 0) {
+            if (!TEST_uint64_t_le(pacing_step_bytes, burst + PACING_ACK_SLACK))
+                goto err;
+            ++paced_steps;
+        }
+
+        fake_now = ossl_time_add(fake_now, ossl_ms2time(1));
+    }
+
+    if (!TEST_mem_eq(rbuf, readbytes, sbuf, PACING_XFER_LEN)
+        || !TEST_int_gt(paced_steps, 0))
+        goto err;
+
+    /* Pacing can be disabled again */
+    if (!TEST_true(SSL_set_generic_value_uint(serverssl,
+            SSL_VALUE_QUIC_PACING, 0))
+        || !TEST_true(SSL_get_generic_value_uint(serverssl,
+            SSL_VALUE_QUIC_PACING, &v))
+        || !TEST_uint64_t_eq(v, 0))
+        goto err;
+
+    testresult = 1;
+
+err:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_free(qlistener);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    OPENSSL_free(sbuf);
+    OPENSSL_free(rbuf);
+
+    return testresult;
+}
+
 /* Test ECH with quic */
 static int test_ech(void)
 {
@@ -4049,6 +4499,7 @@ int setup_tests(void)
     ADD_TEST(test_ssl_listen_ex);
     ADD_TEST(test_ssl_client_as_ossl_quic_method);
     ADD_TEST(test_back_pressure);
+    ADD_TEST(test_write_nocopy);
     ADD_TEST(test_multiple_dgrams);
     ADD_ALL_TESTS(test_non_io_retry, 2);
     ADD_TEST(test_quic_psk);
@@ -4068,6 +4519,11 @@ int setup_tests(void)
 #endif
     ADD_TEST(test_server_method_with_ssl_new);
     ADD_TEST(test_ssl_accept_connection);
+#if defined(OPENSSL_THREADS)
+    ADD_TEST(test_listener_shard);
+#endif
+    ADD_ALL_TESTS(test_congestion_control, SSL_VALUE_QUIC_CC_BBR + 1);
+    ADD_ALL_TESTS(test_pacing, SSL_VALUE_QUIC_CC_BBR + 1);
     ADD_TEST(test_ssl_set_verify);
     ADD_TEST(test_accept_stream);
     ADD_TEST(test_client_hello_retry);
@@ -44,6 +44,12 @@
 #include "../ssl/ssl_local.h"
 #include "../ssl/record/methods/recmethod_local.h"
 #include "filterprov.h"
+#include "fake_pipelineprov.h"
+
+#if defined(OPENSSL_SYS_UNIX)
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #undef OSSL_NO_USABLE_TLS1_3
 #if defined(OPENSSL_NO_TLS1_3) \
@@ -1160,6 +1166,7 @@ static int execute_test_ktls(int cis_ktls, int sis_ktls,
     const size_t bufsz = SSL3_RT_MAX_PLAIN_LENGTH + 16;
     int ret;
     size_t offset = 0, i;
+    uint64_t ktls_bytes, user_bytes;
 
     if (!TEST_true(create_test_sockets(&cfd, &sfd, SOCK_STREAM, NULL)))
         goto end;
@@ -1294,6 +1301,46 @@ static int execute_test_ktls(int cis_ktls, int sis_ktls,
         if (!TEST_true(buf[i] == 0))
             goto end;
 
+    /* Check the bytes were accounted to whichever side did the work */
+    if (!TEST_true(SSL_get_ktls_stats(clientssl, NULL, &ktls_bytes, NULL,
+            &user_bytes)))
+        goto end;
+    if (BIO_get_ktls_send(clientsc->wbio)) {
+        if (!TEST_uint64_t_ge(ktls_bytes, bufsz)
+            || !TEST_uint64_t_eq(user_bytes, 0))
+            goto end;
+    } else {
+        if (!TEST_uint64_t_eq(ktls_bytes, 0)
+            || !TEST_uint64_t_ge(user_bytes, bufsz))
+            goto end;
+    }
+    if (!TEST_true(SSL_get_ktls_stats(serverssl, &ktls_bytes, NULL,
+            &user_bytes, NULL)))
+        goto end;
+    if (BIO_get_ktls_recv(serversc->rbio)) {
+        if (!TEST_uint64_t_ge(ktls_bytes, bufsz)
+            || !TEST_uint64_t_eq(user_bytes, 0))
+            goto end;
+    } else {
+        if (!TEST_uint64_t_eq(ktls_bytes, 0)
+            || !TEST_uint64_t_ge(user_bytes, bufsz))
+            goto end;
+    }
+
+    /*
+     * In TLSv1.3 a key update has to push the new keys into the kernel. That
+     * needs a kernel that supports rekeying.
+     */
+    if (tls_version == TLS1_3_VERSION) {
+        if (!TEST_true(SSL_key_update(clientssl, SSL_KEY_UPDATE_REQUESTED)))
+            goto end;
+        if (!ping_pong_query(clientssl, serverssl)) {
+            if (ERR_GET_REASON(ERR_peek_error()) == SSL_R_KTLS_REKEY_FAILED)
+                testresult = TEST_skip("Kernel does not support KTLS rekeying");
+            goto end;
+        }
+    }
+
     testresult = 1;
 end:
     OPENSSL_free(buf);
@@ -1664,6 +1711,199 @@ static int test_ktls_sendfile(int test)
     return execute_test_ktls_sendfile(cipher->tls_version, cipher->cipher,
         test & 1);
 }
+
+/*
+ * Test SSL_splice() moving data received by the server into a pipe, both
+ * with and without KTLS receive offload.
+ */
+static int execute_test_ktls_splice(int tls_version, const char *cipher,
+    int use_ktls)
+{
+    SSL_CTX *cctx = NULL, *sctx = NULL;
+    SSL *clientssl = NULL, *serverssl = NULL;
+    unsigned char *buf = NULL, *buf_dst = NULL;
+    int cfd = -1, sfd = -1, pipefd[2] = { -1, -1 };
+    ossl_ssize_t ret;
+    size_t off, got;
+    uint64_t ktls_read, user_read;
+    int testresult = 0;
+
+    buf = OPENSSL_zalloc(SENDFILE_SZ);
+    buf_dst = OPENSSL_zalloc(SENDFILE_SZ);
+    if (!TEST_ptr(buf) || !TEST_ptr(buf_dst)
+        || !TEST_int_eq(pipe(pipefd), 0)
+        || !TEST_true(create_test_sockets(&cfd, &sfd, SOCK_STREAM, NULL)))
+        goto end;
+
+    if (use_ktls && !ktls_chk_platform(sfd)) {
+        testresult = TEST_skip("Kernel does not support KTLS");
+        goto end;
+    }
+
+    if (is_fips && strstr(cipher, "CHACHA") != NULL) {
+        testresult = TEST_skip("CHACHA is not supported in FIPS");
+        goto end;
+    }
+
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+            TLS_client_method(),
+            tls_version, tls_version,
+            &sctx, &cctx, cert, privkey)))
+        goto end;
+
+    if (tls_version == TLS1_3_VERSION) {
+        if (!TEST_true(SSL_CTX_set_ciphersuites(cctx, cipher))
+            || !TEST_true(SSL_CTX_set_ciphersuites(sctx, cipher)))
+            goto end;
+    } else {
+        if (!TEST_true(SSL_CTX_set_cipher_list(cctx, cipher))
+            || !TEST_true(SSL_CTX_set_cipher_list(sctx, cipher)))
+            goto end;
+    }
+
+    if (!TEST_true(create_ssl_objects2(sctx, cctx, &serverssl,
+            &clientssl, sfd, cfd)))
+        goto end;
+
+    if (use_ktls && !TEST_true(SSL_set_options(serverssl, SSL_OP_ENABLE_KTLS)))
+        goto end;
+
+    if (!TEST_true(create_ssl_connection(serverssl, clientssl,
+            SSL_ERROR_NONE)))
+        goto end;
+
+    if (use_ktls && !BIO_get_ktls_recv(SSL_get_rbio(serverssl))) {
+        testresult = TEST_skip("Failed to enable KTLS RX for %s cipher %s",
+            tls_version == TLS1_3_VERSION ? "TLS 1.3" : "TLS 1.2", cipher);
+        goto end;
+    }
+
+    if (!TEST_int_gt(RAND_bytes_ex(libctx, buf, SENDFILE_SZ, 0), 0))
+        goto end;
+
+    for (off = 0; off < SENDFILE_SZ; off += SENDFILE_CHUNK) {
+        if (!TEST_int_eq(SSL_write(clientssl, buf + off, SENDFILE_CHUNK),
+                SENDFILE_CHUNK))
+            goto end;
+
+        for (got = 0; got < SENDFILE_CHUNK; got += ret) {
+            ret = SSL_splice(serverssl, pipefd[1], SENDFILE_CHUNK - got, 0);
+            if (ret <= 0) {
+                if (!TEST_int_eq(SSL_get_error(serverssl, (int)ret),
+                        SSL_ERROR_WANT_READ))
+                    goto end;
+                ret = 0;
+                continue;
+            }
+            if (!TEST_size_t_le(got + ret, SENDFILE_CHUNK)
+                || !TEST_int_eq(read(pipefd[0], buf_dst + off + got, ret),
+                    (int)ret))
+                goto end;
+        }
+    }
+
+    if (!TEST_mem_eq(buf_dst, SENDFILE_SZ, buf, SENDFILE_SZ)
+        || !TEST_true(SSL_get_ktls_stats(serverssl, &ktls_read, NULL,
+            &user_read, NULL))
+        || !TEST_uint64_t_eq(ktls_read + user_read, SENDFILE_SZ)
+        || (use_ktls && !TEST_uint64_t_gt(ktls_read, 0))
+        || (!use_ktls && !TEST_uint64_t_eq(ktls_read, 0)))
+        goto end;
+
+    testresult = 1;
+end:
+    if (clientssl) {
+        SSL_shutdown(clientssl);
+        SSL_free(clientssl);
+    }
+    if (serverssl) {
+        SSL_shutdown(serverssl);
+        SSL_free(serverssl);
+    }
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    if (cfd != -1)
+        close(cfd);
+    if (sfd != -1)
+        close(sfd);
+    if (pipefd[0] != -1) {
+        close(pipefd[0]);
+        close(pipefd[1]);
+    }
+    OPENSSL_free(buf);
+    OPENSSL_free(buf_dst);
+    return testresult;
+}
+
+static int test_ktls_splice(int test)
+{
+    struct ktls_test_cipher *cipher;
+    int tst = test >> 1;
+
+    OPENSSL_assert(tst < (int)NUM_KTLS_TEST_CIPHERS);
+    cipher = &ktls_test_ciphers[tst];
+
+    return execute_test_ktls_splice(cipher->tls_version, cipher->cipher,
+        test & 1);
+}
+#endif
+
+#if defined(OPENSSL_SYS_UNIX)
+/*
+ * Test SSL_splice() passing data through user space when kernel TLS is not in
+ * use, and rejecting unknown flags
+ */
+static int test_splice_fallback(void)
+{
+    SSL_CTX *cctx = NULL, *sctx = NULL;
+    SSL *clientssl = NULL, *serverssl = NULL;
+    static const char msg[] = "Hello world";
+    char buf[sizeof(msg)];
+    int pipefd[2] = { -1, -1 };
+    int testresult = 0;
+
+    if (!TEST_int_eq(pipe(pipefd), 0)
+        || !TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+            TLS_client_method(), TLS1_VERSION, 0,
+            &sctx, &cctx, cert, privkey))
+        || !TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+            NULL, NULL))
+        || !TEST_true(create_ssl_connection(serverssl, clientssl,
+            SSL_ERROR_NONE)))
+        goto end;
+
+    if (!TEST_int_eq(SSL_write(clientssl, msg, sizeof(msg)), sizeof(msg))
+        || !TEST_long_eq((long)SSL_splice(serverssl, pipefd[1], sizeof(msg),
+                             1),
+            -1)
+        || !TEST_int_eq(SSL_get_error(serverssl, -1), SSL_ERROR_SSL))
+        goto end;
+    ERR_clear_error();
+
+    if (!TEST_long_eq((long)SSL_splice(serverssl, pipefd[1], sizeof(buf), 0),
+            (long)sizeof(msg))
+        || !TEST_int_eq(read(pipefd[0], buf, sizeof(buf)), sizeof(msg))
+        || !TEST_mem_eq(buf, sizeof(buf), msg, sizeof(msg)))
+        goto end;
+
+    /* Nothing more has been sent */
+    if (!TEST_long_le((long)SSL_splice(serverssl, pipefd[1], sizeof(buf), 0),
+            0)
+        || !TEST_int_eq(SSL_get_error(serverssl, -1), SSL_ERROR_WANT_READ))
+        goto end;
+
+    testresult = 1;
+end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    if (pipefd[0] != -1) {
+        close(pipefd[0]);
+        close(pipefd[1]);
+    }
+    return testresult;
+}
 #endif
 
 static int test_large_message_tls(void)
@@ -10746,125 +10986,2157 @@ end:
 }
 #endif /* OPENSSL_NO_TLS1_2 */
 
-static int test_session_timeout(int test)
+#ifndef OSSL_NO_USABLE_TLS1_3
+static int pipeline_app_data_records = 0;
+static int pipeline_batched_records = 0;
+static uint64_t pipeline_last_written = 0;
+
+/*
+ * Count the application data records that we write, and how many of them were
+ * protected before the previous record was written out to the BIO
+ */
+static void pipeline_msg_cb(int write_p, int version, int content_type,
+    const void *buf, size_t len, SSL *ssl, void *arg)
 {
-    /*
-     * Test session ordering and timeout
-     * Can't explicitly test performance of the new code,
-     * but can test to see if the ordering of the sessions
-     * are correct, and they are removed as expected
-     */
-    SSL_SESSION *early = NULL;
-    SSL_SESSION *middle = NULL;
-    SSL_SESSION *late = NULL;
-    SSL_CTX *ctx;
-    int testresult = 0;
-    time_t now = time(NULL);
-#define TIMEOUT 10
+    uint64_t written;
 
-    if (!TEST_ptr(ctx = SSL_CTX_new_ex(libctx, NULL, TLS_method()))
-        || !TEST_ptr(early = SSL_SESSION_new())
-        || !TEST_ptr(middle = SSL_SESSION_new())
-        || !TEST_ptr(late = SSL_SESSION_new()))
-        goto end;
+    if (!write_p
+        || content_type != SSL3_RT_INNER_CONTENT_TYPE
+        || len != 1
+        || ((const unsigned char *)buf)[0] != SSL3_RT_APPLICATION_DATA)
+        return;
 
-    /* assign unique session ids */
-    early->session_id_length = SSL3_SSL_SESSION_ID_LENGTH;
-    memset(early->session_id, 1, SSL3_SSL_SESSION_ID_LENGTH);
-    middle->session_id_length = SSL3_SSL_SESSION_ID_LENGTH;
-    memset(middle->session_id, 2, SSL3_SSL_SESSION_ID_LENGTH);
-    late->session_id_length = SSL3_SSL_SESSION_ID_LENGTH;
-    memset(late->session_id, 3, SSL3_SSL_SESSION_ID_LENGTH);
+    written = BIO_number_written(SSL_get_wbio(ssl));
+    if (pipeline_app_data_records > 0 && written == pipeline_last_written)
+        pipeline_batched_records++;
+    pipeline_last_written = written;
+    pipeline_app_data_records++;
+}
 
-    if (!TEST_int_eq(SSL_CTX_add_session(ctx, early), 1)
-        || !TEST_int_eq(SSL_CTX_add_session(ctx, middle), 1)
-        || !TEST_int_eq(SSL_CTX_add_session(ctx, late), 1))
-        goto end;
+#define PIPELINE_FRAGSIZE 1024
 
-    /* Make sure they are all added */
-    if (!TEST_ptr(early->prev)
-        || !TEST_ptr(middle->prev)
-        || !TEST_ptr(late->prev))
-        goto end;
+/*
+ * Test that TLSv1.3 records are protected correctly when the AEAD cipher is
+ * provided with the pipeline API.
+ * Test 0: max_pipelines is 1, so one record is protected at a time
+ * Test 1: max_pipelines is 4, so up to 4 records are protected or decrypted
+ *         in one go
+ */
+static int test_tls13_pipeline(int idx)
+{
+    OSSL_LIB_CTX *tmplibctx = OSSL_LIB_CTX_new();
+    OSSL_PROVIDER *defprov = NULL, *pipeprov = NULL;
+    SSL_CTX *cctx = NULL, *sctx = NULL;
+    SSL *clientssl = NULL, *serverssl = NULL;
+    unsigned char msg[PIPELINE_FRAGSIZE * 8];
+    unsigned char buf[sizeof(msg)], *p = buf;
+    size_t readbytes, written, len;
+    int testresult = 0;
 
-    if (!TEST_time_t_ne(SSL_SESSION_set_time_ex(early, now - 10), 0)
-        || !TEST_time_t_ne(SSL_SESSION_set_time_ex(middle, now), 0)
-        || !TEST_time_t_ne(SSL_SESSION_set_time_ex(late, now + 10), 0))
+    if (!TEST_ptr(tmplibctx)
+        || !TEST_ptr(defprov = OSSL_PROVIDER_load(tmplibctx, "default"))
+        || !TEST_ptr(pipeprov = fake_pipeline_start(tmplibctx)))
         goto end;
 
-    if (!TEST_int_ne(SSL_SESSION_set_timeout(early, TIMEOUT), 0)
-        || !TEST_int_ne(SSL_SESSION_set_timeout(middle, TIMEOUT), 0)
-        || !TEST_int_ne(SSL_SESSION_set_timeout(late, TIMEOUT), 0))
+    if (!TEST_ptr(sctx = SSL_CTX_new_ex(tmplibctx, "?provider=fake-pipeline",
+                      TLS_server_method()))
+        || !TEST_ptr(cctx = SSL_CTX_new_ex(tmplibctx,
+                         "?provider=fake-pipeline",
+                         TLS_client_method()))
+        || !TEST_true(create_ssl_ctx_pair(tmplibctx, NULL, NULL,
+            TLS1_3_VERSION, TLS1_3_VERSION,
+            &sctx, &cctx, cert, privkey))
+        || !TEST_true(SSL_CTX_set_ciphersuites(cctx, "TLS_AES_256_GCM_SHA384"))
+        || !TEST_true(SSL_CTX_set_split_send_fragment(sctx, PIPELINE_FRAGSIZE))
+        || !TEST_true(SSL_CTX_set_max_pipelines(sctx, idx == 0 ? 1 : 4))
+        || !TEST_true(SSL_CTX_set_max_pipelines(cctx, idx == 0 ? 1 : 4)))
         goto end;
 
-    /* Make sure they are all still there */
-    if (!TEST_ptr(early->prev)
-        || !TEST_ptr(middle->prev)
-        || !TEST_ptr(late->prev))
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+            NULL, NULL)))
         goto end;
 
-    /* Make sure they are in the expected order */
-    if (!TEST_ptr_eq(late->next, middle)
-        || !TEST_ptr_eq(middle->next, early)
-        || !TEST_ptr_eq(early->prev, middle)
-        || !TEST_ptr_eq(middle->prev, late))
+    /* The callback must be set before the record layer is created */
+    SSL_set_msg_callback(serverssl, pipeline_msg_cb);
+    if (!TEST_true(create_ssl_connection(serverssl, clientssl,
+            SSL_ERROR_NONE)))
         goto end;
 
-    /* This should remove "early" */
-    SSL_CTX_flush_sessions_ex(ctx, now + TIMEOUT - 1);
-    if (!TEST_ptr_null(early->prev)
-        || !TEST_ptr(middle->prev)
-        || !TEST_ptr(late->prev))
-        goto end;
+    for (len = 0; len < sizeof(msg); len++)
+        msg[len] = (unsigned char)(len * 7);
+    pipeline_app_data_records = 0;
+    pipeline_batched_records = 0;
 
-    /* This should remove "middle" */
-    SSL_CTX_flush_sessions_ex(ctx, now + TIMEOUT + 1);
-    if (!TEST_ptr_null(early->prev)
-        || !TEST_ptr_null(middle->prev)
-        || !TEST_ptr(late->prev))
+    if (!TEST_true(SSL_write_ex(serverssl, msg, sizeof(msg), &written))
+        || !TEST_size_t_eq(written, sizeof(msg)))
         goto end;
 
-    /* This should remove "late" */
-    SSL_CTX_flush_sessions_ex(ctx, now + TIMEOUT + 11);
-    if (!TEST_ptr_null(early->prev)
-        || !TEST_ptr_null(middle->prev)
-        || !TEST_ptr_null(late->prev))
+    /*
+     * The data is always split into records of |split_send_fragment| bytes.
+     * With pipelining they are protected 4 at a time before being written.
+     */
+    if (!TEST_int_eq(pipeline_app_data_records,
+            (int)(sizeof(msg) / PIPELINE_FRAGSIZE))
+        || !TEST_int_eq(pipeline_batched_records,
+            idx == 0 ? 0 : pipeline_app_data_records * 3 / 4))
         goto end;
 
-    /* Add them back in again */
-    if (!TEST_int_eq(SSL_CTX_add_session(ctx, early), 1)
-        || !TEST_int_eq(SSL_CTX_add_session(ctx, middle), 1)
-        || !TEST_int_eq(SSL_CTX_add_session(ctx, late), 1))
+    /*
+     * With pipelining the client decrypts up to 4 records in one go, and
+     * returns all of them from a single read.
+     */
+    if (!TEST_true(SSL_read_ex(clientssl, p, sizeof(buf), &readbytes))
+        || !TEST_size_t_eq(readbytes,
+            idx == 0 ? PIPELINE_FRAGSIZE : 4 * PIPELINE_FRAGSIZE))
         goto end;
-
-    /* Make sure they are all added */
-    if (!TEST_ptr(early->prev)
-        || !TEST_ptr(middle->prev)
-        || !TEST_ptr(late->prev))
+    p += readbytes;
+    len = written - readbytes;
+    while (len > 0) {
+        if (!TEST_true(SSL_read_ex(clientssl, p, len, &readbytes)))
+            goto end;
+        p += readbytes;
+        len -= readbytes;
+    }
+    if (!TEST_mem_eq(msg, sizeof(msg), buf, sizeof(buf)))
         goto end;
 
-    /* This should remove all of them */
-    SSL_CTX_flush_sessions_ex(ctx, 0);
-    if (!TEST_ptr_null(early->prev)
-        || !TEST_ptr_null(middle->prev)
-        || !TEST_ptr_null(late->prev))
+    /*
+     * Send a KeyUpdate in the middle of the data so that a batch of records
+     * on the client side straddles the key change.
+     */
+    if (!TEST_true(SSL_write_ex(serverssl, msg, sizeof(msg) / 2, &written))
+        || !TEST_true(SSL_key_update(serverssl, SSL_KEY_UPDATE_NOT_REQUESTED))
+        || !TEST_true(SSL_write_ex(serverssl, msg + sizeof(msg) / 2,
+            sizeof(msg) / 2, &written)))
+        goto end;
+    p = buf;
+    len = sizeof(msg);
+    memset(buf, 0, sizeof(buf));
+    while (len > 0) {
+        if (!TEST_true(SSL_read_ex(clientssl, p, len, &readbytes)))
+            goto end;
+        p += readbytes;
+        len -= readbytes;
+    }
+    if (!TEST_mem_eq(msg, sizeof(msg), buf, sizeof(buf)))
         goto end;
 
-    (void)SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_UPDATE_TIME | SSL_CTX_get_session_cache_mode(ctx));
-
-    /* make sure |now| is NOT  equal to the current time */
-    now -= 10;
-    if (!TEST_time_t_ne(SSL_SESSION_set_time_ex(early, now), 0)
-        || !TEST_int_eq(SSL_CTX_add_session(ctx, early), 1)
-        || !TEST_time_t_ne(SSL_SESSION_get_time_ex(early), now))
+    /* And the other direction */
+    if (!TEST_true(SSL_write_ex(clientssl, msg, sizeof(msg), &written))
+        || !TEST_size_t_eq(written, sizeof(msg)))
+        goto end;
+    p = buf;
+    len = written;
+    while (len > 0) {
+        if (!TEST_true(SSL_read_ex(serverssl, p, len, &readbytes)))
+            goto end;
+        p += readbytes;
+        len -= readbytes;
+    }
+    if (!TEST_mem_eq(msg, sizeof(msg), buf, sizeof(buf)))
+        goto end;
+
+    testresult = 1;
+end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    if (pipeprov != NULL)
+        fake_pipeline_finish(pipeprov);
+    OSSL_PROVIDER_unload(defprov);
+    OSSL_LIB_CTX_free(tmplibctx);
+
+    return testresult;
+}
+#endif /* OSSL_NO_USABLE_TLS1_3 */
+
+/*
+ * Test that record buffers are returned to and reused from an SSL_CTX's
+ * buffer pool.
+ * Test 0: Without SSL_MODE_RELEASE_BUFFERS
+ * Test 1: With SSL_MODE_RELEASE_BUFFERS
+ */
+static int test_record_buffer_pool(int idx)
+{
+    SSL_CTX *cctx = NULL, *sctx = NULL;
+    SSL *clientssl = NULL, *serverssl = NULL;
+    int testresult = 0, i;
+    const char msg[] = "Hello";
+    char buf[sizeof(msg)];
+    size_t written, readbytes, idle;
+    uint64_t hits, misses, prevhits = 0;
+
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+            TLS_client_method(), TLS1_VERSION, 0,
+            &sctx, &cctx, cert, privkey)))
+        goto end;
+
+    if (!TEST_size_t_eq(SSL_CTX_get_record_buffer_pool_size(sctx), 0)
+        || !TEST_true(SSL_CTX_get_record_buffer_pool_stats(sctx, &hits,
+            &misses, &idle))
+        || !TEST_uint64_t_eq(hits, 0)
+        || !TEST_uint64_t_eq(misses, 0)
+        || !TEST_size_t_eq(idle, 0)
+        || !TEST_true(SSL_CTX_set_record_buffer_pool_size(sctx, 4))
+        || !TEST_size_t_eq(SSL_CTX_get_record_buffer_pool_size(sctx), 4))
+        goto end;
+
+    if (idx == 1)
+        SSL_CTX_set_mode(sctx, SSL_MODE_RELEASE_BUFFERS);
+
+    for (i = 0; i < 2; i++) {
+        if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+                NULL, NULL))
+            || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                SSL_ERROR_NONE))
+            || !TEST_true(SSL_write_ex(clientssl, msg, sizeof(msg), &written))
+            || !TEST_true(SSL_read_ex(serverssl, buf, sizeof(buf), &readbytes))
+            || !TEST_mem_eq(buf, readbytes, msg, sizeof(msg))
+            || !TEST_true(SSL_write_ex(serverssl, msg, sizeof(msg), &written))
+            || !TEST_true(SSL_read_ex(clientssl, buf, sizeof(buf), &readbytes))
+            || !TEST_mem_eq(buf, readbytes, msg, sizeof(msg)))
+            goto end;
+
+        shutdown_ssl_connection(serverssl, clientssl);
+        serverssl = clientssl = NULL;
+
+        /* The server's buffers should now be back in the pool */
+        if (!TEST_true(SSL_CTX_get_record_buffer_pool_stats(sctx, &hits,
+                &misses, &idle))
+            || !TEST_uint64_t_gt(misses, 0)
+            || !TEST_size_t_gt(idle, 0))
+            goto end;
+
+        /* ...and reused by the second connection */
+        if (i == 1 && !TEST_uint64_t_gt(hits, prevhits))
+            goto end;
+        prevhits = hits;
+    }
+
+    /* Shrinking the pool to nothing frees everything it holds */
+    if (!TEST_true(SSL_CTX_set_record_buffer_pool_size(sctx, 0))
+        || !TEST_true(SSL_CTX_get_record_buffer_pool_stats(sctx, NULL, NULL,
+            &idle))
+        || !TEST_size_t_eq(idle, 0))
+        goto end;
+
+    testresult = 1;
+end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+
+    return testresult;
+}
+
+/*
+ * Test SSL_hibernate()
+ * Test 0: TLSv1.3, explicit call, then a key update
+ * Test 1: TLSv1.2, explicit call, then a renegotiation
+ * Test 2: TLSv1.3 with SSL_MODE_AUTO_HIBERNATE
+ */
+static int test_hibernate(int idx)
+{
+    SSL_CTX *cctx = NULL, *sctx = NULL;
+    SSL *clientssl = NULL, *serverssl = NULL;
+    SSL_CONNECTION *serversc;
+    int testresult = 0, tlsvers, i;
+    const char msg[] = "Hello";
+    char buf[sizeof(msg)];
+    size_t written, readbytes;
+
+    if (idx == 1) {
+#if defined(OPENSSL_NO_TLS1_2) || defined(OPENSSL_NO_RSA)
+        return TEST_skip("TLSv1.2 is disabled in this build");
+#else
+        tlsvers = TLS1_2_VERSION;
+#endif
+    } else {
+#ifdef OSSL_NO_USABLE_TLS1_3
+        return TEST_skip("No usable TLSv1.3 in this build");
+#else
+        tlsvers = TLS1_3_VERSION;
+#endif
+    }
+
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+            TLS_client_method(), tlsvers, tlsvers,
+            &sctx, &cctx, cert, privkey)))
+        goto end;
+
+    if (idx == 2)
+        SSL_CTX_set_mode(sctx, SSL_MODE_AUTO_HIBERNATE);
+    else
+        SSL_CTX_set_options(sctx, SSL_OP_ALLOW_CLIENT_RENEGOTIATION);
+
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+            NULL, NULL))
+        || !TEST_ptr(serversc = SSL_CONNECTION_FROM_SSL_ONLY(serverssl))
+        /* Not possible before the handshake */
+        || !TEST_false(SSL_hibernate(serverssl))
+        || !TEST_true(create_ssl_connection(serverssl, clientssl,
+            SSL_ERROR_NONE)))
+        goto end;
+
+    if (idx != 2
+        && (!TEST_true(SSL_hibernate(serverssl))
+            || !TEST_true(SSL_hibernate(clientssl))))
+        goto end;
+
+    if (!TEST_ptr_null(serversc->init_buf)
+        || !TEST_ptr_null(serversc->s3.tmp.pkey)
+        || (tlsvers == TLS1_3_VERSION
+            && !TEST_ptr_null(serversc->s3.handshake_dgst)))
+        goto end;
+
+    /* Not possible with unread data */
+    if (!TEST_true(SSL_write_ex(clientssl, msg, sizeof(msg), &written))
+        || !TEST_true(SSL_peek_ex(serverssl, buf, 1, &readbytes))
+        || !TEST_false(SSL_hibernate(serverssl))
+        || !TEST_true(SSL_read_ex(serverssl, buf, sizeof(buf), &readbytes))
+        || !TEST_mem_eq(buf, readbytes, msg, sizeof(msg))
+        || !TEST_true(SSL_hibernate(serverssl)))
+        goto end;
+
+    /* The connection must still be fully usable */
+    if (tlsvers == TLS1_3_VERSION) {
+        if (!TEST_true(SSL_key_update(serverssl, SSL_KEY_UPDATE_REQUESTED)))
+            goto end;
+    } else {
+        if (!TEST_true(SSL_renegotiate(clientssl)))
+            goto end;
+        for (i = 0; i < 3; i++) {
+            if (!TEST_false(SSL_read_ex(clientssl, buf, sizeof(buf),
+                    &readbytes))
+                || !TEST_int_eq(SSL_get_error(clientssl, 0),
+                    SSL_ERROR_WANT_READ)
+                || !TEST_false(SSL_read_ex(serverssl, buf, sizeof(buf),
+                    &readbytes))
+                || !TEST_int_eq(SSL_get_error(serverssl, 0),
+                    SSL_ERROR_WANT_READ))
+                goto end;
+        }
+        if (!TEST_false(SSL_renegotiate_pending(clientssl)))
+            goto end;
+    }
+    if (!TEST_true(SSL_write_ex(serverssl, msg, sizeof(msg), &written))
+        || !TEST_true(SSL_read_ex(clientssl, buf, sizeof(buf), &readbytes))
+        || !TEST_mem_eq(buf, readbytes, msg, sizeof(msg))
+        || !TEST_true(SSL_write_ex(clientssl, msg, sizeof(msg), &written))
+        || !TEST_true(SSL_read_ex(serverssl, buf, sizeof(buf), &readbytes))
+        || !TEST_mem_eq(buf, readbytes, msg, sizeof(msg))
+        || !TEST_true(SSL_write_ex(serverssl, msg, sizeof(msg), &written))
+        || !TEST_true(SSL_read_ex(clientssl, buf, sizeof(buf), &readbytes))
+        || !TEST_mem_eq(buf, readbytes, msg, sizeof(msg))
+        || !TEST_true(SSL_hibernate(serverssl)))
+        goto end;
+
+    testresult = 1;
+end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+
+    return testresult;
+}
+
+/* Overhead of a TLSv1.3 record with AES-GCM: header, inner type and tag */
+#define COALESCE_REC_OVERHEAD (SSL3_RT_HEADER_LENGTH + 1 + EVP_GCM_TLS_TAG_LEN)
+
+static int coalesce_partial_write(SSL *serverssl, SSL *clientssl)
+{
+    unsigned char msg[100], buf[1200];
+    size_t written, readbytes, totread = 0;
+    BIO *bretry = NULL, *tmp;
+    int i, testresult = 0;
+
+    SSL_set_mode(clientssl, SSL_MODE_ENABLE_PARTIAL_WRITE);
+    if (!TEST_true(SSL_set_max_send_fragment(clientssl, 1024)))
+        return 0;
+
+    for (i = 0; i < 10; i++) {
+        memset(msg, 'a' + i, sizeof(msg));
+        if (!TEST_true(SSL_write_ex(clientssl, msg, sizeof(msg), &written)))
+            return 0;
+    }
+    if (!TEST_size_t_eq(SSL_get_coalesced_bytes(clientssl), 10 * sizeof(msg)))
+        return 0;
+
+    /* Let the first of the two records out and make the second one retry */
+    if (!TEST_ptr(bretry = BIO_new(bio_s_maybe_retry()))
+        || !TEST_ptr(tmp = SSL_get_wbio(clientssl))
+        || !TEST_true(BIO_up_ref(tmp)))
+        goto end;
+    BIO_push(bretry, tmp);
+    SSL_set0_wbio(clientssl, bretry);
+    if (!TEST_true(BIO_up_ref(bretry))
+        || !TEST_true(SSL_set_max_send_fragment(clientssl, 512))
+        || !TEST_true(BIO_ctrl(bretry, MAYBE_RETRY_CTRL_SET_RETRY_AFTER_CNT, 1,
+            NULL))
+        || !TEST_int_le(SSL_flush(clientssl), 0)
+        || !TEST_int_eq(SSL_get_error(clientssl, 0), SSL_ERROR_WANT_WRITE)
+        || !TEST_size_t_eq(SSL_get_coalesced_bytes(clientssl),
+            10 * sizeof(msg) - 512)
+        /* The retry fails too */
+        || !TEST_int_le(SSL_flush(clientssl), 0)
+        || !TEST_int_eq(SSL_get_error(clientssl, 0), SSL_ERROR_WANT_WRITE))
+        goto end;
+
+    /*
+     * The new data would fit in the buffer if the held back data was moved to
+     * its start, but the pending write has to finish first
+     */
+    memset(msg, 'k', sizeof(msg));
+    if (!TEST_true(SSL_set_max_send_fragment(clientssl, 1024))
+        || !TEST_false(SSL_write_ex(clientssl, msg, sizeof(msg), &written))
+        || !TEST_int_eq(SSL_get_error(clientssl, 0), SSL_ERROR_WANT_WRITE)
+        || !TEST_true(BIO_ctrl(bretry, MAYBE_RETRY_CTRL_SET_RETRY_AFTER_CNT,
+            100, NULL))
+        || !TEST_true(SSL_write_ex(clientssl, msg, sizeof(msg), &written))
+        || !TEST_size_t_eq(SSL_get_coalesced_bytes(clientssl), sizeof(msg))
+        || !TEST_int_eq(SSL_flush(clientssl), 1))
+        goto end;
+
+    while (totread < sizeof(buf)
+        && SSL_read_ex(serverssl, buf + totread, sizeof(buf) - totread,
+            &readbytes))
+        totread += readbytes;
+    if (!TEST_size_t_eq(totread, 11 * sizeof(msg)))
+        goto end;
+    for (i = 0; i < 11; i++) {
+        memset(msg, 'a' + i, sizeof(msg));
+        if (!TEST_mem_eq(buf + i * sizeof(msg), sizeof(msg), msg, sizeof(msg)))
+            goto end;
+    }
+
+    testresult = 1;
+end:
+    BIO_free(bretry);
+    return testresult;
+}
+
+/*
+ * Test SSL_MODE_COALESCE_WRITES
+ * Test 0: Held back data is sent by SSL_flush()
+ * Test 1: Held back data is sent when the writer reads
+ * Test 2: Held back data is sent when the next write doesn't fit, or the mode
+ *         has been cleared
+ * Test 3: With SSL_MODE_ENABLE_PARTIAL_WRITE, a flush that is split into small
+ *         records and has to be retried is finished before more data is held
+ *         back
+ */
+static int test_coalesce_writes(int idx)
+{
+    SSL_CTX *cctx = NULL, *sctx = NULL;
+    SSL *clientssl = NULL, *serverssl = NULL;
+    int testresult = 0, i;
+    unsigned char msg[120], buf[2048];
+    size_t written, readbytes;
+    uint64_t before;
+
+#ifdef OSSL_NO_USABLE_TLS1_3
+    return TEST_skip("No usable TLSv1.3 in this build");
+#endif
+
+    memset(msg, 'x', sizeof(msg));
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+            TLS_client_method(), TLS1_3_VERSION, TLS1_3_VERSION,
+            &sctx, &cctx, cert, privkey))
+        || !TEST_true(SSL_CTX_set_ciphersuites(cctx, "TLS_AES_128_GCM_SHA256")))
+        goto end;
+
+    SSL_CTX_set_mode(cctx, SSL_MODE_COALESCE_WRITES);
+    if (idx == 2 && !TEST_true(SSL_CTX_set_max_send_fragment(cctx, 512)))
+        goto end;
+
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+            NULL, NULL))
+        || !TEST_true(create_ssl_connection(serverssl, clientssl,
+            SSL_ERROR_NONE)))
+        goto end;
+
+    if (idx == 3) {
+        testresult = coalesce_partial_write(serverssl, clientssl);
+        goto end;
+    }
+
+    before = BIO_number_written(SSL_get_wbio(clientssl));
+    for (i = 0; i < 5; i++) {
+        if (!TEST_true(SSL_write_ex(clientssl, msg, sizeof(msg), &written))
+            || !TEST_size_t_eq(written, sizeof(msg)))
+            goto end;
+    }
+
+    if (idx == 2) {
+        /* Only four writes fit in 512 bytes, so they went out together */
+        if (!TEST_size_t_eq(SSL_get_coalesced_bytes(clientssl), sizeof(msg))
+            || !TEST_uint64_t_eq(BIO_number_written(SSL_get_wbio(clientssl)),
+                before + 4 * sizeof(msg) + COALESCE_REC_OVERHEAD))
+            goto end;
+        /* With the mode cleared the held back data goes before the next write */
+        SSL_clear_mode(clientssl, SSL_MODE_COALESCE_WRITES);
+        if (!TEST_true(SSL_write_ex(clientssl, msg, sizeof(msg), &written))
+            || !TEST_size_t_eq(SSL_get_coalesced_bytes(clientssl), 0)
+            || !TEST_uint64_t_eq(BIO_number_written(SSL_get_wbio(clientssl)),
+                before + 6 * sizeof(msg) + 3 * COALESCE_REC_OVERHEAD))
+            goto end;
+    } else {
+        /* Nothing has been sent yet */
+        if (!TEST_size_t_eq(SSL_get_coalesced_bytes(clientssl),
+                5 * sizeof(msg))
+            || !TEST_uint64_t_eq(BIO_number_written(SSL_get_wbio(clientssl)),
+                before)
+            || !TEST_false(SSL_read_ex(serverssl, buf, sizeof(buf),
+                &readbytes))
+            || !TEST_int_eq(SSL_get_error(serverssl, 0), SSL_ERROR_WANT_READ))
+            goto end;
+
+        if (idx == 0) {
+            if (!TEST_int_eq(SSL_flush(clientssl), 1))
+                goto end;
+        } else if (!TEST_false(SSL_read_ex(clientssl, buf, sizeof(buf),
+                       &readbytes))
+            || !TEST_int_eq(SSL_get_error(clientssl, 0),
+                SSL_ERROR_WANT_READ)) {
+            goto end;
+        }
+
+        /* All of it went in one record */
+        if (!TEST_size_t_eq(SSL_get_coalesced_bytes(clientssl), 0)
+            || !TEST_uint64_t_eq(BIO_number_written(SSL_get_wbio(clientssl)),
+                before + 5 * sizeof(msg) + COALESCE_REC_OVERHEAD))
+            goto end;
+    }
+
+    for (i = 0; i < (idx == 2 ? 6 : 5); i++) {
+        if (!TEST_true(SSL_read_ex(serverssl, buf, sizeof(msg), &readbytes))
+            || !TEST_mem_eq(buf, readbytes, msg, sizeof(msg)))
+            goto end;
+    }
+
+    /* Held back data is sent before the close_notify */
+    if (!TEST_true(SSL_write_ex(clientssl, msg, sizeof(msg), &written))
+        || !TEST_int_eq(SSL_shutdown(clientssl), 0)
+        || !TEST_true(SSL_read_ex(serverssl, buf, sizeof(buf), &readbytes))
+        || !TEST_mem_eq(buf, readbytes, msg, sizeof(msg))
+        || !TEST_false(SSL_read_ex(serverssl, buf, sizeof(buf), &readbytes))
+        || !TEST_int_eq(SSL_get_error(serverssl, 0), SSL_ERROR_ZERO_RETURN))
+        goto end;
+
+    testresult = 1;
+end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+
+    return testresult;
+}
+
+static size_t sizing_reclens[64];
+static size_t sizing_numrecs;
+
+static void record_sizing_cb(int write_p, int version, int content_type,
+    const void *buf, size_t len, SSL *ssl, void *arg)
+{
+    const unsigned char *hdr = buf;
+
+    if (write_p && content_type == SSL3_RT_HEADER
+        && len == SSL3_RT_HEADER_LENGTH
+        && sizing_numrecs < OSSL_NELEM(sizing_reclens))
+        sizing_reclens[sizing_numrecs++] = (hdr[3] << 8) | hdr[4];
+}
+
+/*
+ * Test dynamic record sizing
+ * Test 0: Set with SSL_CTX_set_record_sizing()
+ * Test 1: Set with SSL_CONF_cmd()
+ * Test 2: Small records are used again after the connection has been idle
+ * Test 3: Set with SSL_set_record_sizing() once the connection is up
+ * Test 4: A TLSv1.3 KeyUpdate does not start small records again
+ */
+static int test_record_sizing(int idx)
+{
+    SSL_CTX *cctx = NULL, *sctx = NULL;
+    SSL *clientssl = NULL, *serverssl = NULL;
+    SSL_CONF_CTX *confctx = NULL;
+    int testresult = 0, i;
+    unsigned char *buf = NULL;
+    const size_t buflen = 24000, small = 1000;
+    size_t written, readbytes, total, first = 0;
+
+#ifdef OSSL_NO_USABLE_TLS1_3
+    if (idx == 4)
+        return TEST_skip("No TLSv1.3 available");
+#endif
+
+    if (!TEST_ptr(buf = OPENSSL_zalloc(buflen))
+        || !TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+            TLS_client_method(), TLS1_VERSION, 0,
+            &sctx, &cctx, cert, privkey)))
+        goto end;
+
+    if (idx == 1) {
+        if (!TEST_ptr(confctx = SSL_CONF_CTX_new()))
+            goto end;
+        SSL_CONF_CTX_set_flags(confctx, SSL_CONF_FLAG_FILE);
+        SSL_CONF_CTX_set_ssl_ctx(confctx, sctx);
+        if (!TEST_int_eq(SSL_CONF_cmd(confctx, "RecordSizing", "1000,4000"), 2)
+            || !TEST_int_le(SSL_CONF_cmd(confctx, "RecordSizing", "20000"), 0)
+            || !TEST_int_le(SSL_CONF_cmd(confctx, "RecordSizing", "1,2,3,4"),
+                0))
+            goto end;
+    } else if (idx != 3) {
+        if (!TEST_false(SSL_CTX_set_record_sizing(sctx,
+                SSL3_RT_MAX_PLAIN_LENGTH + 1, 4000, 0))
+            || !TEST_true(SSL_CTX_set_record_sizing(sctx, small, 4000,
+                idx == 2 ? 1 : 0)))
+            goto end;
+    }
+
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+            NULL, NULL)))
+        goto end;
+    SSL_set_msg_callback(serverssl, record_sizing_cb);
+    if (!TEST_true(create_ssl_connection(serverssl, clientssl,
+            SSL_ERROR_NONE)))
+        goto end;
+
+    if (idx == 3
+        && !TEST_true(SSL_set_record_sizing(serverssl, small, 4000, 0)))
+        goto end;
+
+    if (idx == 4) {
+        if (!TEST_int_eq(SSL_version(serverssl), TLS1_3_VERSION))
+            goto end;
+
+        /* Use up half of the threshold, then change the write keys */
+        sizing_numrecs = 0;
+        if (!TEST_true(SSL_write_ex(serverssl, buf, 2000, &written))
+            || !TEST_true(SSL_read_ex(clientssl, buf, buflen, &readbytes))
+            || !TEST_true(SSL_read_ex(clientssl, buf, buflen, &readbytes))
+            || !TEST_size_t_eq(sizing_numrecs, 2)
+            || !TEST_true(SSL_key_update(serverssl,
+                SSL_KEY_UPDATE_NOT_REQUESTED))
+            || !TEST_true(SSL_do_handshake(serverssl)))
+            goto end;
+        first = 2;
+    }
+
+    for (i = 0; i < (idx == 2 ? 2 : 1); i++) {
+        if (i > 0)
+            OSSL_sleep(20);
+
+        sizing_numrecs = 0;
+        if (!TEST_true(SSL_write_ex(serverssl, buf, buflen, &written))
+            || !TEST_size_t_eq(written, buflen))
+            goto end;
+
+        for (total = 0; total < buflen; total += readbytes)
+            if (!TEST_true(SSL_read_ex(clientssl, buf, buflen, &readbytes)))
+                goto end;
+
+        /*
+         * The first 4000 bytes should have gone in small records and the rest
+         * in full sized ones. Allow for the record overhead.
+         */
+        if (!TEST_size_t_gt(sizing_numrecs, 5 - first))
+            goto end;
+        if (!TEST_size_t_le(sizing_reclens[0], small + 256)
+            || !TEST_size_t_le(sizing_reclens[3 - first], small + 256)
+            || !TEST_size_t_gt(sizing_reclens[4 - first],
+                SSL3_RT_MAX_PLAIN_LENGTH))
+            goto end;
+    }
+
+    testresult = 1;
+end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    SSL_CONF_CTX_free(confctx);
+    OPENSSL_free(buf);
+
+    return testresult;
+}
+
+#ifndef OSSL_NO_USABLE_TLS1_3
+/*
+ * The number of transcript lanes running when each ClientHello was written
+ * by the client or read by the server, and whether those lanes all used the
+ * handshake digest.
+ */
+static int lanes_at_ch[2][2];
+static int lanes_match_ch[2][2];
+
+static void transcript_lanes_cb(int write_p, int version, int content_type,
+    const void *buf, size_t len, SSL *ssl, void *arg)
+{
+    SSL_CONNECTION *sc = SSL_CONNECTION_FROM_SSL(ssl);
+    const unsigned char *msg = buf;
+    int *numch = arg, server = SSL_is_server(ssl);
+    const EVP_MD *md = NULL;
+    size_t i;
+
+    if (sc == NULL
+        || content_type != SSL3_RT_HANDSHAKE
+        || len < 1
+        || msg[0] != SSL3_MT_CLIENT_HELLO
+        || write_p == server
+        || numch[server] >= 2)
+        return;
+
+    if (sc->s3.tmp.new_cipher != NULL)
+        md = ssl_handshake_md(sc);
+
+    lanes_match_ch[server][numch[server]] = 1;
+    for (i = 0; i < SSL_TRANSCRIPT_LANES; i++) {
+        if (sc->s3.handshake_lanes[i] == NULL)
+            continue;
+        lanes_at_ch[server][numch[server]]++;
+        if (md != NULL && EVP_MD_CTX_get0_md(sc->s3.handshake_lanes[i]) != md)
+            lanes_match_ch[server][numch[server]] = 0;
+    }
+    numch[server]++;
+}
+
+/*
+ * Test that a HelloRetryRequest, which resets the handshake transcript, works
+ * while the transcript lanes are running. After the HRR only the lane for the
+ * negotiated handshake digest should be left.
+ * Test 0: TLS_AES_128_GCM_SHA256, full handshake
+ * Test 1: TLS_AES_256_GCM_SHA384, full handshake
+ * Test 2: TLS_AES_128_GCM_SHA256, resumption
+ * Test 3: TLS_AES_256_GCM_SHA384, resumption
+ */
+static int test_transcript_lanes_hrr(int idx)
+{
+    SSL_CTX *cctx = NULL, *sctx = NULL;
+    SSL *clientssl = NULL, *serverssl = NULL;
+    SSL_SESSION *sess = NULL;
+    const char *ciphersuite = (idx % 2) == 0 ? "TLS_AES_128_GCM_SHA256"
+                                             : "TLS_AES_256_GCM_SHA384";
+    static const char msg[] = "transcript lanes";
+    char buf[sizeof(msg)];
+    size_t written, readbytes;
+    int numch[2] = { 0, 0 };
+    int testresult = 0;
+
+    memset(lanes_at_ch, 0, sizeof(lanes_at_ch));
+    memset(lanes_match_ch, 0, sizeof(lanes_match_ch));
+
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+            TLS_client_method(), TLS1_3_VERSION, TLS1_3_VERSION,
+            &sctx, &cctx, cert, privkey))
+        || !TEST_true(SSL_CTX_set_ciphersuites(sctx, ciphersuite))
+        || !TEST_true(SSL_CTX_set_ciphersuites(cctx, ciphersuite)))
+        goto end;
+
+    if (idx >= 2) {
+        if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+                NULL, NULL))
+            || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                SSL_ERROR_NONE))
+            || !TEST_ptr(sess = SSL_get1_session(clientssl)))
+            goto end;
+        shutdown_ssl_connection(serverssl, clientssl);
+        serverssl = clientssl = NULL;
+    }
+
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+            NULL, NULL))
+        || (sess != NULL && !TEST_true(SSL_set_session(clientssl, sess))))
+        goto end;
+
+    /* Force an HRR */
+#if defined(OPENSSL_NO_EC)
+    if (!TEST_true(SSL_set1_groups_list(serverssl, "ffdhe3072")))
+        goto end;
+#else
+    if (!TEST_true(SSL_set1_groups_list(serverssl, "P-384")))
+        goto end;
+#endif
+
+    SSL_set_msg_callback(clientssl, transcript_lanes_cb);
+    SSL_set_msg_callback_arg(clientssl, numch);
+    SSL_set_msg_callback(serverssl, transcript_lanes_cb);
+    SSL_set_msg_callback_arg(serverssl, numch);
+
+    if (!TEST_true(create_ssl_connection(serverssl, clientssl, SSL_ERROR_NONE))
+        || !TEST_int_eq(SSL_session_reused(clientssl), sess != NULL)
+        || !TEST_int_eq(numch[0], 2)
+        || !TEST_int_eq(numch[1], 2))
+        goto end;
+
+    /*
+     * Both lanes hash the first ClientHello. Once the HRR has picked the
+     * cipher suite only its lane is started again.
+     */
+    if (!TEST_int_eq(lanes_at_ch[0][0], SSL_TRANSCRIPT_LANES)
+        || !TEST_int_eq(lanes_at_ch[1][0], SSL_TRANSCRIPT_LANES)
+        || !TEST_int_eq(lanes_at_ch[0][1], 1)
+        || !TEST_int_eq(lanes_at_ch[1][1], 1)
+        || !TEST_true(lanes_match_ch[0][1])
+        || !TEST_true(lanes_match_ch[1][1]))
+        goto end;
+
+    /* The transcript hash from the lane must agree with the peer's */
+    if (!TEST_true(SSL_write_ex(clientssl, msg, sizeof(msg), &written))
+        || !TEST_true(SSL_read_ex(serverssl, buf, sizeof(buf), &readbytes))
+        || !TEST_mem_eq(buf, readbytes, msg, sizeof(msg))
+        || !TEST_true(SSL_write_ex(serverssl, msg, sizeof(msg), &written))
+        || !TEST_true(SSL_read_ex(clientssl, buf, sizeof(buf), &readbytes))
+        || !TEST_mem_eq(buf, readbytes, msg, sizeof(msg)))
+        goto end;
+
+    testresult = 1;
+end:
+    SSL_SESSION_free(sess);
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+
+    return testresult;
+}
+#endif
+
+static int test_session_timeout(int test)
+{
+    /*
+     * Test session ordering and timeout
+     * Can't explicitly test performance of the new code,
+     * but can test to see if the ordering of the sessions
+     * are correct, and they are removed as expected
+     */
+    SSL_SESSION *early = NULL;
+    SSL_SESSION *middle = NULL;
+    SSL_SESSION *late = NULL;
+    SSL_CTX *ctx;
+    int testresult = 0;
+    time_t now = time(NULL);
+#define TIMEOUT 10
+
+    if (!TEST_ptr(ctx = SSL_CTX_new_ex(libctx, NULL, TLS_method()))
+        || !TEST_ptr(early = SSL_SESSION_new())
+        || !TEST_ptr(middle = SSL_SESSION_new())
+        || !TEST_ptr(late = SSL_SESSION_new()))
+        goto end;
+
+    /* assign unique session ids */
+    early->session_id_length = SSL3_SSL_SESSION_ID_LENGTH;
+    memset(early->session_id, 1, SSL3_SSL_SESSION_ID_LENGTH);
+    middle->session_id_length = SSL3_SSL_SESSION_ID_LENGTH;
+    memset(middle->session_id, 2, SSL3_SSL_SESSION_ID_LENGTH);
+    late->session_id_length = SSL3_SSL_SESSION_ID_LENGTH;
+    memset(late->session_id, 3, SSL3_SSL_SESSION_ID_LENGTH);
+
+    if (!TEST_int_eq(SSL_CTX_add_session(ctx, early), 1)
+        || !TEST_int_eq(SSL_CTX_add_session(ctx, middle), 1)
+        || !TEST_int_eq(SSL_CTX_add_session(ctx, late), 1))
+        goto end;
+
+    /* Make sure they are all added */
+    if (!TEST_ptr(early->owner)
+        || !TEST_ptr(middle->owner)
+        || !TEST_ptr(late->owner))
+        goto end;
+
+    if (!TEST_time_t_ne(SSL_SESSION_set_time_ex(early, now - 10), 0)
+        || !TEST_time_t_ne(SSL_SESSION_set_time_ex(middle, now), 0)
+        || !TEST_time_t_ne(SSL_SESSION_set_time_ex(late, now + 10), 0))
+        goto end;
+
+    if (!TEST_int_ne(SSL_SESSION_set_timeout(early, TIMEOUT), 0)
+        || !TEST_int_ne(SSL_SESSION_set_timeout(middle, TIMEOUT), 0)
+        || !TEST_int_ne(SSL_SESSION_set_timeout(late, TIMEOUT), 0))
+        goto end;
+
+    /* Make sure they are all still there */
+    if (!TEST_ptr(early->owner)
+        || !TEST_ptr(middle->owner)
+        || !TEST_ptr(late->owner))
+        goto end;
+
+    /* This should remove "early" */
+    SSL_CTX_flush_sessions_ex(ctx, now + TIMEOUT - 1);
+    if (!TEST_ptr_null(early->owner)
+        || !TEST_ptr(middle->owner)
+        || !TEST_ptr(late->owner))
+        goto end;
+
+    /* This should remove "middle" */
+    SSL_CTX_flush_sessions_ex(ctx, now + TIMEOUT + 1);
+    if (!TEST_ptr_null(early->owner)
+        || !TEST_ptr_null(middle->owner)
+        || !TEST_ptr(late->owner))
+        goto end;
+
+    /* This should remove "late" */
+    SSL_CTX_flush_sessions_ex(ctx, now + TIMEOUT + 11);
+    if (!TEST_ptr_null(early->owner)
+        || !TEST_ptr_null(middle->owner)
+        || !TEST_ptr_null(late->owner))
+        goto end;
+
+    /* Add them back in again */
+    if (!TEST_int_eq(SSL_CTX_add_session(ctx, early), 1)
+        || !TEST_int_eq(SSL_CTX_add_session(ctx, middle), 1)
+        || !TEST_int_eq(SSL_CTX_add_session(ctx, late), 1))
+        goto end;
+
+    /* Make sure they are all added */
+    if (!TEST_ptr(early->owner)
+        || !TEST_ptr(middle->owner)
+        || !TEST_ptr(late->owner))
+        goto end;
+
+    /* This should remove all of them */
+    SSL_CTX_flush_sessions_ex(ctx, 0);
+    if (!TEST_ptr_null(early->owner)
+        || !TEST_ptr_null(middle->owner)
+        || !TEST_ptr_null(late->owner))
+        goto end;
+
+    (void)SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_UPDATE_TIME | SSL_CTX_get_session_cache_mode(ctx));
+
+    /* make sure |now| is NOT  equal to the current time */
+    now -= 10;
+    if (!TEST_time_t_ne(SSL_SESSION_set_time_ex(early, now), 0)
+        || !TEST_int_eq(SSL_CTX_add_session(ctx, early), 1)
+        || !TEST_time_t_ne(SSL_SESSION_get_time_ex(early), now))
+        goto end;
+
+    testresult = 1;
+end:
+    SSL_CTX_free(ctx);
+    SSL_SESSION_free(early);
+    SSL_SESSION_free(middle);
+    SSL_SESSION_free(late);
+    return testresult;
+}
+
+/*
+ * Test the built-in session ticket key ring: rotation, decryption with older
+ * keys and sharing keys between servers
+ * Test 0: TLSv1.2
+ * Test 1: TLSv1.3
+ */
+static int test_ticket_key_ring(int idx)
+{
+    SSL_CTX *sctx = NULL, *sctx2 = NULL, *cctx = NULL;
+    SSL *serverssl = NULL, *clientssl = NULL;
+    SSL_SESSION *sess = NULL, *sess2 = NULL;
+    unsigned char ring[SSL_TICKET_KEY_LENGTH * SSL_TICKET_KEYS_MAX];
+    int version = idx == 0 ? TLS1_2_VERSION : TLS1_3_VERSION;
+    int testresult = 0;
+
+#ifdef OPENSSL_NO_TLS1_2
+    if (idx == 0)
+        return TEST_skip("No TLSv1.2 available");
+#endif
+#ifdef OSSL_NO_USABLE_TLS1_3
+    if (idx == 1)
+        return TEST_skip("No TLSv1.3 available");
+#endif
+
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+            TLS_client_method(), version, version,
+            &sctx, &cctx, cert, privkey))
+        || !TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+            NULL, version, version, &sctx2, NULL, cert, privkey)))
+        goto end;
+    SSL_CTX_set_session_cache_mode(sctx, SSL_SESS_CACHE_OFF);
+    SSL_CTX_set_session_cache_mode(sctx2, SSL_SESS_CACHE_OFF);
+
+    if (!TEST_size_t_eq(SSL_CTX_get_ticket_keys(sctx, NULL, 0),
+            SSL_TICKET_KEY_LENGTH)
+        || !TEST_false(SSL_CTX_set_ticket_key_rotation(sctx, 0, 0))
+        || !TEST_false(SSL_CTX_set_ticket_key_rotation(sctx, 0,
+            SSL_TICKET_KEYS_MAX + 1))
+        || !TEST_false(SSL_CTX_set1_ticket_keys(sctx, ring,
+            SSL_TICKET_KEY_LENGTH - 1))
+        || !TEST_true(SSL_CTX_set_ticket_key_rotation(sctx, 0, 2)))
+        goto end;
+
+    /* Get a ticket under the first key */
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+            NULL, NULL))
+        || !TEST_true(create_ssl_connection(serverssl, clientssl,
+            SSL_ERROR_NONE))
+        || !TEST_ptr(sess = SSL_get1_session(clientssl)))
+        goto end;
+    shutdown_ssl_connection(serverssl, clientssl);
+    serverssl = clientssl = NULL;
+
+    /* The previous key still decrypts tickets after a rotation */
+    if (!TEST_true(SSL_CTX_rotate_ticket_keys(sctx))
+        || !TEST_size_t_eq(SSL_CTX_get_ticket_keys(sctx, NULL, 0),
+            2 * SSL_TICKET_KEY_LENGTH)
+        || !TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+            NULL, NULL))
+        || !TEST_true(SSL_set_session(clientssl, sess))
+        || !TEST_true(create_ssl_connection(serverssl, clientssl,
+            SSL_ERROR_NONE))
+        || !TEST_true(SSL_session_reused(clientssl))
+        || !TEST_ptr(sess2 = SSL_get1_session(clientssl)))
+        goto end;
+    shutdown_ssl_connection(serverssl, clientssl);
+    serverssl = clientssl = NULL;
+
+    /* Another server that imports the key ring accepts the new ticket */
+    if (!TEST_size_t_eq(SSL_CTX_get_ticket_keys(sctx, ring, sizeof(ring)),
+            2 * SSL_TICKET_KEY_LENGTH)
+        || !TEST_true(SSL_CTX_set1_ticket_keys(sctx2, ring,
+            2 * SSL_TICKET_KEY_LENGTH))
+        || !TEST_true(create_ssl_objects(sctx2, cctx, &serverssl, &clientssl,
+            NULL, NULL))
+        || !TEST_true(SSL_set_session(clientssl, sess2))
+        || !TEST_true(create_ssl_connection(serverssl, clientssl,
+            SSL_ERROR_NONE))
+        || !TEST_true(SSL_session_reused(clientssl)))
+        goto end;
+    shutdown_ssl_connection(serverssl, clientssl);
+    serverssl = clientssl = NULL;
+
+    /* Two more rotations drop the first key from the ring */
+    if (!TEST_true(SSL_CTX_rotate_ticket_keys(sctx))
+        || !TEST_true(SSL_CTX_rotate_ticket_keys(sctx))
+        || !TEST_size_t_eq(SSL_CTX_get_ticket_keys(sctx, NULL, 0),
+            2 * SSL_TICKET_KEY_LENGTH)
+        || !TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+            NULL, NULL))
+        || !TEST_true(SSL_set_session(clientssl, sess))
+        || !TEST_true(create_ssl_connection(serverssl, clientssl,
+            SSL_ERROR_NONE))
+        || !TEST_false(SSL_session_reused(clientssl)))
+        goto end;
+
+    testresult = 1;
+end:
+    OPENSSL_cleanse(ring, sizeof(ring));
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_SESSION_free(sess);
+    SSL_SESSION_free(sess2);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(sctx2);
+    SSL_CTX_free(cctx);
+    return testresult;
+}
+
+/* Make a connection from |cctx| to |sctx|, resuming |sess| if not NULL */
+static int ticket_key_connect(SSL_CTX *sctx, SSL_CTX *cctx, SSL_SESSION *sess,
+    int reused, SSL_SESSION **newsess)
+{
+    SSL *serverssl = NULL, *clientssl = NULL;
+    int ret = 0;
+
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+            NULL, NULL))
+        || (sess != NULL && !TEST_true(SSL_set_session(clientssl, sess)))
+        || !TEST_true(create_ssl_connection(serverssl, clientssl,
+            SSL_ERROR_NONE))
+        || !TEST_int_eq(SSL_session_reused(clientssl), reused)
+        || (newsess != NULL
+            && !TEST_ptr(*newsess = SSL_get1_session(clientssl))))
+        goto end;
+    shutdown_ssl_connection(serverssl, clientssl);
+    serverssl = clientssl = NULL;
+    ret = 1;
+end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    return ret;
+}
+
+/*
+ * Test rotation of the ticket key ring once the current key is older than the
+ * rotation interval, and that replacing the current key with
+ * SSL_CTX_set_tlsext_ticket_keys() keeps the older keys of the ring.
+ * Test 0: TLSv1.2
+ * Test 1: TLSv1.3
+ */
+static int test_ticket_key_rotation_interval(int idx)
+{
+    SSL_CTX *sctx = NULL, *cctx = NULL;
+    SSL_SESSION *sess = NULL;
+    unsigned char key0[SSL_TICKET_KEY_LENGTH], key1[SSL_TICKET_KEY_LENGTH];
+    int version = idx == 0 ? TLS1_2_VERSION : TLS1_3_VERSION;
+    int testresult = 0;
+
+#ifdef OPENSSL_NO_TLS1_2
+    if (idx == 0)
+        return TEST_skip("No TLSv1.2 available");
+#endif
+#ifdef OSSL_NO_USABLE_TLS1_3
+    if (idx == 1)
+        return TEST_skip("No TLSv1.3 available");
+#endif
+
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+            TLS_client_method(), version, version,
+            &sctx, &cctx, cert, privkey)))
+        goto end;
+    SSL_CTX_set_session_cache_mode(sctx, SSL_SESS_CACHE_OFF);
+
+    if (!TEST_true(SSL_CTX_set_ticket_key_rotation(sctx, 60, 3))
+        || !TEST_int_eq(SSL_CTX_get_tlsext_ticket_keys(sctx, key0,
+                            sizeof(key0)),
+            1))
+        goto end;
+
+    /* The current key is not due for rotation yet */
+    if (!TEST_true(ticket_key_connect(sctx, cctx, NULL, 0, &sess))
+        || !TEST_size_t_eq(SSL_CTX_get_ticket_keys(sctx, NULL, 0),
+            SSL_TICKET_KEY_LENGTH))
+        goto end;
+
+    /* Once it is, issuing a ticket rotates in a new key */
+    sctx->ext.tick_key_time = ossl_time_subtract(sctx->ext.tick_key_time,
+        ossl_seconds2time(61));
+    if (!TEST_true(ticket_key_connect(sctx, cctx, NULL, 0, NULL))
+        || !TEST_size_t_eq(SSL_CTX_get_ticket_keys(sctx, NULL, 0),
+            2 * SSL_TICKET_KEY_LENGTH)
+        || !TEST_int_eq(SSL_CTX_get_tlsext_ticket_keys(sctx, key1,
+                            sizeof(key1)),
+            1)
+        || !TEST_mem_ne(key0, sizeof(key0), key1, sizeof(key1)))
+        goto end;
+
+    /*
+     * Replacing the current key leaves the ring at two keys, and the ticket
+     * issued under the first key can still be resumed
+     */
+    key1[0] ^= 1;
+    if (!TEST_int_eq(SSL_CTX_set_tlsext_ticket_keys(sctx, key1, sizeof(key1)),
+            1)
+        || !TEST_size_t_eq(SSL_CTX_get_ticket_keys(sctx, NULL, 0),
+            2 * SSL_TICKET_KEY_LENGTH)
+        || !TEST_true(ticket_key_connect(sctx, cctx, sess, 1, NULL)))
+        goto end;
+
+    testresult = 1;
+end:
+    OPENSSL_cleanse(key0, sizeof(key0));
+    OPENSSL_cleanse(key1, sizeof(key1));
+    SSL_SESSION_free(sess);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return testresult;
+}
+
+/* Check that the client received exactly |num| certificates |expect| */
+static int peer_chain_is(SSL *clientssl, X509 **expect, int num)
+{
+    STACK_OF(X509) *chain = SSL_get_peer_cert_chain(clientssl);
+    int i;
+
+    if (!TEST_int_eq(sk_X509_num(chain), num))
+        return 0;
+    for (i = 0; i < num; i++)
+        if (!TEST_int_eq(X509_cmp(sk_X509_value(chain, i), expect[i]), 0))
+            return 0;
+    return 1;
+}
+
+/*
+ * Test that the server sends the right chain as it is changed, on the
+ * SSL_CTX and on the SSL, when the encoded chain is cached
+ * Test 0: TLSv1.2
+ * Test 1: TLSv1.3
+ */
+static int test_cert_chain_cache(int idx)
+{
+    SSL_CTX *sctx = NULL, *cctx = NULL;
+    SSL *serverssl = NULL, *clientssl = NULL;
+    char *leaf_chain = test_mk_file_path(certsdir, "leaf-chain.pem");
+    char *skey = test_mk_file_path(certsdir, "leaf.key");
+    char *int1 = test_mk_file_path(certsdir, "interCA.pem");
+    char *int2 = test_mk_file_path(certsdir, "subinterCA.pem");
+    STACK_OF(X509) *chain = NULL;
+    X509 *ca1 = NULL, *ca2 = NULL, *expect[4];
+    int version = idx == 0 ? TLS1_2_VERSION : TLS1_3_VERSION;
+    int i, num = 0, testresult = 0;
+
+#ifdef OPENSSL_NO_TLS1_2
+    if (idx == 0)
+        return TEST_skip("No TLSv1.2 available");
+#endif
+#ifdef OSSL_NO_USABLE_TLS1_3
+    if (idx == 1)
+        return TEST_skip("No TLSv1.3 available");
+#endif
+
+    if (!TEST_ptr(leaf_chain) || !TEST_ptr(skey)
+        || !TEST_ptr(ca1 = load_cert_pem(int1, libctx))
+        || !TEST_ptr(ca2 = load_cert_pem(int2, libctx))
+        || !TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+            TLS_client_method(), version, version,
+            &sctx, &cctx, NULL, NULL))
+        || !TEST_int_eq(SSL_CTX_use_certificate_chain_file(sctx, leaf_chain), 1)
+        || !TEST_int_eq(SSL_CTX_use_PrivateKey_file(sctx, skey,
+                            SSL_FILETYPE_PEM),
+            1))
+        goto end;
+    SSL_CTX_set_mode(sctx, SSL_MODE_NO_AUTO_CHAIN);
+
+    /* The whole chain, several times from the same encoding */
+    if (!TEST_true(SSL_CTX_get0_chain_certs(sctx, &chain))
+        || !TEST_int_eq(sk_X509_num(chain), 3))
+        goto end;
+    expect[num++] = SSL_CTX_get0_certificate(sctx);
+    for (i = 0; i < sk_X509_num(chain); i++)
+        expect[num++] = sk_X509_value(chain, i);
+    for (i = 0; i < 2; i++) {
+        if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+                NULL, NULL))
+            || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                SSL_ERROR_NONE))
+            || !peer_chain_is(clientssl, expect, num))
+            goto end;
+        shutdown_ssl_connection(serverssl, clientssl);
+        serverssl = clientssl = NULL;
+    }
+
+    /* Just the leaf once the chain is cleared */
+    num = 1;
+    if (!TEST_true(SSL_CTX_clear_chain_certs(sctx))
+        || !TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+            NULL, NULL))
+        || !TEST_true(create_ssl_connection(serverssl, clientssl,
+            SSL_ERROR_NONE))
+        || !peer_chain_is(clientssl, expect, num))
+        goto end;
+    shutdown_ssl_connection(serverssl, clientssl);
+    serverssl = clientssl = NULL;
+
+    /* A certificate added to the SSL_CTX chain */
+    expect[num++] = ca1;
+    if (!TEST_true(SSL_CTX_add1_chain_cert(sctx, ca1))
+        || !TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+            NULL, NULL))
+        || !TEST_true(create_ssl_connection(serverssl, clientssl,
+            SSL_ERROR_NONE))
+        || !peer_chain_is(clientssl, expect, num))
+        goto end;
+    shutdown_ssl_connection(serverssl, clientssl);
+    serverssl = clientssl = NULL;
+
+    /* A certificate added to the chain of one SSL only */
+    expect[num++] = ca2;
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+            NULL, NULL))
+        || !TEST_true(SSL_add1_chain_cert(serverssl, ca2))
+        || !TEST_true(create_ssl_connection(serverssl, clientssl,
+            SSL_ERROR_NONE))
+        || !peer_chain_is(clientssl, expect, num))
+        goto end;
+    shutdown_ssl_connection(serverssl, clientssl);
+    serverssl = clientssl = NULL;
+
+    /* Which didn't change the SSL_CTX */
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+            NULL, NULL))
+        || !TEST_true(create_ssl_connection(serverssl, clientssl,
+            SSL_ERROR_NONE))
+        || !peer_chain_is(clientssl, expect, num - 1))
+        goto end;
+
+    testresult = 1;
+end:
+    X509_free(ca1);
+    X509_free(ca2);
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    OPENSSL_free(leaf_chain);
+    OPENSSL_free(skey);
+    OPENSSL_free(int1);
+    OPENSSL_free(int2);
+    return testresult;
+}
+
+static EVP_PKEY *pkey_sign_key = NULL;
+static unsigned char *pkey_sign_tbs = NULL;
+static size_t pkey_sign_tbslen = 0;
+static int pkey_sign_retry = 0;
+static int pkey_sign_calls = 0;
+
+/* Sign like rsa_pss_rsae_sha256, the only signature algorithm allowed below */
+static int pkey_sign(unsigned char *sig, size_t *siglen,
+    const unsigned char *tbs, size_t tbslen)
+{
+    EVP_MD_CTX *mctx = EVP_MD_CTX_new();
+    EVP_PKEY_CTX *pctx = NULL;
+    int ret = 0;
+
+    if (TEST_ptr(mctx)
+        && TEST_int_gt(EVP_DigestSignInit_ex(mctx, &pctx, "SHA256", libctx,
+                           NULL, pkey_sign_key, NULL),
+            0)
+        && TEST_int_gt(EVP_PKEY_CTX_set_rsa_padding(pctx,
+                           RSA_PKCS1_PSS_PADDING),
+            0)
+        && TEST_int_gt(EVP_PKEY_CTX_set_rsa_pss_saltlen(pctx,
+                           RSA_PSS_SALTLEN_DIGEST),
+            0)
+        && TEST_int_gt(EVP_DigestSign(mctx, sig, siglen, tbs, tbslen), 0))
+        ret = 1;
+    EVP_MD_CTX_free(mctx);
+    return ret;
+}
+
+static int private_key_sign_cb(SSL *s, unsigned int sigalg,
+    unsigned char *sig, size_t *siglen, size_t sigsize,
+    const unsigned char *tbs, size_t tbslen, void *arg)
+{
+    pkey_sign_calls++;
+    /* rsa_pss_rsae_sha256 */
+    if (!TEST_uint_eq(sigalg, 0x0804))
+        return SSL_PRIVATE_KEY_FAILURE;
+
+    if (pkey_sign_retry) {
+        /* Keep the data to be signed for later */
+        OPENSSL_free(pkey_sign_tbs);
+        if (!TEST_ptr(pkey_sign_tbs = OPENSSL_memdup(tbs, tbslen)))
+            return SSL_PRIVATE_KEY_FAILURE;
+        pkey_sign_tbslen = tbslen;
+        return SSL_PRIVATE_KEY_RETRY;
+    }
+
+    *siglen = sigsize;
+    return pkey_sign(sig, siglen, tbs, tbslen) ? SSL_PRIVATE_KEY_SUCCESS
+                                               : SSL_PRIVATE_KEY_FAILURE;
+}
+
+/*
+ * Test signing the handshake with the private key sign callback while the
+ * server only holds the public key
+ * Test 0: TLSv1.2, ServerKeyExchange signed in the callback
+ * Test 1: TLSv1.2, ServerKeyExchange signed after the callback returned
+ * Test 2: TLSv1.3, CertificateVerify signed in the callback
+ * Test 3: TLSv1.3, CertificateVerify signed after the callback returned
+ */
+static int test_private_key_sign_cb(int idx)
+{
+    SSL_CTX *sctx = NULL, *cctx = NULL;
+    SSL *serverssl = NULL, *clientssl = NULL;
+    BIO *in = NULL;
+    EVP_PKEY *pubkey = NULL;
+    unsigned char sig[512];
+    size_t siglen = sizeof(sig);
+    int version = idx < 2 ? TLS1_2_VERSION : TLS1_3_VERSION;
+    int testresult = 0;
+
+#ifdef OPENSSL_NO_TLS1_2
+    if (idx < 2)
+        return TEST_skip("No TLSv1.2 available");
+#endif
+#ifdef OSSL_NO_USABLE_TLS1_3
+    if (idx >= 2)
+        return TEST_skip("No TLSv1.3 available");
+#endif
+
+    pkey_sign_retry = idx % 2;
+    pkey_sign_calls = 0;
+
+    if (!TEST_ptr(in = BIO_new_file(privkey, "r"))
+        || !TEST_ptr(pkey_sign_key = PEM_read_bio_PrivateKey_ex(in, NULL,
+                         NULL, NULL, libctx, NULL))
+        || !TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+            TLS_client_method(), version, version,
+            &sctx, &cctx, NULL, NULL))
+        || !TEST_int_eq(SSL_CTX_use_certificate_file(sctx, cert,
+                            SSL_FILETYPE_PEM),
+            1)
+        || !TEST_ptr(pubkey = X509_get_pubkey(SSL_CTX_get0_certificate(sctx)))
+        || !TEST_int_eq(SSL_CTX_use_PrivateKey(sctx, pubkey), 1)
+        || !TEST_true(SSL_CTX_set1_sigalgs_list(sctx, "rsa_pss_rsae_sha256"))
+        || !TEST_true(SSL_CTX_set1_sigalgs_list(cctx, "rsa_pss_rsae_sha256")))
+        goto end;
+    SSL_CTX_set_private_key_sign_cb(sctx, private_key_sign_cb, NULL);
+
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+            NULL, NULL)))
+        goto end;
+
+    if (pkey_sign_retry) {
+        /* The handshake waits until the signature is provided */
+        if (!TEST_false(create_ssl_connection(serverssl, clientssl,
+                SSL_ERROR_WANT_PRIVATE_KEY_OPERATION))
+            || !TEST_true(SSL_want_private_key_operation(serverssl))
+            || !TEST_int_le(SSL_do_handshake(serverssl), 0)
+            || !TEST_int_eq(SSL_get_error(serverssl, 0),
+                SSL_ERROR_WANT_PRIVATE_KEY_OPERATION)
+            || !TEST_int_eq(pkey_sign_calls, 1)
+            || !TEST_true(pkey_sign(sig, &siglen, pkey_sign_tbs,
+                pkey_sign_tbslen))
+            || !TEST_true(SSL_set1_private_key_signature(serverssl, sig,
+                siglen))
+            || !TEST_false(SSL_set1_private_key_signature(serverssl, sig,
+                siglen)))
+            goto end;
+    }
+    if (!TEST_true(create_ssl_connection(serverssl, clientssl,
+            SSL_ERROR_NONE))
+        || !TEST_int_eq(pkey_sign_calls, 1))
+        goto end;
+    shutdown_ssl_connection(serverssl, clientssl);
+    serverssl = clientssl = NULL;
+
+    if (pkey_sign_retry) {
+        /* A failure reported by the application fails the handshake */
+        if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+                NULL, NULL))
+            || !TEST_false(create_ssl_connection(serverssl, clientssl,
+                SSL_ERROR_WANT_PRIVATE_KEY_OPERATION))
+            || !TEST_true(SSL_set1_private_key_signature(serverssl, NULL, 0))
+            || !TEST_false(create_ssl_connection(serverssl, clientssl,
+                SSL_ERROR_SSL)))
+            goto end;
+    }
+
+    testresult = 1;
+end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    EVP_PKEY_free(pubkey);
+    EVP_PKEY_free(pkey_sign_key);
+    pkey_sign_key = NULL;
+    OPENSSL_free(pkey_sign_tbs);
+    pkey_sign_tbs = NULL;
+    BIO_free(in);
+    return testresult;
+}
+
+/*
+ * Test that TLSv1.3 servers sign their CertificateVerify messages together
+ * once the batch is full or flushed
+ * Test 0: RSA-PSS
+ * Test 1: ECDSA
+ */
+static int test_cert_verify_batch(int idx)
+{
+    SSL_CTX *sctx = NULL, *cctx = NULL;
+    SSL *serverssl[4] = { NULL }, *clientssl[4] = { NULL };
+    int i, testresult = 0;
+
+#ifdef OSSL_NO_USABLE_TLS1_3
+    return TEST_skip("No TLSv1.3 available");
+#endif
+#ifdef OPENSSL_NO_EC
+    if (idx == 1)
+        return TEST_skip("No EC available");
+#endif
+
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+            TLS_client_method(), TLS1_3_VERSION, TLS1_3_VERSION,
+            &sctx, &cctx, idx == 0 ? cert : cert2,
+            idx == 0 ? privkey : privkey2))
+        || !TEST_true(SSL_CTX_set_cert_verify_batch(sctx, 3))
+        || !TEST_true(SSL_CTX_set_cert_verify_batch_timeout(sctx, 60000)))
+        goto end;
+
+    /* The first two handshakes wait for the third to fill the batch */
+    for (i = 0; i < 3; i++) {
+        if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl[i],
+                &clientssl[i], NULL, NULL)))
+            goto end;
+        if (i < 2
+            && (!TEST_false(create_ssl_connection(serverssl[i], clientssl[i],
+                    SSL_ERROR_WANT_PRIVATE_KEY_OPERATION))
+                || !TEST_true(SSL_want_private_key_operation(serverssl[i]))))
+            goto end;
+    }
+    for (i = 2; i >= 0; i--) {
+        if (!TEST_true(create_ssl_connection(serverssl[i], clientssl[i],
+                SSL_ERROR_NONE)))
+            goto end;
+    }
+
+    /* Flushing completes a batch that is not full */
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl[3],
+            &clientssl[3], NULL, NULL))
+        || !TEST_false(create_ssl_connection(serverssl[3], clientssl[3],
+            SSL_ERROR_WANT_PRIVATE_KEY_OPERATION))
+        || !TEST_size_t_eq(SSL_CTX_flush_cert_verify_batch(sctx), 1)
+        || !TEST_size_t_eq(SSL_CTX_flush_cert_verify_batch(sctx), 0)
+        || !TEST_true(create_ssl_connection(serverssl[3], clientssl[3],
+            SSL_ERROR_NONE)))
+        goto end;
+    for (i = 0; i < 4; i++) {
+        shutdown_ssl_connection(serverssl[i], clientssl[i]);
+        serverssl[i] = clientssl[i] = NULL;
+    }
+
+    /* A connection freed while queued leaves the batch */
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl[0],
+            &clientssl[0], NULL, NULL))
+        || !TEST_false(create_ssl_connection(serverssl[0], clientssl[0],
+            SSL_ERROR_WANT_PRIVATE_KEY_OPERATION)))
+        goto end;
+    SSL_free(serverssl[0]);
+    serverssl[0] = NULL;
+    if (!TEST_size_t_eq(SSL_CTX_flush_cert_verify_batch(sctx), 0))
+        goto end;
+    SSL_free(clientssl[0]);
+    clientssl[0] = NULL;
+
+    /* A batch that does not fill is signed once the timeout has passed */
+    if (!TEST_true(SSL_CTX_set_cert_verify_batch_timeout(sctx, 50))
+        || !TEST_true(create_ssl_objects(sctx, cctx, &serverssl[0],
+            &clientssl[0], NULL, NULL))
+        || !TEST_false(create_ssl_connection(serverssl[0], clientssl[0],
+            SSL_ERROR_WANT_PRIVATE_KEY_OPERATION)))
+        goto end;
+    OSSL_sleep(100);
+    if (!TEST_true(create_ssl_connection(serverssl[0], clientssl[0],
+            SSL_ERROR_NONE))
+        || !TEST_size_t_eq(SSL_CTX_flush_cert_verify_batch(sctx), 0))
+        goto end;
+
+    testresult = 1;
+end:
+    for (i = 0; i < 4; i++) {
+        SSL_free(serverssl[i]);
+        SSL_free(clientssl[i]);
+    }
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return testresult;
+}
+
+#if defined(OPENSSL_THREADS) && !defined(OPENSSL_NO_THREAD_POOL)
+static int wait_key_share_pool(SSL_CTX *ctx, size_t count)
+{
+    int i;
+
+    /* The keys are generated by the pool worker in the background */
+    for (i = 0; i < 1000; i++) {
+        if (SSL_CTX_get_key_share_pool_count(ctx) == count)
+            return 1;
+        OSSL_sleep(10);
+    }
+    return 0;
+}
+#endif
+
+/*
+ * Test handshakes with ephemeral keys taken from a key share pool
+ * Test 0: TLSv1.3, every key is used once
+ * Test 1: TLSv1.3, every key is used twice
+ * Test 2: TLSv1.2, every key is used twice
+ */
+static int test_key_share_pool(int idx)
+{
+#if !defined(OPENSSL_THREADS) || defined(OPENSSL_NO_THREAD_POOL)
+    return TEST_skip("No thread support");
+#else
+    SSL_CTX *sctx = NULL, *cctx = NULL;
+    SSL *serverssl = NULL, *clientssl = NULL;
+    /* The client and server key of each of the last three connections */
+    EVP_PKEY *ckeys[3] = { NULL }, *skeys[3] = { NULL };
+    int version = idx < 2 ? TLS1_3_VERSION : TLS1_2_VERSION;
+    unsigned int max_uses = idx == 0 ? 1 : 2;
+    int i, testresult = 0;
+
+#ifdef OPENSSL_NO_TLS1_2
+    if (idx == 2)
+        return TEST_skip("No TLSv1.2 available");
+#endif
+#ifdef OSSL_NO_USABLE_TLS1_3
+    if (idx < 2)
+        return TEST_skip("No TLSv1.3 available");
+#endif
+#ifdef OPENSSL_NO_EC
+    return TEST_skip("No EC available");
+#endif
+
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+            TLS_client_method(), version, version,
+            &sctx, &cctx, cert, privkey))
+        || !TEST_true(SSL_CTX_set1_groups_list(sctx, "P-256"))
+        || !TEST_true(SSL_CTX_set1_groups_list(cctx, "P-256"))
+        || !TEST_false(SSL_CTX_set_key_share_pool(sctx, 2, 0))
+        || !TEST_true(SSL_CTX_set_key_share_pool(sctx, 2, max_uses))
+        || !TEST_true(SSL_CTX_set_key_share_pool(cctx, 2, max_uses)))
+        goto end;
+
+    for (i = 0; i < 4; i++) {
+        /*
+         * The first handshake adds the group to the pools, wait for them to
+         * be filled before the others. A TLSv1.2 client derives its key from
+         * the server parameters and does not use the pool.
+         */
+        if (i == 1
+            && (!TEST_true(wait_key_share_pool(sctx, 2))
+                || !TEST_true(wait_key_share_pool(cctx,
+                    version == TLS1_3_VERSION ? 2 : 0))))
+            goto end;
+
+        if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+                NULL, NULL))
+            || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                SSL_ERROR_NONE)))
+            goto end;
+        if (i > 0
+            && (!TEST_true(SSL_get_peer_tmp_key(clientssl, &skeys[i - 1]))
+                || (version == TLS1_3_VERSION
+                    && !TEST_true(SSL_get_peer_tmp_key(serverssl,
+                        &ckeys[i - 1])))))
+            goto end;
+        shutdown_ssl_connection(serverssl, clientssl);
+        serverssl = clientssl = NULL;
+    }
+
+    /* A key is only used again if the reuse policy allows it */
+    if (!TEST_int_eq(EVP_PKEY_eq(skeys[0], skeys[1]), max_uses == 2)
+        || !TEST_int_ne(EVP_PKEY_eq(skeys[1], skeys[2]), 1))
+        goto end;
+    if (version == TLS1_3_VERSION
+        && (!TEST_int_eq(EVP_PKEY_eq(ckeys[0], ckeys[1]), max_uses == 2)
+            || !TEST_int_ne(EVP_PKEY_eq(ckeys[1], ckeys[2]), 1)))
+        goto end;
+
+    /* A depth of 0 removes the pool */
+    if (!TEST_true(SSL_CTX_set_key_share_pool(sctx, 0, 0))
+        || !TEST_size_t_eq(SSL_CTX_get_key_share_pool_count(sctx), 0))
+        goto end;
+
+    testresult = 1;
+end:
+    for (i = 0; i < 3; i++) {
+        EVP_PKEY_free(ckeys[i]);
+        EVP_PKEY_free(skeys[i]);
+    }
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return testresult;
+#endif
+}
+
+/*
+ * Test that a session cached in the shared session cache of one SSL_CTX is
+ * resumed by another SSL_CTX mapping the same file, as the workers of a
+ * multi-process server would. The shared cache is not used for lookups when
+ * SSL_SESS_CACHE_NO_INTERNAL_LOOKUP is set.
+ * Test 0: TLSv1.2
+ * Test 1: TLSv1.3 with stateful tickets
+ */
+static int test_shared_session_cache(int idx)
+{
+#if !defined(OPENSSL_SYS_UNIX)
+    return TEST_skip("No shared memory mappings");
+#else
+    SSL_CTX *sctx = NULL, *sctx2 = NULL, *cctx = NULL, *cctx2 = NULL;
+    SSL *serverssl = NULL, *clientssl = NULL;
+    SSL_SESSION *sess = NULL, *ssess = NULL;
+    char *path = NULL;
+    int version = idx == 0 ? TLS1_2_VERSION : TLS1_3_VERSION;
+    int i, testresult = 0;
+
+#ifdef OPENSSL_NO_TLS1_2
+    if (idx == 0)
+        return TEST_skip("No TLSv1.2 available");
+#endif
+#ifdef OSSL_NO_USABLE_TLS1_3
+    if (idx == 1)
+        return TEST_skip("No TLSv1.3 available");
+#endif
+
+    if (!TEST_ptr(path = OPENSSL_zalloc(strlen(tmpfilename) + 6)))
+        goto end;
+    strcpy(path, tmpfilename);
+    strcat(path, ".sess");
+    remove(path);
+
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+            TLS_client_method(), version, version,
+            &sctx, &cctx, cert, privkey))
+        || !TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+            TLS_client_method(), version, version,
+            &sctx2, &cctx2, cert, privkey)))
+        goto end;
+    SSL_CTX_set_options(sctx, SSL_OP_NO_TICKET);
+    SSL_CTX_set_options(sctx2, SSL_OP_NO_TICKET);
+    /* The second server only finds sessions in the shared cache */
+    SSL_CTX_set_session_cache_mode(sctx2,
+        SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+
+    if (!TEST_true(SSL_CTX_sess_set_shared_cache(sctx, path, 64))
+        || !TEST_false(SSL_CTX_sess_set_shared_cache(sctx2, path, 128))
+        || !TEST_true(SSL_CTX_sess_set_shared_cache(sctx2, path, 64)))
+        goto end;
+
+    for (i = 0; i < 5; i++) {
+        if (!TEST_true(create_ssl_objects(i == 0 ? sctx : sctx2, cctx,
+                &serverssl, &clientssl, NULL, NULL))
+            || (sess != NULL && !TEST_true(SSL_set_session(clientssl, sess)))
+            || !TEST_true(create_ssl_connection(serverssl, clientssl,
+                SSL_ERROR_NONE)))
+            goto end;
+
+        /*
+         * The session of the first server is resumed by the second one until
+         * the second one stops looking sessions up internally, and then
+         * until the first one removes it
+         */
+        if (i == 0) {
+            if (!TEST_ptr(sess = SSL_get1_session(clientssl))
+                || !TEST_ptr(ssess = SSL_get1_session(serverssl)))
+                goto end;
+        } else if (!TEST_int_eq(SSL_session_reused(clientssl),
+                       i == 1 || i == 3)) {
+            goto end;
+        }
+        shutdown_ssl_connection(serverssl, clientssl);
+        serverssl = clientssl = NULL;
+
+        if (i == 1)
+            SSL_CTX_set_session_cache_mode(sctx2,
+                SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+        if (i == 2)
+            SSL_CTX_set_session_cache_mode(sctx2,
+                SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        if (i == 3 && !TEST_true(SSL_CTX_remove_session(sctx, ssess)))
+            goto end;
+    }
+
+    /* Shared cache hits are not counted as external cache hits */
+    if (!TEST_long_eq(SSL_CTX_sess_shared_hits(sctx2), 2)
+        || !TEST_long_eq(SSL_CTX_sess_cb_hits(sctx2), 0)
+        || !TEST_long_eq(SSL_CTX_sess_shared_hits(sctx), 0))
+        goto end;
+
+    /* A file that others can access is refused */
+    SSL_CTX_free(sctx2);
+    sctx2 = NULL;
+    if (!TEST_int_eq(chmod(path, 0644), 0)
+        || !TEST_ptr(sctx2 = SSL_CTX_new_ex(libctx, NULL, TLS_server_method()))
+        || !TEST_false(SSL_CTX_sess_set_shared_cache(sctx2, path, 64)))
+        goto end;
+
+    testresult = 1;
+end:
+    SSL_SESSION_free(sess);
+    SSL_SESSION_free(ssess);
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(sctx2);
+    SSL_CTX_free(cctx);
+    SSL_CTX_free(cctx2);
+    if (path != NULL)
+        remove(path);
+    OPENSSL_free(path);
+    return testresult;
+#endif
+}
+
+/*
+ * Test that the slots of the shared session cache that a writer left busy when
+ * it died are skipped by readers and writers, until a writer finds them busy
+ * for long enough and takes them over.
+ */
+static int test_shared_session_cache_takeover(void)
+{
+#if !defined(OPENSSL_SYS_UNIX)
+    return TEST_skip("No shared memory mappings");
+#else
+    SSL_CTX *sctx = NULL, *cctx = NULL;
+    SSL *serverssl = NULL, *clientssl = NULL;
+    SSL_SESSION *sess = NULL, *found = NULL;
+    int testresult = 0;
+
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+            TLS_client_method(), 0, 0, &sctx, &cctx, cert, privkey)))
+        goto end;
+    SSL_CTX_set_options(sctx, SSL_OP_NO_TICKET);
+
+    /* With as many slots as probes, all sessions may go in every slot */
+    if (!TEST_true(SSL_CTX_sess_set_shared_cache(sctx, NULL, 4))
+        || !TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+            NULL, NULL))
+        || !TEST_true(create_ssl_connection(serverssl, clientssl,
+            SSL_ERROR_NONE))
+        || !TEST_ptr(sess = SSL_get1_session(serverssl))
+        || !TEST_ptr(found = ssl_shared_sess_cache_get(sctx, sess->session_id,
+                         sess->session_id_length)))
+        goto end;
+    SSL_SESSION_free(found);
+
+    /* The slots stay busy while the dead writer may still be writing */
+    ssl_shared_sess_cache_debug_abandon(sctx, sess, time(NULL));
+    ssl_shared_sess_cache_add(sctx, sess);
+    if (!TEST_ptr_null(found = ssl_shared_sess_cache_get(sctx,
+                           sess->session_id, sess->session_id_length)))
+        goto end;
+
+    /* Once they have been busy for too long, a writer takes them over */
+    ssl_shared_sess_cache_debug_abandon(sctx, sess, time(NULL) - 60);
+    ssl_shared_sess_cache_add(sctx, sess);
+    if (!TEST_ptr(found = ssl_shared_sess_cache_get(sctx, sess->session_id,
+                      sess->session_id_length)))
+        goto end;
+    SSL_SESSION_free(found);
+
+    /* and they can be written again afterwards */
+    ssl_shared_sess_cache_remove(sctx, sess);
+    if (!TEST_ptr_null(found = ssl_shared_sess_cache_get(sctx,
+                           sess->session_id, sess->session_id_length)))
+        goto end;
+
+    testresult = 1;
+end:
+    SSL_SESSION_free(found);
+    SSL_SESSION_free(sess);
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    return testresult;
+#endif
+}
+
+static int test_client_hello_peek(void)
+{
+    SSL_CTX *cctx = NULL;
+    SSL *clientssl = NULL;
+    BIO *rbio = NULL, *wbio = NULL;
+    static const unsigned char alpn[] = { 2, 'h', '2' };
+    const unsigned char *data, *out;
+    unsigned char *copy = NULL;
+    size_t len, outlen;
+    long datalen;
+    int testresult = 0;
+
+    if (!TEST_ptr(cctx = SSL_CTX_new_ex(libctx, NULL, TLS_client_method()))
+        || !TEST_ptr(clientssl = SSL_new(cctx))
+        || !TEST_ptr(rbio = BIO_new(BIO_s_mem()))
+        || !TEST_ptr(wbio = BIO_new(BIO_s_mem())))
+        goto end;
+    SSL_set_bio(clientssl, rbio, wbio);
+
+    if (!TEST_true(SSL_set_tlsext_host_name(clientssl, "peek.example"))
+        || !TEST_int_eq(SSL_set_alpn_protos(clientssl, alpn, sizeof(alpn)), 0)
+        || !TEST_int_le(SSL_connect(clientssl), 0)
+        || !TEST_int_eq(SSL_get_error(clientssl, -1), SSL_ERROR_WANT_READ)
+        || !TEST_long_gt(datalen = BIO_get_mem_data(wbio, (char **)&data), 0))
+        goto end;
+    len = (size_t)datalen;
+
+    if (!TEST_int_eq(SSL_client_hello_peek_servername(data, len, &out,
+                         &outlen),
+            1)
+        || !TEST_mem_eq(out, outlen, "peek.example", 12)
+        || !TEST_int_eq(SSL_client_hello_peek_ext(data, len,
+                            TLSEXT_TYPE_application_layer_protocol_negotiation,
+                            &out, &outlen),
+            1)
+        || !TEST_size_t_eq(outlen, sizeof(alpn) + 2)
+        || !TEST_mem_eq(out + 2, outlen - 2, alpn, sizeof(alpn))
+        || !TEST_int_eq(SSL_client_hello_peek_ext(data, len, 0xfe00, NULL,
+                            NULL),
+            0))
+        goto end;
+
+    /* A short read needs more data */
+    if (!TEST_int_eq(SSL_client_hello_peek_ext(data, 3, 0, NULL, NULL), -1)
+        || !TEST_int_eq(SSL_client_hello_peek_ext(data, len - 1, 0, NULL,
+                            NULL),
+            -1))
+        goto end;
+
+    /* Anything but a handshake record is not a ClientHello */
+    if (!TEST_ptr(copy = OPENSSL_memdup(data, len)))
+        goto end;
+    copy[0] = SSL3_RT_APPLICATION_DATA;
+    if (!TEST_int_eq(SSL_client_hello_peek_servername(copy, len, NULL, NULL),
+            -2))
+        goto end;
+
+    testresult = 1;
+end:
+    OPENSSL_free(copy);
+    SSL_free(clientssl);
+    SSL_CTX_free(cctx);
+    return testresult;
+}
+
+/*
+ * Test that sessions with timeouts spread over all levels of the expiry timer
+ * wheel are removed exactly when they time out, and that a bounded flush
+ * makes progress in batches
+ */
+static int test_session_timer_wheel(void)
+{
+    SSL_CTX *ctx = NULL;
+    SSL_SESSION *sessions[200] = { NULL };
+    static const long flushes[] = { 5, 100, 5000, 300000, 2000000 };
+    unsigned char id[SSL3_SSL_SESSION_ID_LENGTH];
+    time_t now = time(NULL);
+    long timeout;
+    size_t i, j;
+    int ret, batches = 0, testresult = 0;
+
+    if (!TEST_ptr(ctx = SSL_CTX_new_ex(libctx, NULL, TLS_method())))
+        goto end;
+
+    for (i = 0; i < OSSL_NELEM(sessions); i++) {
+        memset(id, 0, sizeof(id));
+        id[0] = (unsigned char)i;
+        if (!TEST_ptr(sessions[i] = SSL_SESSION_new())
+            || !TEST_true(SSL_SESSION_set1_id(sessions[i], id, sizeof(id)))
+            || !TEST_time_t_eq(SSL_SESSION_set_time_ex(sessions[i], now), now)
+            || !TEST_true(SSL_SESSION_set_timeout(sessions[i],
+                (long)(i * i * 37 + 1)))
+            || !TEST_int_eq(SSL_CTX_add_session(ctx, sessions[i]), 1))
+            goto end;
+    }
+
+    for (j = 0; j < OSSL_NELEM(flushes); j++) {
+        SSL_CTX_flush_sessions_ex(ctx, now + flushes[j]);
+        for (i = 0; i < OSSL_NELEM(sessions); i++) {
+            timeout = (long)(i * i * 37 + 1);
+            if (!TEST_int_eq(sessions[i]->owner != NULL,
+                    timeout >= flushes[j])) {
+                TEST_info("session %zu, flush at %ld", i, flushes[j]);
+                goto end;
+            }
+        }
+    }
+    if (!TEST_long_eq(SSL_CTX_sess_number(ctx), 0))
+        goto end;
+
+    for (i = 0; i < OSSL_NELEM(sessions); i++)
+        if (!TEST_int_eq(SSL_CTX_add_session(ctx, sessions[i]), 1))
+            goto end;
+
+    /* Nothing has timed out yet */
+    if (!TEST_int_eq(SSL_CTX_flush_sessions_batch(ctx, now, 1), 1)
+        || !TEST_long_eq(SSL_CTX_sess_number(ctx),
+            (long)OSSL_NELEM(sessions)))
+        goto end;
+
+    do {
+        ret = SSL_CTX_flush_sessions_batch(ctx, now + 2000000, 10);
+    } while (++batches < 1000 && ret == 0);
+    if (!TEST_int_eq(ret, 1)
+        || !TEST_int_ge(batches, (int)OSSL_NELEM(sessions) / 10)
+        || !TEST_long_eq(SSL_CTX_sess_number(ctx), 0))
         goto end;
 
     testresult = 1;
 end:
     SSL_CTX_free(ctx);
-    SSL_SESSION_free(early);
-    SSL_SESSION_free(middle);
-    SSL_SESSION_free(late);
+    for (i = 0; i < OSSL_NELEM(sessions); i++)
+        SSL_SESSION_free(sessions[i]);
+    return testresult;
+}
+
+static SSL_SESSION *evicted[8];
+static size_t num_evicted;
+
+static void record_evicted_cb(SSL_CTX *ctx, SSL_SESSION *sess)
+{
+    if (num_evicted < OSSL_NELEM(evicted))
+        evicted[num_evicted++] = sess;
+}
+
+/*
+ * Test that when the cache is full sessions are evicted in the order they
+ * time out, whichever level of the expiry timer wheel they are filed in
+ */
+static int test_session_timer_wheel_eviction(void)
+{
+    SSL_CTX *ctx = NULL;
+    SSL_SESSION *sessions[10] = { NULL };
+    /*
+     * The first five sessions fill the cache and are spread over the first
+     * three levels of the wheel. Each of the others evicts one of them. A
+     * slot comes due at its start, so these are far enough apart that the
+     * slots come due in the same order as the sessions time out.
+     */
+    static const long timeouts[] = { 300, 5, 70000, 40, 5000,
+                                     400000, 400000, 400000, 400000, 400000 };
+    /* The indexes of the sessions in the order they should be evicted */
+    static const size_t order[] = { 1, 3, 0, 4, 2 };
+    unsigned char id[SSL3_SSL_SESSION_ID_LENGTH];
+    time_t now = time(NULL);
+    size_t i;
+    int testresult = 0;
+
+    num_evicted = 0;
+    if (!TEST_ptr(ctx = SSL_CTX_new_ex(libctx, NULL, TLS_method())))
+        goto end;
+    /* Room for the five sessions and the one being added */
+    SSL_CTX_sess_set_cache_size(ctx, 6);
+    SSL_CTX_sess_set_remove_cb(ctx, record_evicted_cb);
+
+    for (i = 0; i < OSSL_NELEM(sessions); i++) {
+        memset(id, 0, sizeof(id));
+        id[0] = (unsigned char)(i + 1);
+        if (!TEST_ptr(sessions[i] = SSL_SESSION_new())
+            || !TEST_true(SSL_SESSION_set1_id(sessions[i], id, sizeof(id)))
+            || !TEST_time_t_eq(SSL_SESSION_set_time_ex(sessions[i], now), now)
+            || !TEST_true(SSL_SESSION_set_timeout(sessions[i], timeouts[i]))
+            || !TEST_int_eq(SSL_CTX_add_session(ctx, sessions[i]), 1))
+            goto end;
+    }
+
+    if (!TEST_size_t_eq(num_evicted, OSSL_NELEM(order))
+        || !TEST_long_eq(SSL_CTX_sess_number(ctx), 5))
+        goto end;
+    for (i = 0; i < OSSL_NELEM(order); i++) {
+        if (!TEST_ptr_eq(evicted[i], sessions[order[i]])) {
+            TEST_info("eviction %zu", i);
+            goto end;
+        }
+    }
+
+    testresult = 1;
+end:
+    SSL_CTX_free(ctx);
+    for (i = 0; i < OSSL_NELEM(sessions); i++)
+        SSL_SESSION_free(sessions[i]);
+    return testresult;
+}
+
+/*
+ * Test that a sharded session cache stores, evicts, flushes and resumes
+ * sessions in the same way as the default single table does
+ */
+static int test_session_cache_shards(void)
+{
+    SSL_CTX *sctx = NULL, *cctx = NULL;
+    SSL *serverssl = NULL, *clientssl = NULL;
+    SSL_SESSION *sessions[64] = { NULL };
+    SSL_SESSION *sess = NULL;
+    unsigned char id[SSL3_SSL_SESSION_ID_LENGTH];
+    size_t i;
+    int testresult = 0;
+
+    if (!TEST_ptr(sctx = SSL_CTX_new_ex(libctx, NULL, TLS_method())))
+        goto end;
+
+    if (!TEST_size_t_eq(SSL_CTX_sess_get_cache_shards(sctx), 1)
+        || !TEST_false(SSL_CTX_sess_set_cache_shards(sctx, 0))
+        || !TEST_false(SSL_CTX_sess_set_cache_shards(sctx,
+            SSL_SESSION_CACHE_MAX_SHARDS + 1))
+        || !TEST_true(SSL_CTX_sess_set_cache_shards(sctx, 8))
+        || !TEST_size_t_eq(SSL_CTX_sess_get_cache_shards(sctx), 8))
+        goto end;
+
+    for (i = 0; i < OSSL_NELEM(sessions); i++) {
+        memset(id, 0, sizeof(id));
+        id[sizeof(id) - 1] = (unsigned char)i;
+        if (!TEST_ptr(sessions[i] = SSL_SESSION_new())
+            || !TEST_true(SSL_SESSION_set1_id(sessions[i], id, sizeof(id)))
+            || !TEST_int_eq(SSL_CTX_add_session(sctx, sessions[i]), 1))
+            goto end;
+    }
+    if (!TEST_long_eq(SSL_CTX_sess_number(sctx), (long)OSSL_NELEM(sessions))
+        || !TEST_int_eq(SSL_CTX_add_session(sctx, sessions[3]), 0))
+        goto end;
+
+    /* The shard count can only be changed while the cache is empty */
+    if (!TEST_false(SSL_CTX_sess_set_cache_shards(sctx, 4))
+        || !TEST_size_t_eq(SSL_CTX_sess_get_cache_shards(sctx), 8))
+        goto end;
+
+    if (!TEST_true(SSL_CTX_remove_session(sctx, sessions[5]))
+        || !TEST_false(SSL_CTX_remove_session(sctx, sessions[5]))
+        || !TEST_long_eq(SSL_CTX_sess_number(sctx),
+            (long)OSSL_NELEM(sessions) - 1))
+        goto end;
+
+    SSL_CTX_flush_sessions_ex(sctx, 0);
+    if (!TEST_long_eq(SSL_CTX_sess_number(sctx), 0))
+        goto end;
+
+    /* The cache size limit applies across all of the shards */
+    SSL_CTX_sess_set_cache_size(sctx, 16);
+    for (i = 0; i < OSSL_NELEM(sessions); i++)
+        if (!TEST_int_eq(SSL_CTX_add_session(sctx, sessions[i]), 1))
+            goto end;
+    if (!TEST_long_gt(SSL_CTX_sess_number(sctx), 0)
+        || !TEST_long_le(SSL_CTX_sess_number(sctx), 16))
+        goto end;
+
+    /* SSL_CTX_sessions() merges the shards into the table it returns */
+    SSL_CTX_flush_sessions_ex(sctx, 0);
+    SSL_CTX_sess_set_cache_size(sctx, 0);
+    for (i = 0; i < OSSL_NELEM(sessions); i++)
+        if (!TEST_int_eq(SSL_CTX_add_session(sctx, sessions[i]), 1))
+            goto end;
+    if (!TEST_ptr(SSL_CTX_sessions(sctx))
+        || !TEST_size_t_eq(SSL_CTX_sess_get_cache_shards(sctx), 1)
+        || !TEST_ulong_eq(lh_SSL_SESSION_num_items(SSL_CTX_sessions(sctx)),
+            OSSL_NELEM(sessions))
+        || !TEST_long_eq(SSL_CTX_sess_number(sctx), (long)OSSL_NELEM(sessions)))
+        goto end;
+    for (i = 0; i < OSSL_NELEM(sessions); i++)
+        if (!TEST_ptr_eq(lh_SSL_SESSION_retrieve(SSL_CTX_sessions(sctx),
+                sessions[i]), sessions[i]))
+            goto end;
+    if (!TEST_true(SSL_CTX_remove_session(sctx, sessions[7]))
+        || !TEST_long_eq(SSL_CTX_sess_number(sctx),
+            (long)OSSL_NELEM(sessions) - 1))
+        goto end;
+    SSL_CTX_flush_sessions_ex(sctx, 0);
+    if (!TEST_long_eq(SSL_CTX_sess_number(sctx), 0)
+        || !TEST_false(SSL_CTX_sess_set_cache_shards(sctx, 8))
+        || !TEST_true(SSL_CTX_sess_set_cache_shards(sctx, 1)))
+        goto end;
+    SSL_CTX_free(sctx);
+    sctx = NULL;
+
+#ifndef OPENSSL_NO_TLS1_2
+    /* Resume a session held in a sharded cache */
+    if (!TEST_true(create_ssl_ctx_pair(libctx, TLS_server_method(),
+            TLS_client_method(), TLS1_VERSION, TLS1_2_VERSION,
+            &sctx, &cctx, cert, privkey))
+        || !TEST_true(SSL_CTX_set_options(sctx, SSL_OP_NO_TICKET))
+        || !TEST_true(SSL_CTX_sess_set_cache_shards(sctx, 16))
+        || !TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+            NULL, NULL))
+        || !TEST_true(create_ssl_connection(serverssl, clientssl,
+            SSL_ERROR_NONE))
+        || !TEST_ptr(sess = SSL_get1_session(clientssl))
+        || !TEST_long_eq(SSL_CTX_sess_number(sctx), 1))
+        goto end;
+
+    shutdown_ssl_connection(serverssl, clientssl);
+    serverssl = clientssl = NULL;
+
+    if (!TEST_true(create_ssl_objects(sctx, cctx, &serverssl, &clientssl,
+            NULL, NULL))
+        || !TEST_true(SSL_set_session(clientssl, sess))
+        || !TEST_true(create_ssl_connection(serverssl, clientssl,
+            SSL_ERROR_NONE))
+        || !TEST_true(SSL_session_reused(clientssl)))
+        goto end;
+#endif
+
+    testresult = 1;
+end:
+    SSL_free(serverssl);
+    SSL_free(clientssl);
+    SSL_CTX_free(sctx);
+    SSL_CTX_free(cctx);
+    SSL_SESSION_free(sess);
+    for (i = 0; i < OSSL_NELEM(sessions); i++)
+        SSL_SESSION_free(sessions[i]);
     return testresult;
 }
 
@@ -15603,10 +17875,14 @@ int setup_tests(void)
 #if !defined(OPENSSL_NO_TLS1_2) || !defined(OSSL_NO_USABLE_TLS1_3)
     ADD_ALL_TESTS(test_ktls, NUM_KTLS_TEST_CIPHERS * 4);
     ADD_ALL_TESTS(test_ktls_sendfile, NUM_KTLS_TEST_CIPHERS * 2);
+    ADD_ALL_TESTS(test_ktls_splice, NUM_KTLS_TEST_CIPHERS * 2);
 #endif
 #ifndef OSSL_NO_USABLE_TLS1_3
     ADD_TEST(test_ktls_moving_write_buffer);
 #endif
+#endif
+#if defined(OPENSSL_SYS_UNIX)
+    ADD_TEST(test_splice_fallback);
 #endif
     ADD_TEST(test_large_message_tls);
     ADD_TEST(test_large_message_tls_read_ahead);
@@ -15740,6 +18016,16 @@ int setup_tests(void)
 #ifndef OPENSSL_NO_TLS1_2
     ADD_ALL_TESTS(test_multiblock_write, OSSL_NELEM(multiblock_cipherlist_data));
 #endif
+#ifndef OSSL_NO_USABLE_TLS1_3
+    ADD_ALL_TESTS(test_tls13_pipeline, 2);
+#endif
+    ADD_ALL_TESTS(test_record_buffer_pool, 2);
+    ADD_ALL_TESTS(test_record_sizing, 5);
+#ifndef OSSL_NO_USABLE_TLS1_3
+    ADD_ALL_TESTS(test_transcript_lanes_hrr, 4);
+#endif
+    ADD_ALL_TESTS(test_hibernate, 3);
+    ADD_ALL_TESTS(test_coalesce_writes, 4);
     ADD_ALL_TESTS(test_servername, 10);
     ADD_TEST(test_unknown_sigalgs_groups);
 #if (!defined(OPENSSL_NO_EC) || !defined(OPENSSL_NO_DH)) || !defined(OPENSSL_NO_ML_KEM)
@@ -15776,6 +18062,18 @@ int setup_tests(void)
     ADD_TEST(test_set_verify_cert_store_ssl_ctx);
     ADD_TEST(test_set_verify_cert_store_ssl);
     ADD_ALL_TESTS(test_session_timeout, 1);
+    ADD_TEST(test_session_timer_wheel);
+    ADD_TEST(test_session_timer_wheel_eviction);
+    ADD_ALL_TESTS(test_ticket_key_ring, 2);
+    ADD_ALL_TESTS(test_ticket_key_rotation_interval, 2);
+    ADD_ALL_TESTS(test_cert_chain_cache, 2);
+    ADD_ALL_TESTS(test_private_key_sign_cb, 4);
+    ADD_ALL_TESTS(test_key_share_pool, 3);
+    ADD_ALL_TESTS(test_cert_verify_batch, 2);
+    ADD_TEST(test_client_hello_peek);
+    ADD_ALL_TESTS(test_shared_session_cache, 2);
+    ADD_TEST(test_shared_session_cache_takeover);
+    ADD_TEST(test_session_cache_shards);
 #if !defined(OSSL_NO_USABLE_TLS1_3) || !defined(OPENSSL_NO_TLS1_2)
     ADD_ALL_TESTS(test_session_cache_overflow, 4);
 #endif
@@ -0,0 +1,209 @@
+/*
+ * Copyright 2026 The OpenSSL Project Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License 2.0 (the "License").  You may not use
+ * this file except in compliance with the License.  You can obtain a copy
+ * in the file LICENSE in the source distribution or at
+ * https://www.openssl.org/source/license.html
+ */
+
+/*
+ * Measure the cost of protecting and unprotecting TLSv1.3 application data
+ * records. A client and a server are connected with a BIO pair so that no
+ * system calls are involved, and the client writes records of a fixed size
+ * which the server reads back. The time reported is dominated by the record
+ * layer and the cipher.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#include <openssl/e_os2.h>
+#include <openssl/crypto.h>
+
+#ifdef OPENSSL_SYS_UNIX
+#include <sys/time.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/bio.h>
+#include "internal/e_os.h"
+#if defined(_POSIX_VERSION) && _POSIX_VERSION >= 200112L
+
+#ifndef timersub
+/* struct timeval * subtraction; a must be greater than or equal to b */
+#define timersub(a, b, res)                                         \
+    do {                                                            \
+        (res)->tv_sec = (a)->tv_sec - (b)->tv_sec;                  \
+        if ((a)->tv_usec < (b)->tv_usec) {                          \
+            (res)->tv_usec = (a)->tv_usec + 1000000 - (b)->tv_usec; \
+            --(res)->tv_sec;                                        \
+        } else {                                                    \
+            (res)->tv_usec = (a)->tv_usec - (b)->tv_usec;           \
+        }                                                           \
+    } while (0)
+#endif
+
+static char *prog;
+
+static void fail(const char *what)
+{
+    fprintf(stderr, "%s: %s failed\n", prog, what);
+    ERR_print_errors_fp(stderr);
+    exit(EXIT_FAILURE);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: %s [flags] cert-file key-file\n", prog);
+    fprintf(stderr, "Flags:\n");
+    fprintf(stderr, "  -c #  Number of records (default 100000)\n");
+    fprintf(stderr, "  -s #  Record size (default 16384)\n");
+    fprintf(stderr, "  -t S  TLSv1.3 ciphersuite (default TLS_AES_128_GCM_SHA256)\n");
+    exit(EXIT_FAILURE);
+}
+
+/* Move everything that is pending in either direction until both sides block */
+static int do_handshake(SSL *client, SSL *server)
+{
+    int i, cret = 0, sret = 0;
+
+    for (i = 0; i < 100 && (cret <= 0 || sret <= 0); i++) {
+        if (cret <= 0) {
+            cret = SSL_do_handshake(client);
+            if (cret <= 0 && SSL_get_error(client, cret) != SSL_ERROR_WANT_READ)
+                return 0;
+        }
+        if (sret <= 0) {
+            sret = SSL_do_handshake(server);
+            if (sret <= 0 && SSL_get_error(server, sret) != SSL_ERROR_WANT_READ)
+                return 0;
+        }
+    }
+
+    return cret > 0 && sret > 0;
+}
+
+int main(int ac, char **av)
+{
+    int i, count = 100000, size = SSL3_RT_MAX_PLAIN_LENGTH;
+    const char *suite = "TLS_AES_128_GCM_SHA256";
+    SSL_CTX *cctx, *sctx;
+    SSL *client, *server;
+    BIO *cbio, *sbio;
+    unsigned char *buf;
+    size_t written, readbytes;
+    struct timeval start, end, elapsed;
+    double usecs;
+
+    /* Parse JCL. */
+    prog = av[0];
+    while ((i = getopt(ac, av, "c:s:t:")) != EOF) {
+        switch (i) {
+        default:
+            usage();
+            break;
+        case 'c':
+        case 's': {
+            unsigned long ul;
+
+            if (!OPENSSL_strtoul(optarg, NULL, 10, &ul) || ul == 0
+                || ul > INT_MAX
+                || (i == 's' && ul > SSL3_RT_MAX_PLAIN_LENGTH))
+                usage();
+            if (i == 'c')
+                count = (int)ul;
+            else
+                size = (int)ul;
+            break;
+        }
+        case 't':
+            suite = optarg;
+            break;
+        }
+    }
+    ac -= optind;
+    av += optind;
+    if (ac != 2)
+        usage();
+
+    cctx = SSL_CTX_new(TLS_client_method());
+    sctx = SSL_CTX_new(TLS_server_method());
+    if (cctx == NULL || sctx == NULL)
+        fail("SSL_CTX_new");
+    if (!SSL_CTX_set_min_proto_version(cctx, TLS1_3_VERSION)
+        || !SSL_CTX_set_min_proto_version(sctx, TLS1_3_VERSION)
+        || !SSL_CTX_set_ciphersuites(cctx, suite)
+        || !SSL_CTX_set_ciphersuites(sctx, suite))
+        fail("ciphersuite selection");
+    if (SSL_CTX_use_certificate_chain_file(sctx, av[0]) <= 0
+        || SSL_CTX_use_PrivateKey_file(sctx, av[1], SSL_FILETYPE_PEM) <= 0)
+        fail("loading the server credentials");
+
+    client = SSL_new(cctx);
+    server = SSL_new(sctx);
+    if (client == NULL || server == NULL)
+        fail("SSL_new");
+    /* Each side of the pair must be able to hold a complete flight */
+    if (!BIO_new_bio_pair(&cbio, 4 * SSL3_RT_MAX_PACKET_SIZE,
+            &sbio, 4 * SSL3_RT_MAX_PACKET_SIZE))
+        fail("BIO_new_bio_pair");
+    SSL_set_bio(client, cbio, cbio);
+    SSL_set_bio(server, sbio, sbio);
+    SSL_set_connect_state(client);
+    SSL_set_accept_state(server);
+    if (!do_handshake(client, server))
+        fail("handshake");
+
+    buf = OPENSSL_zalloc(size);
+    if (buf == NULL)
+        fail("malloc");
+
+    if (gettimeofday(&start, NULL) < 0) {
+        perror("gettimeofday");
+        exit(EXIT_FAILURE);
+    }
+    for (i = count; i > 0; i--) {
+        if (!SSL_write_ex(client, buf, size, &written))
+            fail("SSL_write_ex");
+        for (readbytes = 0; written > 0; written -= readbytes)
+            if (!SSL_read_ex(server, buf, size, &readbytes))
+                fail("SSL_read_ex");
+    }
+    if (gettimeofday(&end, NULL) < 0) {
+        perror("gettimeofday");
+        exit(EXIT_FAILURE);
+    }
+    timersub(&end, &start, &elapsed);
+    usecs = (double)elapsed.tv_sec * 1000000 + elapsed.tv_usec;
+
+    printf("%s, %d records of %d bytes\n", SSL_get_cipher(client), count, size);
+    printf("elapsed   %d sec %d microsec\n",
+        (int)elapsed.tv_sec, (int)elapsed.tv_usec);
+    printf("per record %.0f nanosec\n", usecs * 1000 / count);
+    if (usecs > 0)
+        printf("throughput %.1f MB/s\n", (double)count * size / usecs);
+
+    OPENSSL_free(buf);
+    SSL_free(client);
+    SSL_free(server);
+    SSL_CTX_free(cctx);
+    SSL_CTX_free(sctx);
+    return EXIT_SUCCESS;
+}
+
+#else
+int main(int ac, char **av)
+{
+    fprintf(stderr,
+        "This tool is not supported on this platform for lack of POSIX1.2001 support\n");
+    exit(EXIT_FAILURE);
+}
+#endif
+#else
+int main(int ac, char **av)
+{
+    fprintf(stderr, "This tool is only supported on Unix platforms\n");
+    exit(EXIT_FAILURE);
+}
+#endif
@@ -371,8 +371,121 @@ err:
     return ret;
 }
 
+/*
+ * Encrypt each record with the plaintext left in a separate input buffer, as
+ * the write path does when it encrypts straight from the caller's buffer.
+ * For odd test indexes the trailing inner content type byte is already in
+ * the output buffer, as it is when the record layer adds it.
+ */
+static int test_tls13_encryption_from_input(int idx)
+{
+    TLS_RL_RECORD rec;
+    RECORD_DATA *recd = &refdata[idx / 2];
+    unsigned char *key = NULL, *input = NULL;
+    size_t ivlen = EVP_CIPHER_get_iv_length(EVP_aes_128_gcm());
+    size_t trailer = idx % 2;
+    unsigned char seqbuf[SEQ_NUM_SIZE];
+    unsigned char iv[EVP_MAX_IV_LENGTH];
+    OSSL_RECORD_LAYER *wrl = NULL;
+    int ret = 0;
+
+    rec.data = NULL;
+    rec.type = SSL3_RT_APPLICATION_DATA;
+    rec.rec_version = TLS1_2_VERSION;
+
+    if (!TEST_true(load_record(&rec, recd, &key, iv, ivlen, seqbuf)))
+        goto err;
+
+    /* Move the plaintext out of the buffer the ciphertext is written to */
+    rec.input_len = rec.length - trailer;
+    if (!TEST_ptr(input = OPENSSL_memdup(rec.data, rec.input_len)))
+        goto err;
+    memset(rec.data, 0, rec.input_len);
+    rec.input = input;
+
+    if (!TEST_true(ossl_tls_record_method.new_record_layer(
+            NULL, NULL, TLS1_3_VERSION, OSSL_RECORD_ROLE_SERVER,
+            OSSL_RECORD_DIRECTION_WRITE,
+            OSSL_RECORD_PROTECTION_LEVEL_APPLICATION, 0, NULL, 0,
+            key, 16, iv, ivlen, NULL, 0, EVP_aes_128_gcm(),
+            EVP_GCM_TLS_TAG_LEN, 0, NULL, NULL, NULL, NULL, NULL,
+            NULL, NULL, NULL, NULL, NULL, NULL,
+            &wrl)))
+        goto err;
+    memcpy(wrl->sequence, seqbuf, sizeof(seqbuf));
+
+    if (!TEST_true(wrl->encrypt_from_template)
+        || !TEST_size_t_eq(wrl->funcs->cipher(wrl, &rec, 1, 1, NULL, 0), 1)
+        || !TEST_ptr_eq(rec.input, rec.data)
+        || !TEST_true(test_record(&rec, recd, 1)))
+        goto err;
+
+    ret = 1;
+err:
+    ossl_tls_record_method.free(wrl);
+    OPENSSL_free(input);
+    OPENSSL_free(rec.data);
+    OPENSSL_free(key);
+    return ret;
+}
+
+/*
+ * Only ciphers that can take the plaintext in more than one update may
+ * encrypt from the caller's buffer.
+ */
+static int test_tls13_encrypt_from_template_mode(int idx)
+{
+    unsigned char key[32] = { 0 };
+    unsigned char iv[12] = { 0 };
+    const char *name;
+    size_t keylen = 16, taglen = EVP_GCM_TLS_TAG_LEN;
+    int expected = 1, ret = 0;
+    EVP_CIPHER *ciph = NULL;
+    OSSL_RECORD_LAYER *wrl = NULL;
+
+    switch (idx) {
+    case 0:
+        name = "AES-128-GCM";
+        break;
+    case 1:
+        name = "AES-128-CCM";
+        taglen = EVP_CCM_TLS_TAG_LEN;
+        expected = 0;
+        break;
+    default:
+#ifdef OPENSSL_NO_CHACHA
+        return TEST_skip("ChaCha20-Poly1305 is disabled");
+#else
+        name = "ChaCha20-Poly1305";
+        keylen = 32;
+        taglen = EVP_CHACHAPOLY_TLS_TAG_LEN;
+        break;
+#endif
+    }
+
+    if (!TEST_ptr(ciph = EVP_CIPHER_fetch(NULL, name, NULL))
+        || !TEST_true(ossl_tls_record_method.new_record_layer(
+            NULL, NULL, TLS1_3_VERSION, OSSL_RECORD_ROLE_SERVER,
+            OSSL_RECORD_DIRECTION_WRITE,
+            OSSL_RECORD_PROTECTION_LEVEL_APPLICATION, 0, NULL, 0,
+            key, keylen, iv, sizeof(iv), NULL, 0, ciph,
+            taglen, 0, NULL, NULL, NULL, NULL, NULL,
+            NULL, NULL, NULL, NULL, NULL, NULL,
+            &wrl))
+        || !TEST_int_eq(wrl->encrypt_from_template, expected))
+        goto err;
+
+    ret = 1;
+err:
+    ossl_tls_record_method.free(wrl);
+    EVP_CIPHER_free(ciph);
+    return ret;
+}
+
 int setup_tests(void)
 {
     ADD_TEST(test_tls13_encryption);
+    ADD_ALL_TESTS(test_tls13_encryption_from_input, OSSL_NELEM(refdata) * 2);
+    ADD_ALL_TESTS(test_tls13_encrypt_from_template_mode, 3);
     return 1;
 }
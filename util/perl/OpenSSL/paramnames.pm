@@ -644,6 +644,10 @@ my %params = (
     'OSSL_LIBSSL_RECORD_LAYER_PARAM_MAX_EARLY_DATA' => "max_early_data",
     'OSSL_LIBSSL_RECORD_LAYER_PARAM_BLOCK_PADDING' =>  "block_padding",
     'OSSL_LIBSSL_RECORD_LAYER_PARAM_HS_PADDING' =>     "hs_padding",
+    'OSSL_LIBSSL_RECORD_LAYER_PARAM_SIZING_LEN' =>     "record_sizing_len",
+    'OSSL_LIBSSL_RECORD_LAYER_PARAM_SIZING_THRESHOLD' => "record_sizing_threshold",
+    'OSSL_LIBSSL_RECORD_LAYER_PARAM_SIZING_IDLE' =>    "record_sizing_idle",
+    'OSSL_LIBSSL_RECORD_LAYER_PARAM_SIZING_SENT' =>    "record_sizing_sent",
 
 # Symmetric Key parameters
     'OSSL_SKEY_PARAM_RAW_BYTES' => "raw-bytes",